@@ -0,0 +1,55 @@
+#pragma once
+/**
+ * @file async_log.h
+ * @brief Log output that never waits for the UART.
+ *
+ * Serial.print() blocks once the UART's TX buffer is full, which at 115200
+ * baud stalls a caller for ~87 us per byte beyond it. AsyncLog is a Print
+ * that copies into a RAM ring instead and returns; drain() moves as much
+ * as the UART accepts without blocking, from loop() or any wait loop. When
+ * the ring is full, writes are dropped and counted rather than waited for.
+ *
+ * The ring also keeps the output already drained, so replay() can print
+ * the last few kB again (the console's "trace" command). drain() copies
+ * them out of the ring after the pending output, without taking room from
+ * new output; replayed bytes that new output overwrites first are skipped.
+ * Writes may come from any task; drain() from one.
+ */
+#include <Arduino.h>
+#include <mutex>
+
+static const size_t ASYNC_LOG_BYTES = 4096;  // power of two
+
+class AsyncLog : public Print {
+public:
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  // All of `data` or nothing: a partial line would be harder to read than none.
+  size_t write(const uint8_t* data, size_t len) override;
+  using Print::write;
+
+  // Writes pending output to `out` as far as out.availableForWrite() allows.
+  size_t drain(Print& out);
+
+  // Queues up to `bytes` of the most recent drained output to be drained
+  // again, after the output pending now.
+  size_t replay(size_t bytes = ASYNC_LOG_BYTES);
+
+  // Copies up to `max` bytes of the most recent output into `out`.
+  size_t history(uint8_t* out, size_t max) const;
+
+  // Bytes drain() has yet to write, replayed ones included.
+  size_t pending() const;
+  unsigned long dropped() const { return _dropped; }
+
+private:
+  mutable std::mutex _lock;
+  char _buf[ASYNC_LOG_BYTES];
+  uint32_t _head = 0;  // total bytes written
+  uint32_t _tail = 0;  // total bytes drained
+  // Replay of [_replayFrom, _replayTo), drained once _tail reaches _replayAt
+  bool _replaying = false;
+  uint32_t _replayAt = 0;
+  uint32_t _replayFrom = 0;
+  uint32_t _replayTo = 0;
+  unsigned long _dropped = 0;
+};
@@ -0,0 +1,78 @@
+#pragma once
+/**
+ * @file async_modem.h
+ * @brief Non-blocking AT commands for CoopTask bodies.
+ *
+ * Only one command can be outstanding on the UART, so a task first takes
+ * the modem, then starts its command on the mux's background slot and
+ * awaits the final result while the other tasks keep running:
+ *
+ *   CO_AT(modem, "AT+CENG?", 3000);
+ *   if (modem.result() == AT_OK) parse(modem.response());
+ *
+ * A sequence that must not be interleaved (a restart, an SMS between its
+ * prompt and its result) holds the modem across several commands:
+ *
+ *   CO_AWAIT(modem.acquire(this));
+ *   CO_AT_HELD(modem, "AT+CMGS=23", 5000, ">");
+ *   modem.write(pdu, len);
+ *   CO_AT_HELD(modem, "", 60000);  // wait for +CMGS / OK
+ *   modem.release(this);
+ *
+ * Code outside the tasks that runs blocking mux commands (socket traffic,
+ * transparent mode) acquires the modem the same way before it starts, with
+ * any unique pointer as owner, so it never cuts a task's command short.
+ * A background network scan holding the slot is the one thing acquire()
+ * aborts; it is retried later.
+ */
+#include <Arduino.h>
+
+#include "coop_task.h"
+#include "sim800_mux.h"
+
+class AsyncModem {
+public:
+  explicit AsyncModem(Sim800Mux& mux) : _mux(mux) {}
+
+  // True once `owner` holds the modem. Use as a CO_AWAIT condition.
+  bool acquire(const void* owner);
+  void release(const void* owner);
+  bool busy() const { return _owner != nullptr; }
+
+  // Starts a command for the owner; response() collects its lines. See
+  // Sim800Mux::startBackground() for `expect` and an empty `cmd`.
+  bool start(const String& cmd, unsigned long timeout, const char* expect = nullptr);
+
+  // True when the started command has finished. Use as a CO_AWAIT condition.
+  bool done();
+
+  // Raw bytes for the owner, e.g. the data after a ">" prompt.
+  void write(const uint8_t* data, size_t len) { _mux.at().writeRaw(data, len); }
+
+  AtResult result() const { return _result; }
+  const String& response() const { return _response; }
+
+private:
+  Sim800Mux& _mux;
+  const void* _owner = nullptr;
+  uint32_t _command = 0;  // mux background command id, 0 if none
+  AtResult _result = AT_TIMEOUT;
+  String _response;
+};
+
+// One AT command while the task already holds the modem:
+// CO_AT_HELD(modem, cmd, timeout[, expect]).
+#define CO_AT_HELD(modem, ...)          \
+  do {                                  \
+    (modem).start(__VA_ARGS__);         \
+    CO_AWAIT((modem).done());           \
+  } while (0)
+
+// One AT command from a CoopTask body: wait for the modem, run, release.
+// CO_AT(modem, cmd, timeout[, expect]).
+#define CO_AT(modem, ...)                     \
+  do {                                        \
+    CO_AWAIT((modem).acquire(this));          \
+    CO_AT_HELD(modem, __VA_ARGS__);           \
+    (modem).release(this);                    \
+  } while (0)
@@ -0,0 +1,275 @@
+#pragma once
+/**
+ * @file at_response.h
+ * @brief Information responses of AT commands, parsed from declarations.
+ *
+ * Each response type is declared once as a constexpr AtResponseSpec: its
+ * prefix and a list of field descriptors (name, type, radix, optional).
+ * parseAtLine() walks the descriptors and the line together in one pass,
+ * without allocating: numbers are converted in place, strings are returned
+ * as ranges into the line. With the spec a compile-time constant, the
+ * compiler inlines the descriptor loop into straight-line code per type.
+ *
+ *   AtValues<2> v;
+ *   if (parseAtResponse(AT_CSQ, resp.c_str(), resp.length(), v)) {
+ *     int rssi = v[AT_FIELD(AT_CSQ, rssi)].num;
+ *   }
+ *
+ * Field types:
+ *   AT_NUM     integer in the given radix, quotes allowed ("1A2B")
+ *   AT_STRING  quoted string, returned without the quotes
+ *   AT_TOKEN   unquoted text up to the next comma, trimmed (STATE: IP INITIAL)
+ *
+ * Optional fields may only be followed by optional fields; a response that
+ * ends early leaves them absent.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum AtFieldType : uint8_t {
+  AT_NUM,
+  AT_STRING,
+  AT_TOKEN,
+};
+
+struct AtField {
+  const char* name;
+  AtFieldType type;
+  uint8_t radix;   // AT_NUM only
+  bool optional;
+};
+
+template <size_t N>
+struct AtResponseSpec {
+  const char* prefix;  // including the colon, e.g. "+CSQ:"
+  AtField fields[N];
+};
+
+struct AtValue {
+  bool present;
+  int32_t num;        // AT_NUM
+  const char* str;    // AT_STRING / AT_TOKEN, not NUL-terminated
+  uint16_t len;
+
+  bool is(const char* s) const { return present && strlen(s) == len && memcmp(str, s, len) == 0; }
+};
+
+template <size_t N>
+struct AtValues {
+  AtValue v[N];
+  const AtValue& operator[](size_t i) const { return v[i]; }
+};
+
+constexpr bool atNameEquals(const char* a, const char* b) {
+  return *a == *b && (*a == '\0' || atNameEquals(a + 1, b + 1));
+}
+
+// Index of field `name`; N if there is none (fails a static_assert when
+// used in a constant expression, see AT_FIELD).
+template <size_t N>
+constexpr size_t atFieldIndex(const AtResponseSpec<N>& spec, const char* name) {
+  for (size_t i = 0; i < N; ++i) {
+    if (atNameEquals(spec.fields[i].name, name)) return i;
+  }
+  return N;
+}
+
+// Compile-time checked field index: AT_FIELD(AT_CSQ, rssi).
+#define AT_FIELD(spec, name)                                                       \
+  ([] {                                                                            \
+    constexpr size_t i = atFieldIndex(spec, #name);                                \
+    static_assert(i < sizeof(spec.fields) / sizeof(spec.fields[0]), "no field " #name); \
+    return i;                                                                      \
+  }())
+
+inline bool atParseNum(const char* b, const char* e, uint8_t radix, int32_t& out) {
+  if (e - b >= 2 && *b == '"' && e[-1] == '"') {
+    ++b;
+    --e;
+  }
+  bool neg = b < e && *b == '-';
+  if (neg) ++b;
+  if (b == e) return false;
+  int32_t v = 0;
+  for (; b < e; ++b) {
+    int d;
+    char c = *b;
+    if (c >= '0' && c <= '9') {
+      d = c - '0';
+    } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') {
+      d = (c | 0x20) - 'a' + 10;
+    } else {
+      return false;
+    }
+    if (d >= radix) return false;
+    v = v * radix + d;
+  }
+  out = neg ? -v : v;
+  return true;
+}
+
+/**
+ * @brief Parses one line (without line ending) against `spec`.
+ * @return false if the prefix differs or a required field is missing or malformed
+ */
+template <size_t N>
+bool parseAtLine(const AtResponseSpec<N>& spec, const char* line, const char* end,
+                 AtValues<N>& out) {
+  const char* p = line;
+  while (p < end && *p == ' ') ++p;
+  const size_t plen = strlen(spec.prefix);
+  if (size_t(end - p) < plen || memcmp(p, spec.prefix, plen) != 0) return false;
+  p += plen;
+
+  bool ended = false;
+  for (size_t i = 0; i < N; ++i) {
+    const AtField& f = spec.fields[i];
+    AtValue& v = out.v[i];
+    v = AtValue();
+    while (p < end && *p == ' ') ++p;
+    if (ended || p == end) {
+      ended = true;
+      if (!f.optional) return false;
+      continue;
+    }
+    // Field extent: a quoted string may contain commas.
+    const char* b = p;
+    const char* e = p;
+    if (*e == '"') {
+      ++e;
+      while (e < end && *e != '"') ++e;
+      if (e == end) return false;
+      ++e;
+    }
+    while (e < end && *e != ',') ++e;
+    p = e < end ? e + 1 : e;
+    if (e == end) ended = true;
+    while (e > b && e[-1] == ' ') --e;
+
+    if (b == e) {
+      if (!f.optional) return false;
+      continue;
+    }
+    switch (f.type) {
+      case AT_NUM:
+        if (!atParseNum(b, e, f.radix, v.num)) return false;
+        break;
+      case AT_STRING:
+        if (e - b < 2 || *b != '"' || e[-1] != '"') return false;
+        v.str = b + 1;
+        v.len = uint16_t(e - b - 2);
+        break;
+      case AT_TOKEN:
+        v.str = b;
+        v.len = uint16_t(e - b);
+        break;
+    }
+    v.present = true;
+  }
+  return true;
+}
+
+// Calls each(const AtValues<N>&) for every line of `text` that matches
+// `spec`, e.g. the per-link lines of AT+CIPSEND?. Returns the match count.
+template <size_t N, typename F>
+size_t parseAtLines(const AtResponseSpec<N>& spec, const char* text, size_t len, F each) {
+  const char* end = text + len;
+  const char* line = text;
+  size_t matches = 0;
+  AtValues<N> values;
+  while (line < end) {
+    const char* eol = line;
+    while (eol < end && *eol != '\n') ++eol;
+    const char* e = eol;
+    if (e > line && e[-1] == '\r') --e;
+    if (parseAtLine(spec, line, e, values)) {
+      matches++;
+      each(values);
+    }
+    line = eol + 1;
+  }
+  return matches;
+}
+
+// Parses the first line of a multi-line response that matches `spec`.
+template <size_t N>
+bool parseAtResponse(const AtResponseSpec<N>& spec, const char* text, size_t len,
+                     AtValues<N>& out) {
+  const char* end = text + len;
+  const char* line = text;
+  while (line < end) {
+    const char* eol = line;
+    while (eol < end && *eol != '\n') ++eol;
+    const char* e = eol;
+    if (e > line && e[-1] == '\r') --e;
+    if (parseAtLine(spec, line, e, out)) return true;
+    line = eol + 1;
+  }
+  return false;
+}
+
+// ---- Response declarations ------------------------------------------------------
+
+// +CREG: <n>,<stat>[,<lac>,<ci>]   (AT+CREG? with AT+CREG=2)
+constexpr AtResponseSpec<4> AT_CREG = {"+CREG:", {
+  {"n", AT_NUM, 10, false},
+  {"stat", AT_NUM, 10, false},
+  {"lac", AT_NUM, 16, true},
+  {"ci", AT_NUM, 16, true},
+}};
+
+// +CSQ: <rssi>,<ber>   rssi 0..31 (dBm = -113 + 2 * rssi), 99 = unknown
+constexpr AtResponseSpec<2> AT_CSQ = {"+CSQ:", {
+  {"rssi", AT_NUM, 10, false},
+  {"ber", AT_NUM, 10, false},
+}};
+
+// +COPS: <mode>[,<format>,<oper>]
+constexpr AtResponseSpec<3> AT_COPS = {"+COPS:", {
+  {"mode", AT_NUM, 10, false},
+  {"format", AT_NUM, 10, true},
+  {"oper", AT_STRING, 0, true},
+}};
+
+// +CMGS: <mr>   message reference of a sent SMS
+constexpr AtResponseSpec<1> AT_CMGS = {"+CMGS:", {
+  {"mr", AT_NUM, 10, false},
+}};
+
+// STATE: <state>   AT+CIPSTATUS, e.g. STATE: IP INITIAL
+constexpr AtResponseSpec<1> AT_CIPSTATUS = {"STATE:", {
+  {"state", AT_TOKEN, 0, false},
+}};
+
+// +CPIN: <code>   READY, SIM PIN, ...
+constexpr AtResponseSpec<1> AT_CPIN = {"+CPIN:", {
+  {"code", AT_TOKEN, 0, false},
+}};
+
+// +CIPSEND: <n>,<size>   AT+CIPSEND? in multi-link mode, one line per link
+constexpr AtResponseSpec<2> AT_CIPSEND = {"+CIPSEND:", {
+  {"link", AT_NUM, 10, false},
+  {"size", AT_NUM, 10, false},
+}};
+
+// +CMTI: <mem>,<index>   URC for a newly stored SMS (AT+CNMI=2,1)
+constexpr AtResponseSpec<2> AT_CMTI = {"+CMTI:", {
+  {"mem", AT_STRING, 0, false},
+  {"index", AT_NUM, 10, false},
+}};
+
+// +CMGR: <stat>,<oa>[,<alpha>,<scts>]   AT+CMGR in text mode; the text follows
+constexpr AtResponseSpec<4> AT_CMGR = {"+CMGR:", {
+  {"stat", AT_STRING, 0, false},
+  {"oa", AT_STRING, 0, false},
+  {"alpha", AT_STRING, 0, true},
+  {"scts", AT_STRING, 0, true},
+}};
+
+// +CMGL: <index>,<stat>,<oa>[,...]   one line per message of AT+CMGL
+constexpr AtResponseSpec<3> AT_CMGL = {"+CMGL:", {
+  {"index", AT_NUM, 10, false},
+  {"stat", AT_STRING, 0, false},
+  {"oa", AT_STRING, 0, false},
+}};
@@ -0,0 +1,124 @@
+#pragma once
+/**
+ * @file cell_fusion.h
+ * @brief Fuses the AT+CENG? answers of one scan window into one observation.
+ *
+ * The modem reports each cell's RxLev from a single measurement, and the
+ * neighbour list of any one answer is often partial. Every answer collected
+ * while retrying for a complete one is added here: the union of all cells,
+ * with a running mean and variance (Welford) of each cell's RxLev. The cell
+ * most often reported as serving cell comes first in the fused snapshot,
+ * the neighbours follow by mean level. Only answers whose serving cell line
+ * was complete (CellSnapshot::servingParsed) vote.
+ *
+ * Answers from the extra scan modems (scan_modem.h) are added without a
+ * serving vote: their serving cell belongs to another operator's network
+ * and must not displace the data modem's own.
+ */
+#include <math.h>
+#include <stdint.h>
+
+#include "cell_record.h"
+
+static const uint8_t CELL_FUSION_MAX = 16;
+
+struct FusedCell {
+  CellRecord cell;       // identity and latest timing advance
+  uint8_t seen = 0;      // answers that reported the cell
+  uint8_t serving = 0;   // answers that reported it as serving cell
+  float rxlevMean = 0;
+  float rxlevM2 = 0;     // sum of squared deviations
+
+  float rxlevVariance() const { return seen > 1 ? rxlevM2 / (seen - 1) : 0; }
+};
+
+class CellFusion {
+public:
+  void reset() {
+    _count = 0;
+    _scans = 0;
+  }
+
+  void add(const CellSnapshot& snap, bool voteServing = true) {
+    if (snap.count == 0) return;
+    _scans++;
+    _timestamp = snap.timestamp;
+    for (uint8_t i = 0; i < snap.count; ++i) {
+      const CellRecord& c = snap.cells[i];
+      FusedCell* f = find(cellKey(c));
+      if (!f) {
+        if (_count == CELL_FUSION_MAX) continue;
+        f = &_cells[_count++];
+        *f = FusedCell();
+      }
+      f->cell = c;
+      f->seen++;
+      if (i == 0 && voteServing && snap.servingParsed) f->serving++;
+      float delta = c.rxlev - f->rxlevMean;
+      f->rxlevMean += delta / f->seen;
+      f->rxlevM2 += delta * (c.rxlev - f->rxlevMean);
+    }
+  }
+
+  uint8_t count() const { return _count; }
+  uint8_t scans() const { return _scans; }
+  const FusedCell& operator[](uint8_t i) const { return _cells[i]; }
+
+  // Index of the cell reported most often as serving cell, -1 if empty.
+  int servingIndex() const {
+    int best = -1;
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (_cells[i].serving > 0 && (best < 0 || _cells[i].serving > _cells[best].serving)) best = i;
+    }
+    return best;
+  }
+
+  // Fused cells as a snapshot with rounded mean RxLev, serving cell first.
+  void toSnapshot(CellSnapshot& snap) const {
+    snap.count = toCells(snap.cells, CELL_SNAPSHOT_MAX);
+    snap.servingParsed = servingIndex() >= 0;
+    snap.timestamp = _timestamp;
+  }
+
+  // Like toSnapshot(), for up to `max` cells (all of them with CELL_FUSION_MAX).
+  uint8_t toCells(CellRecord* out, uint8_t max) const {
+    uint8_t order[CELL_FUSION_MAX];
+    uint8_t n = ordered(order);
+    if (n > max) n = max;
+    for (uint8_t i = 0; i < n; ++i) {
+      const FusedCell& f = _cells[order[i]];
+      out[i] = f.cell;
+      out[i].rxlev = uint8_t(f.rxlevMean + 0.5f);
+    }
+    return n;
+  }
+
+private:
+  FusedCell* find(uint64_t key) {
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (cellKey(_cells[i].cell) == key) return &_cells[i];
+    }
+    return nullptr;
+  }
+
+  uint8_t ordered(uint8_t* order) const {
+    int serving = servingIndex();
+    uint8_t n = 0;
+    if (serving >= 0) order[n++] = uint8_t(serving);
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (i == serving) continue;
+      uint8_t j = n++;
+      while (j > (serving >= 0 ? 1 : 0) && _cells[order[j - 1]].rxlevMean < _cells[i].rxlevMean) {
+        order[j] = order[j - 1];
+        j--;
+      }
+      order[j] = i;
+    }
+    return n;
+  }
+
+  FusedCell _cells[CELL_FUSION_MAX];
+  uint8_t _count = 0;
+  uint8_t _scans = 0;
+  uint32_t _timestamp = 0;
+};
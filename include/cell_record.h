@@ -0,0 +1,43 @@
+#pragma once
+/**
+ * @file cell_record.h
+ * @brief Cell observation types shared by the firmware and the host tools.
+ */
+#include <stdint.h>
+
+static const uint8_t CELL_SNAPSHOT_MAX = 8;  // serving cell + up to 7 neighbours
+static const uint8_t CELL_TA_UNKNOWN = 0xFF;
+
+// One cell as reported by AT+CENG. LAC and CID are stored as numbers; the
+// modem prints them in hex.
+struct CellRecord {
+  uint16_t mcc = 0;
+  uint16_t mnc = 0;
+  uint16_t lac = 0;
+  uint32_t cid = 0;
+  uint8_t rxlev = 0;             // 0..63, dBm = -113 + 2 * rxlev
+  uint8_t ta = CELL_TA_UNKNOWN;  // timing advance, ~550 m per unit
+};
+
+inline int rxlevToDbm(uint8_t rxlev) {
+  return -113 + 2 * rxlev;
+}
+
+// (MCC, MNC, LAC, CID) packed into one sortable key.
+inline uint64_t cellKey(uint16_t mcc, uint16_t mnc, uint16_t lac, uint32_t cid) {
+  return (uint64_t(mcc) << 54) | (uint64_t(mnc & 0x3FF) << 44) | (uint64_t(lac) << 28) |
+         (cid & 0x0FFFFFFF);
+}
+
+inline uint64_t cellKey(const CellRecord& c) {
+  return cellKey(c.mcc, c.mnc, c.lac, c.cid);
+}
+
+// All cells of one AT+CENG? answer. Parsers drop incomplete lines and
+// compact the rest, so cells[0] is the serving cell only if servingParsed.
+struct CellSnapshot {
+  CellRecord cells[CELL_SNAPSHOT_MAX];
+  uint8_t count = 0;
+  bool servingParsed = false;  // the serving cell line (CENG index 0) was complete
+  uint32_t timestamp = 0;  // seconds
+};
@@ -0,0 +1,139 @@
+#pragma once
+/**
+ * @file cell_table.h
+ * @brief Cells heard recently, from any operator, with a staleness model.
+ *
+ * AT+CENG only lists the registered operator's cells. The background network
+ * scan (net_scanner.h) adds the other operators' towers, which improve the
+ * geometry of a fix, but it runs minutes apart from the fix it serves. Each
+ * entry therefore keeps when it was heard and its anchor: the strongest cell
+ * of the registered operator in the same scan. An entry is only offered for
+ * a fix if
+ *
+ *   - it is younger than CELL_TABLE_MAX_AGE_S, and
+ *   - its anchor is among the cells of the current AT+CENG observation, i.e.
+ *     the device is still where the scan was taken.
+ *
+ * Candidates are ranked by RxLev less one level per CELL_TABLE_DECAY_S of
+ * age. When the table is full the oldest entry is replaced.
+ */
+#include <stdint.h>
+
+#include "cell_record.h"
+
+static const uint8_t CELL_TABLE_MAX = 32;
+static const uint32_t CELL_TABLE_MAX_AGE_S = 30 * 60;
+static const uint32_t CELL_TABLE_DECAY_S = 60;
+
+enum CellSource : uint8_t {
+  CELL_SOURCE_CENG,
+  CELL_SOURCE_NETSCAN,
+};
+
+struct CellTableEntry {
+  CellRecord cell;
+  uint32_t seen = 0;    // seconds
+  uint64_t anchor = 0;  // cellKey() of the scan's strongest registered-operator cell
+  uint8_t source = CELL_SOURCE_CENG;
+};
+
+class CellTable {
+public:
+  void clear() { _count = 0; }
+
+  /**
+   * @brief Records the cells of one scan.
+   *
+   * The anchor is the strongest cell of PLMN (homeMcc, homeMnc); without one
+   * the cells are still stored but never selected.
+   */
+  void observe(const CellRecord* cells, uint8_t n, uint32_t now, uint16_t homeMcc,
+               uint16_t homeMnc, CellSource source) {
+    uint64_t anchor = 0;
+    int best = -1;
+    for (uint8_t i = 0; i < n; ++i) {
+      if (cells[i].mcc == homeMcc && cells[i].mnc == homeMnc &&
+          (best < 0 || cells[i].rxlev > cells[best].rxlev)) {
+        best = i;
+      }
+    }
+    if (best >= 0) anchor = cellKey(cells[best]);
+    for (uint8_t i = 0; i < n; ++i) {
+      CellTableEntry* e = find(cellKey(cells[i]));
+      if (!e) e = _count < CELL_TABLE_MAX ? &_entries[_count++] : oldest();
+      e->cell = cells[i];
+      e->seen = now;
+      e->anchor = anchor;
+      e->source = source;
+    }
+  }
+
+  // Drops entries older than CELL_TABLE_MAX_AGE_S.
+  void expire(uint32_t now) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (now - _entries[i].seen <= CELL_TABLE_MAX_AGE_S) _entries[n++] = _entries[i];
+    }
+    _count = n;
+  }
+
+  /**
+   * @brief Picks fresh cells that the current observation does not contain.
+   * @return number of cells written to `out`, best first
+   */
+  uint8_t select(const CellRecord* current, uint8_t currentCount, uint32_t now, CellRecord* out,
+                 uint8_t max) const {
+    auto inCurrent = [&](uint64_t key) {
+      for (uint8_t i = 0; i < currentCount; ++i) {
+        if (cellKey(current[i]) == key) return true;
+      }
+      return false;
+    };
+
+    uint8_t idx[CELL_TABLE_MAX];
+    int score[CELL_TABLE_MAX];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < _count; ++i) {
+      const CellTableEntry& e = _entries[i];
+      const uint32_t age = now - e.seen;
+      if (age > CELL_TABLE_MAX_AGE_S || e.anchor == 0 || !inCurrent(e.anchor) ||
+          inCurrent(cellKey(e.cell))) {
+        continue;
+      }
+      const int s = int(e.cell.rxlev) - int(age / CELL_TABLE_DECAY_S);
+      uint8_t j = n++;
+      while (j > 0 && score[j - 1] < s) {
+        idx[j] = idx[j - 1];
+        score[j] = score[j - 1];
+        j--;
+      }
+      idx[j] = i;
+      score[j] = s;
+    }
+    if (n > max) n = max;
+    for (uint8_t i = 0; i < n; ++i) out[i] = _entries[idx[i]].cell;
+    return n;
+  }
+
+  uint8_t count() const { return _count; }
+  const CellTableEntry& operator[](uint8_t i) const { return _entries[i]; }
+
+private:
+  CellTableEntry* find(uint64_t key) {
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (cellKey(_entries[i].cell) == key) return &_entries[i];
+    }
+    return nullptr;
+  }
+
+  CellTableEntry* oldest() {
+    CellTableEntry* o = &_entries[0];
+    for (uint8_t i = 1; i < _count; ++i) {
+      if (_entries[i].seen < o->seen) o = &_entries[i];
+    }
+    return o;
+  }
+
+  CellTableEntry _entries[CELL_TABLE_MAX];
+  uint8_t _count = 0;
+};
@@ -0,0 +1,156 @@
+#pragma once
+/**
+ * @file cell_zone.h
+ * @brief Geofences defined by the cells that cover a site.
+ *
+ * A cell zone is a set of (MCC, MNC, LAC, CID) with an optional minimum
+ * RxLev per cell. Zones are evaluated directly against an AT+CENG snapshot,
+ * so no position fix is needed. All cells of all zones are kept in one array
+ * sorted by cellKey(); each observed cell is a binary search, and a cell may
+ * belong to several zones.
+ *
+ * A zone is entered as soon as one of its cells is heard at or above its
+ * threshold, and left after CELL_ZONE_EXIT_SCANS scans in a row without any,
+ * since neighbour cells routinely drop out of single answers. The first scan
+ * only establishes the state.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "cell_record.h"
+
+static const uint8_t CELL_ZONE_MAX = 32;
+static const uint8_t CELL_ZONE_EXIT_SCANS = 2;
+
+struct CellZone {
+  uint16_t id;
+  const char* name;
+};
+
+struct CellZoneCell {
+  uint16_t zone;     // CellZone::id
+  uint64_t key;      // cellKey(mcc, mnc, lac, cid)
+  uint8_t minRxlev;  // 0: any level
+};
+
+struct CellZoneEvent {
+  const CellZone* zone;
+  bool entered;       // false: left
+  uint64_t key;       // matching cell when entered
+  uint8_t rxlev;
+};
+
+class CellZoneSet {
+public:
+  typedef void (*Handler)(const CellZoneEvent& event, void* ctx);
+
+  ~CellZoneSet() { delete[] _cells; }
+
+  // Copies and sorts the cell list. Cells of unknown zones are dropped.
+  bool begin(const CellZone* zones, uint8_t zoneCount, const CellZoneCell* cells, size_t cellCount) {
+    delete[] _cells;
+    _cells = nullptr;
+    _cellCount = 0;
+    _zoneCount = zoneCount < CELL_ZONE_MAX ? zoneCount : CELL_ZONE_MAX;
+    for (uint8_t i = 0; i < _zoneCount; ++i) {
+      _zones[i].def = &zones[i];
+      _zones[i].state = STATE_UNKNOWN;
+      _zones[i].misses = 0;
+    }
+    _cells = new Entry[cellCount];
+    for (size_t i = 0; i < cellCount; ++i) {
+      int z = zoneIndex(cells[i].zone);
+      if (z < 0) continue;
+      _cells[_cellCount].key = cells[i].key;
+      _cells[_cellCount].zone = uint8_t(z);
+      _cells[_cellCount].minRxlev = cells[i].minRxlev;
+      _cellCount++;
+    }
+    std::sort(_cells, _cells + _cellCount, [](const Entry& a, const Entry& b) { return a.key < b.key; });
+    return _cellCount > 0;
+  }
+
+  void setHandler(Handler handler, void* ctx) {
+    _handler = handler;
+    _ctx = ctx;
+  }
+
+  uint8_t zones() const { return _zoneCount; }
+  bool inside(uint8_t i) const { return i < _zoneCount && _zones[i].state == STATE_INSIDE; }
+
+  /**
+   * @brief Updates all zones from one scan and reports transitions.
+   * @return number of events reported; an empty snapshot changes nothing
+   */
+  uint8_t evaluate(const CellSnapshot& snap) {
+    if (snap.count == 0 || _cellCount == 0) return 0;
+    uint32_t matched = 0;
+    uint64_t matchKey[CELL_ZONE_MAX];
+    uint8_t matchRxlev[CELL_ZONE_MAX];
+    for (uint8_t i = 0; i < snap.count; ++i) {
+      const CellRecord& c = snap.cells[i];
+      const uint64_t key = cellKey(c);
+      const Entry* e = std::lower_bound(_cells, _cells + _cellCount, key,
+                                        [](const Entry& a, uint64_t k) { return a.key < k; });
+      for (; e != _cells + _cellCount && e->key == key; ++e) {
+        if (c.rxlev < e->minRxlev || (matched & (uint32_t(1) << e->zone))) continue;
+        matched |= uint32_t(1) << e->zone;
+        matchKey[e->zone] = key;
+        matchRxlev[e->zone] = c.rxlev;
+      }
+    }
+
+    uint8_t events = 0;
+    for (uint8_t z = 0; z < _zoneCount; ++z) {
+      ZoneState& s = _zones[z];
+      const uint8_t prev = s.state;
+      if (matched & (uint32_t(1) << z)) {
+        s.misses = 0;
+        s.state = STATE_INSIDE;
+      } else if (s.state != STATE_INSIDE || ++s.misses >= CELL_ZONE_EXIT_SCANS) {
+        s.state = STATE_OUTSIDE;
+      }
+      if (prev == STATE_UNKNOWN || prev == s.state) continue;
+      events++;
+      if (!_handler) continue;
+      CellZoneEvent ev;
+      ev.zone = s.def;
+      ev.entered = s.state == STATE_INSIDE;
+      ev.key = ev.entered ? matchKey[z] : 0;
+      ev.rxlev = ev.entered ? matchRxlev[z] : 0;
+      _handler(ev, _ctx);
+    }
+    return events;
+  }
+
+private:
+  enum : uint8_t { STATE_UNKNOWN, STATE_OUTSIDE, STATE_INSIDE };
+
+  struct Entry {
+    uint64_t key;
+    uint8_t zone;  // index into _zones
+    uint8_t minRxlev;
+  };
+
+  struct ZoneState {
+    const CellZone* def;
+    uint8_t state;
+    uint8_t misses;
+  };
+
+  int zoneIndex(uint16_t id) const {
+    for (uint8_t i = 0; i < _zoneCount; ++i) {
+      if (_zones[i].def->id == id) return i;
+    }
+    return -1;
+  }
+
+  Entry* _cells = nullptr;
+  size_t _cellCount = 0;
+  ZoneState _zones[CELL_ZONE_MAX];
+  uint8_t _zoneCount = 0;
+  Handler _handler = nullptr;
+  void* _ctx = nullptr;
+};
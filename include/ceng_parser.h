@@ -0,0 +1,141 @@
+#pragma once
+/**
+ * @file ceng_parser.h
+ * @brief Allocation-free parser for SIM800L AT+CENG? cell lines.
+ *
+ * Works on plain character ranges so the same code parses live modem output
+ * on the device and raw serial captures on the host. Cell lines look like
+ *
+ *   +CENG: <idx>,"<mcc>,<mnc>,<lac>,<cid>,<rxlev>,<ta>"
+ *
+ * with LAC and CID in hex. A cell whose MCC, MNC, LAC or CID is empty,
+ * "0000" or "ffff" is incomplete.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cell_record.h"
+
+enum CengLineResult {
+  CENG_NOT_CELL,    // not a "+CENG:" line with a quoted cell section
+  CENG_INCOMPLETE,  // cell line with a missing or placeholder identifier
+  CENG_OK,
+};
+
+// Parses one field; returns false if it is empty or a 0000/ffff placeholder.
+inline bool parseCengField(const char* b, const char* e, int base, uint32_t& out) {
+  while (b < e && *b == ' ') ++b;
+  while (e > b && e[-1] == ' ') --e;
+  if (b == e) return false;
+  size_t len = size_t(e - b);
+  bool zeros = len == 4, fs = len == 4;
+  uint32_t v = 0;
+  for (const char* p = b; p < e; ++p) {
+    char c = *p;
+    int d;
+    if (c >= '0' && c <= '9') {
+      d = c - '0';
+    } else if (base == 16 && ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')) {
+      d = (c | 0x20) - 'a' + 10;
+    } else {
+      return false;
+    }
+    if (d >= base) return false;
+    zeros = zeros && c == '0';
+    fs = fs && (c | 0x20) == 'f';
+    v = v * base + d;
+  }
+  out = v;
+  return !(zeros || fs);
+}
+
+/**
+ * @brief Parses one line (without line ending) of an AT+CENG? response.
+ *
+ * @param index  receives the cell index after "+CENG:"
+ * @param rec    receives the cell on CENG_OK
+ */
+inline CengLineResult parseCengLine(const char* line, const char* end, int& index, CellRecord& rec) {
+  static const char prefix[] = "+CENG:";
+  const char* p = line;
+  while (p < end && (*p == ' ' || *p == '\r')) ++p;
+  for (size_t i = 0; i < sizeof(prefix) - 1; ++i, ++p) {
+    if (p >= end || *p != prefix[i]) return CENG_NOT_CELL;
+  }
+  while (p < end && *p == ' ') ++p;
+  int idx = 0;
+  const char* digits = p;
+  while (p < end && *p >= '0' && *p <= '9') idx = idx * 10 + (*p++ - '0');
+  if (p == digits || p >= end || *p != ',') return CENG_NOT_CELL;
+  ++p;
+  if (p >= end || *p != '"') return CENG_NOT_CELL;  // header line, e.g. +CENG: 3,1
+  const char* q1 = ++p;
+  const char* q2 = q1;
+  while (q2 < end && *q2 != '"') ++q2;
+  if (q2 >= end) return CENG_NOT_CELL;
+  index = idx;
+
+  // Split the quoted section into at most six comma separated fields.
+  const char* fb[6];
+  const char* fe[6];
+  int n = 0;
+  const char* s = q1;
+  for (const char* c = q1; c <= q2 && n < 6; ++c) {
+    if (c == q2 || *c == ',') {
+      fb[n] = s;
+      fe[n] = c;
+      ++n;
+      s = c + 1;
+    }
+  }
+  if (n < 4) return CENG_INCOMPLETE;
+
+  uint32_t mcc, mnc, lac, cid;
+  if (!parseCengField(fb[0], fe[0], 10, mcc) || !parseCengField(fb[1], fe[1], 10, mnc) ||
+      !parseCengField(fb[2], fe[2], 16, lac) || !parseCengField(fb[3], fe[3], 16, cid)) {
+    return CENG_INCOMPLETE;
+  }
+  rec = CellRecord();
+  rec.mcc = uint16_t(mcc);
+  rec.mnc = uint16_t(mnc);
+  rec.lac = uint16_t(lac);
+  rec.cid = cid;
+  uint32_t v;
+  if (n > 4 && parseCengField(fb[4], fe[4], 10, v)) rec.rxlev = uint8_t(v > 63 ? 63 : v);
+  if (n > 5 && parseCengField(fb[5], fe[5], 10, v)) rec.ta = uint8_t(v > 254 ? 254 : v);
+  return CENG_OK;
+}
+
+/**
+ * @brief Parses a complete AT+CENG? response into a snapshot.
+ *
+ * Cells are stored in index order; an incomplete cell is skipped and clears
+ * `complete`. If the serving cell is skipped, cells[0] is a neighbour and
+ * snap.servingParsed is false. Returns true if at least one cell was parsed.
+ */
+inline bool parseCengResponse(const char* text, size_t len, CellSnapshot& snap, bool& complete) {
+  snap.count = 0;
+  complete = true;
+  bool slot[CELL_SNAPSHOT_MAX] = {false};
+  CellRecord cells[CELL_SNAPSHOT_MAX];
+  const char* end = text + len;
+  const char* line = text;
+  while (line < end) {
+    const char* eol = line;
+    while (eol < end && *eol != '\n') ++eol;
+    int index = 0;
+    CellRecord rec;
+    CengLineResult r = parseCengLine(line, eol, index, rec);
+    if (r == CENG_INCOMPLETE) complete = false;
+    if (r == CENG_OK && index >= 0 && index < CELL_SNAPSHOT_MAX) {
+      cells[index] = rec;
+      slot[index] = true;
+    }
+    line = eol + 1;
+  }
+  for (uint8_t i = 0; i < CELL_SNAPSHOT_MAX; ++i) {
+    if (slot[i]) snap.cells[snap.count++] = cells[i];
+  }
+  snap.servingParsed = slot[0];
+  return snap.count > 0;
+}
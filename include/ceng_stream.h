@@ -0,0 +1,245 @@
+#pragma once
+/**
+ * @file ceng_stream.h
+ * @brief Push parser for AT+CENG? answers, fed one byte at a time.
+ *
+ * parseCengResponse() needs the whole answer. CengStream instead consumes
+ * bytes as the UART delivers them and keeps no line buffer: each cell is
+ * decoded field by field while it arrives, and is reported the moment its
+ * line ends. The final result code ends the answer, so the caller can stop
+ * reading at once instead of waiting out a timeout, and the verdict is
+ * already known.
+ *
+ * The cell rules are those of parseCengLine(): fields are trimmed, and a
+ * cell whose MCC, MNC, LAC or CID is empty, "0000" or "ffff" is incomplete.
+ * Other lines (echo, the "+CENG: 3,1" header, URCs) are skipped.
+ */
+#include <stdint.h>
+
+#include "cell_record.h"
+
+enum CengStreamEvent : uint8_t {
+  CENG_STREAM_NONE,
+  CENG_STREAM_CELL,  // a complete cell line ended: see cell(), index()
+  CENG_STREAM_DONE,  // final OK / ERROR: see ok(), complete()
+};
+
+class CengStream {
+public:
+  CengStream() { reset(); }
+
+  void reset() {
+    _state = S_LINE_START;
+    _headLen = 0;
+    _ok = false;
+    _done = false;
+    _incomplete = false;
+    _cells = 0;
+    for (bool& s : _slot) s = false;
+  }
+
+  CengStreamEvent push(char c) {
+    if (_done) return CENG_STREAM_NONE;
+    if (c == '\n' || c == '\r') return endLine();
+
+    switch (_state) {
+      case S_LINE_START:
+        if (c == ' ') break;
+        _state = S_HEAD;
+        // fall through
+      case S_HEAD:
+        if (_headLen < sizeof(_head)) _head[_headLen++] = c;
+        if (_headLen == 6 && matchHead("+CENG:")) {
+          _state = S_INDEX_SPACE;
+          _index = 0;
+          _indexDigits = 0;
+        }
+        break;
+      case S_INDEX_SPACE:
+        if (c == ' ') break;
+        _state = S_INDEX;
+        // fall through
+      case S_INDEX:
+        if (c >= '0' && c <= '9' && _indexDigits < 3) {
+          _index = _index * 10 + (c - '0');
+          _indexDigits++;
+        } else if (c == ',' && _indexDigits > 0) {
+          _state = S_QUOTE;
+        } else {
+          _state = S_SKIP;
+        }
+        break;
+      case S_QUOTE:
+        // Without a quote this is the header line, e.g. +CENG: 3,1
+        if (c == '"') {
+          _state = S_FIELD;
+          _field = 0;
+          beginField();
+        } else {
+          _state = S_SKIP;
+        }
+        break;
+      case S_FIELD:
+        if (c == ',' || c == '"') {
+          endField();
+          if (c == '"') {
+            _state = S_CELL_END;
+          } else if (++_field == 6) {
+            _state = S_CLOSE_QUOTE;
+          } else {
+            beginField();
+          }
+        } else {
+          fieldChar(c);
+        }
+        break;
+      case S_CLOSE_QUOTE:
+        // Fields past the sixth are ignored, but the quote must close
+        if (c == '"') _state = S_CELL_END;
+        break;
+      case S_CELL_END:
+      case S_SKIP:
+        break;
+    }
+    return CENG_STREAM_NONE;
+  }
+
+  // Last reported cell and its index (0 = serving cell).
+  const CellRecord& cell() const { return _cell; }
+  int index() const { return _index; }
+
+  bool done() const { return _done; }
+  // The answer ended with OK (not ERROR).
+  bool ok() const { return _ok; }
+  // OK, at least one cell, and no incomplete cell line.
+  bool complete() const { return _ok && _cells > 0 && !_incomplete; }
+
+  // Cells received so far, in index order; see CellSnapshot::servingParsed.
+  void snapshot(CellSnapshot& snap) const {
+    snap.count = 0;
+    for (uint8_t i = 0; i < CELL_SNAPSHOT_MAX; ++i) {
+      if (_slot[i]) snap.cells[snap.count++] = _slotCells[i];
+    }
+    snap.servingParsed = _slot[0];
+  }
+
+private:
+  enum State : uint8_t {
+    S_LINE_START,
+    S_HEAD,         // collecting the first characters of a line
+    S_INDEX_SPACE,
+    S_INDEX,
+    S_QUOTE,
+    S_FIELD,
+    S_CLOSE_QUOTE,  // six fields read, waiting for the closing quote
+    S_CELL_END,     // after the quoted section
+    S_SKIP,         // rest of a line that is not a cell
+  };
+
+  bool matchHead(const char* s) const {
+    uint8_t i = 0;
+    for (; s[i]; ++i) {
+      if (i >= _headLen || _head[i] != s[i]) return false;
+    }
+    return true;
+  }
+
+  CengStreamEvent endLine() {
+    CengStreamEvent ev = CENG_STREAM_NONE;
+    if (_state == S_HEAD) {
+      if (_headLen == 2 && matchHead("OK")) {
+        _ok = true;
+        _done = true;
+      } else if ((_headLen == 5 && matchHead("ERROR")) || matchHead("+CME ERROR")) {
+        _done = true;
+      }
+      if (_done) ev = CENG_STREAM_DONE;
+    } else if (_state == S_CELL_END) {
+      // A line cut inside the quotes is not a cell line, as in parseCengLine()
+      ev = finishCell();
+    }
+    _state = S_LINE_START;
+    _headLen = 0;
+    return ev;
+  }
+
+  void beginField() {
+    _value = 0;
+    _digits = 0;
+    _allZero = true;
+    _allF = true;
+    _bad = false;
+    _trailing = false;
+  }
+
+  void fieldChar(char c) {
+    if (c == ' ') {
+      if (_digits > 0) _trailing = true;
+      return;
+    }
+    const uint8_t base = (_field == 2 || _field == 3) ? 16 : 10;
+    int d;
+    if (c >= '0' && c <= '9') {
+      d = c - '0';
+    } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+      d = (c | 0x20) - 'a' + 10;
+    } else {
+      d = 99;
+    }
+    if (_trailing || d >= base) _bad = true;
+    _allZero = _allZero && c == '0';
+    _allF = _allF && (c | 0x20) == 'f';
+    _value = _value * base + uint32_t(d < base ? d : 0);
+    _digits++;
+  }
+
+  // Stores the field; a bad MCC/MNC/LAC/CID marks the cell incomplete.
+  void endField() {
+    const bool valid = _digits > 0 && !_bad && !(_digits == 4 && (_allZero || _allF));
+    if (_field == 0) {
+      _cell = CellRecord();
+      _cellOk = true;
+    }
+    switch (_field) {
+      case 0: _cell.mcc = uint16_t(_value); break;
+      case 1: _cell.mnc = uint16_t(_value); break;
+      case 2: _cell.lac = uint16_t(_value); break;
+      case 3: _cell.cid = _value; break;
+      case 4: if (valid) _cell.rxlev = uint8_t(_value > 63 ? 63 : _value); break;
+      case 5: if (valid) _cell.ta = uint8_t(_value > 254 ? 254 : _value); break;
+    }
+    if (_field < 4 && !valid) _cellOk = false;
+  }
+
+  CengStreamEvent finishCell() {
+    // Fewer than four fields: MCC, MNC, LAC or CID is missing
+    if (_field < 3 || !_cellOk) {
+      _incomplete = true;
+      return CENG_STREAM_NONE;
+    }
+    if (_index < CELL_SNAPSHOT_MAX) {
+      if (!_slot[_index]) _cells++;
+      _slot[_index] = true;
+      _slotCells[_index] = _cell;
+    }
+    return CENG_STREAM_CELL;
+  }
+
+  State _state;
+  char _head[10];
+  uint8_t _headLen;
+  bool _ok, _done, _incomplete;
+
+  int _index;
+  uint8_t _indexDigits;
+  uint8_t _field;
+  uint32_t _value;
+  uint8_t _digits;
+  bool _allZero, _allF, _bad, _trailing;
+  CellRecord _cell;
+  bool _cellOk;
+
+  bool _slot[CELL_SNAPSHOT_MAX];
+  CellRecord _slotCells[CELL_SNAPSHOT_MAX];
+  uint8_t _cells;
+};
@@ -0,0 +1,57 @@
+#pragma once
+/**
+ * @file console.h
+ * @brief Serial command console with line editing and a command registry.
+ *
+ * poll() consumes whatever bytes have arrived and returns at once, so the
+ * console can sit in loop() next to modem work. Input is edited in a fixed
+ * line buffer (no String): backspace/DEL deletes, Ctrl-U clears the line,
+ * Ctrl-C discards it, CR or LF runs it. A line is split on spaces into at
+ * most CONSOLE_MAX_ARGS words and dispatched to the command whose name
+ * matches the first word (case-insensitive); "help" lists the commands.
+ *
+ * Echo, prompts and the handlers' output go to the Print given to the
+ * constructor, usually an AsyncLog.
+ */
+#include <Arduino.h>
+
+static const uint8_t CONSOLE_LINE_MAX = 96;
+static const uint8_t CONSOLE_MAX_ARGS = 6;
+static const uint8_t CONSOLE_MAX_COMMANDS = 16;
+static const uint8_t CONSOLE_POLL_BYTES = 64;  // per poll(), to bound its time
+
+// argv[0] is the command name.
+typedef void (*ConsoleHandler)(int argc, char** argv, void* ctx);
+
+struct ConsoleCommand {
+  const char* name;
+  const char* help;
+  ConsoleHandler handler;
+  void* ctx;
+};
+
+class Console {
+public:
+  explicit Console(Print& out) : _out(out) {}
+
+  // False if the registry is full.
+  bool add(const char* name, const char* help, ConsoleHandler handler, void* ctx = nullptr);
+
+  // Handles the bytes available on `in`. Call from loop().
+  void poll(Stream& in);
+  // Handles one input byte, for callers that read the port themselves.
+  void push(char c);
+
+  void prompt();
+
+private:
+  void execute();
+  void help();
+
+  Print& _out;
+  char _line[CONSOLE_LINE_MAX + 1];
+  uint8_t _len = 0;
+  char _lastEnd = 0;  // CR or LF that ended the previous line
+  ConsoleCommand _commands[CONSOLE_MAX_COMMANDS];
+  uint8_t _count = 0;
+};
@@ -0,0 +1,184 @@
+#pragma once
+/**
+ * @file coop_task.h
+ * @brief Stackless cooperative tasks for modem flows on the loop task.
+ *
+ * A CoopTask body is written top to bottom and suspends at CO_AWAIT /
+ * CO_SLEEP / CO_YIELD; step() resumes it where it left off. The resume
+ * point is a switch label (the protothread technique), so a suspended task
+ * costs two words and no stack, and any number of flows interleave on one
+ * FreeRTOS task. The toolchain (GCC 8) has no C++20 coroutines.
+ *
+ * A body runs another task's body to completion with CO_RUN(child), so a
+ * flow is split into parts (scan, connect, send) that read top to bottom,
+ * and CO_EXIT() leaves it early, like a return.
+ *
+ * Rules of the body, as with any protothread:
+ *   - locals do not survive a suspension: keep state in members;
+ *   - no CO_* macro inside a nested switch;
+ *   - the body is enclosed in CO_BEGIN() ... CO_END().
+ *
+ *   class Blink : public CoopTask {
+ *     CoStatus step() override {
+ *       CO_BEGIN();
+ *       for (;;) {
+ *         digitalWrite(LED, HIGH);
+ *         CO_SLEEP(100);
+ *         digitalWrite(LED, LOW);
+ *         CO_SLEEP(900);
+ *       }
+ *       CO_END();
+ *     }
+ *   };
+ */
+#include <Arduino.h>
+
+static const uint8_t COOP_MAX_TASKS = 8;
+
+enum CoStatus : uint8_t {
+  CO_WAITING,  // suspended, call step() again
+  CO_DONE,     // body finished; the next step() starts it over
+};
+
+class CoopTask {
+public:
+  virtual ~CoopTask() {}
+
+  // Runs the body up to its next suspension point.
+  virtual CoStatus step() = 0;
+
+  // Makes the next step() start the body from the top.
+  void restart() { _co = 0; }
+  bool running() const { return _co != 0; }
+
+protected:
+  uint16_t _co = 0;             // resume point, 0 = start
+  unsigned long _coTimer = 0;   // CO_SLEEP start
+};
+
+#define CO_BEGIN() switch (_co) { case 0:
+
+// `id` must be unique in the translation unit; CO_AWAIT() takes it from __COUNTER__.
+#define CO_AWAIT_ID(id, cond) \
+  do {                        \
+    _co = (id);               \
+    /* fall through */        \
+    case (id):                \
+      if (!(cond)) return CO_WAITING; \
+  } while (0)
+
+#define CO_AWAIT(cond) CO_AWAIT_ID(__COUNTER__ + 1, cond)
+
+#define CO_YIELD_ID(id) \
+  do {                  \
+    _co = (id);         \
+    return CO_WAITING;  \
+    case (id):;         \
+  } while (0)
+
+#define CO_YIELD() CO_YIELD_ID(__COUNTER__ + 1)
+
+#define CO_SLEEP(ms)                              \
+  do {                                            \
+    _coTimer = millis();                          \
+    CO_AWAIT(millis() - _coTimer >= (unsigned long)(ms)); \
+  } while (0)
+
+#define CO_END() \
+  }              \
+  _co = 0;       \
+  return CO_DONE
+
+// Ends the body early, like a return; the next step() starts it over.
+#define CO_EXIT()     \
+  do {                \
+    _co = 0;          \
+    return CO_DONE;   \
+  } while (0)
+
+// Runs another task's body to completion as one step of this one, e.g. a
+// CoopSubtask shared by several flows.
+#define CO_RUN(child)                         \
+  do {                                        \
+    (child).restart();                        \
+    CO_AWAIT((child).step() == CO_DONE);      \
+  } while (0)
+
+// A CoopTask run by other tasks with CO_RUN() rather than by the scheduler.
+// It keeps state between runs (a fused scan, an SMS being sent), so one
+// caller at a time claims it, the same way AsyncModem is acquired:
+//
+//   CO_AWAIT(sender.claim(this));
+//   sender.prepare(...);
+//   CO_RUN(sender);
+//   ... read its results ...
+//   sender.release(this);
+class CoopSubtask : public CoopTask {
+public:
+  // True once `caller` holds the subtask. Use as a CO_AWAIT condition.
+  bool claim(const void* caller) {
+    if (_caller && _caller != caller) return false;
+    _caller = caller;
+    return true;
+  }
+
+  void release(const void* caller) {
+    if (_caller == caller) _caller = nullptr;
+  }
+
+  bool claimed() const { return _caller != nullptr; }
+
+private:
+  const void* _caller = nullptr;
+};
+
+// Round-robin over a fixed set of tasks. Finished tasks are removed unless
+// they were added as repeating.
+class CoopScheduler {
+public:
+  bool add(CoopTask* task, bool repeat = false) {
+    if (_count == COOP_MAX_TASKS) return false;
+    task->restart();
+    _tasks[_count] = task;
+    _repeat[_count] = repeat;
+    _count++;
+    return true;
+  }
+
+  void remove(CoopTask* task) {
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (_tasks[i] != task) continue;
+      for (uint8_t j = i + 1; j < _count; ++j) {
+        _tasks[j - 1] = _tasks[j];
+        _repeat[j - 1] = _repeat[j];
+      }
+      _count--;
+      return;
+    }
+  }
+
+  bool contains(const CoopTask* task) const {
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (_tasks[i] == task) return true;
+    }
+    return false;
+  }
+
+  // Steps every task once. Call from loop().
+  void runOnce() {
+    for (uint8_t i = 0; i < _count;) {
+      if (_tasks[i]->step() == CO_DONE && !_repeat[i]) {
+        remove(_tasks[i]);
+        continue;
+      }
+      ++i;
+    }
+  }
+
+  uint8_t count() const { return _count; }
+
+private:
+  CoopTask* _tasks[COOP_MAX_TASKS];
+  bool _repeat[COOP_MAX_TASKS];
+  uint8_t _count = 0;
+};
@@ -0,0 +1,143 @@
+#pragma once
+/**
+ * @file cpsi_parser.h
+ * @brief Allocation-free parser for SIM7600 / A7670 AT+CPSI? answers.
+ *
+ * LTE modules report the serving cell only, in a format that depends on the
+ * radio access technology:
+ *
+ *   +CPSI: GSM,Online,222-10,0x1a2b,15437,60 EGSM 900,-71,0,38-38
+ *   +CPSI: WCDMA,Online,222-10,0x1a2b,123456789,WCDMA IMT 2000,10700,...,-85,...
+ *   +CPSI: LTE,Online,222-10,0x1a2b,46271491,251,EUTRAN-BAND3,1300,5,5,-94,-850,-536,13
+ *
+ * The area code (LAC or TAC) is hex with a 0x prefix, the cell identity is
+ * decimal (the 28-bit E-UTRAN cell identity on LTE). The level is mapped to
+ * the RxLev scale of CellRecord: GSM reports it in dBm, LTE reports RSRP in
+ * tenths of a dB. "NO SERVICE" and offline answers yield no cell.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ceng_parser.h"
+
+enum CellRadio : uint8_t {
+  RADIO_GSM,
+  RADIO_WCDMA,
+  RADIO_LTE,
+};
+
+// Radio type as named by the Google Geolocation API.
+inline const char* radioTypeName(CellRadio radio) {
+  return radio == RADIO_LTE ? "lte" : (radio == RADIO_WCDMA ? "wcdma" : "gsm");
+}
+
+inline uint8_t dbmToRxlev(long dbm) {
+  long v = (dbm + 113) / 2;
+  return uint8_t(v < 0 ? 0 : (v > 63 ? 63 : v));
+}
+
+// Signed decimal field; false if empty or not a number.
+inline bool parseCpsiSigned(const char* b, const char* e, long& out) {
+  while (b < e && *b == ' ') ++b;
+  bool neg = b < e && *b == '-';
+  if (neg) ++b;
+  if (b == e) return false;
+  long v = 0;
+  for (; b < e; ++b) {
+    if (*b < '0' || *b > '9') return false;
+    v = v * 10 + (*b - '0');
+  }
+  out = neg ? -v : v;
+  return true;
+}
+
+/**
+ * @brief Parses one "+CPSI:" line (without line ending).
+ * @return true if it held a complete serving cell
+ */
+inline bool parseCpsiLine(const char* line, const char* end, CellRecord& rec, CellRadio& radio) {
+  static const char prefix[] = "+CPSI:";
+  const char* p = line;
+  while (p < end && *p == ' ') ++p;
+  if (size_t(end - p) < sizeof(prefix) - 1 || memcmp(p, prefix, sizeof(prefix) - 1) != 0) {
+    return false;
+  }
+  p += sizeof(prefix) - 1;
+  while (p < end && *p == ' ') ++p;
+
+  const char* fb[14];
+  const char* fe[14];
+  int n = 0;
+  const char* s = p;
+  for (const char* c = p; c <= end && n < 14; ++c) {
+    if (c == end || *c == ',') {
+      fb[n] = s;
+      fe[n] = c;
+      ++n;
+      s = c + 1;
+    }
+  }
+  if (n < 5 || size_t(fe[1] - fb[1]) != 6 || memcmp(fb[1], "Online", 6) != 0) return false;
+
+  const size_t modeLen = size_t(fe[0] - fb[0]);
+  int levelField;
+  if (modeLen == 3 && memcmp(fb[0], "GSM", 3) == 0) {
+    radio = RADIO_GSM;
+    levelField = 6;
+  } else if (modeLen == 5 && memcmp(fb[0], "WCDMA", 5) == 0) {
+    radio = RADIO_WCDMA;
+    levelField = -1;  // RSCP position varies between firmwares: not used
+  } else if (modeLen == 3 && memcmp(fb[0], "LTE", 3) == 0) {
+    radio = RADIO_LTE;
+    levelField = 11;
+  } else {
+    return false;
+  }
+
+  // MCC-MNC
+  const char* dash = fb[2];
+  while (dash < fe[2] && *dash != '-') ++dash;
+  uint32_t mcc, mnc, area, cid;
+  if (dash == fe[2] || !parseCengField(fb[2], dash, 10, mcc) ||
+      !parseCengField(dash + 1, fe[2], 10, mnc)) {
+    return false;
+  }
+  const char* ab = fb[3];
+  if (fe[3] - ab > 2 && ab[0] == '0' && (ab[1] | 0x20) == 'x') ab += 2;
+  if (!parseCengField(ab, fe[3], 16, area) || !parseCengField(fb[4], fe[4], 10, cid)) return false;
+
+  rec = CellRecord();
+  rec.mcc = uint16_t(mcc);
+  rec.mnc = uint16_t(mnc);
+  rec.lac = uint16_t(area);
+  rec.cid = cid;
+  long level;
+  if (levelField >= 0 && levelField < n && parseCpsiSigned(fb[levelField], fe[levelField], level)) {
+    rec.rxlev = dbmToRxlev(radio == RADIO_LTE ? level / 10 : level);
+  }
+  return true;
+}
+
+/**
+ * @brief Parses a complete AT+CPSI? response into a one-cell snapshot.
+ *
+ * `complete` is cleared when the modem answered without a usable cell.
+ */
+inline bool parseCpsiResponse(const char* text, size_t len, CellSnapshot& snap, bool& complete,
+                              CellRadio& radio) {
+  snap.count = 0;
+  const char* end = text + len;
+  const char* line = text;
+  while (line < end && snap.count == 0) {
+    const char* eol = line;
+    while (eol < end && *eol != '\n') ++eol;
+    const char* e = eol;
+    if (e > line && e[-1] == '\r') --e;
+    if (parseCpsiLine(line, e, snap.cells[0], radio)) snap.count = 1;
+    line = eol + 1;
+  }
+  complete = snap.count > 0;
+  snap.servingParsed = complete;  // CPSI reports the serving cell only
+  return complete;
+}
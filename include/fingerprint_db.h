@@ -0,0 +1,295 @@
+#pragma once
+/**
+ * @file fingerprint_db.h
+ * @brief RF fingerprint positioning: inverted cell index and weighted k-NN.
+ *
+ * A fingerprint is a reference position with the mean RxLev of every cell
+ * heard there. The file written by tools/fingerprint_builder.cpp is read in
+ * place (on the device straight from the memory-mapped "fprint" partition).
+ * Layout, little-endian:
+ *
+ *   header   32 bytes: "CFPR", version, 3 reserved, cell count u32,
+ *            fingerprint count u32, posting count u32, entry count u32,
+ *            12 reserved
+ *   cells    12 bytes each, sorted by cellKey(): key u64, first posting u32
+ *   postings u32 fingerprint index, ascending within each cell
+ *   prints   12 bytes each: lat i32 (1e-7 deg), lng i32, first entry u32
+ *   entries  u32 (cell index << 8 | mean rxlev), ascending cell index
+ *
+ * A cell's postings run up to the next cell's first posting, a
+ * fingerprint's entries up to the next fingerprint's first entry.
+ *
+ * A query only scores fingerprints that share at least three cells with it
+ * (all of them when fewer are known): the posting lists of the observed
+ * cells are merged, and each candidate's signature is compared with the
+ * observation in one pass over both sorted lists. Cells heard on only one
+ * side count as heard at the floor level.
+ */
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cell_record.h"
+#include "geo_types.h"
+
+static const uint8_t FINGERPRINT_MAGIC[4] = {'C', 'F', 'P', 'R'};
+static const uint8_t FINGERPRINT_VERSION = 1;
+static const size_t FINGERPRINT_HEADER_SIZE = 32;
+static const size_t FINGERPRINT_CELL_SIZE = 12;
+static const size_t FINGERPRINT_PRINT_SIZE = 12;
+static const uint8_t FINGERPRINT_MAX_QUERY = 16;  // observed cells per query
+static const uint8_t FINGERPRINT_MAX_K = 8;
+static const float FINGERPRINT_MIN_ACCURACY_M = 30.0f;
+
+// One observed cell; rxlev may be a mean over several scans.
+struct FingerprintQueryCell {
+  uint64_t key = 0;
+  float rxlev = 0;
+};
+
+struct FingerprintMatch {
+  uint32_t candidates = 0;  // fingerprints sharing enough cells
+  uint8_t neighbours = 0;   // used for the estimate (<= k)
+  float bestDistance = 0;   // dB, RMS over the union of cells
+};
+
+inline uint32_t fpLe32(const uint8_t* p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void fpPutLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+
+inline uint64_t fpLe64(const uint8_t* p) {
+  return uint64_t(fpLe32(p)) | (uint64_t(fpLe32(p + 4)) << 32);
+}
+
+inline void encodeFingerprintHeader(uint8_t* out, uint32_t cells, uint32_t prints,
+                                    uint32_t postings, uint32_t entries) {
+  memset(out, 0, FINGERPRINT_HEADER_SIZE);
+  memcpy(out, FINGERPRINT_MAGIC, 4);
+  out[4] = FINGERPRINT_VERSION;
+  fpPutLe32(out + 8, cells);
+  fpPutLe32(out + 12, prints);
+  fpPutLe32(out + 16, postings);
+  fpPutLe32(out + 20, entries);
+}
+
+class FingerprintDb {
+public:
+  // Validates the header and section sizes; the image must outlive the db.
+  bool attach(const uint8_t* data, size_t len) {
+    _cells = 0;
+    if (len < FINGERPRINT_HEADER_SIZE || memcmp(data, FINGERPRINT_MAGIC, 4) != 0 ||
+        data[4] != FINGERPRINT_VERSION) {
+      return false;
+    }
+    uint32_t cells = fpLe32(data + 8);
+    _prints = fpLe32(data + 12);
+    _postings = fpLe32(data + 16);
+    _entries = fpLe32(data + 20);
+    uint64_t need = FINGERPRINT_HEADER_SIZE + uint64_t(cells) * FINGERPRINT_CELL_SIZE +
+                    uint64_t(_postings) * 4 + uint64_t(_prints) * FINGERPRINT_PRINT_SIZE +
+                    uint64_t(_entries) * 4;
+    if (need > len) return false;
+    _cellTable = data + FINGERPRINT_HEADER_SIZE;
+    _postingTable = _cellTable + size_t(cells) * FINGERPRINT_CELL_SIZE;
+    _printTable = _postingTable + size_t(_postings) * 4;
+    _entryTable = _printTable + size_t(_prints) * FINGERPRINT_PRINT_SIZE;
+    _cells = cells;
+    return true;
+  }
+
+  bool valid() const { return _cells > 0; }
+  uint32_t cells() const { return _cells; }
+  uint32_t fingerprints() const { return _prints; }
+
+  /**
+   * @brief Estimates a position from observed cells by weighted k-NN.
+   * @param obs   observed cells, any order, at most FINGERPRINT_MAX_QUERY used
+   * @param k     neighbours to average, at most FINGERPRINT_MAX_K
+   * @return false if no fingerprint shares enough cells with the observation
+   */
+  bool locate(const FingerprintQueryCell* obs, uint8_t n, LocationFix& fix, uint8_t k = 4,
+              FingerprintMatch* match = nullptr) const {
+    fix.valid = false;
+    if (!valid() || n == 0) return false;
+    if (n > FINGERPRINT_MAX_QUERY) n = FINGERPRINT_MAX_QUERY;
+    if (k == 0) k = 1;
+    if (k > FINGERPRINT_MAX_K) k = FINGERPRINT_MAX_K;
+
+    // Known cells sorted by cell index, with their posting cursors.
+    uint32_t index[FINGERPRINT_MAX_QUERY];
+    float level[FINGERPRINT_MAX_QUERY];
+    uint32_t cursor[FINGERPRINT_MAX_QUERY], stop[FINGERPRINT_MAX_QUERY];
+    uint8_t known = 0;
+    float unknownPenalty = 0;  // observed cells missing from the whole db
+    for (uint8_t i = 0; i < n; ++i) {
+      uint32_t ci;
+      if (!findCell(obs[i].key, ci)) {
+        unknownPenalty += sq(obs[i].rxlev * 2.0f);
+        continue;
+      }
+      uint8_t j = known++;
+      while (j > 0 && index[j - 1] > ci) {
+        index[j] = index[j - 1];
+        level[j] = level[j - 1];
+        j--;
+      }
+      index[j] = ci;
+      level[j] = obs[i].rxlev;
+    }
+    if (known == 0) return false;
+    for (uint8_t i = 0; i < known; ++i) {
+      cursor[i] = fpLe32(cellAt(index[i]) + 8);
+      stop[i] = index[i] + 1 < _cells ? fpLe32(cellAt(index[i] + 1) + 8) : _postings;
+    }
+    const uint8_t minShared = known >= 3 ? 3 : known;
+    const uint8_t unknown = n - known;
+
+    uint32_t bestPrint[FINGERPRINT_MAX_K];
+    float bestDist[FINGERPRINT_MAX_K];
+    uint8_t found = 0;
+    uint32_t candidates = 0;
+    for (;;) {
+      // Smallest fingerprint index at the head of any posting list.
+      uint32_t fp = UINT32_MAX;
+      for (uint8_t i = 0; i < known; ++i) {
+        if (cursor[i] < stop[i]) {
+          uint32_t v = fpLe32(_postingTable + size_t(cursor[i]) * 4);
+          if (v < fp) fp = v;
+        }
+      }
+      if (fp == UINT32_MAX) break;
+      uint8_t shared = 0;
+      for (uint8_t i = 0; i < known; ++i) {
+        if (cursor[i] < stop[i] && fpLe32(_postingTable + size_t(cursor[i]) * 4) == fp) {
+          cursor[i]++;
+          shared++;
+        }
+      }
+      if (shared < minShared || fp >= _prints) continue;
+      candidates++;
+
+      float d = distance(fp, index, level, known, unknown, unknownPenalty);
+      if (found == k && d >= bestDist[k - 1]) continue;
+      uint8_t j = found < k ? found++ : uint8_t(k - 1);
+      while (j > 0 && bestDist[j - 1] > d) {
+        bestDist[j] = bestDist[j - 1];
+        bestPrint[j] = bestPrint[j - 1];
+        j--;
+      }
+      bestDist[j] = d;
+      bestPrint[j] = fp;
+    }
+    if (match) {
+      match->candidates = candidates;
+      match->neighbours = found;
+      match->bestDistance = found ? bestDist[0] : 0;
+    }
+    if (found == 0) return false;
+
+    // Inverse-distance weighted mean; accuracy from the neighbours' spread.
+    double w[FINGERPRINT_MAX_K], lat[FINGERPRINT_MAX_K], lng[FINGERPRINT_MAX_K];
+    double sw = 0, sLat = 0, sLng = 0;
+    for (uint8_t i = 0; i < found; ++i) {
+      const uint8_t* p = printAt(bestPrint[i]);
+      lat[i] = int32_t(fpLe32(p)) * 1e-7;
+      lng[i] = int32_t(fpLe32(p + 4)) * 1e-7;
+      w[i] = 1.0 / (bestDist[i] + 1.0);
+      sw += w[i];
+      sLat += w[i] * lat[i];
+      sLng += w[i] * lng[i];
+    }
+    fix.lat = sLat / sw;
+    fix.lng = sLng / sw;
+    const double mPerDeg = 111195.0;
+    const double cosLat = cos(fix.lat * M_PI / 180.0);
+    double spread = 0;
+    for (uint8_t i = 0; i < found; ++i) {
+      spread += w[i] * (sq((lat[i] - fix.lat) * mPerDeg) + sq((lng[i] - fix.lng) * mPerDeg * cosLat));
+    }
+    fix.accuracy = float(sqrt(spread / sw));
+    if (fix.accuracy < FINGERPRINT_MIN_ACCURACY_M) fix.accuracy = FINGERPRINT_MIN_ACCURACY_M;
+    fix.valid = true;
+    return true;
+  }
+
+  bool locate(const CellSnapshot& snap, LocationFix& fix, uint8_t k = 4,
+              FingerprintMatch* match = nullptr) const {
+    FingerprintQueryCell obs[CELL_SNAPSHOT_MAX];
+    for (uint8_t i = 0; i < snap.count; ++i) {
+      obs[i].key = cellKey(snap.cells[i]);
+      obs[i].rxlev = snap.cells[i].rxlev;
+    }
+    return locate(obs, snap.count, fix, k, match);
+  }
+
+private:
+  template <typename T>
+  static T sq(T v) { return v * v; }
+
+  const uint8_t* cellAt(uint32_t i) const { return _cellTable + size_t(i) * FINGERPRINT_CELL_SIZE; }
+  const uint8_t* printAt(uint32_t i) const { return _printTable + size_t(i) * FINGERPRINT_PRINT_SIZE; }
+
+  bool findCell(uint64_t key, uint32_t& out) const {
+    uint32_t lo = 0, hi = _cells;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      uint64_t k = fpLe64(cellAt(mid));
+      if (k < key) {
+        lo = mid + 1;
+      } else if (k > key) {
+        hi = mid;
+      } else {
+        out = mid;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // RMS RxLev difference in dB over the union of observed and stored cells.
+  float distance(uint32_t fp, const uint32_t* index, const float* level, uint8_t known,
+                 uint8_t unknown, float unknownPenalty) const {
+    uint32_t e = fpLe32(printAt(fp) + 8);
+    const uint32_t end = fp + 1 < _prints ? fpLe32(printAt(fp + 1) + 8) : _entries;
+    float sum = unknownPenalty;
+    uint32_t count = unknown;
+    uint8_t i = 0;
+    while (e < end || i < known) {
+      uint32_t entry = e < end ? fpLe32(_entryTable + size_t(e) * 4) : 0;
+      uint32_t ci = entry >> 8;
+      float stored = float(entry & 0xFF);
+      if (e < end && (i == known || ci < index[i])) {
+        sum += sq(stored * 2.0f);
+        e++;
+      } else if (e == end || index[i] < ci) {
+        sum += sq(level[i] * 2.0f);
+        i++;
+      } else {
+        sum += sq((stored - level[i]) * 2.0f);
+        e++;
+        i++;
+      }
+      count++;
+    }
+    return count ? sqrtf(sum / count) : 0;
+  }
+
+  const uint8_t* _cellTable = nullptr;
+  const uint8_t* _postingTable = nullptr;
+  const uint8_t* _printTable = nullptr;
+  const uint8_t* _entryTable = nullptr;
+  uint32_t _cells = 0;
+  uint32_t _prints = 0;
+  uint32_t _postings = 0;
+  uint32_t _entries = 0;
+};
+
+#if defined(ARDUINO)
+// Maps the "fprint" data partition and attaches `db` to it.
+bool mapFingerprintPartition(FingerprintDb& db);
+#endif
@@ -0,0 +1,123 @@
+#pragma once
+/**
+ * @file fix_datagram.h
+ * @brief Compact authenticated fix datagram for the UDP report channel.
+ *
+ * A report is 32 bytes instead of an HTTPS handshake plus a JSON body.
+ * All fields are little-endian:
+ *
+ *   off size field
+ *     0    1 type      FIX_DATAGRAM_TYPE / ACK_DATAGRAM_TYPE
+ *     1    1 version   FIX_DATAGRAM_VERSION
+ *     2    4 deviceId
+ *     6    2 session   random per boot, so sequence numbers may restart
+ *     8    2 seq
+ *    10    4 timestamp seconds
+ *    14    4 lat       degrees * 1e7
+ *    18    4 lng       degrees * 1e7
+ *    22    2 accuracy  metres, saturated at 65535
+ *    24    8 tag       HMAC-SHA256(psk, bytes 0..23), truncated
+ *
+ * The collector answers with an 18-byte ack: the first 10 bytes of the fix
+ * (type replaced by ACK_DATAGRAM_TYPE) followed by an 8-byte tag over them.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "geo_types.h"
+#include "hmac_sha256.h"
+
+static const uint8_t FIX_DATAGRAM_TYPE = 0xF1;
+static const uint8_t ACK_DATAGRAM_TYPE = 0xA1;
+static const uint8_t FIX_DATAGRAM_VERSION = 1;
+static const size_t FIX_DATAGRAM_TAG_SIZE = 8;
+static const size_t FIX_DATAGRAM_SIZE = 24 + FIX_DATAGRAM_TAG_SIZE;
+static const size_t ACK_DATAGRAM_SIZE = 10 + FIX_DATAGRAM_TAG_SIZE;
+
+// Header fields common to fixes and acks.
+struct DatagramHeader {
+  uint32_t deviceId = 0;
+  uint16_t session = 0;
+  uint16_t seq = 0;
+};
+
+inline void putLe16(uint8_t* p, uint16_t v) {
+  p[0] = uint8_t(v);
+  p[1] = uint8_t(v >> 8);
+}
+
+inline void putLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+
+inline uint16_t getLe16(const uint8_t* p) {
+  return uint16_t(p[0] | (p[1] << 8));
+}
+
+inline uint32_t getLe32(const uint8_t* p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void datagramTag(const uint8_t* psk, size_t pskLen, const uint8_t* body, size_t bodyLen,
+                        uint8_t* tag) {
+  uint8_t full[Sha256::DIGEST_SIZE];
+  hmacSha256(psk, pskLen, body, bodyLen, full);
+  memcpy(tag, full, FIX_DATAGRAM_TAG_SIZE);
+}
+
+inline void encodeHeader(uint8_t* out, uint8_t type, const DatagramHeader& hdr) {
+  out[0] = type;
+  out[1] = FIX_DATAGRAM_VERSION;
+  putLe32(out + 2, hdr.deviceId);
+  putLe16(out + 6, hdr.session);
+  putLe16(out + 8, hdr.seq);
+}
+
+// Writes a FIX_DATAGRAM_SIZE-byte datagram for `fix`.
+inline void encodeFixDatagram(uint8_t* out, const DatagramHeader& hdr, const LocationFix& fix,
+                              const uint8_t* psk, size_t pskLen) {
+  encodeHeader(out, FIX_DATAGRAM_TYPE, hdr);
+  putLe32(out + 10, fix.timestamp);
+  putLe32(out + 14, uint32_t(int32_t(lround(fix.lat * 1e7))));
+  putLe32(out + 18, uint32_t(int32_t(lround(fix.lng * 1e7))));
+  float acc = fix.accuracy < 0 ? 0 : fix.accuracy;
+  putLe16(out + 22, acc > 65535.0f ? 65535 : uint16_t(acc + 0.5f));
+  datagramTag(psk, pskLen, out, 24, out + 24);
+}
+
+// Verifies and decodes a fix datagram. Returns false on a bad size, type or tag.
+inline bool decodeFixDatagram(const uint8_t* in, size_t len, const uint8_t* psk, size_t pskLen,
+                              DatagramHeader& hdr, LocationFix& fix) {
+  if (len != FIX_DATAGRAM_SIZE || in[0] != FIX_DATAGRAM_TYPE || in[1] != FIX_DATAGRAM_VERSION) {
+    return false;
+  }
+  uint8_t tag[FIX_DATAGRAM_TAG_SIZE];
+  datagramTag(psk, pskLen, in, 24, tag);
+  if (!tagsEqual(tag, in + 24, FIX_DATAGRAM_TAG_SIZE)) return false;
+  hdr.deviceId = getLe32(in + 2);
+  hdr.session = getLe16(in + 6);
+  hdr.seq = getLe16(in + 8);
+  fix.timestamp = getLe32(in + 10);
+  fix.lat = int32_t(getLe32(in + 14)) / 1e7;
+  fix.lng = int32_t(getLe32(in + 18)) / 1e7;
+  fix.accuracy = getLe16(in + 22);
+  fix.valid = true;
+  return true;
+}
+
+// Writes an ACK_DATAGRAM_SIZE-byte ack for `hdr`.
+inline void encodeAckDatagram(uint8_t* out, const DatagramHeader& hdr, const uint8_t* psk,
+                              size_t pskLen) {
+  encodeHeader(out, ACK_DATAGRAM_TYPE, hdr);
+  datagramTag(psk, pskLen, out, 10, out + 10);
+}
+
+// True if `in` is an authentic ack for exactly `hdr`.
+inline bool isAckFor(const uint8_t* in, size_t len, const DatagramHeader& hdr, const uint8_t* psk,
+                     size_t pskLen) {
+  if (len != ACK_DATAGRAM_SIZE) return false;
+  uint8_t expected[ACK_DATAGRAM_SIZE];
+  encodeAckDatagram(expected, hdr, psk, pskLen);
+  return tagsEqual(expected, in, ACK_DATAGRAM_SIZE);
+}
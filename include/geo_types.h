@@ -0,0 +1,17 @@
+#pragma once
+/**
+ * @file geo_types.h
+ * @brief Plain position types shared by the firmware and the host tools.
+ *
+ * Kept free of Arduino headers so the same definitions compile on the host.
+ */
+#include <stdint.h>
+
+// One position estimate as returned by the positioning step.
+struct LocationFix {
+  double lat = 0;
+  double lng = 0;
+  float accuracy = 0;      // metres, radius of the 68 % confidence circle
+  uint32_t timestamp = 0;  // seconds (device uptime unless a wall clock is known)
+  bool valid = false;
+};
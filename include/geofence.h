@@ -0,0 +1,278 @@
+#pragma once
+/**
+ * @file geofence.h
+ * @brief Circle and polygon geofences with a grid index and transition events.
+ *
+ * Zones are written by tools/geofence_builder.cpp in metres on a local plane
+ * whose origin is the south-west corner of all zones. Layout, little-endian:
+ *
+ *   header    32 bytes: "CGFZ", version, 3 reserved, zone count u16,
+ *             grid columns u16, grid rows u16, 2 reserved, origin lat i32
+ *             (1e-7 deg), origin lng i32, grid cell size u32 (m),
+ *             vertex count u32
+ *   zones     32 bytes each: id u16, type u8, reserved u8, first vertex u32,
+ *             vertex count u16, 2 reserved, radius u32 (m, circles),
+ *             name char[16] (NUL-padded)
+ *   grid      (columns * rows + 1) u32 offsets into the posting list
+ *   postings  u16 zone indexes whose bounding box touches the grid cell
+ *   vertices  x i32, y i32 (m east / north of the origin); a circle has
+ *             one vertex, its centre
+ *
+ * A fix is tested against the zones listed in its grid cell and the zones
+ * it is currently inside of, which the engine keeps in a short list, so
+ * evaluation cost does not grow with the number of zones. Transitions use
+ * the fix's accuracy as hysteresis: a zone is entered once the fix is at
+ * least GEOFENCE_MARGIN_M inside it, and left once the fix is farther
+ * outside than its accuracy (and at least GEOFENCE_MARGIN_M). Fixes in
+ * between keep the current state, so a noisy cell fix near a boundary does
+ * not flap. The first fix only establishes the state; events are reported
+ * for later changes.
+ */
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "geo_types.h"
+
+static const uint8_t GEOFENCE_MAGIC[4] = {'C', 'G', 'F', 'Z'};
+static const uint8_t GEOFENCE_VERSION = 1;
+static const size_t GEOFENCE_HEADER_SIZE = 32;
+static const size_t GEOFENCE_ZONE_SIZE = 32;
+static const size_t GEOFENCE_NAME_LEN = 16;
+static const uint16_t GEOFENCE_MAX_ZONES = 256;
+static const float GEOFENCE_MARGIN_M = 25.0f;
+static const double GEOFENCE_METRES_PER_DEGREE = 111195.0;
+
+enum GeofenceType : uint8_t {
+  GEOFENCE_CIRCLE = 0,
+  GEOFENCE_POLYGON = 1,
+};
+
+struct GeofenceEvent {
+  uint16_t zoneId;
+  char name[GEOFENCE_NAME_LEN + 1];
+  bool entered;      // false: left
+  float distance;    // signed distance to the boundary, m (negative inside)
+  LocationFix fix;
+};
+
+inline uint32_t gfLe32(const uint8_t* p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline uint16_t gfLe16(const uint8_t* p) {
+  return uint16_t(p[0] | (p[1] << 8));
+}
+
+class GeofenceEngine {
+public:
+  typedef void (*Handler)(const GeofenceEvent& event, void* ctx);
+
+  // Validates the image, which must outlive the engine, and clears all state.
+  bool attach(const uint8_t* data, size_t len) {
+    _zones = 0;
+    if (len < GEOFENCE_HEADER_SIZE || memcmp(data, GEOFENCE_MAGIC, 4) != 0 ||
+        data[4] != GEOFENCE_VERSION) {
+      return false;
+    }
+    uint16_t zones = gfLe16(data + 8);
+    _cols = gfLe16(data + 10);
+    _rows = gfLe16(data + 12);
+    _originLat = int32_t(gfLe32(data + 16)) * 1e-7;
+    _originLng = int32_t(gfLe32(data + 20)) * 1e-7;
+    _cellSize = gfLe32(data + 24);
+    _vertexCount = gfLe32(data + 28);
+    if (zones > GEOFENCE_MAX_ZONES || _cellSize == 0) return false;
+
+    const size_t cells = size_t(_cols) * _rows;
+    size_t off = GEOFENCE_HEADER_SIZE;
+    _zoneTable = data + off;
+    off += size_t(zones) * GEOFENCE_ZONE_SIZE;
+    _grid = data + off;
+    off += (cells + 1) * 4;
+    if (off > len) return false;
+    _postings = data + off;
+    off += size_t(gfLe32(_grid + cells * 4)) * 2;
+    _vertices = data + off;
+    off += size_t(_vertexCount) * 8;
+    if (off > len) return false;
+
+    _cosOrigin = cos(_originLat * M_PI / 180.0);
+    _zones = zones;
+    memset(_state, STATE_UNKNOWN, sizeof(_state));
+    _watchCount = 0;
+    _started = false;
+    return true;
+  }
+
+  uint16_t zones() const { return _zones; }
+
+  void setHandler(Handler handler, void* ctx) {
+    _handler = handler;
+    _ctx = ctx;
+  }
+
+  // True if the last decided state of zone index `i` is inside.
+  bool inside(uint16_t i) const { return i < _zones && _state[i] == STATE_INSIDE; }
+
+  /**
+   * @brief Evaluates one fix and reports enter/leave transitions.
+   * @return number of events reported
+   */
+  uint8_t evaluate(const LocationFix& fix) {
+    if (_zones == 0 || !fix.valid) return 0;
+    double x, y;
+    toLocal(fix.lat, fix.lng, x, y);
+
+    // The first fix decides every zone: outside, unless its grid cell lists it
+    const bool first = !_started;
+    if (first) {
+      memset(_state, STATE_OUTSIDE, _zones);
+      _started = true;
+    }
+
+    // Candidates: the fix's grid cell plus every zone we are inside of.
+    uint8_t tested[GEOFENCE_MAX_ZONES / 8];
+    memset(tested, 0, sizeof(tested));
+    uint8_t events = 0;
+    if (x >= 0 && y >= 0) {
+      uint32_t col = uint32_t(x / _cellSize), row = uint32_t(y / _cellSize);
+      if (col < _cols && row < _rows) {
+        size_t cell = size_t(row) * _cols + col;
+        uint32_t begin = gfLe32(_grid + cell * 4), end = gfLe32(_grid + cell * 4 + 4);
+        for (uint32_t p = begin; p < end; ++p) {
+          uint16_t z = gfLe16(_postings + size_t(p) * 2);
+          if (z >= _zones) continue;
+          tested[z / 8] |= uint8_t(1 << (z % 8));
+          if (first) setState(z, STATE_UNKNOWN);
+          events += test(z, x, y, fix);
+        }
+      }
+    }
+    // Not in this grid cell's list: the fix is outside the zone's bounds.
+    // Backwards, as setState() moves the last entry into a removed one.
+    for (uint16_t k = _watchCount; k-- > 0;) {
+      const uint16_t z = _watch[k];
+      if (tested[z / 8] & (1 << (z % 8))) continue;
+      if (_state[z] == STATE_INSIDE) {
+        events += test(z, x, y, fix);
+      } else {
+        setState(z, STATE_OUTSIDE);
+      }
+    }
+    return events;
+  }
+
+  // Signed distance in metres from the fix to zone index `i` (negative inside).
+  float distance(uint16_t i, const LocationFix& fix) const {
+    double x, y;
+    toLocal(fix.lat, fix.lng, x, y);
+    return float(signedDistance(i, x, y));
+  }
+
+private:
+  enum : uint8_t { STATE_UNKNOWN, STATE_OUTSIDE, STATE_INSIDE };
+
+  const uint8_t* zoneAt(uint16_t i) const { return _zoneTable + size_t(i) * GEOFENCE_ZONE_SIZE; }
+
+  // Keeps _watch to the zones not known to be outside.
+  void setState(uint16_t i, uint8_t next) {
+    const bool watched = _state[i] != STATE_OUTSIDE;
+    _state[i] = next;
+    if (next != STATE_OUTSIDE) {
+      if (!watched) _watch[_watchCount++] = i;
+    } else if (watched) {
+      for (uint16_t k = 0; k < _watchCount; ++k) {
+        if (_watch[k] != i) continue;
+        _watch[k] = _watch[--_watchCount];
+        break;
+      }
+    }
+  }
+
+  void vertex(uint32_t i, double& x, double& y) const {
+    const uint8_t* v = _vertices + size_t(i) * 8;
+    x = int32_t(gfLe32(v));
+    y = int32_t(gfLe32(v + 4));
+  }
+
+  void toLocal(double lat, double lng, double& x, double& y) const {
+    x = (lng - _originLng) * GEOFENCE_METRES_PER_DEGREE * _cosOrigin;
+    y = (lat - _originLat) * GEOFENCE_METRES_PER_DEGREE;
+  }
+
+  double signedDistance(uint16_t i, double x, double y) const {
+    const uint8_t* z = zoneAt(i);
+    uint32_t first = gfLe32(z + 4);
+    uint16_t count = gfLe16(z + 8);
+    if (first + uint32_t(count) > _vertexCount || count == 0) return INFINITY;
+    if (z[2] == GEOFENCE_CIRCLE) {
+      double cx, cy;
+      vertex(first, cx, cy);
+      return hypot(x - cx, y - cy) - gfLe32(z + 12);
+    }
+    // Even-odd rule for inside, nearest edge for the distance.
+    bool in = false;
+    double best = INFINITY;
+    double ax, ay;
+    vertex(first + count - 1, ax, ay);
+    for (uint16_t k = 0; k < count; ++k) {
+      double bx, by;
+      vertex(first + k, bx, by);
+      if ((ay > y) != (by > y) && x < ax + (y - ay) * (bx - ax) / (by - ay)) in = !in;
+      const double ex = bx - ax, ey = by - ay;
+      const double len2 = ex * ex + ey * ey;
+      double t = len2 > 0 ? ((x - ax) * ex + (y - ay) * ey) / len2 : 0;
+      t = t < 0 ? 0 : (t > 1 ? 1 : t);
+      const double d = hypot(x - (ax + t * ex), y - (ay + t * ey));
+      if (d < best) best = d;
+      ax = bx;
+      ay = by;
+    }
+    return in ? -best : best;
+  }
+
+  uint8_t test(uint16_t i, double x, double y, const LocationFix& fix) {
+    const double d = signedDistance(i, x, y);
+    const double exitMargin = fix.accuracy > GEOFENCE_MARGIN_M ? fix.accuracy : GEOFENCE_MARGIN_M;
+    uint8_t next = _state[i];
+    if (d <= -GEOFENCE_MARGIN_M) {
+      next = STATE_INSIDE;
+    } else if (d >= exitMargin) {
+      next = STATE_OUTSIDE;
+    }
+    const uint8_t prev = _state[i];
+    setState(i, next);
+    if (prev == STATE_UNKNOWN || prev == next || !_handler) return 0;
+
+    GeofenceEvent ev;
+    const uint8_t* z = zoneAt(i);
+    ev.zoneId = gfLe16(z);
+    memcpy(ev.name, z + 16, GEOFENCE_NAME_LEN);
+    ev.name[GEOFENCE_NAME_LEN] = '\0';
+    ev.entered = next == STATE_INSIDE;
+    ev.distance = float(d);
+    ev.fix = fix;
+    _handler(ev, _ctx);
+    return 1;
+  }
+
+  const uint8_t* _zoneTable = nullptr;
+  const uint8_t* _grid = nullptr;
+  const uint8_t* _postings = nullptr;
+  const uint8_t* _vertices = nullptr;
+  uint16_t _zones = 0;
+  uint16_t _cols = 0, _rows = 0;
+  uint32_t _cellSize = 0;
+  uint32_t _vertexCount = 0;
+  double _originLat = 0, _originLng = 0, _cosOrigin = 1;
+  uint8_t _state[GEOFENCE_MAX_ZONES];
+  // Zones inside, or undecided since the first fix; re-tested on every fix
+  uint16_t _watch[GEOFENCE_MAX_ZONES];
+  uint16_t _watchCount = 0;
+  bool _started = false;
+
+  Handler _handler = nullptr;
+  void* _ctx = nullptr;
+};
@@ -0,0 +1,138 @@
+#pragma once
+/**
+ * @file hmac_sha256.h
+ * @brief Small portable SHA-256 / HMAC-SHA256 (FIPS 180-4, RFC 2104).
+ *
+ * Header-only and dependency free so the firmware and the host collector
+ * authenticate report datagrams with exactly the same code.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class Sha256 {
+public:
+  static const size_t DIGEST_SIZE = 32;
+  static const size_t BLOCK_SIZE = 64;
+
+  Sha256() { reset(); }
+
+  void reset() {
+    static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(_h, init, sizeof(_h));
+    _length = 0;
+    _used = 0;
+  }
+
+  void update(const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    _length += len;
+    while (len > 0) {
+      size_t n = BLOCK_SIZE - _used;
+      if (n > len) n = len;
+      memcpy(_block + _used, p, n);
+      _used += n;
+      p += n;
+      len -= n;
+      if (_used == BLOCK_SIZE) {
+        compress(_block);
+        _used = 0;
+      }
+    }
+  }
+
+  void finish(uint8_t out[DIGEST_SIZE]) {
+    uint64_t bits = _length * 8;
+    uint8_t pad = 0x80;
+    update(&pad, 1);
+    pad = 0;
+    while (_used != BLOCK_SIZE - 8) update(&pad, 1);
+    uint8_t lenBytes[8];
+    for (int i = 0; i < 8; ++i) lenBytes[i] = uint8_t(bits >> (56 - 8 * i));
+    update(lenBytes, 8);
+    for (int i = 0; i < 8; ++i) {
+      out[4 * i + 0] = uint8_t(_h[i] >> 24);
+      out[4 * i + 1] = uint8_t(_h[i] >> 16);
+      out[4 * i + 2] = uint8_t(_h[i] >> 8);
+      out[4 * i + 3] = uint8_t(_h[i]);
+    }
+  }
+
+private:
+  static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+  void compress(const uint8_t* block) {
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+      w[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16) |
+             (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+      uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3];
+    uint32_t e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+    for (int i = 0; i < 64; ++i) {
+      uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+      uint32_t ch = (e & f) ^ (~e & g);
+      uint32_t t1 = h + s1 + ch + k[i] + w[i];
+      uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+      uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint32_t t2 = s0 + maj;
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    _h[0] += a; _h[1] += b; _h[2] += c; _h[3] += d;
+    _h[4] += e; _h[5] += f; _h[6] += g; _h[7] += h;
+  }
+
+  uint32_t _h[8];
+  uint8_t _block[BLOCK_SIZE];
+  uint64_t _length;
+  size_t _used;
+};
+
+// HMAC-SHA256 of `msg` under `key`; writes the full 32-byte tag.
+inline void hmacSha256(const uint8_t* key, size_t keyLen, const uint8_t* msg, size_t msgLen,
+                       uint8_t out[Sha256::DIGEST_SIZE]) {
+  uint8_t k[Sha256::BLOCK_SIZE] = {0};
+  if (keyLen > Sha256::BLOCK_SIZE) {
+    Sha256 kh;
+    kh.update(key, keyLen);
+    kh.finish(k);
+  } else {
+    memcpy(k, key, keyLen);
+  }
+  uint8_t pad[Sha256::BLOCK_SIZE];
+  for (size_t i = 0; i < Sha256::BLOCK_SIZE; ++i) pad[i] = k[i] ^ 0x36;
+  Sha256 inner;
+  inner.update(pad, sizeof(pad));
+  inner.update(msg, msgLen);
+  uint8_t innerDigest[Sha256::DIGEST_SIZE];
+  inner.finish(innerDigest);
+
+  for (size_t i = 0; i < Sha256::BLOCK_SIZE; ++i) pad[i] = k[i] ^ 0x5c;
+  Sha256 outer;
+  outer.update(pad, sizeof(pad));
+  outer.update(innerDigest, sizeof(innerDigest));
+  outer.finish(out);
+}
+
+// Compares two tags without an early exit.
+inline bool tagsEqual(const uint8_t* a, const uint8_t* b, size_t len) {
+  uint8_t diff = 0;
+  for (size_t i = 0; i < len; ++i) diff |= a[i] ^ b[i];
+  return diff == 0;
+}
@@ -0,0 +1,176 @@
+#pragma once
+/**
+ * @file host_frame.h
+ * @brief Binary request/response frames on the USB serial port.
+ *
+ * Pulling survey logs over the text console means hex dumps and prompts;
+ * these frames carry raw bytes at close to the line rate instead. They are
+ * shared by the firmware (host_link.h) and the host client
+ * (tools/host_client.h).
+ *
+ * A frame is COBS-encoded and sent between two 0x00 delimiters, so either
+ * side can resynchronise on the next 0x00 and tell frames from console
+ * text, which never contains 0x00. Decoded, all fields little-endian:
+ *
+ *   off size field
+ *     0    1 command   HOST_CMD_*, | HOST_RESPONSE in responses
+ *     1    1 status    HOST_STATUS_* in responses, 0 in requests
+ *     2    2 id        chosen by the host, echoed in the response
+ *     4    n payload   up to HOST_FRAME_MAX_PAYLOAD bytes
+ *   4+n    2 crc       crc16() of bytes 0..3+n
+ *
+ * Requests (payload -> response payload):
+ *   PING      -                          -> version u8, uptime s u32
+ *   STATS     -                          -> records, bytesWritten, segmentsDeleted,
+ *                                           writeErrors, bytesOnFlash, logDropped u32
+ *   SEGMENTS  -                          -> first u32, current u32
+ *   READ      segment u32, offset u32,   -> segment size u32, data
+ *             length u16
+ *   TRACE     -                          -> the last console output, up to a full payload
+ *
+ * The device answers requests in order, one at a time; the host may send
+ * several ahead (READs of consecutive chunks) and match responses by id.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crc16.h"
+
+static const uint8_t HOST_PROTOCOL_VERSION = 1;
+static const size_t HOST_FRAME_HEADER = 4;
+static const size_t HOST_FRAME_MAX_PAYLOAD = 1024;
+static const size_t HOST_FRAME_MAX = HOST_FRAME_HEADER + HOST_FRAME_MAX_PAYLOAD + 2;
+// COBS adds one byte per 254 and one more; plus the two delimiters
+static const size_t HOST_WIRE_MAX = HOST_FRAME_MAX + HOST_FRAME_MAX / 254 + 1 + 2;
+static const size_t HOST_READ_HEADER = 4;  // segment size before the data of a READ
+
+static const uint8_t HOST_RESPONSE = 0x80;
+
+enum HostCommand : uint8_t {
+  HOST_CMD_PING = 0x01,
+  HOST_CMD_STATS = 0x02,
+  HOST_CMD_SEGMENTS = 0x03,
+  HOST_CMD_READ = 0x04,
+  HOST_CMD_TRACE = 0x05,
+};
+
+enum HostStatus : uint8_t {
+  HOST_STATUS_OK = 0,
+  HOST_STATUS_UNKNOWN = 1,  // no such command
+  HOST_STATUS_BAD_ARG = 2,
+  HOST_STATUS_IO = 3,       // file missing or unreadable
+};
+
+inline void hostPutLe16(uint8_t* p, uint16_t v) {
+  p[0] = uint8_t(v);
+  p[1] = uint8_t(v >> 8);
+}
+
+inline void hostPutLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+
+inline uint16_t hostGetLe16(const uint8_t* p) {
+  return uint16_t(p[0] | (p[1] << 8));
+}
+
+inline uint32_t hostGetLe32(const uint8_t* p) {
+  return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+/**
+ * @brief COBS-encodes `len` bytes; `out` needs len + len / 254 + 1 bytes.
+ * @return encoded length, without delimiters
+ */
+inline size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+  size_t code = 0;  // position of the current block's length byte
+  size_t o = 1;
+  uint8_t run = 1;
+  for (size_t i = 0; i < len; ++i) {
+    if (in[i] == 0) {
+      out[code] = run;
+      code = o++;
+      run = 1;
+      continue;
+    }
+    out[o++] = in[i];
+    if (++run == 0xFF) {
+      out[code] = run;
+      code = o++;
+      run = 1;
+    }
+  }
+  out[code] = run;
+  return o;
+}
+
+/**
+ * @brief Decodes a COBS block (without delimiters) into `out` of `max` bytes.
+ * @return decoded length, 0 if the input is malformed or does not fit
+ */
+inline size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out, size_t max) {
+  size_t o = 0;
+  size_t i = 0;
+  while (i < len) {
+    const uint8_t run = in[i++];
+    if (run == 0 || i + run - 1 > len) return 0;
+    for (uint8_t k = 1; k < run; ++k) {
+      if (o == max) return 0;
+      out[o++] = in[i++];
+    }
+    // A full block (0xFF) has no implied zero; neither has the last block
+    if (run != 0xFF && i < len) {
+      if (o == max) return 0;
+      out[o++] = 0;
+    }
+  }
+  return o;
+}
+
+/**
+ * @brief Builds the wire form of a frame: 0x00, COBS(frame + crc), 0x00.
+ * @param out at least HOST_WIRE_MAX bytes
+ * @return wire length, 0 if `len` exceeds HOST_FRAME_MAX_PAYLOAD
+ */
+inline size_t hostEncodeFrame(uint8_t command, uint8_t status, uint16_t id, const uint8_t* payload,
+                              size_t len, uint8_t* out) {
+  if (len > HOST_FRAME_MAX_PAYLOAD) return 0;
+  uint8_t frame[HOST_FRAME_MAX];
+  frame[0] = command;
+  frame[1] = status;
+  hostPutLe16(frame + 2, id);
+  for (size_t i = 0; i < len; ++i) frame[HOST_FRAME_HEADER + i] = payload[i];
+  const size_t n = HOST_FRAME_HEADER + len;
+  hostPutLe16(frame + n, crc16(frame, n));
+  out[0] = 0;
+  const size_t enc = cobsEncode(frame, n + 2, out + 1);
+  out[1 + enc] = 0;
+  return enc + 2;
+}
+
+struct HostFrame {
+  uint8_t command = 0;
+  uint8_t status = 0;
+  uint16_t id = 0;
+  const uint8_t* payload = nullptr;  // into the decode buffer
+  size_t length = 0;
+};
+
+/**
+ * @brief Decodes one COBS block (between delimiters) into `buf`.
+ * @param buf `cap` bytes, holds the payload afterwards
+ * @param cap size of `buf`; a frame that does not fit is a length error
+ * @return false on a COBS, length or CRC error
+ */
+inline bool hostDecodeFrame(const uint8_t* in, size_t len, uint8_t* buf, HostFrame& frame,
+                            size_t cap = HOST_FRAME_MAX) {
+  const size_t n = cobsDecode(in, len, buf, cap);
+  if (n < HOST_FRAME_HEADER + 2) return false;
+  if (crc16(buf, n - 2) != hostGetLe16(buf + n - 2)) return false;
+  frame.command = buf[0];
+  frame.status = buf[1];
+  frame.id = hostGetLe16(buf + 2);
+  frame.payload = buf + HOST_FRAME_HEADER;
+  frame.length = n - 2 - HOST_FRAME_HEADER;
+  return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+/**
+ * @file host_link.h
+ * @brief Device end of the binary host protocol (host_frame.h).
+ *
+ * The link shares the USB serial port with the text console: bytes outside
+ * 0x00-delimited frames are handed to a text handler (Console::push), bytes
+ * inside are collected and decoded when the closing 0x00 arrives. Each
+ * command is served by a registered handler that fills the response
+ * payload; the response is sent from a buffer as fast as the UART takes it,
+ * and no further request is read until it has gone, so requests the host
+ * sends ahead wait in the UART's receive buffer.
+ *
+ * While sending() is true, nothing else may write to the port, or the
+ * frame is corrupted: drain the console log only when it is false.
+ */
+#include <Arduino.h>
+
+#include "host_frame.h"
+
+static const size_t HOST_LINK_MAX_REQUEST = 64;  // encoded, requests are small
+static const uint8_t HOST_LINK_MAX_COMMANDS = 8;
+
+// Fills up to HOST_FRAME_MAX_PAYLOAD bytes of `out`, sets `outLen`, and
+// returns a HostStatus.
+typedef uint8_t (*HostHandler)(const uint8_t* req, size_t reqLen, uint8_t* out, size_t& outLen,
+                               void* ctx);
+typedef void (*HostTextHandler)(char c, void* ctx);
+
+struct HostLinkStats {
+  unsigned long requests = 0;
+  unsigned long badFrames = 0;  // COBS, CRC or size error
+  unsigned long bytesSent = 0;
+};
+
+class HostLink {
+public:
+  explicit HostLink(Stream& port) : _port(port) {}
+
+  // False if the registry is full.
+  bool add(uint8_t command, HostHandler handler, void* ctx = nullptr);
+  void setTextHandler(HostTextHandler handler, void* ctx) {
+    _text = handler;
+    _textCtx = ctx;
+  }
+
+  // Sends the pending response, then reads and serves requests. Call from loop().
+  void poll();
+
+  // Writes as much of the pending response as the UART accepts; true while
+  // some is left.
+  bool transmit();
+  bool sending() const { return _txPos < _txLen; }
+
+  const HostLinkStats& stats() const { return _stats; }
+
+private:
+  void handleFrame();
+
+  Stream& _port;
+  HostTextHandler _text = nullptr;
+  void* _textCtx = nullptr;
+  struct Entry {
+    uint8_t command;
+    HostHandler handler;
+    void* ctx;
+  };
+  Entry _handlers[HOST_LINK_MAX_COMMANDS];
+  uint8_t _count = 0;
+
+  bool _inFrame = false;
+  bool _overflow = false;
+  uint8_t _rx[HOST_LINK_MAX_REQUEST];
+  size_t _rxLen = 0;
+
+  uint8_t _tx[HOST_WIRE_MAX];
+  size_t _txLen = 0;
+  size_t _txPos = 0;
+  uint8_t _payload[HOST_FRAME_MAX_PAYLOAD];
+  HostLinkStats _stats;
+};
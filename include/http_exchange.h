@@ -0,0 +1,91 @@
+#pragma once
+/**
+ * @file http_exchange.h
+ * @brief One HTTP/1.1 request and response over a connected Client, without
+ *        blocking.
+ *
+ * HTTPClient waits inside GET()/POST() until the whole response is in, which
+ * stalls every other flow on the loop task for the length of a round trip.
+ * HttpExchange writes the request in one go and then parses whatever has
+ * arrived on each poll(), so a CoopTask awaits it:
+ *
+ *   exchange.begin(client, "GET", host, path);
+ *   CO_AWAIT(exchange.poll());
+ *   if (exchange.status() == 200) parse(exchange.body());
+ *
+ * Bodies with Content-Length, chunked bodies and bodies ended by the server
+ * closing the connection are understood. Bytes past HTTP_MAX_BODY are read
+ * and dropped.
+ */
+#include <Arduino.h>
+#include <Client.h>
+
+static const size_t HTTP_MAX_BODY = 8192;
+static const size_t HTTP_MAX_LINE = 512;  // status, header and chunk size lines
+
+// Negative status() values.
+enum HttpError : int {
+  HTTP_ERROR_CONNECT = -1,    // no connection (set by the caller)
+  HTTP_ERROR_SEND = -2,       // the request could not be written
+  HTTP_ERROR_CLOSED = -3,     // closed before the response was complete
+  HTTP_ERROR_TIMEOUT = -4,
+  HTTP_ERROR_MALFORMED = -5,
+};
+
+class HttpExchange {
+public:
+  // Sends the request; `body` (with `contentType`) may be null. Returns false,
+  // with status() HTTP_ERROR_SEND, if it could not be written.
+  bool begin(Client& client, const char* method, const char* host, const String& path,
+             const char* contentType = nullptr, const String* body = nullptr,
+             unsigned long timeout = 10000);
+
+  // Parses what has arrived; true once the exchange is over. Use as a
+  // CO_AWAIT condition.
+  bool poll();
+
+  // Marks the exchange as failed with `error`, e.g. HTTP_ERROR_CONNECT.
+  void fail(int error);
+
+  bool finished() const { return _state == DONE; }
+  // HTTP status code once finished, or a negative HttpError.
+  int status() const { return _status; }
+  const String& body() const { return _body; }
+  // False if the server closes the connection after this response.
+  bool keepAlive() const { return _keepAlive; }
+
+private:
+  enum State : uint8_t {
+    IDLE,
+    STATUS_LINE,
+    HEADERS,
+    BODY_LENGTH,   // Content-Length bytes
+    CHUNK_SIZE,
+    CHUNK_DATA,
+    CHUNK_END,     // CRLF after a chunk
+    TRAILERS,
+    BODY_CLOSE,    // until the server closes
+    DONE,
+  };
+
+  // Feeds one byte; false once the exchange is over.
+  bool feed(char c);
+  bool lineComplete(char c);
+  void statusLine();
+  void headerLine();
+  void bodyByte(char c);
+  void finish(int status);
+
+  Client* _client = nullptr;
+  State _state = IDLE;
+  int _status = HTTP_ERROR_CONNECT;
+  int _code = 0;
+  unsigned long _start = 0;
+  unsigned long _timeout = 0;
+  String _line;
+  String _body;
+  bool _keepAlive = true;
+  bool _chunked = false;
+  long _contentLength = -1;
+  unsigned long _remaining = 0;  // of the body or the current chunk
+};
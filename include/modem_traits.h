@@ -0,0 +1,70 @@
+#pragma once
+/**
+ * @file modem_traits.h
+ * @brief Compile-time description of the cellular module the firmware drives.
+ *
+ * The pipeline (cell scan, fusion, geolocation) is the same for every
+ * module; what differs is how cells are queried and reported. Each traits
+ * struct gives the commands, timeouts, capabilities and a static cell parser,
+ * and ModemTraits is chosen by a build flag, so the parse path is a direct
+ * call with no runtime dispatch:
+ *
+ *   (default)        SIM800    AT+CENG?, serving cell + neighbours, GSM
+ *   -DMODEM_SIM7600  SIM7600   AT+CPSI?, serving cell, GSM/WCDMA/LTE
+ *   -DMODEM_A7670    A7670     AT+CPSI?, serving cell, GSM/LTE
+ *
+ * Including this header also selects the matching TinyGSM driver, so it
+ * must come before <TinyGsmClient.h>. The A7670 answers the SIM7600 command
+ * set that TinyGSM uses.
+ */
+#include <stddef.h>
+
+#include "ceng_parser.h"
+#include "cpsi_parser.h"
+
+struct Sim800Traits {
+  static constexpr const char* NAME = "SIM800";
+  static constexpr const char* CELL_ENABLE = "AT+CENG=3,1";  // "" if none
+  static constexpr const char* CELL_QUERY = "AT+CENG?";
+  static constexpr unsigned long CELL_TIMEOUT_MS = 3000;
+  static constexpr bool HAS_NEIGHBOURS = true;
+  static constexpr bool HAS_NETSCAN = true;  // AT+CNETSCAN
+  static constexpr bool HAS_CIPMUX = true;   // Sim800Mux command set
+
+  static bool parseCells(const char* text, size_t len, CellSnapshot& snap, bool& complete,
+                         CellRadio& radio) {
+    radio = RADIO_GSM;
+    return parseCengResponse(text, len, snap, complete);
+  }
+};
+
+struct Sim7600Traits {
+  static constexpr const char* NAME = "SIM7600";
+  static constexpr const char* CELL_ENABLE = "";
+  static constexpr const char* CELL_QUERY = "AT+CPSI?";
+  static constexpr unsigned long CELL_TIMEOUT_MS = 9000;
+  static constexpr bool HAS_NEIGHBOURS = false;
+  static constexpr bool HAS_NETSCAN = false;
+  static constexpr bool HAS_CIPMUX = false;  // NETOPEN/CIPOPEN instead
+
+  static bool parseCells(const char* text, size_t len, CellSnapshot& snap, bool& complete,
+                         CellRadio& radio) {
+    return parseCpsiResponse(text, len, snap, complete, radio);
+  }
+};
+
+struct A7670Traits : Sim7600Traits {
+  static constexpr const char* NAME = "A7670";
+  static constexpr unsigned long CELL_TIMEOUT_MS = 5000;
+};
+
+#if defined(MODEM_SIM7600)
+#define TINY_GSM_MODEM_SIM7600
+typedef Sim7600Traits ModemTraits;
+#elif defined(MODEM_A7670)
+#define TINY_GSM_MODEM_SIM7600
+typedef A7670Traits ModemTraits;
+#else
+#define TINY_GSM_MODEM_SIM800
+typedef Sim800Traits ModemTraits;
+#endif
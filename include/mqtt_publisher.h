@@ -0,0 +1,122 @@
+#pragma once
+/**
+ * @file mqtt_publisher.h
+ * @brief Minimal MQTT 3.1.1 publisher with QoS 1 batching and offline buffer.
+ *
+ * Runs over any Arduino `Client`, so the same publisher works on a
+ * WiFiClient or a TinyGsmClient; setClient() switches transports without
+ * losing queued messages. The session is persistent (clean session = 0) and
+ * one publish is in flight at a time: when several messages are backlogged
+ * they are sent as one JSON array, and removed from the queue only once the
+ * broker has acknowledged it with PUBACK.
+ *
+ * loop() never waits for the broker: the CONNACK is picked up by a later
+ * call. A transport whose connect() blocks for long (a SIM800 mux link) is
+ * opened by its owner instead, see setAutoConnect().
+ */
+#include <Arduino.h>
+#include <Client.h>
+
+#include "cell_record.h"
+#include "geo_types.h"
+
+static const size_t MQTT_QUEUE_BYTES = 4096;   // offline buffer
+static const size_t MQTT_MAX_PAYLOAD = 1024;   // largest batched payload
+static const size_t MQTT_MAX_TOPIC = 64;
+
+enum MqttTopic : uint8_t {
+  MQTT_TOPIC_FIX = 0,    // <prefix>/fix
+  MQTT_TOPIC_CELLS = 1,  // <prefix>/cells
+  MQTT_TOPIC_COUNT
+};
+
+struct MqttStats {
+  unsigned long published = 0;  // PUBLISH packets acknowledged
+  unsigned long messages = 0;   // queued messages delivered inside them
+  unsigned long resent = 0;     // DUP retransmissions
+  unsigned long dropped = 0;    // messages lost to a full buffer
+  unsigned long connects = 0;
+};
+
+class MqttPublisher {
+public:
+  MqttPublisher(const char* host, uint16_t port, const char* clientId, const char* topicPrefix);
+
+  void setClient(Client& client);
+  void setCredentials(const char* user, const char* pass);
+
+  // With auto-connect off, loop() only logs in once the transport is
+  // connected and leaves opening it to the owner, who does so while
+  // wantsTransport() and reports a failed attempt with transportFailed(),
+  // so the reconnect backoff covers it as well.
+  void setAutoConnect(bool enabled) { _autoConnect = enabled; }
+  bool wantsTransport();
+  void transportFailed() { retryLater(); }
+
+  // Queues one JSON message. Drops the oldest messages when the buffer is full.
+  bool enqueue(MqttTopic topic, const char* json, size_t len);
+  bool publishFix(const LocationFix& fix);
+  // Serving cell first, as [mcc,mnc,lac,cid,rxlev] rows.
+  bool publishCells(const CellSnapshot& cells);
+
+  // Drives connection, acks, retransmission and keepalive. Call often, also
+  // with nothing queued, or the broker drops the idle session.
+  void loop();
+
+  // Calls loop() until the queue is empty or `timeout` expires.
+  bool flush(unsigned long timeout);
+  // Nothing queued or waiting for its PUBACK.
+  bool idle() const { return _count == 0 && !_inflight; }
+
+  void disconnect();
+
+  bool connected() const { return _connected; }
+  size_t pending() const { return _count; }
+  const MqttStats& stats() const { return _stats; }
+
+private:
+  bool connect();
+  bool readConnack();
+  void retryLater();
+  void readPackets();
+  void sendBatch();
+  bool sendPublish(bool dup);
+  bool sendPacket(uint8_t header, const uint8_t* body, size_t len);
+
+  // Offline buffer: records of [topic][len lo][len hi][json...].
+  void pushBytes(const uint8_t* data, size_t len);
+  void peekBytes(size_t offset, uint8_t* out, size_t len) const;
+  size_t recordSize(size_t offset, uint8_t* topic) const;
+  void dropFront(size_t records);
+
+  const char* _host;
+  uint16_t _port;
+  const char* _clientId;
+  const char* _topicPrefix;
+  const char* _user = nullptr;
+  const char* _pass = nullptr;
+  uint16_t _keepAlive = 60;
+  Client* _client = nullptr;
+  bool _connected = false;
+  bool _autoConnect = true;
+  bool _handshake = false;  // CONNECT sent, waiting for the CONNACK
+  unsigned long _lastAttempt = 0;
+  unsigned long _backoff = 0;
+  unsigned long _lastOut = 0;
+
+  uint8_t _queue[MQTT_QUEUE_BYTES];
+  size_t _head = 0;
+  size_t _used = 0;
+  size_t _count = 0;
+
+  // In-flight batch, kept for DUP retransmission.
+  bool _inflight = false;
+  uint16_t _packetId = 0;
+  size_t _inflightRecords = 0;
+  uint8_t _inflightTopic = 0;
+  unsigned long _inflightSent = 0;
+  uint8_t _payload[MQTT_MAX_PAYLOAD];
+  size_t _payloadLen = 0;
+
+  MqttStats _stats;
+};
@@ -0,0 +1,63 @@
+#pragma once
+/**
+ * @file net_scanner.h
+ * @brief Background all-operator cell scan (AT+CNETSCAN) into the cell table.
+ *
+ * A network scan takes tens of seconds, during which the UART is busy. The
+ * scanner therefore only starts one when the caller says the device is
+ * idle, runs it as the mux's background command, and collects the answer
+ * from poll(). Any foreground AT command aborts a running scan (see
+ * Sim800Mux::abortBackground()), so a scan never delays a fix; an aborted
+ * scan is retried at the next idle period.
+ *
+ * AT+COPS=? is not used: it lists operators but no cell identities.
+ */
+#include <Arduino.h>
+
+#include "cell_table.h"
+#include "sim800_mux.h"
+
+static const unsigned long NETSCAN_TIMEOUT_MS = 90000;
+static const uint8_t NETSCAN_MAX_CELLS = 24;
+
+struct NetScanStats {
+  unsigned long scans = 0;    // completed scans
+  unsigned long aborted = 0;  // by a foreground command
+  unsigned long failed = 0;   // error or no answer
+  uint8_t lastCells = 0;
+};
+
+class NetScanner {
+public:
+  NetScanner(Sim800Mux& mux, CellTable& table, unsigned long intervalMs)
+      : _mux(mux), _table(table), _interval(intervalMs) {}
+
+  // Registered operator, used to anchor scans to the AT+CENG cells.
+  void setHome(uint16_t mcc, uint16_t mnc) {
+    _homeMcc = mcc;
+    _homeMnc = mnc;
+  }
+
+  // Starts a due scan while `idle` and collects a finished one. Call from loop().
+  void poll(bool idle);
+
+  bool scanning() const { return _scanning; }
+  const NetScanStats& stats() const { return _stats; }
+
+private:
+  void collect();
+
+  Sim800Mux& _mux;
+  CellTable& _table;
+  unsigned long _interval;
+  unsigned long _lastScan = 0;
+  unsigned long _scanStart = 0;
+  bool _done = false;       // a scan has completed or failed for good
+  bool _configured = false; // AT+CNETSCAN=1 sent
+  bool _scanning = false;
+  uint32_t _command = 0;    // mux background command id
+  String _response;
+  uint16_t _homeMcc = 0;
+  uint16_t _homeMnc = 0;
+  NetScanStats _stats;
+};
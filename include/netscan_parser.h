@@ -0,0 +1,73 @@
+#pragma once
+/**
+ * @file netscan_parser.h
+ * @brief Allocation-free parser for SIM800L AT+CNETSCAN results.
+ *
+ * The network scan reports the cells of every operator in range, not only
+ * those of the registered one. With AT+CNETSCAN=1 (LAC and BSIC shown) a
+ * cell line looks like
+ *
+ *   Operator:"22210",MCC:222,MNC:10,Rxlev:35,Cellid:3C4D,Arfcn:60,Lac:1A2B,Bsic:2F
+ *
+ * with Cellid and Lac in hex. Fields are matched by name, so their order
+ * does not matter. Lines without a LAC (scan display mode 0) or with a
+ * placeholder identifier are skipped, as in parseCengLine().
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ceng_parser.h"
+
+// Finds "<name>:" in [b, e) and returns the value range up to the next comma.
+inline bool netscanField(const char* b, const char* e, const char* name, const char*& vb,
+                         const char*& ve) {
+  const size_t n = strlen(name);
+  for (const char* p = b; p + n < e; ++p) {
+    if ((p == b || p[-1] == ',') && memcmp(p, name, n) == 0 && p[n] == ':') {
+      vb = p + n + 1;
+      ve = vb;
+      while (ve < e && *ve != ',') ++ve;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Parses one line (without line ending); returns false if it is not a complete cell.
+inline bool parseNetscanLine(const char* line, const char* end, CellRecord& rec) {
+  const char *vb, *ve;
+  uint32_t mcc, mnc, lac, cid, rxlev;
+  if (!netscanField(line, end, "MCC", vb, ve) || !parseCengField(vb, ve, 10, mcc)) return false;
+  if (!netscanField(line, end, "MNC", vb, ve) || !parseCengField(vb, ve, 10, mnc)) return false;
+  if (!netscanField(line, end, "Lac", vb, ve) || !parseCengField(vb, ve, 16, lac)) return false;
+  if (!netscanField(line, end, "Cellid", vb, ve) || !parseCengField(vb, ve, 16, cid)) return false;
+  rec = CellRecord();
+  rec.mcc = uint16_t(mcc);
+  rec.mnc = uint16_t(mnc);
+  rec.lac = uint16_t(lac);
+  rec.cid = cid;
+  if (netscanField(line, end, "Rxlev", vb, ve) && parseCengField(vb, ve, 10, rxlev)) {
+    rec.rxlev = uint8_t(rxlev > 63 ? 63 : rxlev);
+  }
+  return true;
+}
+
+/**
+ * @brief Parses a complete AT+CNETSCAN response.
+ * @return number of cells stored in `cells` (at most `max`)
+ */
+inline uint8_t parseNetscanResponse(const char* text, size_t len, CellRecord* cells, uint8_t max) {
+  uint8_t n = 0;
+  const char* end = text + len;
+  const char* line = text;
+  while (line < end && n < max) {
+    const char* eol = line;
+    while (eol < end && *eol != '\n') ++eol;
+    const char* e = eol;
+    if (e > line && e[-1] == '\r') --e;
+    if (parseNetscanLine(line, e, cells[n])) n++;
+    line = eol + 1;
+  }
+  return n;
+}
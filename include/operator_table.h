@@ -0,0 +1,173 @@
+#pragma once
+/**
+ * @file operator_table.h
+ * @brief MCC/MNC -> country and operator name, resolved without the modem.
+ *
+ * The table is a subset of the ITU-T E.212 assignments: the main networks
+ * of the countries we ship to and of the larger markets. Add rows as needed;
+ * keys are mcc * 1000 + mnc, so "01" and "001" are the same network.
+ *
+ * The lookup index is a perfect hash built by the compiler (hash and
+ * displace): keys are split into buckets by one hash, and each bucket gets
+ * the first seed that sends all its keys to free slots. A lookup is two
+ * hashes, two table reads and one key compare, all from flash. The build
+ * fails with a static_assert if no placement is found, which only needs a
+ * larger OPERATOR_SLOTS.
+ *
+ * Needs C++17 (constexpr loops and local arrays); see platformio.ini.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+struct OperatorInfo {
+  uint16_t mcc;
+  uint16_t mnc;
+  const char* country;  // ISO 3166 alpha-2
+  const char* name;
+};
+
+inline constexpr OperatorInfo OPERATORS[] = {
+  // Europe
+  {202, 1, "GR", "Cosmote"},       {202, 5, "GR", "Vodafone"},      {202, 10, "GR", "Nova"},
+  {204, 4, "NL", "Vodafone"},      {204, 8, "NL", "KPN"},           {204, 16, "NL", "Odido"},
+  {204, 20, "NL", "Odido"},        {206, 1, "BE", "Proximus"},      {206, 10, "BE", "Orange"},
+  {206, 20, "BE", "BASE"},         {208, 1, "FR", "Orange"},        {208, 10, "FR", "SFR"},
+  {208, 15, "FR", "Free"},         {208, 20, "FR", "Bouygues"},     {214, 1, "ES", "Vodafone"},
+  {214, 3, "ES", "Orange"},        {214, 4, "ES", "Yoigo"},         {214, 7, "ES", "Movistar"},
+  {216, 1, "HU", "Yettel"},        {216, 30, "HU", "Telekom"},      {216, 70, "HU", "Vodafone"},
+  {222, 1, "IT", "TIM"},           {222, 10, "IT", "Vodafone"},     {222, 50, "IT", "Iliad"},
+  {222, 88, "IT", "WindTre"},      {222, 99, "IT", "WindTre"},      {226, 1, "RO", "Vodafone"},
+  {226, 3, "RO", "Telekom"},       {226, 10, "RO", "Orange"},       {228, 1, "CH", "Swisscom"},
+  {228, 2, "CH", "Sunrise"},       {228, 3, "CH", "Salt"},          {230, 1, "CZ", "T-Mobile"},
+  {230, 2, "CZ", "O2"},            {230, 3, "CZ", "Vodafone"},      {232, 1, "AT", "A1"},
+  {232, 3, "AT", "Magenta"},       {232, 10, "AT", "Drei"},         {234, 10, "GB", "O2"},
+  {234, 15, "GB", "Vodafone"},     {234, 20, "GB", "Three"},        {234, 30, "GB", "EE"},
+  {234, 33, "GB", "EE"},           {238, 1, "DK", "TDC"},           {238, 2, "DK", "Telenor"},
+  {238, 6, "DK", "3"},             {238, 20, "DK", "Telia"},        {240, 1, "SE", "Telia"},
+  {240, 2, "SE", "Tre"},           {240, 7, "SE", "Tele2"},         {242, 1, "NO", "Telenor"},
+  {242, 2, "NO", "Telia"},         {244, 5, "FI", "Elisa"},         {244, 12, "FI", "DNA"},
+  {244, 91, "FI", "Telia"},        {250, 1, "RU", "MTS"},           {250, 2, "RU", "MegaFon"},
+  {250, 20, "RU", "Tele2"},        {250, 99, "RU", "Beeline"},      {255, 1, "UA", "Vodafone"},
+  {255, 3, "UA", "Kyivstar"},      {255, 6, "UA", "lifecell"},      {260, 1, "PL", "Plus"},
+  {260, 2, "PL", "T-Mobile"},      {260, 3, "PL", "Orange"},        {260, 6, "PL", "Play"},
+  {262, 1, "DE", "Telekom"},       {262, 2, "DE", "Vodafone"},      {262, 3, "DE", "O2"},
+  {262, 7, "DE", "O2"},            {268, 1, "PT", "Vodafone"},      {268, 3, "PT", "NOS"},
+  {268, 6, "PT", "MEO"},           {272, 1, "IE", "Vodafone"},      {272, 2, "IE", "Three"},
+  {272, 3, "IE", "Eir"},           {272, 5, "IE", "Three"},         {286, 1, "TR", "Turkcell"},
+  {286, 2, "TR", "Vodafone"},      {286, 3, "TR", "Turk Telekom"},
+  // Americas
+  {302, 220, "CA", "Telus"},       {302, 610, "CA", "Bell"},        {302, 720, "CA", "Rogers"},
+  {310, 260, "US", "T-Mobile"},    {310, 410, "US", "AT&T"},        {311, 480, "US", "Verizon"},
+  {334, 20, "MX", "Telcel"},       {334, 30, "MX", "Movistar"},     {334, 50, "MX", "AT&T"},
+  {722, 70, "AR", "Movistar"},     {722, 310, "AR", "Claro"},       {722, 340, "AR", "Personal"},
+  {724, 2, "BR", "TIM"},           {724, 3, "BR", "TIM"},           {724, 4, "BR", "TIM"},
+  {724, 5, "BR", "Claro"},         {724, 6, "BR", "Vivo"},          {724, 10, "BR", "Vivo"},
+  {724, 11, "BR", "Vivo"},         {724, 31, "BR", "Oi"},
+  // Middle East, Asia, Oceania
+  {410, 1, "PK", "Jazz"},          {410, 3, "PK", "Ufone"},         {410, 4, "PK", "Zong"},
+  {410, 6, "PK", "Telenor"},       {420, 1, "SA", "STC"},           {420, 3, "SA", "Mobily"},
+  {420, 4, "SA", "Zain"},          {424, 2, "AE", "Etisalat"},      {424, 3, "AE", "du"},
+  {425, 1, "IL", "Partner"},       {425, 2, "IL", "Cellcom"},       {425, 3, "IL", "Pelephone"},
+  {432, 11, "IR", "MCI"},          {432, 35, "IR", "Irancell"},     {440, 10, "JP", "NTT docomo"},
+  {440, 20, "JP", "SoftBank"},     {440, 50, "JP", "au"},           {450, 5, "KR", "SK Telecom"},
+  {450, 6, "KR", "LG U+"},         {450, 8, "KR", "KT"},            {452, 1, "VN", "MobiFone"},
+  {452, 2, "VN", "Vinaphone"},     {452, 4, "VN", "Viettel"},       {460, 0, "CN", "China Mobile"},
+  {460, 1, "CN", "China Unicom"},  {460, 11, "CN", "China Telecom"}, {470, 1, "BD", "Grameenphone"},
+  {470, 2, "BD", "Robi"},          {470, 3, "BD", "Banglalink"},    {502, 12, "MY", "Maxis"},
+  {502, 13, "MY", "Celcom"},       {502, 16, "MY", "DiGi"},         {505, 1, "AU", "Telstra"},
+  {505, 2, "AU", "Optus"},         {505, 3, "AU", "Vodafone"},      {510, 1, "ID", "Indosat"},
+  {510, 10, "ID", "Telkomsel"},    {510, 11, "ID", "XL"},           {515, 2, "PH", "Globe"},
+  {515, 3, "PH", "Smart"},         {520, 3, "TH", "AIS"},           {520, 4, "TH", "True"},
+  {525, 1, "SG", "Singtel"},       {525, 3, "SG", "M1"},            {525, 5, "SG", "StarHub"},
+  {530, 1, "NZ", "One NZ"},        {530, 5, "NZ", "Spark"},         {530, 24, "NZ", "2degrees"},
+  // Africa
+  {602, 1, "EG", "Orange"},        {602, 2, "EG", "Vodafone"},      {602, 3, "EG", "Etisalat"},
+  {621, 20, "NG", "Airtel"},       {621, 30, "NG", "MTN"},          {621, 50, "NG", "Glo"},
+  {639, 2, "KE", "Safaricom"},     {639, 3, "KE", "Airtel"},        {655, 1, "ZA", "Vodacom"},
+  {655, 7, "ZA", "Cell C"},        {655, 10, "ZA", "MTN"},
+};
+
+constexpr size_t OPERATOR_COUNT = sizeof(OPERATORS) / sizeof(OPERATORS[0]);
+constexpr size_t OPERATOR_SLOTS = 512;   // power of two, > OPERATOR_COUNT
+constexpr size_t OPERATOR_BUCKETS = 64;  // power of two
+constexpr uint32_t OPERATOR_MAX_SEED = 4096;
+
+constexpr uint32_t operatorKey(uint16_t mcc, uint16_t mnc) {
+  return uint32_t(mcc) * 1000 + mnc;
+}
+
+constexpr uint32_t operatorHash(uint32_t key, uint32_t seed) {
+  uint32_t h = key ^ (seed * 0x9E3779B9u);
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h;
+}
+
+struct OperatorIndex {
+  uint16_t seed[OPERATOR_BUCKETS];
+  uint8_t slot[OPERATOR_SLOTS];  // OPERATORS index + 1, 0 = empty
+  bool ok;
+};
+
+// Places the largest buckets first, each with the first seed that fits.
+constexpr OperatorIndex buildOperatorIndex() {
+  OperatorIndex idx{};
+  idx.ok = true;
+  uint8_t bucketOf[OPERATOR_COUNT] = {};
+  size_t size[OPERATOR_BUCKETS] = {};
+  for (size_t i = 0; i < OPERATOR_COUNT; ++i) {
+    bucketOf[i] = uint8_t(operatorHash(operatorKey(OPERATORS[i].mcc, OPERATORS[i].mnc), 0) %
+                          OPERATOR_BUCKETS);
+    size[bucketOf[i]]++;
+  }
+  bool done[OPERATOR_BUCKETS] = {};
+  for (size_t round = 0; round < OPERATOR_BUCKETS; ++round) {
+    size_t b = 0;
+    for (size_t j = 0; j < OPERATOR_BUCKETS; ++j) {
+      if (!done[j] && (done[b] || size[j] > size[b])) b = j;
+    }
+    done[b] = true;
+    if (size[b] == 0) continue;
+    bool placed = false;
+    for (uint32_t seed = 1; seed < OPERATOR_MAX_SEED && !placed; ++seed) {
+      size_t slots[OPERATOR_COUNT] = {};
+      size_t n = 0;
+      bool fits = true;
+      for (size_t i = 0; i < OPERATOR_COUNT && fits; ++i) {
+        if (bucketOf[i] != b) continue;
+        size_t s = operatorHash(operatorKey(OPERATORS[i].mcc, OPERATORS[i].mnc), seed) % OPERATOR_SLOTS;
+        if (idx.slot[s] != 0) fits = false;
+        for (size_t k = 0; k < n && fits; ++k) {
+          if (slots[k] == s) fits = false;
+        }
+        slots[n++] = s;
+      }
+      if (!fits) continue;
+      n = 0;
+      for (size_t i = 0; i < OPERATOR_COUNT; ++i) {
+        if (bucketOf[i] == b) idx.slot[slots[n++]] = uint8_t(i + 1);
+      }
+      idx.seed[b] = uint16_t(seed);
+      placed = true;
+    }
+    if (!placed) idx.ok = false;
+  }
+  return idx;
+}
+
+inline constexpr OperatorIndex OPERATOR_INDEX = buildOperatorIndex();
+static_assert(OPERATOR_INDEX.ok, "operator perfect hash: increase OPERATOR_SLOTS");
+static_assert(OPERATOR_COUNT < 256, "operator index stores 8-bit positions");
+
+// Returns the operator for (mcc, mnc), or nullptr if it is not in the table.
+constexpr const OperatorInfo* findOperator(uint16_t mcc, uint16_t mnc) {
+  const uint32_t key = operatorKey(mcc, mnc);
+  const uint16_t seed = OPERATOR_INDEX.seed[operatorHash(key, 0) % OPERATOR_BUCKETS];
+  const uint8_t i = OPERATOR_INDEX.slot[operatorHash(key, seed) % OPERATOR_SLOTS];
+  if (i == 0) return nullptr;
+  const OperatorInfo& op = OPERATORS[i - 1];
+  return operatorKey(op.mcc, op.mnc) == key ? &op : nullptr;
+}
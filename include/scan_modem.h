@@ -0,0 +1,70 @@
+#pragma once
+/**
+ * @file scan_modem.h
+ * @brief Extra modems on their own UARTs, used only for cell scans.
+ *
+ * One modem reports the cells of its own operator only. A scan modem, of
+ * the same type as the data modem (modem_traits.h), carries a SIM of
+ * another operator and runs its cell query rounds in its own FreeRTOS task,
+ * in parallel with the data modem's, so its cells join the observation
+ * without adding to the time a fix takes. The data modem (TinyGSM, the mux)
+ * stays on the loop task and is unaffected.
+ *
+ *   startScan()  wakes the task, which collects up to `rounds` answers
+ *                (stopping at the first complete one) and signals;
+ *   collect()    waits for that and adds the answers to a CellFusion
+ *                without a serving-cell vote.
+ *
+ * A modem that answers nothing within the wait is skipped for that fix.
+ */
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "cell_fusion.h"
+#include "sim800_at.h"
+
+static const uint8_t SCAN_MODEM_MAX_ROUNDS = 5;
+static const uint32_t SCAN_MODEM_STACK = 4096;
+
+class ScanModem {
+public:
+  ScanModem(const char* name, HardwareSerial& serial, int8_t rxPin, int8_t txPin,
+            uint32_t baud = 9600)
+      : _name(name), _serial(serial), _at(serial), _rxPin(rxPin), _txPin(txPin), _baud(baud) {}
+
+  // Opens the UART, enables engineering mode and starts the task.
+  bool begin();
+
+  // Starts one scan window in the background. False while one is running.
+  bool startScan(uint8_t rounds);
+
+  // Waits up to `timeout` for the window and adds its answers to `fusion`.
+  bool collect(CellFusion& fusion, unsigned long timeout);
+
+  const char* name() const { return _name; }
+  bool ready() const { return _task != nullptr; }
+  // False while a scan window is running.
+  bool finished() const { return !_busy; }
+
+private:
+  static void taskEntry(void* arg);
+  void run();
+  void scan();
+
+  const char* _name;
+  HardwareSerial& _serial;
+  Sim800At _at;
+  int8_t _rxPin, _txPin;
+  uint32_t _baud;
+
+  TaskHandle_t _task = nullptr;
+  SemaphoreHandle_t _done = nullptr;
+  volatile bool _busy = false;
+
+  // Written by the task while _busy, read by collect() after _done.
+  uint8_t _rounds = 0;
+  CellSnapshot _answers[SCAN_MODEM_MAX_ROUNDS];
+  uint8_t _answerCount = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+/**
+ * @file seqlock.h
+ * @brief Single-writer snapshot of a value that readers copy without locking.
+ *
+ * loop() owns the latest fix and the cell table; the scan modem tasks, a
+ * console or the USB protocol may want to read them from the other core.
+ * Seqlock<T> keeps two copies of T and a sequence counter (a seqlock
+ * "latch"): write() updates the copy readers are not directed to, then
+ * the other one, bumping the counter before each. read() copies the slot
+ * the counter points at and checks that the counter did not move; it
+ * never waits for the writer and only retries if the writer finished a
+ * whole half-update during the copy.
+ *
+ * T must be trivially copyable. There must be one writer at a time; call
+ * write() from one task only.
+ */
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock<T> copies T bytewise");
+
+public:
+  Seqlock() = default;
+  explicit Seqlock(const T& value) {
+    _slot[0] = value;
+    _slot[1] = value;
+  }
+
+  void write(const T& value) {
+    // Readers move to slot 1 while slot 0 changes, then back
+    for (uint8_t i = 0; i < 2; ++i) {
+      _seq.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      memcpy((void*)&_slot[i], &value, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+  }
+
+  T read() const {
+    T out;
+    uint32_t seq;
+    do {
+      seq = _seq.load(std::memory_order_acquire);
+      memcpy(&out, (const void*)&_slot[seq & 1], sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while (_seq.load(std::memory_order_relaxed) != seq);
+    return out;
+  }
+
+  // Number of write() calls, for readers that only want to know of a change.
+  uint32_t version() const { return _seq.load(std::memory_order_acquire) / 2; }
+
+private:
+  std::atomic<uint32_t> _seq{0};
+  T _slot[2];
+};
@@ -0,0 +1,53 @@
+#pragma once
+/**
+ * @file sim800_at.h
+ * @brief Minimal AT command channel for the SIM800L.
+ *
+ * Wraps the modem UART with line-oriented helpers so modules that speak raw
+ * AT commands (UDP reports, sockets, SMS) do not each re-implement the
+ * sendAT/readAT loops from `test/main3.cpp`.
+ */
+#include <Arduino.h>
+
+enum AtResult {
+  AT_OK,       // final "OK"
+  AT_ERROR,    // "ERROR", "+CME ERROR" or "+CMS ERROR"
+  AT_MATCH,    // a line containing the expected token
+  AT_TIMEOUT,
+};
+
+class Sim800At {
+public:
+  explicit Sim800At(Stream& serial) : _serial(serial) {}
+
+  // Writes `cmd` followed by CR LF.
+  void send(const String& cmd);
+
+  /**
+   * @brief Reads lines until a final result code or `expect` is seen.
+   *
+   * Intermediate lines are appended to `out` (newline separated) when given.
+   * With `expect` set, a line containing it ends the wait with AT_MATCH.
+   */
+  AtResult waitResponse(unsigned long timeout, String* out = nullptr, const char* expect = nullptr);
+
+  // send() + waitResponse().
+  AtResult command(const String& cmd, unsigned long timeout = 1000, String* out = nullptr,
+                   const char* expect = nullptr);
+
+  // Reads one non-empty line without its CR LF. Returns false on timeout.
+  bool readLine(String& line, unsigned long timeout);
+
+  // Waits for the "> " data prompt of AT+CIPSEND / AT+CMGS.
+  bool waitPrompt(unsigned long timeout);
+
+  // Reads exactly `len` raw bytes. Returns the number actually read.
+  size_t readRaw(uint8_t* buf, size_t len, unsigned long timeout);
+
+  void writeRaw(const uint8_t* data, size_t len) { _serial.write(data, len); }
+
+  Stream& stream() { return _serial; }
+
+private:
+  Stream& _serial;
+};
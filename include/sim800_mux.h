@@ -0,0 +1,223 @@
+#pragma once
+/**
+ * @file sim800_mux.h
+ * @brief Multiplexed SIM800L TCP/UDP sockets (AT+CIPMUX=1).
+ *
+ * The SIM800L can hold six connections at once, but only one AT command can
+ * be outstanding on the UART. Sim800Mux serialises commands and, while
+ * waiting for any of them, dispatches the unsolicited lines that belong to
+ * the other links:
+ *
+ *   +RECEIVE,<n>,<len>:       incoming data, copied to link n's rx buffer
+ *   <n>, CONNECT OK / FAIL    connection state
+ *   <n>, SEND OK / FAIL       completion of the link's AT+CIPSEND
+ *   <n>, CLOSED               remote close
+ *
+ * Each link sends in chunks no larger than the size the modem reports for it
+ * in AT+CIPSEND?, with one chunk outstanding at a time, so a slow link never
+ * blocks the queue for longer than one chunk. With quick send (AT+CIPQSEND=1)
+ * a chunk completes on "DATA ACCEPT" as soon as the modem has buffered it,
+ * instead of on "SEND OK" after the peer's TCP ack.
+ *
+ * MuxSocket exposes a link as an Arduino Client, so the geocode request, the
+ * SMTP session and the telemetry uploads can each hold their own socket.
+ *
+ * The mux owns the modem's IP stack configuration: after begin(), use
+ * MuxSocket rather than TinyGsmClient for data connections.
+ */
+#include <Arduino.h>
+#include <Client.h>
+
+#include <mutex>
+
+#include "sim800_at.h"
+
+static const uint8_t SIM800_MAX_LINKS = 6;
+static const size_t SIM800_LINK_RX_BYTES = 1024;
+static const size_t SIM800_DEFAULT_MAX_SEND = 1024;
+static const unsigned long SIM800_ABORT_WAIT_MS = 2000;
+
+enum LinkState : uint8_t {
+  LINK_FREE,
+  LINK_IDLE,        // allocated, not connected
+  LINK_CONNECTING,
+  LINK_CONNECTED,
+  LINK_CLOSED,      // closed by the remote end or the network
+};
+
+struct LinkStats {
+  unsigned long bytesIn = 0;
+  unsigned long bytesOut = 0;
+  unsigned long dropped = 0;  // received bytes lost to a full rx buffer
+};
+
+class Sim800Mux {
+public:
+  typedef void (*UrcHandler)(const String& line, void* ctx);
+
+  explicit Sim800Mux(Sim800At& at) : _at(at) {}
+
+  // Switches the IP stack to multi-link mode with pushed (+RECEIVE) data.
+  bool begin();
+
+  // Selects AT+CIPQSEND=1 (complete on DATA ACCEPT) or =0 (on SEND OK).
+  bool setQuickSend(bool enabled);
+  bool quickSend() const { return _quickSend; }
+
+  // Number of allocated links; transparent mode needs this to be zero.
+  uint8_t linksInUse() const;
+
+  // Dispatches whatever the modem has sent since the last call. Non-blocking.
+  void poll();
+
+  // Runs one AT command; links keep being serviced while it is pending.
+  AtResult command(const String& cmd, unsigned long timeout = 1000, String* out = nullptr,
+                   const char* expect = nullptr);
+
+  // Receives unsolicited lines that are not socket events (+CMTI, RING, ...).
+  void setUrcHandler(UrcHandler handler, void* ctx);
+
+  // Starts a long command (network scans) and returns at once; poll()
+  // collects its answer into `out`. Returns the command's id, 0 if one is
+  // already running. `expect` ends it with AT_MATCH as for command(); ">"
+  // matches the data prompt of AT+CMGS / AT+CIPSEND. An empty `cmd` sends
+  // nothing and only waits, e.g. for the result of data written after a
+  // prompt.
+  uint32_t startBackground(const String& cmd, unsigned long timeout, String* out,
+                           const char* expect = nullptr);
+  bool backgroundPending() const { return _background; }
+  bool backgroundPending(uint32_t id) const { return _background && id == _backgroundId; }
+  // AT_TIMEOUT if command `id` timed out or was aborted.
+  AtResult backgroundResult(uint32_t id) const {
+    return id == _backgroundId ? _backgroundResult : AT_TIMEOUT;
+  }
+
+  // Aborts the background command with one character, as 27.007 scans allow,
+  // and waits briefly for its final result. Foreground commands do this first.
+  void abortBackground();
+
+  int allocate();
+  void release(uint8_t link);
+  bool open(uint8_t link, const char* proto, const char* host, uint16_t port,
+            unsigned long timeout = 15000);
+  // open() in steps, for code that runs the command on the background slot
+  // (AsyncModem) instead of blocking for CONNECT OK: openCommand() marks the
+  // link connecting and returns its AT+CIPSTART, poll() takes the link out
+  // of LINK_CONNECTING when the modem reports the outcome, and finishOpen()
+  // completes it as open() does. A link that did not connect is LINK_IDLE.
+  // With `ssl` the modem runs TLS on the link (AT+CIPSSL=1, set here with a
+  // short blocking command, so hold the modem as for the AT+CIPSTART);
+  // empty if the modem refused it.
+  String openCommand(uint8_t link, const char* proto, const char* host, uint16_t port,
+                     bool ssl = false);
+  bool finishOpen(uint8_t link);
+  size_t send(uint8_t link, const uint8_t* data, size_t len);
+  void close(uint8_t link);
+
+  LinkState state(uint8_t link) const { return _links[link].state; }
+  size_t available(uint8_t link) const { return _links[link].count; }
+  int read(uint8_t link);
+  int peek(uint8_t link) const;
+  size_t read(uint8_t link, uint8_t* buf, size_t len);
+  const LinkStats& stats(uint8_t link) const { return _links[link].stats; }
+
+  Sim800At& at() { return _at; }
+
+  // Held by code that takes the UART out of multi-link mode (transparent mode).
+  std::recursive_mutex& lock() { return _lock; }
+
+private:
+  struct Link {
+    LinkState state = LINK_FREE;
+    bool sendPending = false;
+    bool sendFailed = false;
+    size_t maxSend = SIM800_DEFAULT_MAX_SEND;
+    uint8_t rx[SIM800_LINK_RX_BYTES];
+    size_t head = 0;
+    size_t count = 0;
+    LinkStats stats;
+  };
+
+  bool nextLine(String& line);
+  void handleLine(const String& line);
+  bool handleLinkEvent(const String& line);
+  void receive(uint8_t link, size_t len);
+  void querySendSizes();
+  void finishBackground();
+
+  // Services the UART until `done()` holds or `timeout` expires.
+  template <typename Pred>
+  bool pumpUntil(unsigned long timeout, Pred done) {
+    unsigned long start = millis();
+    String line;
+    for (;;) {
+      while (nextLine(line)) handleLine(line);
+      if (done()) return true;
+      if (millis() - start >= timeout) return false;
+      delay(1);
+    }
+  }
+
+  Sim800At& _at;
+  Link _links[SIM800_MAX_LINKS];
+  std::recursive_mutex _lock;
+  String _partial;
+  bool _prompt = false;
+  bool _quickSend = false;
+  bool _ssl = false;  // AT+CIPSSL of the next AT+CIPSTART
+
+  // State of the command currently waiting for its final result.
+  bool _waiting = false;
+  AtResult _result = AT_TIMEOUT;
+  String* _out = nullptr;
+  const char* _expect = nullptr;
+
+  // Background command; shares the state above while it runs.
+  bool _background = false;
+  uint32_t _backgroundId = 0;
+  unsigned long _backgroundStart = 0;
+  unsigned long _backgroundTimeout = 0;
+  AtResult _backgroundResult = AT_TIMEOUT;
+
+  UrcHandler _urcHandler = nullptr;
+  void* _urcCtx = nullptr;
+};
+
+// One multiplexed link as an Arduino Client.
+class MuxSocket : public Client {
+public:
+  explicit MuxSocket(Sim800Mux& mux) : _mux(mux) {}
+  ~MuxSocket() { stop(); }
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char* host, uint16_t port) override;
+  // Opens a UDP "connection" to host:port.
+  bool connectUdp(const char* host, uint16_t port);
+
+  // connect() without blocking, for CoopTask code: run the returned
+  // AT+CIPSTART while holding the modem (empty if no link is free or the
+  // modem refused `ssl`), wait while connecting(), then finishConnect()
+  // holding it again.
+  String startConnect(const char* host, uint16_t port, bool ssl = false);
+  bool connecting();
+  bool finishConnect();
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return _link >= 0; }
+
+  int link() const { return _link; }
+
+private:
+  bool open(const char* proto, const char* host, uint16_t port);
+
+  Sim800Mux& _mux;
+  int _link = -1;
+};
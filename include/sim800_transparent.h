@@ -0,0 +1,84 @@
+#pragma once
+/**
+ * @file sim800_transparent.h
+ * @brief Transparent-mode (AT+CIPMODE=1) data path for bulk transfers.
+ *
+ * In transparent mode the UART carries the TCP stream directly: no
+ * AT+CIPSEND prompt per chunk, no "+RECEIVE" headers. The modem only
+ * supports it with a single connection (AT+CIPMUX=0), so connecting tears
+ * down the multiplexed stack, and stop() brings it back. No mux link may be
+ * allocated while a TransparentSocket is connected.
+ *
+ * "+++" with a guard time of silence on both sides switches back to command
+ * mode (escape()); ATO resumes the data stream (resume()).
+ */
+#include <Arduino.h>
+#include <Client.h>
+
+#include <mutex>
+
+#include "sim800_mux.h"
+
+// Data path of bulk uploads over GPRS.
+enum SendMode : uint8_t {
+  SEND_MODE_PROMPT,       // mux link, AT+CIPSEND chunks complete on SEND OK
+  SEND_MODE_QUICK,        // mux link, AT+CIPQSEND=1: complete on DATA ACCEPT
+  SEND_MODE_TRANSPARENT,  // TransparentSocket, AT+CIPMODE=1 on a single link
+};
+
+const char* sendModeName(SendMode mode);
+
+struct GprsApn {
+  const char* apn;
+  const char* user;
+  const char* pass;
+};
+
+class TransparentSocket : public Client {
+public:
+  TransparentSocket(Sim800Mux& mux, const GprsApn& apn) : _mux(mux), _apn(apn) {}
+  ~TransparentSocket() { stop(); }
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char* host, uint16_t port) override;
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override;
+  void stop() override;
+  uint8_t connected() override { return _state == STATE_DATA; }
+  operator bool() override { return _state != STATE_CLOSED; }
+
+  // Data mode -> command mode ("+++"), keeping the connection open.
+  bool escape();
+  // Command mode -> data mode ("ATO").
+  bool resume();
+
+private:
+  enum State { STATE_CLOSED, STATE_DATA, STATE_COMMAND };
+
+  bool reconfigure(bool transparent);
+
+  Sim800Mux& _mux;
+  GprsApn _apn;
+  std::unique_lock<std::recursive_mutex> _hold;
+  State _state = STATE_CLOSED;
+  unsigned long _lastWrite = 0;
+};
+
+/**
+ * @brief Compares the three send paths for typical payload sizes.
+ *
+ * Sends payloads of 32 B (UDP fix datagram), 200 B (JSON fix), 1 KB (MQTT
+ * batch) and 4 KB (survey log chunk) to tools/send_sink.cpp at host:port in
+ * each SendMode. Every payload is framed as [u32 length][bytes] and the sink
+ * answers with the length once it has read them all, so each mode is timed
+ * to the server's ack, not to the point where the modem took the data.
+ * Prints, per mode and size, how long write() blocked and when the ack came.
+ */
+void runSendModeBenchmark(Sim800Mux& mux, const GprsApn& apn, const char* host, uint16_t port,
+                          Print& out);
@@ -0,0 +1,112 @@
+#pragma once
+/**
+ * @file sms_inbox.h
+ * @brief Incoming SMS: +CMTI indices, AT+CMGR parsing and the sender whitelist.
+ *
+ * With AT+CNMI=2,1 the modem stores each message and announces it with
+ * "+CMTI: "SM",<index>". The URC can arrive in the middle of any command,
+ * so onUrc() (a Sim800Mux::UrcHandler) only queues the index; a task
+ * fetches the message later with AT+CMGR=<index> and, once it has been
+ * read and parsed, deletes it with AT+CMGD=<index>. URCs the mux did not
+ * see (TinyGSM or the SMS code held the UART) are caught up with AT+CMGL,
+ * see queueListed().
+ *
+ * Messages from numbers outside the whitelist are read like any other, then
+ * deleted and left unanswered by the caller. Numbers are compared as given,
+ * e.g. "+1234567890".
+ */
+#include <Arduino.h>
+
+#include "at_response.h"
+
+static const uint8_t SMS_INBOX_QUEUE = 8;
+static const size_t SMS_NUMBER_MAX = 24;
+static const size_t SMS_TEXT_MAX = 160;
+
+struct SmsMessage {
+  char sender[SMS_NUMBER_MAX + 1] = "";
+  char text[SMS_TEXT_MAX + 1] = "";
+};
+
+class SmsInbox {
+public:
+  // Sim800Mux::UrcHandler; ctx is the SmsInbox.
+  static void onUrc(const String& line, void* ctx) {
+    AtValues<2> v;
+    if (parseAtLine(AT_CMTI, line.c_str(), line.c_str() + line.length(), v)) {
+      static_cast<SmsInbox*>(ctx)->queue(uint16_t(v[AT_FIELD(AT_CMTI, index)].num));
+    }
+  }
+
+  // Queues every message index of an AT+CMGL answer.
+  void queueListed(const String& resp) {
+    parseAtLines(AT_CMGL, resp.c_str(), resp.length(), [this](const AtValues<3>& v) {
+      queue(uint16_t(v[AT_FIELD(AT_CMGL, index)].num));
+    });
+  }
+
+  // False if the queue is full; the message then waits for the next AT+CMGL.
+  bool queue(uint16_t index) {
+    for (uint8_t i = 0; i < _count; ++i) {
+      if (_queue[(_head + i) % SMS_INBOX_QUEUE] == index) return true;
+    }
+    if (_count == SMS_INBOX_QUEUE) return false;
+    _queue[(_head + _count++) % SMS_INBOX_QUEUE] = index;
+    return true;
+  }
+
+  bool next(uint16_t& index) {
+    if (_count == 0) return false;
+    index = _queue[_head];
+    _head = (_head + 1) % SMS_INBOX_QUEUE;
+    _count--;
+    return true;
+  }
+
+  bool empty() const { return _count == 0; }
+
+  // Sender and text of an AT+CMGR answer (text mode); the text is trimmed
+  // and cut at SMS_TEXT_MAX.
+  static bool parseMessage(const String& resp, SmsMessage& msg) {
+    AtValues<4> v;
+    const char* text = resp.c_str();
+    const char* end = text + resp.length();
+    const char* line = text;
+    while (line < end) {
+      const char* eol = line;
+      while (eol < end && *eol != '\n') ++eol;
+      const char* le = eol > line && eol[-1] == '\r' ? eol - 1 : eol;
+      if (parseAtLine(AT_CMGR, line, le, v)) {
+        copyRange(msg.sender, SMS_NUMBER_MAX, v[AT_FIELD(AT_CMGR, oa)].str,
+                  v[AT_FIELD(AT_CMGR, oa)].len);
+        // The text is everything after the header line
+        const char* b = eol < end ? eol + 1 : end;
+        const char* e = end;
+        while (b < e && isspace((unsigned char)*b)) ++b;
+        while (e > b && isspace((unsigned char)e[-1])) --e;
+        copyRange(msg.text, SMS_TEXT_MAX, b, size_t(e - b));
+        return true;
+      }
+      line = eol + 1;
+    }
+    return false;
+  }
+
+  static bool authorized(const char* sender, const char* const* whitelist, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      if (strcmp(sender, whitelist[i]) == 0) return true;
+    }
+    return false;
+  }
+
+private:
+  static void copyRange(char* out, size_t max, const char* s, size_t len) {
+    if (len > max) len = max;
+    memcpy(out, s, len);
+    out[len] = '\0';
+  }
+
+  uint16_t _queue[SMS_INBOX_QUEUE];
+  uint8_t _head = 0;
+  uint8_t _count = 0;
+};
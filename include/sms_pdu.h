@@ -0,0 +1,170 @@
+#pragma once
+/**
+ * @file sms_pdu.h
+ * @brief SMS-SUBMIT PDUs in the GSM 7-bit alphabet, split into segments.
+ *
+ * Text mode sends at most 160 characters and re-reads the text for every
+ * AT+CMGS. In PDU mode the user data of each segment (concatenation header
+ * plus packed septets) is independent of the recipient, so smsEncode()
+ * builds it once, already as hex, and smsPduHeader() only adds the few
+ * octets that name the recipient.
+ *
+ * ASCII maps to GSM 03.38, with [ ] { } \ ^ | ~ as two-septet escapes;
+ * other characters (UTF-8 sequences included) become '?'. A text longer
+ * than one SMS is sent as up to SMS_MAX_SEGMENTS concatenated segments of
+ * 153 septets (8-bit reference); the rest is cut.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+static const uint8_t SMS_MAX_SEGMENTS = 6;
+static const uint8_t SMS_SEPTETS_SINGLE = 160;
+static const uint8_t SMS_SEPTETS_CONCAT = 153;
+static const uint8_t SMS_UD_MAX = 140;  // octets of user data
+static const uint8_t SMS_CONCAT_UDH = 6;  // 05 00 03 ref total seq
+
+struct SmsSegment {
+  uint8_t udl = 0;                   // TP-UDL: septets, header included
+  uint8_t udOctets = 0;
+  char udHex[2 * SMS_UD_MAX + 1];    // TP-UD as hex, ready to write
+};
+
+struct SmsEncoded {
+  uint8_t count = 0;
+  bool concat = false;
+  bool truncated = false;
+  SmsSegment segments[SMS_MAX_SEGMENTS];
+};
+
+// GSM 03.38 septets of one ASCII character: 1, or 2 for an escape.
+inline uint8_t gsm7Septets(char ch, uint8_t out[2]) {
+  const uint8_t c = uint8_t(ch);
+  switch (c) {
+    case '@': out[0] = 0x00; return 1;
+    case '$': out[0] = 0x02; return 1;
+    case '_': out[0] = 0x11; return 1;
+    case '[': out[1] = 0x3C; break;
+    case '\\': out[1] = 0x2F; break;
+    case ']': out[1] = 0x3E; break;
+    case '^': out[1] = 0x14; break;
+    case '{': out[1] = 0x28; break;
+    case '|': out[1] = 0x40; break;
+    case '}': out[1] = 0x29; break;
+    case '~': out[1] = 0x3D; break;
+    default:
+      if (c == '\n' || c == '\r' || (c >= 0x20 && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+        out[0] = c;
+      } else {
+        out[0] = '?';  // '`', control and non-ASCII characters
+      }
+      return 1;
+  }
+  out[0] = 0x1B;
+  return 2;
+}
+
+inline void smsHexByte(uint8_t b, char* out) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  out[0] = HEX_DIGITS[b >> 4];
+  out[1] = HEX_DIGITS[b & 0x0F];
+}
+
+// Packs septets after `udh` (may be empty) into one segment's TP-UD.
+inline void smsPackSegment(const uint8_t* udh, uint8_t udhLen, const uint8_t* septets, uint8_t n,
+                           SmsSegment& seg) {
+  uint8_t ud[SMS_UD_MAX] = {0};
+  for (uint8_t i = 0; i < udhLen; ++i) ud[i] = udh[i];
+  // Septets start at the first septet boundary after the header
+  const uint16_t headerBits = udhLen * 8;
+  const uint16_t start = (headerBits + 6) / 7 * 7;
+  for (uint8_t i = 0; i < n; ++i) {
+    const uint16_t bit = start + i * 7;
+    const uint16_t v = uint16_t(septets[i] & 0x7F) << (bit % 8);
+    ud[bit / 8] |= uint8_t(v);
+    if ((bit % 8) > 1) ud[bit / 8 + 1] |= uint8_t(v >> 8);
+  }
+  seg.udl = uint8_t(start / 7 + n);
+  seg.udOctets = uint8_t((start + n * 7 + 7) / 8);
+  for (uint8_t i = 0; i < seg.udOctets; ++i) smsHexByte(ud[i], seg.udHex + 2 * i);
+  seg.udHex[2 * seg.udOctets] = '\0';
+}
+
+/**
+ * @brief Encodes `text` into segments; `ref` identifies a concatenated message.
+ * @return false if the text did not fit into SMS_MAX_SEGMENTS (it is cut)
+ */
+inline bool smsEncode(const char* text, size_t len, uint8_t ref, SmsEncoded& out) {
+  static const uint16_t MAX_SEPTETS = SMS_MAX_SEGMENTS * SMS_SEPTETS_CONCAT;
+  uint8_t septets[MAX_SEPTETS];
+  uint16_t n = 0;
+  // Segment boundaries, never between an escape and its character
+  uint16_t cuts[SMS_MAX_SEGMENTS + 1] = {0};
+  uint8_t segments = 1;
+  out.truncated = false;
+  for (size_t i = 0; i < len; ++i) {
+    const uint8_t c = uint8_t(text[i]);
+    if ((c & 0xC0) == 0x80) continue;  // UTF-8 continuation: one '?' per character
+    uint8_t s[2];
+    const uint8_t k = gsm7Septets(char(c), s);
+    if (n + k - cuts[segments - 1] > SMS_SEPTETS_CONCAT) {
+      if (segments == SMS_MAX_SEGMENTS) {
+        out.truncated = true;
+        break;
+      }
+      cuts[segments++] = n;
+    }
+    for (uint8_t j = 0; j < k; ++j) septets[n++] = s[j];
+  }
+  cuts[segments] = n;
+
+  out.concat = n > SMS_SEPTETS_SINGLE;
+  if (!out.concat) {
+    out.count = 1;
+    smsPackSegment(nullptr, 0, septets, uint8_t(n), out.segments[0]);
+    return true;
+  }
+  out.count = segments;
+  for (uint8_t i = 0; i < segments; ++i) {
+    const uint8_t udh[SMS_CONCAT_UDH] = {0x05, 0x00, 0x03, ref, segments, uint8_t(i + 1)};
+    smsPackSegment(udh, SMS_CONCAT_UDH, septets + cuts[i], uint8_t(cuts[i + 1] - cuts[i]),
+                   out.segments[i]);
+  }
+  return !out.truncated;
+}
+
+/**
+ * @brief Writes the recipient-specific start of an SMS-SUBMIT as hex.
+ *
+ * SMSC (from the SIM), first octet, TP-MR, TP-DA, TP-PID, TP-DCS and
+ * TP-UDL; the segment's udHex follows it.
+ *
+ * @param out at least 2 * (7 + 12) + 1 chars
+ * @return octets for AT+CMGS=<n> (the whole TPDU, without the SMSC octet)
+ */
+inline size_t smsPduHeader(const SmsSegment& seg, bool concat, const char* number, char* out) {
+  size_t o = 0;
+  auto put = [&](uint8_t b) {
+    smsHexByte(b, out + o);
+    o += 2;
+  };
+  const bool international = number[0] == '+';
+  if (international) ++number;
+  uint8_t digits = 0;
+  while (number[digits] >= '0' && number[digits] <= '9' && digits < 20) ++digits;
+
+  put(0x00);                        // SMSC from the SIM
+  put(concat ? 0x41 : 0x01);        // SMS-SUBMIT, UDHI with a header
+  put(0x00);                        // TP-MR, assigned by the modem
+  put(digits);
+  put(international ? 0x91 : 0x81);
+  for (uint8_t i = 0; i < digits; i += 2) {
+    const uint8_t lo = uint8_t(number[i] - '0');
+    const uint8_t hi = i + 1 < digits ? uint8_t(number[i + 1] - '0') : 0x0F;
+    put(uint8_t(hi << 4 | lo));
+  }
+  put(0x00);                        // TP-PID
+  put(0x00);                        // TP-DCS: GSM 7-bit
+  put(seg.udl);
+  out[o] = '\0';
+  return o / 2 - 1 + seg.udOctets;
+}
@@ -0,0 +1,80 @@
+#pragma once
+/**
+ * @file sms_sender.h
+ * @brief Sends one text to several numbers over a single PDU-mode session.
+ *
+ * The text is encoded once (sms_pdu.h) and each segment's user data is
+ * reused for every recipient; only the destination octets differ. The
+ * modem is switched to PDU mode once per run and the segments go out
+ * back to back. A failed segment ends its recipient's turn in the pass; the
+ * next pass resumes that recipient from that segment on, so the others are
+ * not held up and nobody gets a segment twice.
+ *
+ * The modem is left in text mode (AT+CMGF=1), which SmsInbox relies on.
+ * The sender is a CoopSubtask: it holds the AsyncModem from AT+CMGF=0 to
+ * AT+CMGF=1, so no other task's command lands in PDU mode or in the middle
+ * of a PDU, while the rest of the loop keeps running:
+ *
+ *   CO_AWAIT(smsSender.claim(this));
+ *   smsSender.prepare(text, numbers, count);
+ *   CO_RUN(smsSender);
+ *   ... smsSender.result(i) ...
+ *   smsSender.release(this);
+ *
+ * The caller must not hold the AsyncModem itself meanwhile.
+ */
+#include <Arduino.h>
+
+#include "async_modem.h"
+#include "coop_task.h"
+#include "sms_pdu.h"
+
+static const uint8_t SMS_MAX_RECIPIENTS = 8;
+
+struct SmsSendConfig {
+  uint8_t attempts = 3;                 // passes over undelivered recipients
+  unsigned long promptTimeoutMs = 5000;
+  unsigned long sendTimeoutMs = 60000;  // network answer to AT+CMGS
+  unsigned long retryDelayMs = 3000;    // between passes over failed recipients
+};
+
+struct SmsRecipientResult {
+  const char* number = nullptr;
+  uint8_t sent = 0;       // segments accepted by the network, in order
+  uint8_t attempts = 0;   // AT+CMGS issued, retries included
+  int16_t lastMr = -1;    // TP-MR of the last accepted segment
+  bool ok = false;        // every segment sent
+};
+
+class SmsSender : public CoopSubtask {
+public:
+  explicit SmsSender(AsyncModem& modem, const SmsSendConfig& config = SmsSendConfig())
+      : _modem(modem), _config(config) {}
+
+  // Encodes `text` for `count` numbers (at most SMS_MAX_RECIPIENTS), to be
+  // sent by the next run. The numbers must stay valid until it has finished.
+  void prepare(const String& text, const char* const* numbers, uint8_t count);
+
+  // Sends what prepare() set up. Run with CO_RUN().
+  CoStatus step() override;
+
+  // Recipients that received every segment in the last run.
+  uint8_t delivered() const { return _delivered; }
+  uint8_t resultCount() const { return _count; }
+  const SmsRecipientResult& result(uint8_t i) const { return _results[i]; }
+  const SmsEncoded& encoded() const { return _encoded; }
+
+private:
+  AsyncModem& _modem;
+  SmsSendConfig _config;
+  SmsEncoded _encoded;
+  SmsRecipientResult _results[SMS_MAX_RECIPIENTS];
+  uint8_t _count = 0;
+  uint8_t _delivered = 0;
+  uint8_t _ref = 0;  // concatenation reference, one per prepare()
+
+  // Position of the run, kept across suspensions.
+  uint8_t _pass = 0;
+  uint8_t _recipient = 0;
+  char _header[2 * (7 + 12) + 1];  // of the segment being sent
+};
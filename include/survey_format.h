@@ -0,0 +1,247 @@
+#pragma once
+/**
+ * @file survey_format.h
+ * @brief On-flash format of the survey log, shared with the host tools.
+ *
+ * A survey log is a sequence of segment files. Each segment starts with a
+ * 12-byte header ("CSLG", version, 3 reserved bytes, segment number as
+ * little-endian u32) followed by framed records:
+ *
+ *   [payload length: varint][payload][CRC-16 of payload: 2 bytes LE]
+ *
+ * A torn write at the end of a segment simply fails its CRC and ends the
+ * segment. Payloads are delta-encoded against the previous record in the same
+ * segment, so every segment decodes on its own:
+ *
+ *   flags        u8     SURVEY_HAS_POSITION, SURVEY_SAME_CELLS
+ *   dt           svarint seconds since the previous record (absolute first)
+ *   SAME_CELLS:  per cell: svarint rxlev delta, svarint ta delta
+ *   otherwise:   count u8, then per cell svarint deltas of mcc, mnc, lac,
+ *                cid against the previous cell (the first cell against the
+ *                previous record's serving cell), varint rxlev, varint ta
+ *   HAS_POSITION: svarint deltas of lat/lng (1e-7 deg), varint accuracy (m)
+ *
+ * Unchanged cell sets, the common case when stationary, cost about two bytes
+ * per cell.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cell_record.h"
+#include "crc16.h"
+#include "geo_types.h"
+
+static const uint8_t SURVEY_MAGIC[4] = {'C', 'S', 'L', 'G'};
+static const uint8_t SURVEY_VERSION = 1;
+static const size_t SURVEY_HEADER_SIZE = 12;
+static const size_t SURVEY_MAX_RECORD = 4 + 1 + 5 + 1 + CELL_SNAPSHOT_MAX * 24 + 16 + 2;
+
+static const uint8_t SURVEY_HAS_POSITION = 0x01;
+static const uint8_t SURVEY_SAME_CELLS = 0x02;
+
+inline size_t putVarint(uint8_t* p, uint64_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = uint8_t(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = uint8_t(v);
+  return n;
+}
+
+inline size_t putSvarint(uint8_t* p, int64_t v) {
+  return putVarint(p, (uint64_t(v) << 1) ^ uint64_t(v >> 63));
+}
+
+inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t b = *p++;
+    v |= uint64_t(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+inline bool getSvarint(const uint8_t*& p, const uint8_t* end, int64_t& v) {
+  uint64_t u;
+  if (!getVarint(p, end, u)) return false;
+  v = int64_t(u >> 1) ^ -int64_t(u & 1);
+  return true;
+}
+
+inline void encodeSurveyHeader(uint8_t* out, uint32_t segment) {
+  memcpy(out, SURVEY_MAGIC, 4);
+  out[4] = SURVEY_VERSION;
+  out[5] = out[6] = out[7] = 0;
+  for (int i = 0; i < 4; ++i) out[8 + i] = uint8_t(segment >> (8 * i));
+}
+
+inline bool decodeSurveyHeader(const uint8_t* in, size_t len, uint32_t& segment) {
+  if (len < SURVEY_HEADER_SIZE || memcmp(in, SURVEY_MAGIC, 4) != 0 || in[4] != SURVEY_VERSION) {
+    return false;
+  }
+  segment = uint32_t(in[8]) | (uint32_t(in[9]) << 8) | (uint32_t(in[10]) << 16) |
+            (uint32_t(in[11]) << 24);
+  return true;
+}
+
+// One decoded survey entry.
+struct SurveyRecord {
+  CellSnapshot snapshot;
+  LocationFix position;  // position.valid is false when none was logged
+};
+
+// Delta state shared by the encoder and the decoder; reset per segment.
+struct SurveyCodecState {
+  uint32_t timestamp = 0;
+  CellSnapshot last;
+  int32_t lat7 = 0;
+  int32_t lng7 = 0;
+
+  void reset() { *this = SurveyCodecState(); }
+};
+
+inline bool sameCellSet(const CellSnapshot& a, const CellSnapshot& b) {
+  if (a.count != b.count || a.count == 0) return false;
+  for (uint8_t i = 0; i < a.count; ++i) {
+    if (cellKey(a.cells[i]) != cellKey(b.cells[i])) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Encodes one framed record into `out` (at least SURVEY_MAX_RECORD bytes).
+ * @return number of bytes written
+ */
+inline size_t encodeSurveyRecord(SurveyCodecState& st, const CellSnapshot& snap,
+                                 const LocationFix* pos, uint8_t* out) {
+  uint8_t payload[SURVEY_MAX_RECORD];
+  size_t n = 0;
+  uint8_t flags = 0;
+  const bool same = sameCellSet(snap, st.last);
+  if (same) flags |= SURVEY_SAME_CELLS;
+  if (pos && pos->valid) flags |= SURVEY_HAS_POSITION;
+  payload[n++] = flags;
+  n += putSvarint(payload + n, int64_t(snap.timestamp) - int64_t(st.timestamp));
+
+  if (same) {
+    for (uint8_t i = 0; i < snap.count; ++i) {
+      n += putSvarint(payload + n, int(snap.cells[i].rxlev) - int(st.last.cells[i].rxlev));
+      n += putSvarint(payload + n, int(snap.cells[i].ta) - int(st.last.cells[i].ta));
+    }
+  } else {
+    payload[n++] = snap.count;
+    CellRecord prev = st.last.count > 0 ? st.last.cells[0] : CellRecord();
+    for (uint8_t i = 0; i < snap.count; ++i) {
+      const CellRecord& c = snap.cells[i];
+      n += putSvarint(payload + n, int64_t(c.mcc) - prev.mcc);
+      n += putSvarint(payload + n, int64_t(c.mnc) - prev.mnc);
+      n += putSvarint(payload + n, int64_t(c.lac) - prev.lac);
+      n += putSvarint(payload + n, int64_t(c.cid) - int64_t(prev.cid));
+      n += putVarint(payload + n, c.rxlev);
+      n += putVarint(payload + n, c.ta);
+      prev = c;
+    }
+  }
+
+  if (flags & SURVEY_HAS_POSITION) {
+    int32_t lat7 = int32_t(pos->lat * 1e7);
+    int32_t lng7 = int32_t(pos->lng * 1e7);
+    n += putSvarint(payload + n, int64_t(lat7) - st.lat7);
+    n += putSvarint(payload + n, int64_t(lng7) - st.lng7);
+    n += putVarint(payload + n, uint64_t(pos->accuracy < 0 ? 0 : pos->accuracy + 0.5f));
+    st.lat7 = lat7;
+    st.lng7 = lng7;
+  }
+
+  st.timestamp = snap.timestamp;
+  st.last = snap;
+
+  size_t len = putVarint(out, n);
+  memcpy(out + len, payload, n);
+  len += n;
+  uint16_t crc = crc16(payload, n);
+  out[len++] = uint8_t(crc);
+  out[len++] = uint8_t(crc >> 8);
+  return len;
+}
+
+/**
+ * @brief Decodes the framed record at `p`, advancing `p` past it.
+ *
+ * Returns false at the end of the data or on a damaged record; the rest of
+ * the segment is unusable in that case.
+ */
+inline bool decodeSurveyRecord(SurveyCodecState& st, const uint8_t*& p, const uint8_t* end,
+                               SurveyRecord& rec) {
+  uint64_t len;
+  const uint8_t* q = p;
+  if (!getVarint(q, end, len) || len == 0 || len > size_t(end - q) || size_t(end - q) - len < 2) {
+    return false;
+  }
+  const uint8_t* payload = q;
+  const uint8_t* pend = q + len;
+  uint16_t crc = uint16_t(pend[0] | (pend[1] << 8));
+  if (crc16(payload, size_t(len)) != crc) return false;
+
+  uint8_t flags = *q++;
+  int64_t dt;
+  if (!getSvarint(q, pend, dt)) return false;
+  CellSnapshot& snap = rec.snapshot;
+  snap.timestamp = uint32_t(int64_t(st.timestamp) + dt);
+
+  if (flags & SURVEY_SAME_CELLS) {
+    snap = st.last;
+    snap.timestamp = uint32_t(int64_t(st.timestamp) + dt);
+    for (uint8_t i = 0; i < snap.count; ++i) {
+      int64_t drx, dta;
+      if (!getSvarint(q, pend, drx) || !getSvarint(q, pend, dta)) return false;
+      snap.cells[i].rxlev = uint8_t(snap.cells[i].rxlev + drx);
+      snap.cells[i].ta = uint8_t(snap.cells[i].ta + dta);
+    }
+  } else {
+    if (q >= pend) return false;
+    snap.count = *q++;
+    if (snap.count > CELL_SNAPSHOT_MAX) return false;
+    CellRecord prev = st.last.count > 0 ? st.last.cells[0] : CellRecord();
+    for (uint8_t i = 0; i < snap.count; ++i) {
+      int64_t d[4];
+      uint64_t rx, ta;
+      for (int k = 0; k < 4; ++k) {
+        if (!getSvarint(q, pend, d[k])) return false;
+      }
+      if (!getVarint(q, pend, rx) || !getVarint(q, pend, ta)) return false;
+      CellRecord& c = snap.cells[i];
+      c.mcc = uint16_t(prev.mcc + d[0]);
+      c.mnc = uint16_t(prev.mnc + d[1]);
+      c.lac = uint16_t(prev.lac + d[2]);
+      c.cid = uint32_t(int64_t(prev.cid) + d[3]);
+      c.rxlev = uint8_t(rx);
+      c.ta = uint8_t(ta);
+      prev = c;
+    }
+  }
+
+  rec.position = LocationFix();
+  if (flags & SURVEY_HAS_POSITION) {
+    int64_t dlat, dlng;
+    uint64_t acc;
+    if (!getSvarint(q, pend, dlat) || !getSvarint(q, pend, dlng) || !getVarint(q, pend, acc)) {
+      return false;
+    }
+    st.lat7 = int32_t(st.lat7 + dlat);
+    st.lng7 = int32_t(st.lng7 + dlng);
+    rec.position.lat = st.lat7 / 1e7;
+    rec.position.lng = st.lng7 / 1e7;
+    rec.position.accuracy = float(acc);
+    rec.position.timestamp = snap.timestamp;
+    rec.position.valid = true;
+  }
+
+  st.timestamp = snap.timestamp;
+  st.last = snap;
+  p = pend + 2;
+  return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+/**
+ * @file survey_log.h
+ * @brief Append-only survey log of cell observations on LittleFS.
+ *
+ * Records (see survey_format.h) are collected in a RAM buffer of one flash
+ * block and written out only when the block is full, so every flash block
+ * of a segment is programmed exactly once instead of being rewritten by
+ * LittleFS's copy-on-write for each small append. Segments have a fixed
+ * size; when the log exceeds its byte budget the oldest segment is deleted,
+ * which keeps erases spread evenly over the whole partition.
+ *
+ * At one snapshot every 10 s an unchanged cell set costs about 20 bytes, so
+ * the 2.4 MB data partition holds several weeks of continuous scanning.
+ * Up to one buffer (SURVEY_BUFFER_BYTES) is lost on power failure; call
+ * flush() before a planned reset or sleep. When records arrive slowly (one
+ * per fix), setFlushPolicy() bounds the loss by count and age instead, at
+ * the price of one partial block rewrite per early flush.
+ */
+#include <Arduino.h>
+#include <FS.h>
+
+#include "survey_format.h"
+
+static const size_t SURVEY_BUFFER_BYTES = 4096;            // one LittleFS block
+static const size_t SURVEY_SEGMENT_BYTES = 8 * SURVEY_BUFFER_BYTES;
+
+struct SurveyStats {
+  unsigned long records = 0;
+  unsigned long bytesWritten = 0;
+  unsigned long segmentsDeleted = 0;
+  unsigned long writeErrors = 0;
+};
+
+class SurveyLog {
+public:
+  // Opens the log in `dir`, limiting it to `budgetBytes` on flash. A new
+  // segment is started on every boot.
+  bool begin(fs::FS& fs, size_t budgetBytes, const char* dir = "/survey");
+  // Writes the buffered records out and closes the log; begin() opens it
+  // again, on a new segment.
+  void end();
+  bool active() const { return _fs != nullptr; }
+
+  bool append(const CellSnapshot& snapshot, const LocationFix* position = nullptr);
+
+  // Writes the buffered records out, even if the block is not full.
+  bool flush();
+
+  // Lets flushIfDue() write the buffer out early once it holds `records`
+  // unwritten records, or the oldest of them is `maxAgeMs` old. 0 disables
+  // either limit; by default only full blocks are written.
+  void setFlushPolicy(uint16_t records, unsigned long maxAgeMs);
+  // Call often, also without new records, so the age limit is kept.
+  bool flushIfDue();
+
+  uint32_t firstSegment() const { return _first; }
+  uint32_t currentSegment() const { return _current; }
+  size_t bytesOnFlash() const { return _diskBytes; }
+  size_t bufferedBytes() const { return _buffered; }
+  const SurveyStats& stats() const { return _stats; }
+
+  // "/survey/00000042.log"
+  String segmentPath(uint32_t segment) const;
+
+private:
+  void startSegment();
+  void enforceBudget(size_t incoming);
+  bool writeBuffer();
+
+  fs::FS* _fs = nullptr;
+  const char* _dir = "/survey";
+  size_t _budget = 0;
+  uint32_t _first = 0;
+  uint32_t _current = 0;
+  size_t _segmentBytes = 0;
+  size_t _diskBytes = 0;
+  SurveyCodecState _codec;
+  uint8_t _buffer[SURVEY_BUFFER_BYTES];
+  size_t _buffered = 0;
+  uint16_t _unwritten = 0;           // records since the last write
+  unsigned long _unwrittenSince = 0;  // millis() of the oldest of them
+  uint16_t _flushRecords = 0;
+  unsigned long _flushAgeMs = 0;
+  SurveyStats _stats;
+};
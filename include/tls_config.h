@@ -0,0 +1,148 @@
+#pragma once
+/**
+ * @file tls_config.h
+ * @brief TLS configuration for the Google API endpoints.
+ *
+ * Every HTTPS call used to build a fresh client and pay a full handshake.
+ * A TlsEndpoint keeps one WiFiClientSecure per host, verified against a small
+ * pinned set of trust anchors, and keeps the connection alive between
+ * requests so only the first call to a host performs the handshake.
+ *
+ * A connection the server closed while idle is only noticed when the next
+ * request fails; TlsRequest then reconnects once and sends it again.
+ *
+ * TlsRequest runs one request as a CoopTask, so the other flows keep running
+ * while the response is in flight. The handshake itself still blocks, up to
+ * the 10 s handshake timeout, but only the first request to a host pays it.
+ *
+ * On GPRS an endpoint runs over a SIM800 mux link instead (useModem()), one
+ * per endpoint, so the Google requests share the cellular link with MQTT
+ * and the UDP reports. The modem does the TLS (AT+CIPSSL) and opens the link
+ * without blocking; it does not check the pinned trust anchors below.
+ *
+ * Profiles:
+ *   - TLS_PROFILE_PINNED: GTS Root R1 and R4 (default). The server picks the
+ *                         chain it presents; either one verifies.
+ *   - TLS_PROFILE_ECDSA:  only GTS Root R4. Trust anchors do not change the
+ *                         chain the server sends, so this handshake fails
+ *                         whenever Google serves its RSA (R1) chain. Kept for
+ *                         runTlsBenchmark(), to see which chain is served.
+ */
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+#include "async_modem.h"
+#include "coop_task.h"
+#include "http_exchange.h"
+#include "sim800_mux.h"
+
+enum TlsProfile {
+  TLS_PROFILE_ECDSA,
+  TLS_PROFILE_PINNED,
+};
+
+// Handshake counters, kept per endpoint.
+struct TlsStats {
+  unsigned long handshakes = 0;      // full TLS handshakes performed
+  unsigned long reused = 0;          // requests served on a kept-alive connection
+  unsigned long failures = 0;        // connect/handshake failures
+  unsigned long reconnects = 0;      // kept-alive connections found closed
+  unsigned long lastHandshakeMs = 0;
+  unsigned long totalHandshakeMs = 0;
+};
+
+// Returns true once the pinned root certificates have been filled in.
+bool tlsTrustAnchorsConfigured();
+
+const char* tlsProfileName(TlsProfile profile);
+
+class TlsEndpoint {
+public:
+  explicit TlsEndpoint(const char* host, uint16_t port = 443,
+                       TlsProfile profile = TLS_PROFILE_PINNED);
+
+  // Connects, or keeps the open connection; `reused` tells which. Null if
+  // the connection failed.
+  Client* open(bool& reused);
+
+  // A reused connection failed: the server has closed it since the last
+  // request. Drops it so the next open() reconnects.
+  void dropStale();
+
+  // Requests go over `socket`, taking `modem` for its AT commands; both
+  // null for WiFi. TlsRequest opens the link, see MuxSocket::startConnect().
+  void useModem(AsyncModem* modem, MuxSocket* socket);
+  AsyncModem* modem() const { return _modem; }
+  MuxSocket* socket() const { return _socket; }
+  // Mux link steps, with the connection counted in the stats.
+  bool reuseLink();
+  String startLink();
+  bool finishLink();
+
+  void setProfile(TlsProfile profile);
+  TlsProfile profile() const { return _profile; }
+
+  // Drops the connection; the next begin() performs a full handshake.
+  void reset();
+
+  const char* host() const { return _host; }
+  const TlsStats& stats() const { return _stats; }
+
+  // Performs one full handshake and returns its duration in ms, or -1.
+  long measureHandshake();
+
+private:
+  bool connect();
+  void applyProfile();
+
+  const char* _host;
+  uint16_t _port;
+  TlsProfile _profile;
+  WiFiClientSecure _client;
+  AsyncModem* _modem = nullptr;
+  MuxSocket* _socket = nullptr;
+  unsigned long _linkStart = 0;
+  TlsStats _stats;
+};
+
+// One HTTPS request on an endpoint's kept-alive connection:
+//
+//   request.prepare(endpoint, "GET", path);
+//   CO_RUN(request);
+//   if (request.status() == 200) parse(request.body());
+class TlsRequest : public CoopTask {
+public:
+  // `body` and `contentType` may be null; the body is copied.
+  void prepare(TlsEndpoint& endpoint, const char* method, const String& path,
+               const char* contentType = nullptr, const String* body = nullptr);
+
+  CoStatus step() override;
+
+  // HTTP status, or a negative HttpError.
+  int status() const { return _exchange.status(); }
+  const String& body() const { return _exchange.body(); }
+
+private:
+  void send(Client& client);
+
+  TlsEndpoint* _endpoint = nullptr;
+  const char* _method = "GET";
+  String _path;
+  const char* _contentType = nullptr;
+  String _body;
+  bool _hasBody = false;
+  bool _reused = false;
+  uint8_t _attempt = 0;
+  AsyncModem* _modem = nullptr;  // of the endpoint, on GPRS
+  String _command;
+  unsigned long _start = 0;
+  HttpExchange _exchange;
+};
+
+/**
+ * @brief Measures the handshake time of each profile against an endpoint.
+ *
+ * Runs `rounds` full handshakes per profile and prints min/avg/max to `out`.
+ * The endpoint's original profile is restored afterwards.
+ */
+void runTlsBenchmark(TlsEndpoint& endpoint, int rounds, Print& out);
@@ -0,0 +1,92 @@
+#pragma once
+/**
+ * @file tower_db.h
+ * @brief Sorted tower-position file written by tools/tower_estimator.cpp.
+ *
+ * Layout (little-endian): a 16-byte header ("CTWR", version, 3 reserved,
+ * record count u32, 4 reserved) followed by fixed 24-byte records sorted by
+ * cellKey(), so a reader can binary-search the file in place:
+ *
+ *   key u64 | lat i32 (1e-7 deg) | lng i32 | observations u32 |
+ *   spread u16 (m, RMS distance of observations) | method u8 | reserved u8
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cell_record.h"
+
+static const uint8_t TOWER_DB_MAGIC[4] = {'C', 'T', 'W', 'R'};
+static const uint8_t TOWER_DB_VERSION = 1;
+static const size_t TOWER_DB_HEADER_SIZE = 16;
+static const size_t TOWER_DB_RECORD_SIZE = 24;
+
+enum TowerMethod : uint8_t {
+  TOWER_CENTROID = 0,       // RxLev-weighted centroid of observer positions
+  TOWER_LEAST_SQUARES = 1,  // timing-advance ranges, linearised least squares
+};
+
+struct TowerRecord {
+  uint64_t key = 0;
+  int32_t lat7 = 0;
+  int32_t lng7 = 0;
+  uint32_t observations = 0;
+  uint16_t spread = 0;
+  uint8_t method = TOWER_CENTROID;
+};
+
+inline void encodeTowerHeader(uint8_t* out, uint32_t count) {
+  memset(out, 0, TOWER_DB_HEADER_SIZE);
+  memcpy(out, TOWER_DB_MAGIC, 4);
+  out[4] = TOWER_DB_VERSION;
+  for (int i = 0; i < 4; ++i) out[8 + i] = uint8_t(count >> (8 * i));
+}
+
+inline void encodeTowerRecord(uint8_t* out, const TowerRecord& r) {
+  for (int i = 0; i < 8; ++i) out[i] = uint8_t(r.key >> (8 * i));
+  for (int i = 0; i < 4; ++i) out[8 + i] = uint8_t(uint32_t(r.lat7) >> (8 * i));
+  for (int i = 0; i < 4; ++i) out[12 + i] = uint8_t(uint32_t(r.lng7) >> (8 * i));
+  for (int i = 0; i < 4; ++i) out[16 + i] = uint8_t(r.observations >> (8 * i));
+  out[20] = uint8_t(r.spread);
+  out[21] = uint8_t(r.spread >> 8);
+  out[22] = r.method;
+  out[23] = 0;
+}
+
+inline void decodeTowerRecord(const uint8_t* in, TowerRecord& r) {
+  r.key = 0;
+  for (int i = 0; i < 8; ++i) r.key |= uint64_t(in[i]) << (8 * i);
+  uint32_t v[3] = {0, 0, 0};
+  for (int k = 0; k < 3; ++k) {
+    for (int i = 0; i < 4; ++i) v[k] |= uint32_t(in[8 + 4 * k + i]) << (8 * i);
+  }
+  r.lat7 = int32_t(v[0]);
+  r.lng7 = int32_t(v[1]);
+  r.observations = v[2];
+  r.spread = uint16_t(in[20] | (in[21] << 8));
+  r.method = in[22];
+}
+
+// Binary search over a tower file image. Returns false if `key` is absent.
+inline bool findTower(const uint8_t* db, size_t len, uint64_t key, TowerRecord& out) {
+  if (len < TOWER_DB_HEADER_SIZE || memcmp(db, TOWER_DB_MAGIC, 4) != 0) return false;
+  uint32_t count = uint32_t(db[8]) | (uint32_t(db[9]) << 8) | (uint32_t(db[10]) << 16) |
+                   (uint32_t(db[11]) << 24);
+  if ((len - TOWER_DB_HEADER_SIZE) / TOWER_DB_RECORD_SIZE < count) return false;
+  const uint8_t* recs = db + TOWER_DB_HEADER_SIZE;
+  size_t lo = 0, hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    uint64_t k = 0;
+    for (int i = 0; i < 8; ++i) k |= uint64_t(recs[mid * TOWER_DB_RECORD_SIZE + i]) << (8 * i);
+    if (k < key) {
+      lo = mid + 1;
+    } else if (k > key) {
+      hi = mid;
+    } else {
+      decodeTowerRecord(recs + mid * TOWER_DB_RECORD_SIZE, out);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,181 @@
+#pragma once
+/**
+ * @file track_filter.h
+ * @brief Constant-velocity Kalman filter over successive position fixes.
+ *
+ * Cell-based fixes scatter by hundreds of metres around the true track. The
+ * filter works in metres on a local tangent plane around its first fix and
+ * keeps position and velocity per axis. Because both the measurement noise
+ * (the fix's accuracy circle) and the process noise (white acceleration) are
+ * isotropic, the east and north axes share one 2x2 covariance, so an update
+ * is a handful of multiplications.
+ *
+ * A fix whose innovation is implausible for the current estimate is
+ * rejected; after TRACK_MAX_REJECTS rejections in a row the filter restarts
+ * at the new fix, since the asset has most likely really moved.
+ *
+ * moved() tells whether the smoothed position has left the last reported one
+ * by more than a distance plus the filter's own uncertainty, so callers can
+ * skip notifications for noise.
+ */
+#include <math.h>
+#include <stdint.h>
+
+#include "geo_types.h"
+
+static const float TRACK_SIGMA_PER_ACCURACY = 1.0f / 1.515f;  // 68 % circle -> per-axis sigma
+static const float TRACK_GATE = 13.8f;  // innovation chi-square, 2 dof, 99.9 %
+static const uint8_t TRACK_MAX_REJECTS = 3;
+static const double TRACK_RECENTRE_M = 20000.0;
+static const double TRACK_METRES_PER_DEGREE = 111195.0;
+
+class TrackFilter {
+public:
+  // accelSigma: random acceleration of the asset in m/s^2, averaged over the
+  // minutes between fixes; small values smooth more but lag behind turns.
+  explicit TrackFilter(float accelSigma = 0.02f) : _q(accelSigma * accelSigma) {}
+
+  void reset() {
+    _init = false;
+    _reported = false;
+    _rejects = 0;
+  }
+
+  /**
+   * @brief Feeds one fix. Invalid fixes are ignored.
+   * @return false if the fix was rejected as an outlier
+   */
+  bool update(const LocationFix& fix) {
+    if (!fix.valid) return false;
+    const float r = measurementVariance(fix);
+    if (!_init) {
+      start(fix, r);
+      return true;
+    }
+    predict(fix.timestamp);
+
+    double zx, zy;
+    toLocal(fix.lat, fix.lng, zx, zy);
+    const double ix = zx - _x[0], iy = zy - _y[0];
+    const double s = _p[0][0] + r;
+    if ((ix * ix + iy * iy) / s > TRACK_GATE) {
+      if (++_rejects < TRACK_MAX_REJECTS) return false;
+      start(fix, r);  // a sustained jump: follow it
+      return true;
+    }
+    _rejects = 0;
+
+    // Same gain for both axes.
+    const double k0 = _p[0][0] / s, k1 = _p[1][0] / s;
+    _x[0] += k0 * ix;
+    _x[1] += k1 * ix;
+    _y[0] += k0 * iy;
+    _y[1] += k1 * iy;
+    const double p00 = _p[0][0], p01 = _p[0][1], p11 = _p[1][1];
+    _p[0][0] = (1 - k0) * p00;
+    _p[0][1] = _p[1][0] = (1 - k0) * p01;
+    _p[1][1] = p11 - k1 * p01;
+    recentre();
+    return true;
+  }
+
+  bool valid() const { return _init; }
+
+  // Smoothed position; accuracy is the 68 % radius of the filter's estimate.
+  LocationFix estimate() const {
+    LocationFix out;
+    if (!_init) return out;
+    toGeo(_x[0], _y[0], out.lat, out.lng);
+    out.accuracy = float(sqrt(_p[0][0]) / TRACK_SIGMA_PER_ACCURACY);
+    out.timestamp = _t;
+    out.valid = true;
+    return out;
+  }
+
+  // Metres per second over ground.
+  float speed() const { return _init ? float(hypot(_x[1], _y[1])) : 0; }
+
+  // True if the estimate is more than `minDistance` plus its own accuracy
+  // away from the last reported position (always true before the first report).
+  bool moved(float minDistance) const {
+    if (!_init) return false;
+    if (!_reported) return true;
+    double x, y;
+    toLocal(_reportedLat, _reportedLng, x, y);
+    const double limit = minDistance + sqrt(_p[0][0]) / TRACK_SIGMA_PER_ACCURACY;
+    return hypot(_x[0] - x, _y[0] - y) > limit;
+  }
+
+  // Records the current estimate as the last reported position.
+  void markReported() {
+    if (!_init) return;
+    toGeo(_x[0], _y[0], _reportedLat, _reportedLng);
+    _reported = true;
+  }
+
+private:
+  static float measurementVariance(const LocationFix& fix) {
+    float sigma = (fix.accuracy > 1 ? fix.accuracy : 1) * TRACK_SIGMA_PER_ACCURACY;
+    return sigma * sigma;
+  }
+
+  void start(const LocationFix& fix, float r) {
+    _refLat = fix.lat;
+    _refLng = fix.lng;
+    _cosRef = cos(fix.lat * M_PI / 180.0);
+    _x[0] = _x[1] = _y[0] = _y[1] = 0;
+    // Unknown velocity: a few m/s either way.
+    _p[0][0] = r;
+    _p[0][1] = _p[1][0] = 0;
+    _p[1][1] = 25;
+    _t = fix.timestamp;
+    _rejects = 0;
+    _init = true;
+  }
+
+  void predict(uint32_t t) {
+    if (t <= _t) return;
+    const double dt = t - _t;
+    _t = t;
+    _x[0] += dt * _x[1];
+    _y[0] += dt * _y[1];
+    // P = F P F' + Q, F = [1 dt; 0 1], Q from white acceleration.
+    const double p00 = _p[0][0], p01 = _p[0][1], p11 = _p[1][1];
+    const double dt2 = dt * dt;
+    _p[0][0] = p00 + 2 * dt * p01 + dt2 * p11 + _q * dt2 * dt2 / 4;
+    _p[0][1] = _p[1][0] = p01 + dt * p11 + _q * dt2 * dt / 2;
+    _p[1][1] = p11 + _q * dt2;
+  }
+
+  // Keeps the tangent plane close to the track.
+  void recentre() {
+    if (fabs(_x[0]) < TRACK_RECENTRE_M && fabs(_y[0]) < TRACK_RECENTRE_M) return;
+    double lat, lng;
+    toGeo(_x[0], _y[0], lat, lng);
+    _refLat = lat;
+    _refLng = lng;
+    _cosRef = cos(lat * M_PI / 180.0);
+    _x[0] = _y[0] = 0;
+  }
+
+  void toLocal(double lat, double lng, double& x, double& y) const {
+    x = (lng - _refLng) * TRACK_METRES_PER_DEGREE * _cosRef;
+    y = (lat - _refLat) * TRACK_METRES_PER_DEGREE;
+  }
+
+  void toGeo(double x, double y, double& lat, double& lng) const {
+    lat = _refLat + y / TRACK_METRES_PER_DEGREE;
+    lng = _refLng + x / (TRACK_METRES_PER_DEGREE * _cosRef);
+  }
+
+  double _q;
+  bool _init = false;
+  uint8_t _rejects = 0;
+  uint32_t _t = 0;
+  double _refLat = 0, _refLng = 0, _cosRef = 1;
+  double _x[2] = {0, 0};  // east position, velocity
+  double _y[2] = {0, 0};  // north position, velocity
+  double _p[2][2] = {{0, 0}, {0, 0}};
+  bool _reported = false;
+  double _reportedLat = 0, _reportedLng = 0;
+};
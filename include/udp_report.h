@@ -0,0 +1,58 @@
+#pragma once
+/**
+ * @file udp_report.h
+ * @brief Optional fix report transport over a SIM800L UDP link.
+ *
+ * Sends each fix as a 32-byte authenticated datagram (see fix_datagram.h) to
+ * a self-hosted collector (tools/udp_collector.cpp) and waits for its ack,
+ * retrying a few times. The datagrams go out on their own multiplexed link,
+ * so reports do not wait for other sockets.
+ */
+#include <Arduino.h>
+
+#include "fix_datagram.h"
+#include "geo_types.h"
+#include "sim800_mux.h"
+
+struct UdpReportConfig {
+  UdpReportConfig(const char* host, uint16_t port, const char* psk, uint32_t deviceId)
+      : host(host), port(port), psk(psk), deviceId(deviceId) {}
+
+  const char* host;
+  uint16_t port;
+  const char* psk;
+  uint32_t deviceId;
+  uint8_t attempts = 3;              // sends per fix before giving up
+  unsigned long ackTimeoutMs = 3000;
+};
+
+struct UdpReportStats {
+  unsigned long sent = 0;     // datagrams written, including retries
+  unsigned long acked = 0;
+  unsigned long failed = 0;   // fixes given up on
+  unsigned long bytes = 0;
+  unsigned long lastRttMs = 0;
+};
+
+class UdpReporter {
+public:
+  UdpReporter(Sim800Mux& mux, const UdpReportConfig& config);
+
+  // Sends `fix` and waits for the collector's ack. Opens the link on demand.
+  bool report(const LocationFix& fix);
+
+  // Closes the UDP link.
+  void end();
+
+  const UdpReportStats& stats() const { return _stats; }
+
+private:
+  bool open();
+  bool waitAck(const DatagramHeader& hdr, unsigned long timeout);
+
+  MuxSocket _socket;
+  UdpReportConfig _config;
+  UdpReportStats _stats;
+  uint16_t _session;
+  uint16_t _seq = 0;
+};
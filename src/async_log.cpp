@@ -0,0 +1,92 @@
+#include "async_log.h"
+
+typedef std::lock_guard<std::mutex> LogGuard;
+
+static const uint32_t RING_MASK = ASYNC_LOG_BYTES - 1;
+
+size_t AsyncLog::write(const uint8_t* data, size_t len) {
+  LogGuard guard(_lock);
+  if (len > ASYNC_LOG_BYTES - (_head - _tail)) {
+    _dropped += len;
+    return 0;
+  }
+  for (size_t i = 0; i < len; ++i) _buf[(_head + i) & RING_MASK] = char(data[i]);
+  _head += len;
+  return len;
+}
+
+// Writes ring bytes [from, to) to `out` within `room`; returns the count.
+static size_t writeRing(Print& out, const char* buf, uint32_t from, uint32_t to, size_t room) {
+  size_t written = 0;
+  while (room > 0 && from != to) {
+    // Up to the end of the range or of the ring, whichever is first
+    size_t start = from & RING_MASK;
+    size_t n = to - from;
+    if (n > ASYNC_LOG_BYTES - start) n = ASYNC_LOG_BYTES - start;
+    if (n > room) n = room;
+    n = out.write((const uint8_t*)buf + start, n);
+    if (n == 0) break;
+    from += n;
+    room -= n;
+    written += n;
+  }
+  return written;
+}
+
+size_t AsyncLog::drain(Print& out) {
+  LogGuard guard(_lock);
+  size_t room = (size_t)out.availableForWrite();
+  size_t written = 0;
+  for (;;) {
+    if (_replaying && _tail == _replayAt) {
+      // Bytes new output has overwritten since replay() are lost
+      if (_head - _replayFrom > ASYNC_LOG_BYTES) _replayFrom = _head - ASYNC_LOG_BYTES;
+      if ((int32_t)(_replayTo - _replayFrom) > 0) {
+        size_t n = writeRing(out, _buf, _replayFrom, _replayTo, room);
+        _replayFrom += n;
+        room -= n;
+        written += n;
+        if (_replayFrom != _replayTo) break;
+      }
+      _replaying = false;
+    }
+    const uint32_t end = _replaying ? _replayAt : _head;
+    size_t n = writeRing(out, _buf, _tail, end, room);
+    _tail += n;
+    room -= n;
+    written += n;
+    if (_tail != end || !_replaying) break;
+  }
+  return written;
+}
+
+size_t AsyncLog::replay(size_t bytes) {
+  LogGuard guard(_lock);
+  // Drained bytes stay in the ring until new output overwrites them
+  uint32_t kept = _head < ASYNC_LOG_BYTES ? _head : ASYNC_LOG_BYTES;
+  uint32_t drained = kept - (_head - _tail);
+  if (bytes > drained) bytes = drained;
+  _replaying = bytes > 0;
+  _replayAt = _head;
+  _replayFrom = _tail - bytes;
+  _replayTo = _tail;
+  return bytes;
+}
+
+size_t AsyncLog::history(uint8_t* out, size_t max) const {
+  LogGuard guard(_lock);
+  uint32_t kept = _head < ASYNC_LOG_BYTES ? _head : ASYNC_LOG_BYTES;
+  if (max > kept) max = kept;
+  for (size_t i = 0; i < max; ++i) out[i] = uint8_t(_buf[(_head - max + i) & RING_MASK]);
+  return max;
+}
+
+size_t AsyncLog::pending() const {
+  LogGuard guard(_lock);
+  size_t replayed = 0;
+  if (_replaying) {
+    uint32_t from = _head - _replayFrom > ASYNC_LOG_BYTES ? _head - ASYNC_LOG_BYTES : _replayFrom;
+    if ((int32_t)(_replayTo - from) > 0) replayed = _replayTo - from;
+  }
+  return (_head - _tail) + replayed;
+}
@@ -0,0 +1,28 @@
+#include "async_modem.h"
+
+bool AsyncModem::acquire(const void* owner) {
+  if (_owner && _owner != owner) return false;
+  if (!_owner && _mux.backgroundPending()) _mux.abortBackground();  // e.g. a network scan
+  _owner = owner;
+  return true;
+}
+
+void AsyncModem::release(const void* owner) {
+  if (_owner == owner) _owner = nullptr;
+}
+
+bool AsyncModem::start(const String& cmd, unsigned long timeout, const char* expect) {
+  _response = "";
+  _result = AT_TIMEOUT;
+  _command = _mux.startBackground(cmd, timeout, &_response, expect);
+  return _command != 0;
+}
+
+bool AsyncModem::done() {
+  if (_command == 0) return true;
+  _mux.poll();
+  if (_mux.backgroundPending(_command)) return false;
+  _result = _mux.backgroundResult(_command);
+  _command = 0;
+  return true;
+}
@@ -0,0 +1,98 @@
+#include "console.h"
+
+#include <strings.h>
+
+bool Console::add(const char* name, const char* help, ConsoleHandler handler, void* ctx) {
+  if (_count == CONSOLE_MAX_COMMANDS) return false;
+  _commands[_count++] = {name, help, handler, ctx};
+  return true;
+}
+
+void Console::poll(Stream& in) {
+  for (uint8_t budget = CONSOLE_POLL_BYTES; budget > 0 && in.available() > 0; --budget) {
+    push(char(in.read()));
+  }
+}
+
+void Console::push(char c) {
+  if (c == '\r' || c == '\n') {
+    // CR LF is one line end, not an empty line after the first
+    if (_len == 0 && _lastEnd != 0 && _lastEnd != c) {
+      _lastEnd = 0;
+      return;
+    }
+    _lastEnd = c;
+    _out.println();
+    execute();
+    _len = 0;
+    prompt();
+    return;
+  }
+  _lastEnd = 0;
+  switch (c) {
+    case '\b':
+    case 0x7F:
+      if (_len > 0) {
+        _len--;
+        _out.print("\b \b");
+      }
+      break;
+    case 0x15:  // Ctrl-U
+      while (_len > 0) {
+        _len--;
+        _out.print("\b \b");
+      }
+      break;
+    case 0x03:  // Ctrl-C
+      _len = 0;
+      _out.println("^C");
+      prompt();
+      break;
+    default:
+      if (c >= 32 && c <= 126 && _len < CONSOLE_LINE_MAX) {
+        _line[_len++] = c;
+        _out.write(uint8_t(c));
+      }
+      break;
+  }
+}
+
+void Console::prompt() {
+  _out.print("> ");
+}
+
+void Console::execute() {
+  _line[_len] = '\0';
+  char* argv[CONSOLE_MAX_ARGS];
+  int argc = 0;
+  char* p = _line;
+  while (argc < CONSOLE_MAX_ARGS) {
+    while (*p == ' ') ++p;
+    if (!*p) break;
+    argv[argc++] = p;
+    while (*p && *p != ' ') ++p;
+    if (*p) *p++ = '\0';
+  }
+  if (argc == 0) return;
+
+  if (strcasecmp(argv[0], "help") == 0) {
+    help();
+    return;
+  }
+  for (uint8_t i = 0; i < _count; ++i) {
+    if (strcasecmp(argv[0], _commands[i].name) == 0) {
+      _commands[i].handler(argc, argv, _commands[i].ctx);
+      return;
+    }
+  }
+  _out.println(String("Unknown command '") + argv[0] + "', try 'help'.");
+}
+
+void Console::help() {
+  for (uint8_t i = 0; i < _count; ++i) {
+    _out.print("  ");
+    _out.print(_commands[i].name);
+    for (size_t n = strlen(_commands[i].name); n < 10; ++n) _out.write(uint8_t(' '));
+    _out.println(_commands[i].help);
+  }
+}
@@ -0,0 +1,24 @@
+#include "fingerprint_db.h"
+
+#include <esp_partition.h>
+
+static const char* FINGERPRINT_PARTITION = "fprint";
+
+bool mapFingerprintPartition(FingerprintDb& db) {
+  static spi_flash_mmap_handle_t handle = 0;
+  static const void* mapped = nullptr;
+  static size_t mappedSize = 0;
+
+  if (!mapped) {
+    const esp_partition_t* part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, FINGERPRINT_PARTITION);
+    if (!part) return false;
+    // Reads through the flash cache; nothing is copied to RAM.
+    if (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+      mapped = nullptr;
+      return false;
+    }
+    mappedSize = part->size;
+  }
+  return db.attach(static_cast<const uint8_t*>(mapped), mappedSize);
+}
@@ -0,0 +1,72 @@
+#include "host_link.h"
+
+bool HostLink::add(uint8_t command, HostHandler handler, void* ctx) {
+  if (_count == HOST_LINK_MAX_COMMANDS) return false;
+  _handlers[_count++] = {command, handler, ctx};
+  return true;
+}
+
+void HostLink::poll() {
+  if (transmit()) return;
+  while (_port.available() > 0) {
+    const uint8_t c = uint8_t(_port.read());
+    if (c == 0) {
+      // Opening delimiter, or the closing one of a frame
+      if (_inFrame && _rxLen > 0) {
+        handleFrame();
+        _inFrame = false;
+        // Serve one request at a time; the rest wait in the UART
+        if (transmit()) return;
+      } else {
+        _inFrame = true;
+      }
+      _rxLen = 0;
+      _overflow = false;
+    } else if (_inFrame) {
+      if (_rxLen < sizeof(_rx)) {
+        _rx[_rxLen++] = c;
+      } else {
+        _overflow = true;
+      }
+    } else if (_text) {
+      _text(char(c), _textCtx);
+    }
+  }
+}
+
+bool HostLink::transmit() {
+  while (_txPos < _txLen) {
+    int room = _port.availableForWrite();
+    if (room <= 0) return true;
+    size_t n = _txLen - _txPos;
+    if (n > size_t(room)) n = size_t(room);
+    n = _port.write(_tx + _txPos, n);
+    if (n == 0) return true;
+    _txPos += n;
+    _stats.bytesSent += n;
+  }
+  return false;
+}
+
+void HostLink::handleFrame() {
+  uint8_t buf[HOST_LINK_MAX_REQUEST];  // COBS never decodes to more than its input
+  HostFrame req;
+  if (_overflow || !hostDecodeFrame(_rx, _rxLen, buf, req, sizeof(buf)) || (req.command & HOST_RESPONSE)) {
+    // No trustworthy id to answer; the host times out and retries
+    _stats.badFrames++;
+    return;
+  }
+  _stats.requests++;
+
+  size_t outLen = 0;
+  uint8_t status = HOST_STATUS_UNKNOWN;
+  for (uint8_t i = 0; i < _count; ++i) {
+    if (_handlers[i].command == req.command) {
+      status = _handlers[i].handler(req.payload, req.length, _payload, outLen, _handlers[i].ctx);
+      break;
+    }
+  }
+  if (status != HOST_STATUS_OK || outLen > HOST_FRAME_MAX_PAYLOAD) outLen = 0;
+  _txLen = hostEncodeFrame(req.command | HOST_RESPONSE, status, req.id, _payload, outLen, _tx);
+  _txPos = 0;
+}
@@ -0,0 +1,172 @@
+#include "http_exchange.h"
+
+#include <strings.h>
+
+bool HttpExchange::begin(Client& client, const char* method, const char* host, const String& path,
+                         const char* contentType, const String* body, unsigned long timeout) {
+  _client = &client;
+  _status = HTTP_ERROR_CLOSED;
+  _code = 0;
+  _start = millis();
+  _timeout = timeout;
+  _line = "";
+  _body = "";
+  _keepAlive = true;
+  _chunked = false;
+  _contentLength = -1;
+  _remaining = 0;
+
+  // One write, so the request leaves in as few segments as the link allows
+  String request = String(method) + " " + path + " HTTP/1.1\r\nHost: " + host +
+                   "\r\nConnection: keep-alive\r\n";
+  if (body) {
+    if (contentType) request += String("Content-Type: ") + contentType + "\r\n";
+    request += "Content-Length: " + String((unsigned long)body->length()) + "\r\n";
+  }
+  request += "\r\n";
+  if (body) request += *body;
+  if (client.write((const uint8_t*)request.c_str(), request.length()) != request.length()) {
+    fail(HTTP_ERROR_SEND);
+    return false;
+  }
+  _state = STATUS_LINE;
+  return true;
+}
+
+bool HttpExchange::poll() {
+  if (_state == DONE || _state == IDLE) return true;
+  uint8_t buf[128];
+  int n;
+  while ((n = _client->available()) > 0) {
+    n = _client->read(buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf));
+    if (n <= 0) break;
+    for (int i = 0; i < n; ++i) {
+      if (!feed((char)buf[i])) return true;
+    }
+  }
+  if (!_client->connected()) {
+    if (_state == BODY_CLOSE) {
+      _keepAlive = false;
+      finish(_code);
+    } else {
+      fail(HTTP_ERROR_CLOSED);
+    }
+    return true;
+  }
+  if (millis() - _start >= _timeout) {
+    fail(HTTP_ERROR_TIMEOUT);
+    return true;
+  }
+  return false;
+}
+
+void HttpExchange::fail(int error) {
+  _keepAlive = false;
+  finish(error);
+}
+
+void HttpExchange::finish(int status) {
+  _status = status;
+  _state = DONE;
+}
+
+bool HttpExchange::lineComplete(char c) {
+  if (c == '\n') return true;
+  if (c != '\r' && _line.length() < HTTP_MAX_LINE) _line += c;
+  return false;
+}
+
+bool HttpExchange::feed(char c) {
+  switch (_state) {
+    case STATUS_LINE:
+      if (lineComplete(c)) statusLine();
+      break;
+    case HEADERS:
+      if (lineComplete(c)) headerLine();
+      break;
+    case BODY_LENGTH:
+    case BODY_CLOSE:
+      bodyByte(c);
+      if (_state == BODY_LENGTH && --_remaining == 0) finish(_code);
+      break;
+    case CHUNK_SIZE:
+      if (!lineComplete(c)) break;
+      {
+        char* end = nullptr;
+        _remaining = strtoul(_line.c_str(), &end, 16);
+        if (end == _line.c_str()) {
+          fail(HTTP_ERROR_MALFORMED);
+          break;
+        }
+      }
+      _line = "";
+      _state = _remaining > 0 ? CHUNK_DATA : TRAILERS;
+      break;
+    case CHUNK_DATA:
+      bodyByte(c);
+      if (--_remaining == 0) _state = CHUNK_END;
+      break;
+    case CHUNK_END:
+      if (c == '\n') _state = CHUNK_SIZE;
+      break;
+    case TRAILERS:
+      if (!lineComplete(c)) break;
+      if (_line.length() == 0) finish(_code);
+      _line = "";
+      break;
+    case IDLE:
+    case DONE:
+      break;
+  }
+  return _state != DONE;
+}
+
+void HttpExchange::statusLine() {
+  // "HTTP/1.1 200 OK"
+  const char* s = _line.c_str();
+  if (strncmp(s, "HTTP/1.", 7) != 0 || strlen(s) < 12) {
+    fail(HTTP_ERROR_MALFORMED);
+    return;
+  }
+  _code = atoi(s + 9);
+  if (s[7] == '0') _keepAlive = false;  // HTTP/1.0 closes unless told otherwise
+  _line = "";
+  _state = HEADERS;
+}
+
+void HttpExchange::headerLine() {
+  const char* s = _line.c_str();
+  if (*s == '\0') {
+    // End of the headers
+    if (_chunked) {
+      _state = CHUNK_SIZE;
+    } else if (_contentLength == 0 || _code == 204 || _code == 304) {
+      finish(_code);
+    } else if (_contentLength > 0) {
+      _remaining = (unsigned long)_contentLength;
+      _state = BODY_LENGTH;
+    } else {
+      _keepAlive = false;
+      _state = BODY_CLOSE;
+    }
+    return;
+  }
+  const char* colon = strchr(s, ':');
+  if (colon) {
+    const size_t name = colon - s;
+    const char* value = colon + 1;
+    while (*value == ' ') value++;
+    if (name == 14 && strncasecmp(s, "Content-Length", 14) == 0) {
+      _contentLength = atol(value);
+    } else if (name == 17 && strncasecmp(s, "Transfer-Encoding", 17) == 0) {
+      _chunked = strncasecmp(value, "chunked", 7) == 0;
+    } else if (name == 10 && strncasecmp(s, "Connection", 10) == 0) {
+      _keepAlive = strncasecmp(value, "close", 5) != 0;
+    }
+  }
+  _line = "";
+}
+
+void HttpExchange::bodyByte(char c) {
+  if (_body.length() < HTTP_MAX_BODY) _body += c;
+}
@@ -1,18 +1,44 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
-#define TINY_GSM_MODEM_SIM800
+#include "modem_traits.h"  // selects the TinyGSM driver
 #include <TinyGsmClient.h>
 #include <ArduinoJson.h>
 #include <SoftwareSerial.h>
+#include <LittleFS.h>
+#include <esp_system.h>
+#include "tls_config.h"
+#include "at_response.h"
+#include "cell_fusion.h"
+#include "cell_table.h"
+#include "cell_zone.h"
+#include "async_modem.h"
+#include "ceng_parser.h"
+#include "geofence.h"
+#include "operator_table.h"
+#include "sim800_at.h"
+#include "sim800_mux.h"
+#include "sim800_transparent.h"
+#include "track_filter.h"
+#include "udp_report.h"
+#include "mqtt_publisher.h"
+#include "net_scanner.h"
+#include "scan_modem.h"
+#include "seqlock.h"
+#include "sms_inbox.h"
+#include "sms_sender.h"
+#include "survey_log.h"
 
 // WiFi credentials
 const char* WIFI_SSID = "YOUR_WIFI_SSID";
 const char* WIFI_PASS = "YOUR_WIFI_PASSWORD";
+const unsigned long WIFI_CONNECT_MS = 10000;
 
 // Google API Key
 const char* GOOGLE_API_KEY = "YOUR_GOOGLE_API_KEY";
 
+// Prints the TLS handshake time of each trust profile on the first WiFi run
+const bool RUN_TLS_BENCHMARK = false;
+
 // Email settings
 const char* EMAIL_TO = "recipient@example.com";
 const char* EMAIL_FROM = "your_email@example.com";
@@ -20,8 +46,93 @@ const char* EMAIL_PASS = "your_email_password"; // Use app password if Gmail
 const char* SMTP_SERVER = "smtp.gmail.com";
 const int SMTP_PORT = 465;
 
-// SMS settings
-const char* PHONE_NUMBER = "+1234567890";
+// GPRS settings
+const char* GPRS_APN = "YOUR_APN";
+const char* GPRS_USER = "YOUR_USER";
+const char* GPRS_PASS = "YOUR_PASS";
+const unsigned long GPRS_REGISTER_MS = 60000;  // network registration after a restart
+
+// SMS settings: reports and geofence alerts go to every number
+const char* const SMS_RECIPIENTS[] = {"+1234567890"};
+
+// SMS commands: texts from these numbers are answered (WHERE, INTERVAL <min>,
+// SURVEY [ON|OFF]), texts from other numbers are read and deleted unanswered
+const bool USE_SMS_COMMANDS = false;
+const char* const SMS_WHITELIST[] = {"+1234567890"};
+const uint32_t SMS_FIX_MAX_AGE_S = 600;  // WHERE answers from a fix this recent
+const unsigned long SMS_INTERVAL_MAX_MIN = 1440;  // INTERVAL is clamped to a day
+const unsigned long SMS_READ_RETRY_MS = 5000;     // after AT+CMGR timed out
+
+// Text mode, and +CMTI for each message stored on the SIM. A modem restart
+// resets both, so GprsConnectTask sends them again after every restart.
+const char* const SMS_MODE_COMMANDS[] = {"AT+CMGF=1", "AT+CNMI=2,1,0,0,0"};
+
+// UDP report settings (see tools/udp_collector.cpp)
+const bool USE_UDP_REPORT = false;
+const char* REPORT_COLLECTOR_HOST = "your.collector.example.com";
+const uint16_t REPORT_COLLECTOR_PORT = 5683;
+const char* REPORT_PSK = "YOUR_REPORT_PSK";
+const uint32_t REPORT_DEVICE_ID = 1;
+
+// MQTT settings
+const bool USE_MQTT = false;
+const char* MQTT_BROKER = "broker.example.com";
+const uint16_t MQTT_PORT = 1883;
+const char* MQTT_CLIENT_ID = "cell-locator-1";
+const char* MQTT_TOPIC_PREFIX = "cell-locator/1";
+const char* MQTT_USER = nullptr;
+const char* MQTT_PASS = nullptr;
+const unsigned long MQTT_FLUSH_MS = 15000;  // per fix, before the rest stays buffered
+const unsigned long MQTT_LINK_OPEN_MS = 20000;  // CONNECT OK of the broker's mux link
+// GPRS data path of the MQTT upload (sim800_transparent.h). Transparent mode
+// holds the UART for the upload and hands it back to the mux afterwards.
+const SendMode MQTT_SEND_MODE = SEND_MODE_QUICK;
+
+// Times each send mode against tools/send_sink.cpp on the first GPRS run
+const bool RUN_SEND_MODE_BENCHMARK = false;
+const char* BENCH_SINK_HOST = "your.sink.example.com";
+const uint16_t BENCH_SINK_PORT = 5684;
+
+// Track smoothing: telemetry and the address lookup only run once the smoothed
+// position has moved this far beyond its own uncertainty
+const float MOVED_REPORT_DISTANCE_M = 250.0f;
+
+// Survey log: every fused observation with its fix, for tools/tower_estimator
+// and tools/fingerprint_builder (segments in /survey on LittleFS). This is
+// the state at boot; SURVEY ON / SURVEY OFF switch it at runtime.
+const bool SURVEY_LOG_AT_BOOT = false;
+// Records come one per fix, so the log writes its buffer out after this many
+// of them or once the oldest is this old, not only when a block is full
+const uint16_t SURVEY_FLUSH_RECORDS = 16;
+const unsigned long SURVEY_FLUSH_MS = 30UL * 60 * 1000;
+
+// Geofence zones (see tools/geofence_builder.cpp), uploaded with the LittleFS image
+const char* GEOFENCE_FILE = "/geofences.bin";
+
+// Cell-ID zones: sites known by the cells that cover them, checked on every
+// AT+CENG scan without a position fix. minRxlev 0 accepts any level.
+const bool USE_CELL_ZONES = false;
+const unsigned long CELL_ZONE_SCAN_MS = 60000;
+const CellZone CELL_ZONES[] = {
+  {1, "DEPOT"},
+};
+const CellZoneCell CELL_ZONE_CELLS[] = {
+  {1, cellKey(222, 10, 0x1A2B, 0x3C4D), 0},
+  {1, cellKey(222, 10, 0x1A2B, 0x3C4E), 20},
+};
+
+// All-operator network scan (AT+CNETSCAN), run in the background once the
+// device has been idle for a while; fresh cells of other operators are added
+// to the geolocation request
+const bool USE_NETSCAN = false;
+const unsigned long NETSCAN_INTERVAL_MS = 15UL * 60 * 1000;
+const unsigned long NETSCAN_IDLE_MS = 30000;
+const uint8_t NETSCAN_EXTRA_TOWERS = 6;
+
+// Extra SIM800L modules, each with a SIM of another operator, that read
+// their operator's cells in parallel with the data modem
+const bool USE_SCAN_MODEMS = false;
+const unsigned long SCAN_MODEM_WAIT_MS = 2000;  // after the data modem's own scan
 
 // SIM800L pins
 #define MODEM_RX 16
@@ -32,6 +143,33 @@ const char* PHONE_NUMBER = "+1234567890";
 
 SoftwareSerial sim800Serial(MODEM_RX, MODEM_TX);
 TinyGsm modem(sim800Serial);
+Sim800At modemAt(sim800Serial);
+Sim800Mux modemMux(modemAt);
+
+// Scan modems on UART1 / UART2 (RX, TX), one task each
+ScanModem scanModems[] = {
+  ScanModem("scan-uart1", Serial1, 26, 27),
+  ScanModem("scan-uart2", Serial2, 32, 33),
+};
+
+// Kept-alive TLS connections to the Google APIs, each on its own mux link on GPRS
+TlsEndpoint geolocateEndpoint("www.googleapis.com");
+TlsEndpoint geocodeEndpoint("maps.googleapis.com");
+MuxSocket geolocateLink(modemMux);
+MuxSocket geocodeLink(modemMux);
+
+UdpReportConfig udpReportConfig(REPORT_COLLECTOR_HOST, REPORT_COLLECTOR_PORT, REPORT_PSK,
+                                REPORT_DEVICE_ID);
+UdpReporter udpReporter(modemMux, udpReportConfig);
+
+// MQTT runs over whichever link the fix brought up (a mux link on GPRS)
+WiFiClient wifiClient;
+MuxSocket gsmClient(modemMux);
+const GprsApn gprsApn = {GPRS_APN, GPRS_USER, GPRS_PASS};
+TransparentSocket gsmBulkClient(modemMux, gprsApn);
+MqttPublisher mqtt(MQTT_BROKER, MQTT_PORT, MQTT_CLIENT_ID, MQTT_TOPIC_PREFIX);
+bool usingWiFi = false;
+bool gprsUp = false;  // PDP context of the data modem, see GprsConnectTask
 
 // Helper variables
 String cellInfo = "";
@@ -39,16 +177,568 @@ String locationInfo = "";
 String addressInfo = "";
 String googleMapLink = "";
 String allInfo = "";
+LocationFix currentFix;   // smoothed by the track filter
+TrackFilter track;
+GeofenceEngine geofences;
+uint8_t* geofenceImage = nullptr;
+CellZoneSet cellZones;
+SurveyLog surveyLog;
+bool littleFsMounted = false;
+CellFusion cellFusion; // All cell answers of the last scan window
+CellRadio cellRadio = RADIO_GSM;  // of the data modem's serving cell
+CellTable cellTable;   // Recent cells of all operators
+NetScanner netScanner(modemMux, cellTable, NETSCAN_INTERVAL_MS);
+unsigned long lastForeground = 0;  // end of the last modem use for a fix or zone scan
+CoopScheduler scheduler;  // modem flows that run between button presses
+AsyncModem asyncModem(modemMux);
+
+// The last observation, fix and cell table, published for readers outside
+// loop() (other tasks, the other core); cellInfo and locationInfo are
+// loop()'s own text of them
+struct CellObservation {
+  CellRecord cells[CELL_FUSION_MAX];  // serving cell first
+  uint8_t count = 0;
+  uint8_t scans = 0;
+  CellRadio radio = RADIO_GSM;
+  uint32_t timestamp = 0;  // seconds
+};
+Seqlock<CellObservation> latestCells;
+Seqlock<LocationFix> latestFix;
+Seqlock<CellTable> latestCellTable;
+unsigned long publishedNetScans = 0;
+
+SmsInbox smsInbox;            // +CMTI indices waiting for AT+CMGR
+SmsSender smsSender(asyncModem);  // claimed by the flow that sends
+unsigned long reportIntervalMs = 0;  // set by INTERVAL, 0 = off
+unsigned long lastReport = 0;
 
 // Function declarations
-bool connectWiFi();
-bool connectGPRS();
-bool getCellInfo();
-bool getLocationFromGoogle();
-bool getAddressFromGoogle();
+bool registered(const String& resp);
+bool addCellAnswer(const String& resp);
+bool scanModemsFinished();
+bool finishCellInfo();
+String geolocatePayload();
+bool applyGeolocation(const String& resp);
+String geocodePath();
+bool applyAddress(const String& resp);
 void sendEmail();
-void sendSMS();
-void runProcess();
+void prepareSMS(const String& text, const char* number = nullptr);
+void logSMS();
+void closeMuxLinks();
+String handleSmsCommand(const SmsMessage& msg);
+String describeFix(const LocationFix& fix);
+bool loadGeofences();
+bool startSurveyLog();
+void flushSurveyLog();
+void onGeofenceEvent(const GeofenceEvent& event, void* ctx);
+void onCellZoneEvent(const CellZoneEvent& event, void* ctx);
+
+// Every flow below runs on the scheduler and takes the modem through
+// asyncModem, so a fix, a zone scan and an SMS command interleave between
+// their AT commands instead of cutting each other's commands short.
+
+// One cell scan: the data modem's answers (see modem_traits.h) fused with
+// those of the scan modems. Shared by the fix and the zone scan, which claim
+// it. ok() once a serving cell is known.
+class CellScanTask : public CoopSubtask {
+public:
+  bool ok() const { return _ok; }
+
+  CoStatus step() override {
+    CO_BEGIN();
+    _ok = false;
+    if (ModemTraits::CELL_ENABLE[0]) CO_AT(asyncModem, ModemTraits::CELL_ENABLE, 1000);
+    cellFusion.reset();
+    if (USE_SCAN_MODEMS) {
+      for (ScanModem& m : scanModems) m.startScan(5);
+    }
+    // Retry until one answer is complete, fusing every answer on the way
+    for (_round = 0; _round < 5; ++_round) {
+      CO_AT(asyncModem, ModemTraits::CELL_QUERY, ModemTraits::CELL_TIMEOUT_MS);
+      if (asyncModem.result() == AT_OK && addCellAnswer(asyncModem.response())) break;
+      CO_SLEEP(500);
+    }
+    // The scan modems ran alongside; their cells join without a serving vote
+    _waitStart = millis();
+    CO_AWAIT(!USE_SCAN_MODEMS || scanModemsFinished() ||
+             millis() - _waitStart >= SCAN_MODEM_WAIT_MS);
+    if (USE_SCAN_MODEMS) {
+      for (ScanModem& m : scanModems) m.collect(cellFusion, 0);
+    }
+    _ok = finishCellInfo();
+    CO_END();
+  }
+
+private:
+  bool _ok = false;
+  uint8_t _round = 0;
+  unsigned long _waitStart = 0;
+};
+
+CellScanTask cellScan;
+
+// GPRS bring-up. The SIM800 sequence is TinyGSM's restart() and
+// gprsConnect() as async commands, so SMS commands and the zone scan are
+// served while the modem registers. LTE modules keep TinyGSM's NETOPEN
+// bring-up, which blocks.
+class GprsConnectTask : public CoopTask {
+public:
+  CoStatus step() override {
+    CO_BEGIN();
+    gprsUp = false;
+    CO_AWAIT(asyncModem.acquire(this));
+    if (!ModemTraits::HAS_CIPMUX) {
+      gprsUp = modem.restart();
+      if (gprsUp && USE_SMS_COMMANDS) {
+        for (const char* cmd : SMS_MODE_COMMANDS) modemMux.command(cmd);
+      }
+      gprsUp = gprsUp && modem.waitForNetwork() &&
+               modem.gprsConnect(GPRS_APN, GPRS_USER, GPRS_PASS);
+      asyncModem.release(this);
+      CO_EXIT();
+    }
+
+    CO_AT_HELD(asyncModem, "AT+CFUN=1,1", 10000);
+    CO_SLEEP(3000);
+    // Until the modem has booted and synced to the baud rate
+    for (_tries = 0; _tries < 20; ++_tries) {
+      CO_AT_HELD(asyncModem, "AT", 500);
+      if (asyncModem.result() == AT_OK) break;
+      CO_SLEEP(500);
+    }
+    if (!check(AT_OK)) CO_EXIT();
+    CO_AT_HELD(asyncModem, "ATE0", 1000);
+    // Before anyone else gets the modem, so no AT+CMGR is answered in PDU mode
+    if (USE_SMS_COMMANDS) {
+      for (_command = 0; _command < sizeof(SMS_MODE_COMMANDS) / sizeof(SMS_MODE_COMMANDS[0]);
+           ++_command) {
+        CO_AT_HELD(asyncModem, SMS_MODE_COMMANDS[_command], 1000);
+      }
+    }
+
+    // Home network or roaming
+    _start = millis();
+    for (;;) {
+      CO_AT_HELD(asyncModem, "AT+CREG?", 1000);
+      if (registered(asyncModem.response())) break;
+      if (millis() - _start >= GPRS_REGISTER_MS) {
+        asyncModem.release(this);
+        CO_EXIT();
+      }
+      CO_SLEEP(1000);
+    }
+
+    CO_AT_HELD(asyncModem, "AT+CIPSHUT", 10000, "SHUT OK");
+    if (!check(AT_MATCH)) CO_EXIT();
+    CO_AT_HELD(asyncModem, "AT+CGATT=1", 10000);
+    if (!check(AT_OK)) CO_EXIT();
+    CO_AT_HELD(asyncModem, "AT+CIPMUX=1", 1000);
+    if (!check(AT_OK)) CO_EXIT();
+    CO_AT_HELD(asyncModem, String("AT+CSTT=\"") + GPRS_APN + "\",\"" + GPRS_USER + "\",\"" +
+                               GPRS_PASS + "\"",
+               1000);
+    if (!check(AT_OK)) CO_EXIT();
+    CO_AT_HELD(asyncModem, "AT+CIICR", 60000);
+    if (!check(AT_OK)) CO_EXIT();
+    CO_AT_HELD(asyncModem, "AT+CIFSR", 5000, ".");  // the local IP
+    if (!check(AT_MATCH)) CO_EXIT();
+
+    // Data connections go through the multiplexed socket layer from here on
+    gprsUp = modemMux.begin() && modemMux.setQuickSend(MQTT_SEND_MODE == SEND_MODE_QUICK);
+    asyncModem.release(this);
+    CO_END();
+  }
+
+private:
+  // True if the last command ended with `expected`; gives the modem back otherwise.
+  bool check(AtResult expected) {
+    if (asyncModem.result() == expected) return true;
+    asyncModem.release(this);
+    return false;
+  }
+
+  uint8_t _tries = 0;
+  uint8_t _command = 0;
+  unsigned long _start = 0;
+};
+
+GprsConnectTask gprsConnect;
+
+// The broker's mux link on GPRS, opened without blocking: AT+CIPSTART runs
+// on the background slot and CONNECT OK is awaited with the modem free, so
+// a broker that is down never stalls the other flows. The publisher backs
+// off between failed attempts and logs in once the link is up.
+class MqttLinkTask : public CoopTask {
+public:
+  CoStatus step() override {
+    CO_BEGIN();
+    for (;;) {
+      CO_AWAIT(!usingWiFi && gprsUp && mqtt.wantsTransport());
+      CO_AWAIT(asyncModem.acquire(this));
+      _command = gsmClient.startConnect(MQTT_BROKER, MQTT_PORT);
+      if (_command.length() > 0) CO_AT_HELD(asyncModem, _command, 2000);
+      asyncModem.release(this);
+      if (_command.length() > 0 && asyncModem.result() == AT_OK) {
+        _start = millis();
+        CO_AWAIT(!gsmClient.connecting() || millis() - _start >= MQTT_LINK_OPEN_MS);
+      }
+      CO_AWAIT(asyncModem.acquire(this));
+      _ok = gsmClient.finishConnect();
+      asyncModem.release(this);
+      if (!_ok) {
+        Serial.println("MQTT broker not reachable over GPRS.");
+        mqtt.transportFailed();
+      }
+    }
+    CO_END();
+  }
+
+private:
+  String _command;
+  unsigned long _start = 0;
+  bool _ok = false;
+};
+
+MqttLinkTask mqttLink;
+
+// The fix itself: connect, scan, geolocate, then report by every channel.
+// CO_EXIT() ends it at the first step that fails.
+class FixProcess : public CoopTask {
+public:
+  CoStatus step() override {
+    CO_BEGIN();
+    Serial.println("=== Process started ===");
+    _alerts = "";
+
+    // Try WiFi first
+    Serial.println("Connecting to WiFi...");
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    _start = millis();
+    CO_AWAIT(WiFi.status() == WL_CONNECTED || millis() - _start >= WIFI_CONNECT_MS);
+    usingWiFi = WiFi.status() == WL_CONNECTED;
+    if (usingWiFi) {
+      Serial.println("WiFi connected.");
+      if (RUN_TLS_BENCHMARK && !_tlsBenchmarked) {
+        _tlsBenchmarked = true;
+        runTlsBenchmark(geolocateEndpoint, 5, Serial);
+      }
+    } else {
+      Serial.println("WiFi not available, trying SIM800L GPRS...");
+      CO_RUN(gprsConnect);
+      if (!gprsUp) {
+        Serial.println("GPRS connection failed!");
+        CO_EXIT();
+      }
+      Serial.println("GPRS connected.");
+      if (RUN_SEND_MODE_BENCHMARK && ModemTraits::HAS_CIPMUX && !_sendBenchmarked) {
+        _sendBenchmarked = true;
+        CO_AWAIT(asyncModem.acquire(this));
+        closeMuxLinks();
+        runSendModeBenchmark(modemMux, gprsApn, BENCH_SINK_HOST, BENCH_SINK_PORT, Serial);
+        asyncModem.release(this);
+      }
+    }
+    // The Google requests follow the link: TLS on the ESP32 over WiFi, TLS
+    // in the modem on a mux link each over GPRS
+    {
+      const bool mux = !usingWiFi && ModemTraits::HAS_CIPMUX;
+      geolocateEndpoint.useModem(mux ? &asyncModem : nullptr, mux ? &geolocateLink : nullptr);
+      geocodeEndpoint.useModem(mux ? &asyncModem : nullptr, mux ? &geocodeLink : nullptr);
+    }
+
+    Serial.println("Getting cell info...");
+    CO_AWAIT(cellScan.claim(this));
+    CO_RUN(cellScan);
+    // Copied out: a zone scan may fuse new answers while the requests run
+    cellFusion.toSnapshot(_cells);
+    _payload = cellScan.ok() ? geolocatePayload() : String("");
+    if (cellScan.ok()) {
+      cellZones.setHandler(onCellZoneEvent, &_alerts);
+      cellZones.evaluate(_cells);
+    }
+    cellScan.release(this);
+    if (_payload.length() == 0) {
+      Serial.println("Failed to get cell info.");
+      CO_EXIT();
+    }
+    Serial.println("Cell info retrieved:");
+    Serial.println(cellInfo);
+
+    Serial.println("Getting location from Google...");
+    _request.prepare(geolocateEndpoint, "POST",
+                     "/geolocation/v1/geolocate?key=" + String(GOOGLE_API_KEY), "application/json",
+                     &_payload);
+    CO_RUN(_request);
+    if (_request.status() != 200 || !applyGeolocation(_request.body())) {
+      Serial.println("Failed to get location info.");
+      CO_EXIT();
+    }
+    Serial.println("Location info retrieved:");
+    Serial.println(locationInfo);
+
+    if (surveyLog.active()) {
+      surveyLog.append(_cells, &currentFix);
+      surveyLog.flushIfDue();
+    }
+
+    geofences.setHandler(onGeofenceEvent, &_alerts);
+    geofences.evaluate(currentFix);
+
+    // Noise around an unchanged position needs no new address or telemetry
+    _moved = track.moved(MOVED_REPORT_DISTANCE_M);
+    if (!_moved && addressInfo.length() > 0) {
+      Serial.println("Position unchanged, reusing address:");
+      Serial.println(addressInfo);
+    } else {
+      Serial.println("Getting address from Google...");
+      _request.prepare(geocodeEndpoint, "GET", geocodePath());
+      CO_RUN(_request);
+      if (_request.status() != 200 || !applyAddress(_request.body())) {
+        Serial.println("Failed to get address info.");
+        CO_EXIT();
+      }
+      Serial.println("Address info retrieved:");
+      Serial.println(addressInfo);
+    }
+
+    // Generate Google Maps link
+    googleMapLink = "https://maps.google.com/?q=" + locationInfo;
+
+    // Combine all info
+    allInfo = "Cell Info:\n" + cellInfo + "\nLocation (Lat,Lng):\n" + locationInfo +
+              "\nAddress:\n" + addressInfo + "\nGoogle Maps:\n" + googleMapLink;
+    if (_alerts.length() > 0) allInfo = "Geofence:\n" + _alerts + allInfo;
+
+    Serial.println("=== All Info ===");
+    Serial.println(allInfo);
+
+    Serial.println("Sending email...");
+    sendEmail();
+
+    Serial.println("Sending SMS...");
+    CO_AWAIT(smsSender.claim(this));
+    prepareSMS(allInfo);
+    CO_RUN(smsSender);
+    logSMS();
+    smsSender.release(this);
+
+    // The reporter and the GPRS MQTT client run blocking mux commands: they
+    // hold the modem, so no task's command is aborted under them
+    if (USE_UDP_REPORT && ModemTraits::HAS_CIPMUX && _moved && gprsUp) {
+      Serial.println("Sending UDP report...");
+      CO_AWAIT(asyncModem.acquire(this));
+      if (!udpReporter.report(currentFix)) {
+        Serial.println("UDP report not acknowledged.");
+      }
+      asyncModem.release(this);
+    }
+
+    if (USE_MQTT && (usingWiFi || ModemTraits::HAS_CIPMUX)) {
+      Serial.println("Publishing to MQTT...");
+      _transparent = !usingWiFi && MQTT_SEND_MODE == SEND_MODE_TRANSPARENT;
+      if (usingWiFi) {
+        mqtt.setClient(wifiClient);
+        mqtt.setAutoConnect(true);
+      } else if (_transparent) {
+        // The transparent upload holds the UART until it is done
+        CO_AWAIT(asyncModem.acquire(this));
+        closeMuxLinks();
+        mqtt.setClient(gsmBulkClient);
+        mqtt.setAutoConnect(true);
+      } else {
+        mqtt.setClient(gsmClient);
+        mqtt.setAutoConnect(false);  // mqttLink opens the link
+      }
+      // Cells on every run, the fix only once it has moved
+      mqtt.publishCells(_cells);
+      if (_moved) mqtt.publishFix(currentFix);
+      for (_start = millis(); !mqtt.idle() && millis() - _start < MQTT_FLUSH_MS;) {
+        // A mux link is served between the other tasks' commands, so
+        // mqttLink can open it in the meantime
+        _muxLink = !usingWiFi && !_transparent;
+        if (_muxLink) CO_AWAIT(asyncModem.acquire(this));
+        mqtt.loop();
+        if (_muxLink) asyncModem.release(this);
+        CO_YIELD();
+      }
+      if (!mqtt.idle()) {
+        Serial.println("MQTT publish pending, " + String(mqtt.pending()) + " message(s) buffered.");
+      }
+      // Back to the mux; the broker keeps the session until the next run
+      if (_transparent) {
+        mqtt.disconnect();
+        asyncModem.release(this);
+      }
+    }
+
+    if (_moved) track.markReported();
+
+    Serial.println("=== Process finished ===");
+    CO_END();
+  }
+
+private:
+  unsigned long _start = 0;
+  bool _tlsBenchmarked = false;
+  bool _sendBenchmarked = false;
+  CellSnapshot _cells;
+  String _payload;
+  String _alerts;  // zone transitions of this run
+  TlsRequest _request;
+  bool _moved = false;
+  bool _transparent = false;
+  bool _muxLink = false;
+};
+
+FixProcess fixProcess;
+
+// Cell-ID zones between fixes: alerts as soon as a scan shows a change.
+class CellZoneScanTask : public CoopTask {
+public:
+  CoStatus step() override {
+    CO_BEGIN();
+    for (;;) {
+      CO_SLEEP(CELL_ZONE_SCAN_MS);
+      _alerts = "";
+      CO_AWAIT(cellScan.claim(this));
+      CO_RUN(cellScan);
+      if (cellScan.ok()) {
+        CellSnapshot cells;
+        cellFusion.toSnapshot(cells);
+        cellZones.setHandler(onCellZoneEvent, &_alerts);
+        cellZones.evaluate(cells);
+      }
+      cellScan.release(this);
+      if (_alerts.length() > 0) {
+        CO_AWAIT(smsSender.claim(this));
+        prepareSMS("Geofence:\n" + _alerts + "Cell Info:\n" + cellInfo);
+        CO_RUN(smsSender);
+        logSMS();
+        smsSender.release(this);
+      }
+      lastForeground = millis();
+    }
+    CO_END();
+  }
+
+private:
+  String _alerts;  // zone transitions of this scan
+};
+
+CellZoneScanTask zoneScanTask;
+
+// Incoming SMS commands: fetches each announced message through the async
+// modem, so a zone scan in progress only waits between its commands.
+class SmsCommandTask : public CoopTask {
+public:
+  // Lists the stored messages again, for +CMTI URCs nobody read.
+  void sweep() { _sweep = true; }
+
+  CoStatus step() override {
+    CO_BEGIN();
+    for (;;) {
+      CO_AWAIT(_sweep || !smsInbox.empty());
+      if (_sweep) {
+        _sweep = false;
+        CO_AT(asyncModem, "AT+CMGL=\"ALL\"", 5000);
+        if (asyncModem.result() == AT_OK) smsInbox.queueListed(asyncModem.response());
+      }
+      while (smsInbox.next(_index)) {
+        CO_AT(asyncModem, "AT+CMGR=" + String(_index), 5000);
+        if (asyncModem.result() == AT_TIMEOUT) {
+          // Still on the SIM: read it again later, or find it on the next sweep
+          if (!smsInbox.queue(_index)) _sweep = true;
+          CO_SLEEP(SMS_READ_RETRY_MS);
+          continue;
+        }
+        // Only a message that was read is deleted; an empty slot or an
+        // answer that does not parse leaves the SIM as it is
+        if (asyncModem.result() != AT_OK || !SmsInbox::parseMessage(asyncModem.response(), _msg)) {
+          continue;
+        }
+        CO_AT(asyncModem, "AT+CMGD=" + String(_index), 5000);
+        if (!SmsInbox::authorized(_msg.sender, SMS_WHITELIST,
+                                  sizeof(SMS_WHITELIST) / sizeof(SMS_WHITELIST[0]))) {
+          Serial.println(String("SMS from ") + _msg.sender + " ignored.");
+          continue;
+        }
+        Serial.println(String("SMS command from ") + _msg.sender + ": " + _msg.text);
+        _reply = handleSmsCommand(_msg);
+        if (_reply.length() > 0) {
+          CO_AWAIT(smsSender.claim(this));
+          prepareSMS(_reply, _msg.sender);
+          CO_RUN(smsSender);
+          logSMS();
+          smsSender.release(this);
+        }
+      }
+    }
+    CO_END();
+  }
+
+private:
+  bool _sweep = true;  // messages that arrived while powered off
+  uint16_t _index = 0;
+  SmsMessage _msg;
+  String _reply;
+};
+
+SmsCommandTask smsTask;
+
+// Runs the fix for the button, WHERE and INTERVAL. Requests while a fix is
+// running are served by one more fix after it, which replies to all of them.
+class FixTask : public CoopTask {
+public:
+  // `replyTo` also gets the new position by SMS.
+  void request(const String& replyTo = String("")) {
+    _requested = true;
+    if (replyTo.length() == 0) return;
+    for (uint8_t i = 0; i < _replyCount; ++i) {
+      if (_replyTo[i] == replyTo) return;
+    }
+    if (_replyCount < SMS_MAX_RECIPIENTS) {
+      _replyTo[_replyCount++] = replyTo;
+    } else {
+      Serial.println("No reply slot left for " + replyTo + ".");
+    }
+  }
+
+  CoStatus step() override {
+    CO_BEGIN();
+    for (;;) {
+      CO_AWAIT(_requested);
+      _requested = false;
+      for (uint8_t i = 0; i < _replyCount; ++i) {
+        _to[i] = _replyTo[i];
+        _numbers[i] = _to[i].c_str();
+      }
+      _toCount = _replyCount;
+      _replyCount = 0;
+      CO_RUN(fixProcess);
+      if (_toCount > 0) {
+        CO_AWAIT(smsSender.claim(this));
+        smsSender.prepare(describeFix(latestFix.read()), _numbers, _toCount);
+        CO_RUN(smsSender);
+        logSMS();
+        smsSender.release(this);
+      }
+      if (USE_SMS_COMMANDS) smsTask.sweep();
+      lastForeground = millis();
+      Serial.println("Ready. Press BOOT button to start process.");
+    }
+    CO_END();
+  }
+
+private:
+  bool _requested = false;
+  String _replyTo[SMS_MAX_RECIPIENTS];  // of the next fix
+  uint8_t _replyCount = 0;
+  String _to[SMS_MAX_RECIPIENTS];       // of the running fix
+  const char* _numbers[SMS_MAX_RECIPIENTS];
+  uint8_t _toCount = 0;
+};
+
+FixTask fixTask;
 
 void setup() {
   Serial.begin(115200);
@@ -59,6 +749,39 @@ void setup() {
 
   pinMode(BOOT_BUTTON_PIN, INPUT_PULLUP);
 
+  mqtt.setCredentials(MQTT_USER, MQTT_PASS);
+
+  if (USE_SCAN_MODEMS) {
+    for (ScanModem& m : scanModems) {
+      if (m.begin()) Serial.println(String("Scan modem ") + m.name() + " ready.");
+    }
+  }
+
+  if (USE_CELL_ZONES) {
+    cellZones.begin(CELL_ZONES, sizeof(CELL_ZONES) / sizeof(CELL_ZONES[0]), CELL_ZONE_CELLS,
+                    sizeof(CELL_ZONE_CELLS) / sizeof(CELL_ZONE_CELLS[0]));
+    scheduler.add(&zoneScanTask, true);
+  }
+
+  if (USE_SMS_COMMANDS) {
+    for (const char* cmd : SMS_MODE_COMMANDS) modemMux.command(cmd);
+    modemMux.setUrcHandler(SmsInbox::onUrc, &smsInbox);
+    scheduler.add(&smsTask, true);
+  }
+  if (USE_MQTT && ModemTraits::HAS_CIPMUX && MQTT_SEND_MODE != SEND_MODE_TRANSPARENT) {
+    scheduler.add(&mqttLink, true);
+  }
+  scheduler.add(&fixTask, true);
+
+  littleFsMounted = LittleFS.begin(true);
+  if (littleFsMounted) {
+    if (loadGeofences()) {
+      Serial.println("Loaded " + String(geofences.zones()) + " geofence zones.");
+    }
+    if (SURVEY_LOG_AT_BOOT && !startSurveyLog()) Serial.println("Survey log not available.");
+  }
+  esp_register_shutdown_handler(flushSurveyLog);
+
   Serial.println("Ready. Press BOOT button to start process.");
 }
 
@@ -66,168 +789,212 @@ void loop() {
   static bool lastButtonState = HIGH;
   bool buttonState = digitalRead(BOOT_BUTTON_PIN);
 
-  // Button pressed (active LOW)
+  // Button pressed (active LOW); fixTask runs it on the scheduler
   if (lastButtonState == HIGH && buttonState == LOW) {
     delay(50); // debounce
-    if (digitalRead(BOOT_BUTTON_PIN) == LOW) {
-      runProcess();
-      // Wait for button release to avoid retrigger
-      while (digitalRead(BOOT_BUTTON_PIN) == LOW) {
-        delay(10);
-      }
-      Serial.println("Ready. Press BOOT button to start process.");
-    }
+    if (digitalRead(BOOT_BUTTON_PIN) == LOW) fixTask.request();
   }
   lastButtonState = buttonState;
-}
 
-void runProcess() {
-  Serial.println("=== Process started ===");
+  scheduler.runOnce();
 
-  // Try WiFi first
-  Serial.println("Connecting to WiFi...");
-  if (connectWiFi()) {
-    Serial.println("WiFi connected.");
-  } else {
-    Serial.println("WiFi not available, trying SIM800L GPRS...");
-    if (!connectGPRS()) {
-      Serial.println("GPRS connection failed!");
-      return;
+  if (USE_SMS_COMMANDS) {
+    modemMux.poll();  // +CMTI URCs while no task is talking to the modem
+    if (reportIntervalMs > 0 && millis() - lastReport >= reportIntervalMs) {
+      lastReport = millis();
+      fixTask.request();
     }
-    Serial.println("GPRS connected.");
   }
 
-  Serial.println("Getting cell info...");
-  if (getCellInfo()) {
-    Serial.println("Cell info retrieved:");
-    Serial.println(cellInfo);
-  } else {
-    Serial.println("Failed to get cell info.");
-    return;
+  // Drain messages buffered while the link was down, and keep the session
+  // alive; a transparent upload holds the UART, so it only runs in the fix.
+  // On GPRS only while no task holds the modem, as its mux commands would
+  // abort the task's command; a dropped link is reopened by mqttLink, never
+  // from here.
+  if (USE_MQTT && (usingWiFi || (MQTT_SEND_MODE != SEND_MODE_TRANSPARENT && !asyncModem.busy()))) {
+    mqtt.loop();
   }
 
-  Serial.println("Getting location from Google...");
-  if (getLocationFromGoogle()) {
-    Serial.println("Location info retrieved:");
-    Serial.println(locationInfo);
-  } else {
-    Serial.println("Failed to get location info.");
-    return;
+  if (surveyLog.active()) surveyLog.flushIfDue();
+
+  if (USE_NETSCAN && ModemTraits::HAS_NETSCAN) {
+    netScanner.poll(millis() - lastForeground >= NETSCAN_IDLE_MS && !asyncModem.busy());
+    if (netScanner.stats().scans != publishedNetScans) {
+      publishedNetScans = netScanner.stats().scans;
+      latestCellTable.write(cellTable);
+    }
   }
+}
 
-  Serial.println("Getting address from Google...");
-  if (getAddressFromGoogle()) {
-    Serial.println("Address info retrieved:");
-    Serial.println(addressInfo);
-  } else {
-    Serial.println("Failed to get address info.");
-    return;
+// Load the geofence zones into RAM
+bool loadGeofences() {
+  File f = LittleFS.open(GEOFENCE_FILE, "r");
+  if (!f) return false;
+  size_t len = f.size();
+  geofenceImage = (uint8_t*)malloc(len);
+  if (!geofenceImage || f.read(geofenceImage, len) != len || !geofences.attach(geofenceImage, len)) {
+    free(geofenceImage);
+    geofenceImage = nullptr;
+    f.close();
+    return false;
   }
+  f.close();
+  return true;
+}
 
-  // Generate Google Maps link
-  googleMapLink = "https://maps.google.com/?q=" + locationInfo;
+// Opens the survey log, unless it is open; false without LittleFS
+bool startSurveyLog() {
+  if (surveyLog.active()) return true;
+  // Room for the geofence image and the rest of the data partition
+  if (!littleFsMounted || !surveyLog.begin(LittleFS, LittleFS.totalBytes() / 10 * 7)) return false;
+  surveyLog.setFlushPolicy(SURVEY_FLUSH_RECORDS, SURVEY_FLUSH_MS);
+  return true;
+}
 
-  // Combine all info
-  allInfo = "Cell Info:\n" + cellInfo + "\nLocation (Lat,Lng):\n" + locationInfo +
-            "\nAddress:\n" + addressInfo + "\nGoogle Maps:\n" + googleMapLink;
+// Buffered survey records on esp_restart(); power loss still costs them
+void flushSurveyLog() {
+  surveyLog.flush();
+}
 
-  Serial.println("=== All Info ===");
-  Serial.println(allInfo);
+// Collect geofence transitions into the alerts (a String) of the flow
+// that evaluates them
+void onGeofenceEvent(const GeofenceEvent& event, void* ctx) {
+  String line = String(event.entered ? "Entered " : "Left ") + event.name;
+  Serial.println("Geofence: " + line);
+  *static_cast<String*>(ctx) += line + "\n";
+}
 
-  Serial.println("Sending email...");
-  sendEmail();
+// Collect cell zone transitions; they need no position fix
+void onCellZoneEvent(const CellZoneEvent& event, void* ctx) {
+  String line = String(event.entered ? "Entered " : "Left ") + event.zone->name + " (cell zone)";
+  Serial.println("Geofence: " + line);
+  *static_cast<String*>(ctx) += line + "\n";
+}
 
-  Serial.println("Sending SMS...");
-  sendSMS();
+// True if an AT+CREG? answer shows the home network or roaming
+bool registered(const String& resp) {
+  AtValues<4> v;
+  if (!parseAtResponse(AT_CREG, resp.c_str(), resp.length(), v)) return false;
+  const int32_t stat = v[AT_FIELD(AT_CREG, stat)].num;
+  return stat == 1 || stat == 5;
+}
 
-  Serial.println("=== Process finished ===");
+// Fuse one answer of the data modem; true if it was complete
+bool addCellAnswer(const String& resp) {
+  CellSnapshot snap;
+  bool complete = false;
+  ModemTraits::parseCells(resp.c_str(), resp.length(), snap, complete, cellRadio);
+  snap.timestamp = millis() / 1000;
+  cellFusion.add(snap);
+  return complete && snap.count > 0;
 }
 
-// Connect to WiFi
-bool connectWiFi() {
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
-  unsigned long start = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - start < 10000) {
-    delay(500);
-    Serial.print(".");
+bool scanModemsFinished() {
+  for (ScanModem& m : scanModems) {
+    if (!m.finished()) return false;
   }
-  Serial.println();
-  return WiFi.status() == WL_CONNECTED;
+  return true;
 }
 
-// Connect to GPRS via SIM800L
-bool connectGPRS() {
-  modem.restart();
-  if (!modem.waitForNetwork()) return false;
-  if (!modem.gprsConnect("YOUR_APN", "YOUR_USER", "YOUR_PASS")) return false;
+// Describe the fused observation and update the cell table
+bool finishCellInfo() {
+  int serving = cellFusion.servingIndex();
+  if (serving < 0) return false;
+  const CellRecord& cell = cellFusion[serving].cell;
+  const OperatorInfo* op = findOperator(cell.mcc, cell.mnc);
+  cellInfo = op ? String(op->name) + " (" + op->country + "), " : String("");
+  cellInfo += "MCC " + String(cell.mcc) + ", MNC " + String(cell.mnc) + ", LAC " + String(cell.lac) +
+              ", CID " + String(cell.cid) + " (" + String(cellFusion.count()) + " cells over " +
+              String(cellFusion.scans()) + " scans)";
+
+  CellObservation observation;
+  observation.count = cellFusion.toCells(observation.cells, CELL_FUSION_MAX);
+  observation.scans = cellFusion.scans();
+  observation.radio = cellRadio;
+  observation.timestamp = millis() / 1000;
+  latestCells.write(observation);
+
+  if (USE_NETSCAN) {
+    CellSnapshot cells;
+    cellFusion.toSnapshot(cells);
+    uint32_t now = millis() / 1000;
+    netScanner.setHome(cell.mcc, cell.mnc);
+    cellTable.expire(now);
+    cellTable.observe(cells.cells, cells.count, now, cell.mcc, cell.mnc, CELL_SOURCE_CENG);
+    latestCellTable.write(cellTable);
+  }
   return true;
 }
 
-// Get cell info from SIM800L
-bool getCellInfo() {
-  // Example: AT+CENG or AT+CREG? or AT+CSQ
-  String response;
-  sim800Serial.println("AT+CREG?");
-  delay(500);
-  while (sim800Serial.available()) {
-    response += char(sim800Serial.read());
-  }
-  cellInfo = response;
-  // Parse and extract more info as needed (LAC, CID, MCC, MNC, etc.)
-  // For full info, use AT+CENG or AT+CGED commands and parse response
-  return response.length() > 0;
-}
-
-// Get location from Google Geolocation API
-bool getLocationFromGoogle() {
-  // You must extract MCC, MNC, LAC, CID from cellInfo
-  // For demo, use dummy values
-  int mcc = 222, mnc = 10, lac = 12345, cid = 67890;
-  String payload = "{\"cellTowers\":[{\"cellId\":" + String(cid) +
-                   ",\"locationAreaCode\":" + String(lac) +
-                   ",\"mobileCountryCode\":" + String(mcc) +
-                   ",\"mobileNetworkCode\":" + String(mnc) + "}]}";
-
-  HTTPClient http;
-  String url = "https://www.googleapis.com/geolocation/v1/geolocate?key=" + String(GOOGLE_API_KEY);
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  int httpCode = http.POST(payload);
-  if (httpCode == 200) {
-    String resp = http.getString();
-    DynamicJsonDocument doc(1024);
-    deserializeJson(doc, resp);
-    float lat = doc["location"]["lat"];
-    float lng = doc["location"]["lng"];
-    float accuracy = doc["accuracy"];
-    locationInfo = String(lat, 6) + "," + String(lng, 6) + " (Accuracy: " + String(accuracy) + "m)";
-    http.end();
-    return true;
-  }
-  http.end();
-  return false;
-}
-
-// Get address from Google Reverse Geocoding API
-bool getAddressFromGoogle() {
+// Google Geolocation API request body; empty without cells
+String geolocatePayload() {
+  // Serving cell first, neighbours (of every scan modem) by mean RxLev over
+  // the scan window
+  CellRecord cells[CELL_FUSION_MAX + NETSCAN_EXTRA_TOWERS];
+  uint8_t count = cellFusion.toCells(cells, CELL_FUSION_MAX);
+  if (count == 0) return "";
+  // Other operators' cells from the background scan, if taken at this place
+  if (USE_NETSCAN) {
+    count += cellTable.select(cells, count, millis() / 1000, cells + count, NETSCAN_EXTRA_TOWERS);
+  }
+  JsonDocument request;
+  request["radioType"] = radioTypeName(cellRadio);
+  request["considerIp"] = false;
+  JsonArray towers = request["cellTowers"].to<JsonArray>();
+  for (uint8_t i = 0; i < count; ++i) {
+    const CellRecord& c = cells[i];
+    JsonObject tower = towers.add<JsonObject>();
+    tower["cellId"] = c.cid;
+    tower["locationAreaCode"] = c.lac;
+    tower["mobileCountryCode"] = c.mcc;
+    tower["mobileNetworkCode"] = c.mnc;
+    tower["signalStrength"] = rxlevToDbm(c.rxlev);
+    if (i == 0 && c.ta != CELL_TA_UNKNOWN) tower["timingAdvance"] = c.ta;
+  }
+  String payload;
+  serializeJson(request, payload);
+  return payload;
+}
+
+// Feed the Geolocation API answer to the track filter
+bool applyGeolocation(const String& resp) {
+  JsonDocument doc;
+  if (deserializeJson(doc, resp)) return false;
+  LocationFix raw;
+  raw.lat = doc["location"]["lat"];
+  raw.lng = doc["location"]["lng"];
+  raw.accuracy = doc["accuracy"];
+  raw.timestamp = millis() / 1000;
+  raw.valid = true;
+  if (!track.update(raw)) Serial.println("Fix rejected as outlier, keeping the track.");
+  currentFix = track.estimate();
+  latestFix.write(currentFix);
+  locationInfo = String(currentFix.lat, 6) + "," + String(currentFix.lng, 6) +
+                 " (Accuracy: " + String(currentFix.accuracy) + "m)";
+  return true;
+}
+
+// Google Reverse Geocoding API request for the current position
+String geocodePath() {
   // Extract lat/lng from locationInfo
   float lat = 0, lng = 0;
   sscanf(locationInfo.c_str(), "%f,%f", &lat, &lng);
-  HTTPClient http;
-  String url = "https://maps.googleapis.com/maps/api/geocode/json?latlng=" +
-               String(lat, 6) + "," + String(lng, 6) + "&key=" + String(GOOGLE_API_KEY);
-  http.begin(url);
-  int httpCode = http.GET();
-  if (httpCode == 200) {
-    String resp = http.getString();
-    DynamicJsonDocument doc(2048);
-    deserializeJson(doc, resp);
-    addressInfo = doc["results"][0]["formatted_address"].as<String>();
-    http.end();
-    return true;
-  }
-  http.end();
-  return false;
+  return "/maps/api/geocode/json?latlng=" + String(lat, 6) + "," + String(lng, 6) +
+         "&key=" + String(GOOGLE_API_KEY);
+}
+
+bool applyAddress(const String& resp) {
+  JsonDocument doc;
+  if (deserializeJson(doc, resp)) return false;
+  addressInfo = doc["results"][0]["formatted_address"].as<String>();
+  return true;
+}
+
+// Transparent mode needs every mux link closed; run holding the modem
+void closeMuxLinks() {
+  udpReporter.end();
+  geolocateLink.stop();
+  geocodeLink.stop();
 }
 
 // Send email (use ESP_Mail_Client or similar library)
@@ -236,17 +1003,85 @@ void sendEmail() {
   Serial.println("Sending email (not implemented in this scaffold)...");
 }
 
-// Send SMS via SIM800L
-void sendSMS() {
-  sim800Serial.println("AT+CMGF=1"); // Set SMS to text mode
-  delay(1000);
-  sim800Serial.print("AT+CMGS=\"");
-  sim800Serial.print(PHONE_NUMBER);
-  sim800Serial.println("\"");
-  delay(1000);
-  sim800Serial.print(allInfo);
-  delay(500);
-  sim800Serial.write(26); // Ctrl+Z to send
-  delay(5000);
-  Serial.println("SMS sent.");
+// Prepare the claimed smsSender for `number`, or for all SMS_RECIPIENTS
+void prepareSMS(const String& text, const char* number) {
+  const char* const* numbers = number ? &number : SMS_RECIPIENTS;
+  uint8_t count = number ? 1 : sizeof(SMS_RECIPIENTS) / sizeof(SMS_RECIPIENTS[0]);
+  smsSender.prepare(text, numbers, count);
+}
+
+void logSMS() {
+  const uint8_t segments = smsSender.encoded().count;
+  for (uint8_t i = 0; i < smsSender.resultCount(); ++i) {
+    const SmsRecipientResult& r = smsSender.result(i);
+    Serial.println(String("SMS to ") + r.number + (r.ok ? ": sent" : ": failed") + " (" + r.sent +
+                   "/" + segments + " segments, " + r.attempts + " attempts)");
+  }
+}
+
+// The argument of INTERVAL: whitespace, then only digits. Clamped to
+// SMS_INTERVAL_MAX_MIN; false if it is anything else.
+bool parseIntervalMinutes(const char* arg, unsigned long& minutes) {
+  if (!isspace((unsigned char)*arg)) return false;
+  while (isspace((unsigned char)*arg)) arg++;
+  if (!isdigit((unsigned char)*arg)) return false;
+  minutes = 0;
+  for (; isdigit((unsigned char)*arg); arg++) {
+    // Stops growing past the maximum, so no number of digits overflows
+    if (minutes <= SMS_INTERVAL_MAX_MIN) minutes = minutes * 10 + (*arg - '0');
+  }
+  if (*arg != '\0') return false;
+  if (minutes > SMS_INTERVAL_MAX_MIN) minutes = SMS_INTERVAL_MAX_MIN;
+  return true;
+}
+
+// Reply to a whitelisted SMS; empty if the reply comes later (WHERE without
+// a recent fix is answered after the next fix)
+String handleSmsCommand(const SmsMessage& msg) {
+  String text = msg.text;
+  text.trim();
+  text.toUpperCase();
+  if (text == "WHERE") {
+    LocationFix fix = latestFix.read();
+    if (fix.valid && millis() / 1000 - fix.timestamp <= SMS_FIX_MAX_AGE_S) return describeFix(fix);
+    fixTask.request(msg.sender);
+    return "";
+  }
+  if (text.startsWith("INTERVAL")) {
+    unsigned long minutes;
+    if (!parseIntervalMinutes(text.c_str() + 8, minutes)) {
+      return "Usage: INTERVAL <min>, 0 to " + String(SMS_INTERVAL_MAX_MIN) + " (0 = off).";
+    }
+    reportIntervalMs = minutes * 60000UL;
+    lastReport = millis();
+    return minutes > 0 ? "Reporting every " + String(minutes) + " min." : String("Reports off.");
+  }
+  if (text == "SURVEY ON") {
+    if (!startSurveyLog()) return "Survey log not available.";
+    return "Survey log on, " + String((unsigned long)surveyLog.bytesOnFlash()) + " bytes on flash.";
+  }
+  if (text == "SURVEY OFF") {
+    surveyLog.end();
+    return "Survey log off.";
+  }
+  if (text == "SURVEY") {
+    CellObservation cells = latestCells.read();
+    if (cells.count == 0) return "No cells observed yet.";
+    const CellRecord& c = cells.cells[0];
+    // The SMS task runs in loop(), which owns the table: no copy of it needed
+    const CellTable& table = cellTable;
+    return "Serving MCC " + String(c.mcc) + ", MNC " + String(c.mnc) + ", LAC " + String(c.lac) +
+           ", CID " + String(c.cid) + "; " + String(cells.count) + " cells over " +
+           String(cells.scans) + " scans, " + String((millis() / 1000 - cells.timestamp) / 60) +
+           " min ago; " + String(table.count()) + " cells of all operators known; survey log " +
+           (surveyLog.active() ? "on." : "off.");
+  }
+  return "Commands: WHERE, INTERVAL <min> (0 = off), SURVEY [ON|OFF]";
+}
+
+String describeFix(const LocationFix& fix) {
+  if (!fix.valid) return "No position fix available.";
+  String pos = String(fix.lat, 6) + "," + String(fix.lng, 6);
+  return pos + " +/-" + String(fix.accuracy, 0) + " m, " +
+         String((millis() / 1000 - fix.timestamp) / 60) + " min ago\nhttps://maps.google.com/?q=" + pos;
 }
@@ -0,0 +1,336 @@
+#include "mqtt_publisher.h"
+
+static const uint8_t MQTT_CONNECT = 0x10;
+static const uint8_t MQTT_CONNACK = 0x20;
+static const uint8_t MQTT_PUBLISH_QOS1 = 0x32;
+static const uint8_t MQTT_DUP_FLAG = 0x08;
+static const uint8_t MQTT_PUBACK = 0x40;
+static const uint8_t MQTT_PINGREQ = 0xC0;
+static const uint8_t MQTT_DISCONNECT = 0xE0;
+
+static const unsigned long MQTT_ACK_TIMEOUT_MS = 10000;
+static const unsigned long MQTT_CONNACK_TIMEOUT_MS = 5000;
+static const unsigned long MQTT_BACKOFF_MAX_MS = 60000;
+
+// Fixed header (max 5 bytes) + topic + packet id + payload.
+static uint8_t txBuffer[5 + 2 + MQTT_MAX_TOPIC + 2 + MQTT_MAX_PAYLOAD];
+
+static size_t putString(uint8_t* p, const char* s) {
+  size_t len = strlen(s);
+  p[0] = uint8_t(len >> 8);
+  p[1] = uint8_t(len);
+  memcpy(p + 2, s, len);
+  return len + 2;
+}
+
+MqttPublisher::MqttPublisher(const char* host, uint16_t port, const char* clientId,
+                             const char* topicPrefix)
+    : _host(host), _port(port), _clientId(clientId), _topicPrefix(topicPrefix) {}
+
+void MqttPublisher::setClient(Client& client) {
+  if (_client == &client) return;
+  if (_client && _client->connected()) _client->stop();
+  _client = &client;
+  _connected = false;
+  _handshake = false;
+  _backoff = 0;
+}
+
+bool MqttPublisher::wantsTransport() {
+  return _client && !_client->connected() && millis() - _lastAttempt >= _backoff;
+}
+
+void MqttPublisher::setCredentials(const char* user, const char* pass) {
+  _user = user;
+  _pass = pass;
+}
+
+// ---- offline buffer --------------------------------------------------------
+
+void MqttPublisher::pushBytes(const uint8_t* data, size_t len) {
+  size_t tail = (_head + _used) % MQTT_QUEUE_BYTES;
+  for (size_t i = 0; i < len; ++i) {
+    _queue[tail] = data[i];
+    tail = (tail + 1) % MQTT_QUEUE_BYTES;
+  }
+  _used += len;
+}
+
+void MqttPublisher::peekBytes(size_t offset, uint8_t* out, size_t len) const {
+  size_t pos = (_head + offset) % MQTT_QUEUE_BYTES;
+  for (size_t i = 0; i < len; ++i) {
+    out[i] = _queue[pos];
+    pos = (pos + 1) % MQTT_QUEUE_BYTES;
+  }
+}
+
+// Total size of the record starting `offset` bytes after the head.
+size_t MqttPublisher::recordSize(size_t offset, uint8_t* topic) const {
+  uint8_t hdr[3];
+  peekBytes(offset, hdr, 3);
+  if (topic) *topic = hdr[0];
+  return 3 + (hdr[1] | (size_t(hdr[2]) << 8));
+}
+
+void MqttPublisher::dropFront(size_t records) {
+  while (records-- > 0 && _count > 0) {
+    size_t size = recordSize(0, nullptr);
+    _head = (_head + size) % MQTT_QUEUE_BYTES;
+    _used -= size;
+    _count--;
+  }
+}
+
+bool MqttPublisher::enqueue(MqttTopic topic, const char* json, size_t len) {
+  // A message must fit in a publish on its own, with the array brackets.
+  if (len + 2 > MQTT_MAX_PAYLOAD) return false;
+  while (_used + len + 3 > MQTT_QUEUE_BYTES) {
+    // The oldest message may be part of the in-flight batch; that copy is
+    // still sent, its PUBACK just removes one record less.
+    if (_inflightRecords > 0) _inflightRecords--;
+    dropFront(1);
+    _stats.dropped++;
+  }
+  uint8_t hdr[3] = {uint8_t(topic), uint8_t(len), uint8_t(len >> 8)};
+  pushBytes(hdr, 3);
+  pushBytes(reinterpret_cast<const uint8_t*>(json), len);
+  _count++;
+  return true;
+}
+
+bool MqttPublisher::publishFix(const LocationFix& fix) {
+  if (!fix.valid) return false;
+  char json[96];
+  int len = snprintf(json, sizeof(json), "{\"t\":%lu,\"lat\":%.6f,\"lng\":%.6f,\"acc\":%.0f}",
+                     (unsigned long)fix.timestamp, fix.lat, fix.lng, fix.accuracy);
+  return enqueue(MQTT_TOPIC_FIX, json, (size_t)len);
+}
+
+bool MqttPublisher::publishCells(const CellSnapshot& cells) {
+  if (cells.count == 0) return false;
+  char json[32 + CELL_SNAPSHOT_MAX * 36];
+  size_t len = (size_t)snprintf(json, sizeof(json), "{\"t\":%lu,\"cells\":[",
+                                (unsigned long)cells.timestamp);
+  for (uint8_t i = 0; i < cells.count; ++i) {
+    const CellRecord& c = cells.cells[i];
+    len += (size_t)snprintf(json + len, sizeof(json) - len, "%s[%u,%u,%u,%lu,%u]", i ? "," : "",
+                            c.mcc, c.mnc, c.lac, (unsigned long)c.cid, c.rxlev);
+  }
+  len += (size_t)snprintf(json + len, sizeof(json) - len, "]}");
+  return enqueue(MQTT_TOPIC_CELLS, json, len);
+}
+
+// ---- protocol ----------------------------------------------------------------
+
+// Sends a packet whose variable header and payload already sit at txBuffer + 5.
+bool MqttPublisher::sendPacket(uint8_t header, const uint8_t* body, size_t len) {
+  uint8_t* start = txBuffer + 5;
+  if (body) memcpy(start, body, len);
+
+  uint8_t lenBytes[4];
+  size_t n = 0;
+  size_t remaining = len;
+  do {
+    uint8_t b = remaining % 128;
+    remaining /= 128;
+    if (remaining > 0) b |= 0x80;
+    lenBytes[n++] = b;
+  } while (remaining > 0);
+
+  start -= n;
+  memcpy(start, lenBytes, n);
+  *--start = header;
+  size_t total = 1 + n + len;
+  if (_client->write(start, total) != total) {
+    _client->stop();
+    _connected = false;
+    return false;
+  }
+  _lastOut = millis();
+  return true;
+}
+
+bool MqttPublisher::connect() {
+  _lastAttempt = millis();
+  if (!_client->connected() && !_client->connect(_host, _port)) {
+    retryLater();
+    return false;
+  }
+
+  uint8_t* p = txBuffer + 5;
+  size_t len = putString(p, "MQTT");
+  p[len++] = 4;  // protocol level 3.1.1
+  uint8_t flags = 0;  // clean session off: the broker keeps our session
+  if (_user) flags |= 0x80;
+  if (_pass) flags |= 0x40;
+  p[len++] = flags;
+  p[len++] = uint8_t(_keepAlive >> 8);
+  p[len++] = uint8_t(_keepAlive);
+  len += putString(p + len, _clientId);
+  if (_user) len += putString(p + len, _user);
+  if (_pass) len += putString(p + len, _pass);
+  if (!sendPacket(MQTT_CONNECT, nullptr, len)) {
+    retryLater();
+    return false;
+  }
+  _handshake = true;
+  return true;
+}
+
+// CONNACK: 20 02 <session present> <return code>. False while it has not
+// arrived, and after a refusal or a timeout.
+bool MqttPublisher::readConnack() {
+  if (_client->available() < 4) {
+    if (_client->connected() && millis() - _lastAttempt < MQTT_CONNACK_TIMEOUT_MS) return false;
+  } else {
+    uint8_t ack[4];
+    for (uint8_t& b : ack) b = uint8_t(_client->read());
+    if (ack[0] == MQTT_CONNACK && ack[3] == 0) {
+      _handshake = false;
+      _connected = true;
+      _backoff = 0;
+      _stats.connects++;
+      // An unacknowledged batch is resent with DUP set, whatever the broker kept.
+      if (_inflight) sendPublish(true);
+      return true;
+    }
+  }
+  Serial.println("[MQTT] Broker refused connection.");
+  _handshake = false;
+  _client->stop();
+  retryLater();
+  return false;
+}
+
+void MqttPublisher::retryLater() {
+  _lastAttempt = millis();
+  _backoff = _backoff == 0 ? 1000 : min(_backoff * 2, MQTT_BACKOFF_MAX_MS);
+}
+
+void MqttPublisher::readPackets() {
+  while (_client->available() >= 2) {
+    uint8_t header = uint8_t(_client->read());
+    size_t remaining = 0;
+    int shift = 0;
+    int b;
+    do {
+      b = _client->read();
+      if (b < 0) return;
+      remaining |= size_t(b & 0x7F) << shift;
+      shift += 7;
+    } while ((b & 0x80) && shift < 28);
+
+    uint8_t body[4];
+    size_t got = 0;
+    unsigned long start = millis();
+    while (got < remaining && millis() - start < 1000) {
+      int c = _client->read();
+      if (c < 0) {
+        delay(1);
+        continue;
+      }
+      if (got < sizeof(body)) body[got] = uint8_t(c);
+      got++;
+    }
+
+    if ((header & 0xF0) == MQTT_PUBACK && remaining == 2 && _inflight) {
+      uint16_t id = uint16_t((body[0] << 8) | body[1]);
+      if (id == _packetId) {
+        _stats.published++;
+        _stats.messages += _inflightRecords;
+        dropFront(_inflightRecords);
+        _inflightRecords = 0;
+        _inflight = false;
+      }
+    }
+    // PINGRESP and anything else need no action.
+  }
+}
+
+bool MqttPublisher::sendPublish(bool dup) {
+  static const char* suffixes[MQTT_TOPIC_COUNT] = {"/fix", "/cells"};
+  char topic[MQTT_MAX_TOPIC + 1];
+  snprintf(topic, sizeof(topic), "%s%s", _topicPrefix, suffixes[_inflightTopic]);
+
+  uint8_t* p = txBuffer + 5;
+  size_t len = putString(p, topic);
+  p[len++] = uint8_t(_packetId >> 8);
+  p[len++] = uint8_t(_packetId);
+  memcpy(p + len, _payload, _payloadLen);
+  len += _payloadLen;
+
+  _inflightSent = millis();
+  if (dup) _stats.resent++;
+  return sendPacket(MQTT_PUBLISH_QOS1 | (dup ? MQTT_DUP_FLAG : 0), nullptr, len);
+}
+
+void MqttPublisher::sendBatch() {
+  // Collect consecutive messages for the same topic into one JSON array.
+  uint8_t topic = 0;
+  recordSize(0, &topic);
+  size_t offset = 0;
+  size_t records = 0;
+  _payloadLen = 0;
+  _payload[_payloadLen++] = '[';
+  while (records < _count) {
+    uint8_t t;
+    size_t size = recordSize(offset, &t);
+    size_t json = size - 3;
+    if (t != topic || _payloadLen + json + 2 > MQTT_MAX_PAYLOAD) break;
+    if (records > 0) _payload[_payloadLen++] = ',';
+    peekBytes(offset + 3, _payload + _payloadLen, json);
+    _payloadLen += json;
+    offset += size;
+    records++;
+  }
+  _payload[_payloadLen++] = ']';
+
+  _packetId = _packetId == 0xFFFF ? 1 : _packetId + 1;
+  _inflightRecords = records;
+  _inflightTopic = topic;
+  _inflight = true;
+  sendPublish(false);
+}
+
+void MqttPublisher::loop() {
+  if (!_client) return;
+  if (!_client->connected()) _connected = false;
+  if (!_connected) {
+    if (!_handshake) {
+      if (millis() - _lastAttempt < _backoff) return;
+      if (!_autoConnect && !_client->connected()) return;
+      if (!connect()) return;
+    }
+    if (!readConnack()) return;
+  }
+
+  readPackets();
+
+  if (_inflight) {
+    if (millis() - _inflightSent > MQTT_ACK_TIMEOUT_MS) sendPublish(true);
+  } else if (_count > 0) {
+    sendBatch();
+  }
+
+  if (_connected && millis() - _lastOut > _keepAlive * 1000UL / 2) {
+    sendPacket(MQTT_PINGREQ, nullptr, 0);
+  }
+}
+
+bool MqttPublisher::flush(unsigned long timeout) {
+  unsigned long start = millis();
+  while (!idle() && millis() - start < timeout) {
+    loop();
+    delay(10);
+  }
+  return idle();
+}
+
+void MqttPublisher::disconnect() {
+  if (_client && (_connected || _handshake)) {
+    if (_connected) sendPacket(MQTT_DISCONNECT, nullptr, 0);
+    _client->stop();
+  }
+  _connected = false;
+  _handshake = false;
+}
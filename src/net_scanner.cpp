@@ -0,0 +1,50 @@
+#include "net_scanner.h"
+
+#include "netscan_parser.h"
+
+void NetScanner::poll(bool idle) {
+  if (_scanning) {
+    _mux.poll();
+    if (!_mux.backgroundPending(_command)) collect();
+    return;
+  }
+  if (!idle || _homeMcc == 0) return;
+  if (_done && millis() - _lastScan < _interval) return;
+
+  // Show LAC and BSIC, without which the cells cannot be identified.
+  if (!_configured) {
+    if (_mux.command("AT+CNETSCAN=1") != AT_OK) {
+      _stats.failed++;
+      _done = true;
+      _lastScan = millis();
+      return;
+    }
+    _configured = true;
+  }
+  _response = "";
+  _scanStart = millis();
+  _command = _mux.startBackground("AT+CNETSCAN", NETSCAN_TIMEOUT_MS, &_response);
+  _scanning = _command != 0;
+}
+
+void NetScanner::collect() {
+  _scanning = false;
+  AtResult result = _mux.backgroundResult(_command);
+  if (result == AT_TIMEOUT && millis() - _scanStart < NETSCAN_TIMEOUT_MS) {
+    // Aborted by a foreground command; try again when idle.
+    _stats.aborted++;
+    return;
+  }
+  _done = true;
+  _lastScan = millis();
+  if (result != AT_OK) {
+    _stats.failed++;
+    return;
+  }
+  CellRecord cells[NETSCAN_MAX_CELLS];
+  uint8_t n = parseNetscanResponse(_response.c_str(), _response.length(), cells, NETSCAN_MAX_CELLS);
+  _response = "";
+  _table.observe(cells, n, millis() / 1000, _homeMcc, _homeMnc, CELL_SOURCE_NETSCAN);
+  _stats.scans++;
+  _stats.lastCells = n;
+}
@@ -0,0 +1,65 @@
+#include "scan_modem.h"
+
+#include "modem_traits.h"
+
+bool ScanModem::begin() {
+  _serial.begin(_baud, SERIAL_8N1, _rxPin, _txPin);
+  if (_at.command("AT", 1000) != AT_OK) {
+    Serial.println(String("[SCAN] ") + _name + ": no answer from modem.");
+    return false;
+  }
+  if (ModemTraits::CELL_ENABLE[0]) _at.command(ModemTraits::CELL_ENABLE);
+  _done = xSemaphoreCreateBinary();
+  if (!_done) return false;
+  if (xTaskCreate(taskEntry, _name, SCAN_MODEM_STACK, this, 1, &_task) != pdPASS) {
+    _task = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool ScanModem::startScan(uint8_t rounds) {
+  if (!_task || _busy) return false;
+  xSemaphoreTake(_done, 0);  // drop the signal of a window nobody collected
+  _rounds = rounds < SCAN_MODEM_MAX_ROUNDS ? rounds : SCAN_MODEM_MAX_ROUNDS;
+  _busy = true;
+  xTaskNotifyGive(_task);
+  return true;
+}
+
+bool ScanModem::collect(CellFusion& fusion, unsigned long timeout) {
+  if (!_task) return false;
+  if (xSemaphoreTake(_done, pdMS_TO_TICKS(timeout)) != pdTRUE) return false;
+  for (uint8_t i = 0; i < _answerCount; ++i) fusion.add(_answers[i], false);
+  return _answerCount > 0;
+}
+
+void ScanModem::taskEntry(void* arg) {
+  static_cast<ScanModem*>(arg)->run();
+}
+
+void ScanModem::run() {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    scan();
+    _busy = false;
+    xSemaphoreGive(_done);
+  }
+}
+
+void ScanModem::scan() {
+  _answerCount = 0;
+  for (uint8_t i = 0; i < _rounds; ++i) {
+    String resp;
+    if (_at.command(ModemTraits::CELL_QUERY, ModemTraits::CELL_TIMEOUT_MS, &resp) == AT_OK) {
+      CellSnapshot& snap = _answers[_answerCount];
+      bool complete = false;
+      CellRadio radio;
+      ModemTraits::parseCells(resp.c_str(), resp.length(), snap, complete, radio);
+      snap.timestamp = millis() / 1000;
+      if (snap.count > 0) _answerCount++;
+      if (complete && snap.count > 0) break;
+    }
+    vTaskDelay(pdMS_TO_TICKS(500));
+  }
+}
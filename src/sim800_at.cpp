@@ -0,0 +1,76 @@
+#include "sim800_at.h"
+
+static bool isErrorLine(const String& line) {
+  return line == "ERROR" || line.startsWith("+CME ERROR") || line.startsWith("+CMS ERROR");
+}
+
+void Sim800At::send(const String& cmd) {
+  _serial.print(cmd);
+  _serial.print("\r\n");
+}
+
+bool Sim800At::readLine(String& line, unsigned long timeout) {
+  line = "";
+  unsigned long start = millis();
+  while (millis() - start < timeout) {
+    while (_serial.available()) {
+      char c = _serial.read();
+      if (c == '\n') {
+        if (line.length() > 0) return true;
+        continue;
+      }
+      if (c == '\r') continue;
+      line += c;
+    }
+    delay(1);
+  }
+  return false;
+}
+
+AtResult Sim800At::waitResponse(unsigned long timeout, String* out, const char* expect) {
+  unsigned long start = millis();
+  String line;
+  for (;;) {
+    unsigned long elapsed = millis() - start;
+    if (elapsed >= timeout || !readLine(line, timeout - elapsed)) break;
+    if (expect && line.indexOf(expect) != -1) {
+      if (out) *out += line + "\n";
+      return AT_MATCH;
+    }
+    if (line == "OK") return AT_OK;
+    if (isErrorLine(line)) {
+      if (out) *out += line + "\n";
+      return AT_ERROR;
+    }
+    if (out) *out += line + "\n";
+  }
+  return AT_TIMEOUT;
+}
+
+AtResult Sim800At::command(const String& cmd, unsigned long timeout, String* out, const char* expect) {
+  send(cmd);
+  return waitResponse(timeout, out, expect);
+}
+
+bool Sim800At::waitPrompt(unsigned long timeout) {
+  unsigned long start = millis();
+  while (millis() - start < timeout) {
+    while (_serial.available()) {
+      if (_serial.read() == '>') return true;
+    }
+    delay(1);
+  }
+  return false;
+}
+
+size_t Sim800At::readRaw(uint8_t* buf, size_t len, unsigned long timeout) {
+  size_t got = 0;
+  unsigned long start = millis();
+  while (got < len && millis() - start < timeout) {
+    while (got < len && _serial.available()) {
+      buf[got++] = uint8_t(_serial.read());
+    }
+    if (got < len) delay(1);
+  }
+  return got;
+}
@@ -0,0 +1,442 @@
+#include "sim800_mux.h"
+
+#include "at_response.h"
+
+typedef std::lock_guard<std::recursive_mutex> MuxGuard;
+
+static bool isErrorLine(const String& line) {
+  return line == "ERROR" || line.startsWith("+CME ERROR") || line.startsWith("+CMS ERROR");
+}
+
+// Lines the modem may send at any time that are not socket events.
+static bool isUnsolicited(const String& line) {
+  return line.startsWith("+CMTI:") || line.startsWith("+CDS:") || line.startsWith("+CLIP:") ||
+         line == "RING" || line == "Call Ready" || line == "SMS Ready" ||
+         line.startsWith("UNDER-VOLTAGE") || line.startsWith("OVER-VOLTAGE") ||
+         line == "NORMAL POWER DOWN";
+}
+
+bool Sim800Mux::begin() {
+  MuxGuard guard(_lock);
+  // CIPMUX can only change while no connection is open; ERROR here just
+  // means it is already in multi-link mode.
+  command("AT+CIPMUX=1");
+  if (command("AT+CIPRXGET=0") != AT_OK) return false;
+  _ssl = false;  // the modem's default after a restart
+  if (!setQuickSend(_quickSend)) return false;
+  querySendSizes();
+  return true;
+}
+
+bool Sim800Mux::setQuickSend(bool enabled) {
+  MuxGuard guard(_lock);
+  if (command(enabled ? "AT+CIPQSEND=1" : "AT+CIPQSEND=0") != AT_OK) return false;
+  _quickSend = enabled;
+  return true;
+}
+
+uint8_t Sim800Mux::linksInUse() const {
+  uint8_t n = 0;
+  for (const Link& l : _links) {
+    if (l.state != LINK_FREE) n++;
+  }
+  return n;
+}
+
+void Sim800Mux::setUrcHandler(UrcHandler handler, void* ctx) {
+  _urcHandler = handler;
+  _urcCtx = ctx;
+}
+
+void Sim800Mux::poll() {
+  MuxGuard guard(_lock);
+  String line;
+  while (nextLine(line)) handleLine(line);
+  if (_background && (!_waiting || millis() - _backgroundStart >= _backgroundTimeout)) {
+    finishBackground();
+  }
+}
+
+uint32_t Sim800Mux::startBackground(const String& cmd, unsigned long timeout, String* out,
+                                    const char* expect) {
+  MuxGuard guard(_lock);
+  if (_background) return 0;
+  _out = out;
+  _expect = expect;
+  _result = AT_TIMEOUT;
+  _waiting = true;
+  _prompt = false;
+  _background = true;
+  _backgroundStart = millis();
+  _backgroundTimeout = timeout;
+  if (cmd.length() > 0) _at.send(cmd);
+  if (++_backgroundId == 0) _backgroundId = 1;
+  return _backgroundId;
+}
+
+void Sim800Mux::abortBackground() {
+  MuxGuard guard(_lock);
+  if (!_background) return;
+  const uint8_t abort = '\r';
+  _at.writeRaw(&abort, 1);
+  pumpUntil(SIM800_ABORT_WAIT_MS, [this] { return !_waiting; });
+  _result = AT_TIMEOUT;
+  _waiting = true;  // an abort is never a result
+  finishBackground();
+}
+
+void Sim800Mux::finishBackground() {
+  _backgroundResult = _waiting ? AT_TIMEOUT : _result;
+  _background = false;
+  _waiting = false;
+  _out = nullptr;
+  _expect = nullptr;
+}
+
+bool Sim800Mux::nextLine(String& line) {
+  Stream& serial = _at.stream();
+  while (serial.available()) {
+    char c = serial.read();
+    if (c == '\n') {
+      // A lone space is what is left of a "> " prompt.
+      if (_partial.length() == 0 || _partial == " ") {
+        _partial = "";
+        continue;
+      }
+      line = _partial;
+      _partial = "";
+      return true;
+    }
+    if (c == '\r') continue;
+    _partial += c;
+    // The CIPSEND / CMGS prompt is "> " with no line ending.
+    if (_partial == ">" && _waiting) {
+      _prompt = true;
+      _partial = "";
+      if (_expect && strcmp(_expect, ">") == 0) {
+        _result = AT_MATCH;
+        _waiting = false;
+      }
+    }
+  }
+  return false;
+}
+
+void Sim800Mux::receive(uint8_t link, size_t len) {
+  Link& l = _links[link];
+  uint8_t chunk[64];
+  while (len > 0) {
+    size_t n = len < sizeof(chunk) ? len : sizeof(chunk);
+    size_t got = _at.readRaw(chunk, n, 1000);
+    for (size_t i = 0; i < got; ++i) {
+      if (l.count == SIM800_LINK_RX_BYTES) {
+        l.stats.dropped++;
+        continue;
+      }
+      l.rx[(l.head + l.count) % SIM800_LINK_RX_BYTES] = chunk[i];
+      l.count++;
+    }
+    l.stats.bytesIn += got;
+    if (got < n) break;
+    len -= n;
+  }
+}
+
+bool Sim800Mux::handleLinkEvent(const String& line) {
+  if (line.startsWith("+RECEIVE,")) {
+    // +RECEIVE,<n>,<len>:
+    int comma = line.indexOf(',', 9);
+    int link = line.substring(9, comma).toInt();
+    size_t len = (size_t)line.substring(comma + 1).toInt();
+    if (comma != -1 && link >= 0 && link < SIM800_MAX_LINKS) receive(uint8_t(link), len);
+    return true;
+  }
+  if (line.startsWith("DATA ACCEPT:")) {
+    int link = line.substring(12).toInt();
+    if (link >= 0 && link < SIM800_MAX_LINKS) _links[link].sendPending = false;
+    return true;
+  }
+  if (line == "+PDP: DEACT") {
+    for (Link& l : _links) {
+      if (l.state == LINK_CONNECTED || l.state == LINK_CONNECTING) l.state = LINK_CLOSED;
+      l.sendPending = false;
+    }
+    return true;
+  }
+  // "<n>, <event>"
+  if (line.length() < 4 || line[0] < '0' || line[0] > '5' || line[1] != ',' || line[2] != ' ') {
+    return false;
+  }
+  Link& l = _links[line[0] - '0'];
+  String event = line.substring(3);
+  if (event == "CONNECT OK" || event == "ALREADY CONNECT") {
+    l.state = LINK_CONNECTED;
+  } else if (event == "CONNECT FAIL" || event == "CLOSED" || event == "CLOSE OK") {
+    l.state = LINK_CLOSED;
+    l.sendFailed = l.sendPending;
+    l.sendPending = false;
+  } else if (event == "SEND OK") {
+    l.sendPending = false;
+  } else if (event == "SEND FAIL") {
+    l.sendPending = false;
+    l.sendFailed = true;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void Sim800Mux::handleLine(const String& line) {
+  if (handleLinkEvent(line)) return;
+  if (isUnsolicited(line)) {
+    if (_urcHandler) _urcHandler(line, _urcCtx);
+    return;
+  }
+  if (!_waiting) return;  // stray response, nobody is waiting for it
+  if (_expect && line.indexOf(_expect) != -1) {
+    if (_out) *_out += line + "\n";
+    _result = AT_MATCH;
+    _waiting = false;
+  } else if (line == "OK") {
+    _result = AT_OK;
+    _waiting = false;
+  } else if (isErrorLine(line)) {
+    if (_out) *_out += line + "\n";
+    _result = AT_ERROR;
+    _waiting = false;
+  } else if (_out) {
+    *_out += line + "\n";
+  }
+}
+
+AtResult Sim800Mux::command(const String& cmd, unsigned long timeout, String* out,
+                            const char* expect) {
+  MuxGuard guard(_lock);
+  abortBackground();
+  _out = out;
+  _expect = expect;
+  _result = AT_TIMEOUT;
+  _waiting = true;
+  _at.send(cmd);
+  pumpUntil(timeout, [this] { return !_waiting; });
+  _waiting = false;
+  _out = nullptr;
+  _expect = nullptr;
+  return _result;
+}
+
+void Sim800Mux::querySendSizes() {
+  String resp;
+  if (command("AT+CIPSEND?", 1000, &resp) != AT_OK) return;
+  parseAtLines(AT_CIPSEND, resp.c_str(), resp.length(), [this](const AtValues<2>& v) {
+    const int32_t link = v[AT_FIELD(AT_CIPSEND, link)].num;
+    const int32_t size = v[AT_FIELD(AT_CIPSEND, size)].num;
+    if (link >= 0 && link < SIM800_MAX_LINKS && size > 0) _links[link].maxSend = (size_t)size;
+  });
+}
+
+int Sim800Mux::allocate() {
+  MuxGuard guard(_lock);
+  for (uint8_t i = 0; i < SIM800_MAX_LINKS; ++i) {
+    if (_links[i].state == LINK_FREE) {
+      _links[i].state = LINK_IDLE;
+      _links[i].head = 0;
+      _links[i].count = 0;
+      _links[i].stats = LinkStats();
+      return i;
+    }
+  }
+  return -1;
+}
+
+void Sim800Mux::release(uint8_t link) {
+  MuxGuard guard(_lock);
+  close(link);
+  _links[link].state = LINK_FREE;
+}
+
+bool Sim800Mux::open(uint8_t link, const char* proto, const char* host, uint16_t port,
+                     unsigned long timeout) {
+  MuxGuard guard(_lock);
+  Link& l = _links[link];
+  String cmd = openCommand(link, proto, host, port);
+  if (cmd.length() == 0 || command(cmd, 2000) != AT_OK) {
+    l.state = LINK_IDLE;
+    return false;
+  }
+  pumpUntil(timeout, [&l] { return l.state != LINK_CONNECTING; });
+  return finishOpen(link);
+}
+
+String Sim800Mux::openCommand(uint8_t link, const char* proto, const char* host, uint16_t port,
+                              bool ssl) {
+  MuxGuard guard(_lock);
+  if (ssl != _ssl) {
+    if (command(ssl ? "AT+CIPSSL=1" : "AT+CIPSSL=0") != AT_OK) return "";
+    _ssl = ssl;
+  }
+  _links[link].state = LINK_CONNECTING;
+  return "AT+CIPSTART=" + String(link) + ",\"" + proto + "\",\"" + host + "\"," + String(port);
+}
+
+bool Sim800Mux::finishOpen(uint8_t link) {
+  MuxGuard guard(_lock);
+  Link& l = _links[link];
+  if (l.state != LINK_CONNECTED) {
+    // No answer yet: close it, or a late CONNECT OK revives the link
+    if (l.state == LINK_CONNECTING) close(link);
+    l.state = LINK_IDLE;
+    return false;
+  }
+  querySendSizes();
+  return true;
+}
+
+size_t Sim800Mux::send(uint8_t link, const uint8_t* data, size_t len) {
+  MuxGuard guard(_lock);
+  abortBackground();
+  Link& l = _links[link];
+  size_t sent = 0;
+  while (sent < len && l.state == LINK_CONNECTED) {
+    size_t chunk = len - sent;
+    if (chunk > l.maxSend) chunk = l.maxSend;
+
+    _prompt = false;
+    _result = AT_TIMEOUT;
+    _waiting = true;
+    _at.send("AT+CIPSEND=" + String(link) + "," + String(chunk));
+    pumpUntil(3000, [this] { return _prompt || !_waiting; });
+    bool prompted = _prompt;
+    _waiting = false;
+    if (!prompted) break;
+
+    l.sendPending = true;
+    l.sendFailed = false;
+    _at.writeRaw(data + sent, chunk);
+    if (!pumpUntil(10000, [&l] { return !l.sendPending; }) || l.sendFailed) break;
+    sent += chunk;
+    l.stats.bytesOut += chunk;
+  }
+  return sent;
+}
+
+void Sim800Mux::close(uint8_t link) {
+  MuxGuard guard(_lock);
+  Link& l = _links[link];
+  if (l.state == LINK_CONNECTED || l.state == LINK_CONNECTING) {
+    command("AT+CIPCLOSE=" + String(link) + ",1", 2000, nullptr, "CLOSE OK");
+  }
+  l.state = LINK_IDLE;
+  l.sendPending = false;
+}
+
+int Sim800Mux::read(uint8_t link) {
+  MuxGuard guard(_lock);
+  Link& l = _links[link];
+  if (l.count == 0) return -1;
+  uint8_t b = l.rx[l.head];
+  l.head = (l.head + 1) % SIM800_LINK_RX_BYTES;
+  l.count--;
+  return b;
+}
+
+int Sim800Mux::peek(uint8_t link) const {
+  const Link& l = _links[link];
+  return l.count == 0 ? -1 : l.rx[l.head];
+}
+
+size_t Sim800Mux::read(uint8_t link, uint8_t* buf, size_t len) {
+  MuxGuard guard(_lock);
+  size_t n = 0;
+  int b;
+  while (n < len && (b = read(link)) >= 0) buf[n++] = uint8_t(b);
+  return n;
+}
+
+// ---- MuxSocket -----------------------------------------------------------------
+
+bool MuxSocket::open(const char* proto, const char* host, uint16_t port) {
+  if (_link >= 0) stop();
+  _link = _mux.allocate();
+  if (_link < 0) return false;
+  if (!_mux.open(uint8_t(_link), proto, host, port)) {
+    _mux.release(uint8_t(_link));
+    _link = -1;
+    return false;
+  }
+  return true;
+}
+
+int MuxSocket::connect(const char* host, uint16_t port) {
+  return open("TCP", host, port) ? 1 : 0;
+}
+
+int MuxSocket::connect(IPAddress ip, uint16_t port) {
+  return connect(ip.toString().c_str(), port);
+}
+
+bool MuxSocket::connectUdp(const char* host, uint16_t port) {
+  return open("UDP", host, port);
+}
+
+String MuxSocket::startConnect(const char* host, uint16_t port, bool ssl) {
+  if (_link >= 0) stop();
+  _link = _mux.allocate();
+  if (_link < 0) return "";
+  return _mux.openCommand(uint8_t(_link), "TCP", host, port, ssl);
+}
+
+bool MuxSocket::connecting() {
+  if (_link < 0) return false;
+  _mux.poll();
+  return _mux.state(uint8_t(_link)) == LINK_CONNECTING;
+}
+
+bool MuxSocket::finishConnect() {
+  if (_link < 0) return false;
+  if (_mux.finishOpen(uint8_t(_link))) return true;
+  stop();
+  return false;
+}
+
+size_t MuxSocket::write(const uint8_t* buf, size_t size) {
+  if (_link < 0) return 0;
+  return _mux.send(uint8_t(_link), buf, size);
+}
+
+int MuxSocket::available() {
+  if (_link < 0) return 0;
+  _mux.poll();
+  return (int)_mux.available(uint8_t(_link));
+}
+
+int MuxSocket::read() {
+  if (_link < 0) return -1;
+  _mux.poll();
+  return _mux.read(uint8_t(_link));
+}
+
+int MuxSocket::read(uint8_t* buf, size_t size) {
+  if (_link < 0) return -1;
+  _mux.poll();
+  return (int)_mux.read(uint8_t(_link), buf, size);
+}
+
+int MuxSocket::peek() {
+  if (_link < 0) return -1;
+  _mux.poll();
+  return _mux.peek(uint8_t(_link));
+}
+
+void MuxSocket::stop() {
+  if (_link < 0) return;
+  _mux.release(uint8_t(_link));
+  _link = -1;
+}
+
+uint8_t MuxSocket::connected() {
+  if (_link < 0) return 0;
+  _mux.poll();
+  // Data received before a remote close can still be read.
+  return _mux.state(uint8_t(_link)) == LINK_CONNECTED || _mux.available(uint8_t(_link)) > 0;
+}
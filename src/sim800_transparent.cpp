@@ -0,0 +1,195 @@
+#include "sim800_transparent.h"
+
+// Silence required before and after "+++" (AT+CIPCCFG default is 1 s).
+static const unsigned long ESCAPE_GUARD_MS = 1000;
+
+const char* sendModeName(SendMode mode) {
+  switch (mode) {
+    case SEND_MODE_PROMPT: return "prompt";
+    case SEND_MODE_QUICK: return "quick-send";
+    case SEND_MODE_TRANSPARENT: return "transparent";
+  }
+  return "?";
+}
+
+bool TransparentSocket::reconfigure(bool transparent) {
+  Sim800At& at = _mux.at();
+  // CIPMUX and CIPMODE can only change in IP INITIAL state, i.e. with the
+  // bearer shut down, so the PDP context is brought up again afterwards.
+  if (at.command("AT+CIPSHUT", 10000, nullptr, "SHUT OK") != AT_MATCH) return false;
+  if (at.command(transparent ? "AT+CIPMUX=0" : "AT+CIPMUX=1") != AT_OK) return false;
+  if (at.command(transparent ? "AT+CIPMODE=1" : "AT+CIPMODE=0") != AT_OK) return false;
+  if (transparent) {
+    // 5 retries, 200 ms packing timer, 1024 B packets, escape enabled
+    at.command("AT+CIPCCFG=5,2,1024,1");
+  }
+  String cstt = String("AT+CSTT=\"") + _apn.apn + "\",\"" + _apn.user + "\",\"" + _apn.pass + "\"";
+  if (at.command(cstt) != AT_OK) return false;
+  if (at.command("AT+CIICR", 60000) != AT_OK) return false;
+  // AT+CIFSR answers with the bare IP address and no OK.
+  if (at.command("AT+CIFSR", 5000, nullptr, ".") != AT_MATCH) return false;
+  return transparent || _mux.begin();
+}
+
+int TransparentSocket::connect(const char* host, uint16_t port) {
+  stop();
+  _hold = std::unique_lock<std::recursive_mutex>(_mux.lock());
+  if (_mux.linksInUse() > 0) {
+    Serial.println("[TCP] Transparent mode needs all mux links closed.");
+    _hold.unlock();
+    return 0;
+  }
+  if (!reconfigure(true)) {
+    Serial.println("[TCP] Could not switch to transparent mode.");
+    reconfigure(false);
+    _hold.unlock();
+    return 0;
+  }
+
+  Sim800At& at = _mux.at();
+  String cmd = String("AT+CIPSTART=\"TCP\",\"") + host + "\"," + String(port);
+  String resp;
+  if (at.command(cmd, 2000) != AT_OK || at.waitResponse(15000, &resp, "CONNECT") != AT_MATCH ||
+      resp.indexOf("FAIL") != -1) {
+    reconfigure(false);
+    _hold.unlock();
+    return 0;
+  }
+  _state = STATE_DATA;
+  _lastWrite = millis();
+  return 1;
+}
+
+int TransparentSocket::connect(IPAddress ip, uint16_t port) {
+  return connect(ip.toString().c_str(), port);
+}
+
+size_t TransparentSocket::write(const uint8_t* buf, size_t size) {
+  if (_state != STATE_DATA) return 0;
+  _mux.at().writeRaw(buf, size);
+  _lastWrite = millis();
+  return size;
+}
+
+int TransparentSocket::available() {
+  return _state == STATE_DATA ? _mux.at().stream().available() : 0;
+}
+
+int TransparentSocket::read() {
+  return _state == STATE_DATA ? _mux.at().stream().read() : -1;
+}
+
+int TransparentSocket::read(uint8_t* buf, size_t size) {
+  if (_state != STATE_DATA) return -1;
+  Stream& serial = _mux.at().stream();
+  size_t n = 0;
+  while (n < size && serial.available()) buf[n++] = uint8_t(serial.read());
+  return (int)n;
+}
+
+int TransparentSocket::peek() {
+  return _state == STATE_DATA ? _mux.at().stream().peek() : -1;
+}
+
+void TransparentSocket::flush() {
+  _mux.at().stream().flush();
+}
+
+bool TransparentSocket::escape() {
+  if (_state != STATE_DATA) return _state == STATE_COMMAND;
+  flush();
+  unsigned long idle = millis() - _lastWrite;
+  if (idle < ESCAPE_GUARD_MS) delay(ESCAPE_GUARD_MS - idle);
+  _mux.at().stream().print("+++");
+  delay(ESCAPE_GUARD_MS);
+  if (_mux.at().waitResponse(2000) != AT_OK) return false;
+  _state = STATE_COMMAND;
+  return true;
+}
+
+bool TransparentSocket::resume() {
+  if (_state != STATE_COMMAND) return _state == STATE_DATA;
+  if (_mux.at().command("ATO", 3000, nullptr, "CONNECT") != AT_MATCH) return false;
+  _state = STATE_DATA;
+  return true;
+}
+
+void TransparentSocket::stop() {
+  if (_state == STATE_CLOSED) return;
+  escape();
+  _mux.at().command("AT+CIPCLOSE", 5000, nullptr, "CLOSE OK");
+  reconfigure(false);
+  _state = STATE_CLOSED;
+  if (_hold.owns_lock()) _hold.unlock();
+}
+
+// ---- benchmark -----------------------------------------------------------------
+
+static const size_t BENCH_SIZES[] = {32, 200, 1024, 4096};
+static const unsigned long BENCH_ACK_TIMEOUT_MS = 30000;
+
+static void putLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+
+// The sink's 4-byte answer: the length it received.
+static bool waitAck(Client& client, uint32_t size) {
+  uint8_t ack[4];
+  size_t got = 0;
+  unsigned long start = millis();
+  while (got < sizeof(ack) && millis() - start < BENCH_ACK_TIMEOUT_MS) {
+    int b = client.read();
+    if (b < 0) {
+      delay(1);
+      continue;
+    }
+    ack[got++] = uint8_t(b);
+  }
+  uint8_t expected[4];
+  putLe32(expected, size);
+  return got == sizeof(ack) && memcmp(ack, expected, sizeof(ack)) == 0;
+}
+
+static void benchClient(Client& client, SendMode mode, Print& out) {
+  static uint8_t payload[4096];
+  for (size_t i = 0; i < sizeof(payload); ++i) payload[i] = uint8_t('A' + i % 26);
+  for (size_t size : BENCH_SIZES) {
+    uint8_t header[4];
+    putLe32(header, uint32_t(size));
+    unsigned long start = millis();
+    size_t sent = client.write(header, sizeof(header));
+    sent += client.write(payload, size);
+    client.flush();
+    unsigned long blocked = millis() - start;
+    bool acked = sent == size + sizeof(header) && waitAck(client, uint32_t(size));
+    unsigned long total = millis() - start;
+    out.println(String("[BENCH] ") + sendModeName(mode) + " " + String((unsigned long)size) +
+                " B: blocked " + String(blocked) + " ms, " +
+                (acked ? "acked after " + String(total) + " ms" : String("no ack")));
+  }
+}
+
+void runSendModeBenchmark(Sim800Mux& mux, const GprsApn& apn, const char* host, uint16_t port,
+                          Print& out) {
+  const bool quick = mux.quickSend();
+  const bool modes[] = {false, true};
+  for (bool q : modes) {
+    mux.setQuickSend(q);
+    MuxSocket socket(mux);
+    if (!socket.connect(host, port)) {
+      out.println("[BENCH] Could not connect to sink.");
+      continue;
+    }
+    benchClient(socket, q ? SEND_MODE_QUICK : SEND_MODE_PROMPT, out);
+    socket.stop();
+  }
+  mux.setQuickSend(quick);
+
+  TransparentSocket transparent(mux, apn);
+  if (!transparent.connect(host, port)) {
+    out.println("[BENCH] Could not open transparent connection.");
+    return;
+  }
+  benchClient(transparent, SEND_MODE_TRANSPARENT, out);
+  transparent.stop();
+}
@@ -0,0 +1,75 @@
+#include "sms_sender.h"
+
+#include "at_response.h"
+
+static const uint8_t CTRL_Z = 0x1A;
+static const uint8_t ESCAPE = 0x1B;
+
+void SmsSender::prepare(const String& text, const char* const* numbers, uint8_t count) {
+  if (count > SMS_MAX_RECIPIENTS) count = SMS_MAX_RECIPIENTS;
+  _count = count;
+  for (uint8_t i = 0; i < count; ++i) {
+    _results[i] = SmsRecipientResult();
+    _results[i].number = numbers[i];
+  }
+  smsEncode(text.c_str(), text.length(), ++_ref, _encoded);
+}
+
+CoStatus SmsSender::step() {
+  CO_BEGIN();
+  _delivered = 0;
+  CO_AWAIT(_modem.acquire(this));
+  CO_AT_HELD(_modem, "AT+CMGF=0", 1000);
+  if (_modem.result() == AT_OK) {
+    for (_pass = 0; _pass < _config.attempts && _delivered < _count; ++_pass) {
+      // The modem stays held: released, another task's command would run in PDU mode
+      if (_pass > 0) CO_SLEEP(_config.retryDelayMs);
+      for (_recipient = 0; _recipient < _count; ++_recipient) {
+        if (_results[_recipient].ok) continue;
+        // Resume where the last pass stopped; a failed segment ends this pass
+        while (_results[_recipient].sent < _encoded.count) {
+          _results[_recipient].attempts++;
+          {
+            const SmsRecipientResult& r = _results[_recipient];
+            const size_t tpdu = smsPduHeader(_encoded.segments[r.sent], _encoded.concat, r.number,
+                                             _header);
+            _modem.start("AT+CMGS=" + String(tpdu), _config.promptTimeoutMs, ">");
+          }
+          CO_AWAIT(_modem.done());
+          if (_modem.result() != AT_MATCH) {
+            if (_modem.result() == AT_TIMEOUT) {
+              // Leave the PDU input, if the prompt was only late
+              _modem.write(&ESCAPE, 1);
+              CO_AT_HELD(_modem, "", 1000);
+            }
+            break;
+          }
+          {
+            const SmsSegment& seg = _encoded.segments[_results[_recipient].sent];
+            _modem.write((const uint8_t*)_header, strlen(_header));
+            _modem.write((const uint8_t*)seg.udHex, 2 * seg.udOctets);
+            _modem.write(&CTRL_Z, 1);
+          }
+          CO_AT_HELD(_modem, "", _config.sendTimeoutMs);
+          if (_modem.result() != AT_OK) break;
+          {
+            SmsRecipientResult& r = _results[_recipient];
+            const String& resp = _modem.response();
+            AtValues<1> v;
+            if (parseAtResponse(AT_CMGS, resp.c_str(), resp.length(), v)) {
+              r.lastMr = int16_t(v[AT_FIELD(AT_CMGS, mr)].num);
+            }
+            r.sent++;
+          }
+        }
+        if (_results[_recipient].sent == _encoded.count) {
+          _results[_recipient].ok = true;
+          _delivered++;
+        }
+      }
+    }
+  }
+  CO_AT_HELD(_modem, "AT+CMGF=1", 1000);
+  _modem.release(this);
+  CO_END();
+}
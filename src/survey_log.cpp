@@ -0,0 +1,131 @@
+#include "survey_log.h"
+
+String SurveyLog::segmentPath(uint32_t segment) const {
+  char name[16];
+  snprintf(name, sizeof(name), "/%08lu.log", (unsigned long)segment);
+  return String(_dir) + name;
+}
+
+bool SurveyLog::begin(fs::FS& fs, size_t budgetBytes, const char* dir) {
+  _fs = &fs;
+  _dir = dir;
+  _budget = budgetBytes;
+  if (!fs.exists(dir)) fs.mkdir(dir);
+
+  // Find the segment range and the space it occupies.
+  bool any = false;
+  uint32_t lo = 0, hi = 0;
+  _diskBytes = 0;
+  File root = fs.open(dir);
+  if (!root || !root.isDirectory()) return false;
+  for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+    const char* name = strrchr(f.name(), '/');
+    name = name ? name + 1 : f.name();
+    char* end = nullptr;
+    unsigned long seg = strtoul(name, &end, 10);
+    if (end == name || strcmp(end, ".log") != 0) continue;
+    if (!any || seg < lo) lo = seg;
+    if (!any || seg > hi) hi = seg;
+    any = true;
+    _diskBytes += f.size();
+  }
+  _first = any ? lo : 1;
+  _current = any ? hi : 0;
+  startSegment();
+  return true;
+}
+
+void SurveyLog::end() {
+  flush();
+  _fs = nullptr;
+  _buffered = 0;
+  _unwritten = 0;
+}
+
+void SurveyLog::startSegment() {
+  if (_buffered > 0) writeBuffer();
+  _current++;
+  _codec.reset();
+  encodeSurveyHeader(_buffer, _current);
+  _buffered = SURVEY_HEADER_SIZE;
+  _segmentBytes = SURVEY_HEADER_SIZE;
+}
+
+void SurveyLog::enforceBudget(size_t incoming) {
+  while (_diskBytes + incoming > _budget && _first < _current) {
+    String path = segmentPath(_first);
+    File f = _fs->open(path, "r");
+    size_t size = f ? f.size() : 0;
+    if (f) f.close();
+    _fs->remove(path);
+    _diskBytes = _diskBytes > size ? _diskBytes - size : 0;
+    _first++;
+    _stats.segmentsDeleted++;
+  }
+}
+
+bool SurveyLog::writeBuffer() {
+  enforceBudget(_buffered);
+  File f = _fs->open(segmentPath(_current), "a");
+  size_t written = f ? f.write(_buffer, _buffered) : 0;
+  if (f) f.close();
+  _unwritten = 0;
+  if (written != _buffered) {
+    _stats.writeErrors++;
+    _buffered = 0;
+    // The segment is now missing records its deltas depend on; start over.
+    startSegment();
+    return false;
+  }
+  _diskBytes += written;
+  _stats.bytesWritten += written;
+  _buffered = 0;
+  return true;
+}
+
+bool SurveyLog::append(const CellSnapshot& snapshot, const LocationFix* position) {
+  if (!_fs || snapshot.count == 0) return false;
+
+  uint8_t record[SURVEY_MAX_RECORD];
+  size_t len = encodeSurveyRecord(_codec, snapshot, position, record);
+  if (_segmentBytes + len > SURVEY_SEGMENT_BYTES) {
+    startSegment();
+    len = encodeSurveyRecord(_codec, snapshot, position, record);
+  }
+
+  // Fill the block completely before writing it, splitting the record if
+  // needed, so each flash block is programmed once.
+  size_t off = 0;
+  while (off < len) {
+    size_t n = len - off;
+    if (n > SURVEY_BUFFER_BYTES - _buffered) n = SURVEY_BUFFER_BYTES - _buffered;
+    memcpy(_buffer + _buffered, record + off, n);
+    _buffered += n;
+    off += n;
+    if (_buffered == SURVEY_BUFFER_BYTES && !writeBuffer()) return false;
+  }
+  _segmentBytes += len;
+  _stats.records++;
+  // Also a record split over a full block: its tail is still buffered
+  if (_unwritten++ == 0) _unwrittenSince = millis();
+  return true;
+}
+
+bool SurveyLog::flush() {
+  if (!_fs || _buffered == 0) return true;
+  return writeBuffer();
+}
+
+void SurveyLog::setFlushPolicy(uint16_t records, unsigned long maxAgeMs) {
+  _flushRecords = records;
+  _flushAgeMs = maxAgeMs;
+}
+
+bool SurveyLog::flushIfDue() {
+  if (_unwritten == 0) return true;
+  if ((_flushRecords > 0 && _unwritten >= _flushRecords) ||
+      (_flushAgeMs > 0 && millis() - _unwrittenSince >= _flushAgeMs)) {
+    return flush();
+  }
+  return true;
+}
@@ -0,0 +1,221 @@
+#include "tls_config.h"
+
+// Pinned trust anchors for *.googleapis.com.
+// Paste the PEM blocks of "GTS Root R1" (RSA) and "GTS Root R4" (ECDSA P-384)
+// from https://pki.goog/repository/ here. Both must be complete
+// "-----BEGIN CERTIFICATE----- ... -----END CERTIFICATE-----" blocks.
+static const char GTS_ROOT_R1_PEM[] = "YOUR_GTS_ROOT_R1_PEM";
+static const char GTS_ROOT_R4_PEM[] = "YOUR_GTS_ROOT_R4_PEM";
+
+// CONNECT OK of a modem TLS link: the modem's handshake comes first
+static const unsigned long TLS_LINK_OPEN_MS = 30000;
+
+// Both roots in one bundle: whichever chain the server presents verifies.
+static String pinnedBundle;
+
+static bool isPem(const char* pem) {
+  return strncmp(pem, "-----BEGIN CERTIFICATE-----", 27) == 0;
+}
+
+bool tlsTrustAnchorsConfigured() {
+  return isPem(GTS_ROOT_R1_PEM) && isPem(GTS_ROOT_R4_PEM);
+}
+
+const char* tlsProfileName(TlsProfile profile) {
+  switch (profile) {
+    case TLS_PROFILE_ECDSA: return "ecdsa";
+    case TLS_PROFILE_PINNED: return "pinned";
+  }
+  return "?";
+}
+
+TlsEndpoint::TlsEndpoint(const char* host, uint16_t port, TlsProfile profile)
+    : _host(host), _port(port), _profile(profile) {}
+
+void TlsEndpoint::setProfile(TlsProfile profile) {
+  if (profile == _profile) return;
+  _profile = profile;
+  reset();
+}
+
+void TlsEndpoint::reset() {
+  if (_socket) {
+    _socket->stop();
+  } else {
+    _client.stop();
+  }
+}
+
+void TlsEndpoint::applyProfile() {
+  if (_profile == TLS_PROFILE_ECDSA) {
+    _client.setCACert(GTS_ROOT_R4_PEM);
+  } else {
+    if (pinnedBundle.length() == 0) {
+      pinnedBundle = String(GTS_ROOT_R4_PEM) + "\n" + GTS_ROOT_R1_PEM;
+    }
+    _client.setCACert(pinnedBundle.c_str());
+  }
+  _client.setHandshakeTimeout(10);
+}
+
+bool TlsEndpoint::connect() {
+  if (!tlsTrustAnchorsConfigured()) {
+    Serial.println("[TLS] Trust anchors not configured, refusing to connect.");
+    _stats.failures++;
+    return false;
+  }
+  applyProfile();
+  unsigned long start = millis();
+  if (!_client.connect(_host, _port)) {
+    char err[96];
+    _client.lastError(err, sizeof(err));
+    Serial.println(String("[TLS] Handshake with ") + _host + " failed: " + err);
+    _stats.failures++;
+    return false;
+  }
+  _stats.lastHandshakeMs = millis() - start;
+  _stats.totalHandshakeMs += _stats.lastHandshakeMs;
+  _stats.handshakes++;
+  return true;
+}
+
+Client* TlsEndpoint::open(bool& reused) {
+  reused = _client.connected();
+  if (reused) {
+    _stats.reused++;
+  } else if (!connect()) {
+    return nullptr;
+  }
+  return &_client;
+}
+
+void TlsEndpoint::dropStale() {
+  reset();
+  _stats.reconnects++;
+}
+
+void TlsEndpoint::useModem(AsyncModem* modem, MuxSocket* socket) {
+  _modem = modem;
+  _socket = socket;
+}
+
+bool TlsEndpoint::reuseLink() {
+  if (!_socket->connected()) return false;
+  _stats.reused++;
+  return true;
+}
+
+String TlsEndpoint::startLink() {
+  _linkStart = millis();
+  return _socket->startConnect(_host, _port, true);
+}
+
+bool TlsEndpoint::finishLink() {
+  if (!_socket->finishConnect()) {
+    Serial.println(String("[TLS] Modem link to ") + _host + " failed.");
+    _stats.failures++;
+    return false;
+  }
+  _stats.lastHandshakeMs = millis() - _linkStart;
+  _stats.totalHandshakeMs += _stats.lastHandshakeMs;
+  _stats.handshakes++;
+  return true;
+}
+
+void TlsRequest::prepare(TlsEndpoint& endpoint, const char* method, const String& path,
+                         const char* contentType, const String* body) {
+  _endpoint = &endpoint;
+  _method = method;
+  _path = path;
+  _contentType = contentType;
+  _hasBody = body != nullptr;
+  _body = body ? *body : String("");
+}
+
+void TlsRequest::send(Client& client) {
+  _exchange.begin(client, _method, _endpoint->host(), _path, _contentType,
+                  _hasBody ? &_body : nullptr);
+}
+
+CoStatus TlsRequest::step() {
+  CO_BEGIN();
+  _modem = _endpoint->modem();
+  for (_attempt = 0; _attempt < 2; ++_attempt) {
+    if (_modem) {
+      // Every AT command (open, send, close) runs holding the modem; the
+      // link opens and the response arrives with the modem free
+      CO_AWAIT(_modem->acquire(this));
+      _reused = _endpoint->reuseLink();
+      if (!_reused) {
+        _command = _endpoint->startLink();
+        if (_command.length() > 0) CO_AT_HELD(*_modem, _command, 2000);
+        _modem->release(this);
+        if (_command.length() > 0 && _modem->result() == AT_OK) {
+          _start = millis();
+          CO_AWAIT(!_endpoint->socket()->connecting() || millis() - _start >= TLS_LINK_OPEN_MS);
+        }
+        CO_AWAIT(_modem->acquire(this));
+        if (!_endpoint->finishLink()) {
+          _modem->release(this);
+          _exchange.fail(HTTP_ERROR_CONNECT);
+          CO_EXIT();
+        }
+      }
+      send(*_endpoint->socket());
+      _modem->release(this);
+    } else {
+      Client* client = _endpoint->open(_reused);
+      if (!client) {
+        _exchange.fail(HTTP_ERROR_CONNECT);
+        CO_EXIT();
+      }
+      send(*client);
+    }
+    CO_AWAIT(_exchange.poll());
+    if (_exchange.status() >= 0 || !_reused) break;
+    CO_AWAIT(!_modem || _modem->acquire(this));
+    _endpoint->dropStale();
+    if (_modem) _modem->release(this);
+  }
+  if (!_exchange.keepAlive()) {
+    CO_AWAIT(!_modem || _modem->acquire(this));
+    _endpoint->reset();
+    if (_modem) _modem->release(this);
+  }
+  CO_END();
+}
+
+long TlsEndpoint::measureHandshake() {
+  reset();
+  if (!connect()) return -1;
+  return (long)_stats.lastHandshakeMs;
+}
+
+void runTlsBenchmark(TlsEndpoint& endpoint, int rounds, Print& out) {
+  const TlsProfile original = endpoint.profile();
+  const TlsProfile profiles[] = {TLS_PROFILE_ECDSA, TLS_PROFILE_PINNED};
+
+  out.println(String("[TLS] Handshake benchmark against ") + endpoint.host());
+  for (TlsProfile profile : profiles) {
+    endpoint.setProfile(profile);
+    long minMs = -1, maxMs = 0, sumMs = 0;
+    int ok = 0;
+    for (int i = 0; i < rounds; ++i) {
+      long ms = endpoint.measureHandshake();
+      if (ms < 0) continue;
+      if (minMs < 0 || ms < minMs) minMs = ms;
+      if (ms > maxMs) maxMs = ms;
+      sumMs += ms;
+      ok++;
+    }
+    out.print(String("[TLS] ") + tlsProfileName(profile) + ": ");
+    if (ok == 0) {
+      out.println("all handshakes failed");
+      continue;
+    }
+    out.println(String(ok) + "/" + String(rounds) + " ok, min " + String(minMs) +
+                " ms, avg " + String(sumMs / ok) + " ms, max " + String(maxMs) + " ms");
+  }
+  endpoint.reset();
+  endpoint.setProfile(original);
+}
@@ -0,0 +1,67 @@
+#include "udp_report.h"
+
+#include <esp_system.h>
+
+UdpReporter::UdpReporter(Sim800Mux& mux, const UdpReportConfig& config)
+    : _socket(mux), _config(config), _session(uint16_t(esp_random())) {}
+
+bool UdpReporter::open() {
+  if (_socket.connected()) return true;
+  if (!_socket.connectUdp(_config.host, _config.port)) {
+    Serial.println("[UDP] Could not open link to collector.");
+    return false;
+  }
+  return true;
+}
+
+void UdpReporter::end() {
+  _socket.stop();
+}
+
+bool UdpReporter::waitAck(const DatagramHeader& hdr, unsigned long timeout) {
+  const uint8_t* psk = reinterpret_cast<const uint8_t*>(_config.psk);
+  const size_t pskLen = strlen(_config.psk);
+  uint8_t buf[ACK_DATAGRAM_SIZE];
+  unsigned long start = millis();
+  while (millis() - start < timeout) {
+    if (_socket.available() < (int)ACK_DATAGRAM_SIZE) {
+      if (!_socket.connected()) return false;
+      delay(5);
+      continue;
+    }
+    _socket.read(buf, sizeof(buf));
+    if (isAckFor(buf, sizeof(buf), hdr, psk, pskLen)) return true;
+    // Anything else (late ack of an earlier try, junk) is dropped.
+  }
+  return false;
+}
+
+bool UdpReporter::report(const LocationFix& fix) {
+  if (!fix.valid) return false;
+
+  DatagramHeader hdr;
+  hdr.deviceId = _config.deviceId;
+  hdr.session = _session;
+  hdr.seq = _seq++;
+
+  uint8_t datagram[FIX_DATAGRAM_SIZE];
+  encodeFixDatagram(datagram, hdr, fix, reinterpret_cast<const uint8_t*>(_config.psk),
+                    strlen(_config.psk));
+
+  for (uint8_t attempt = 0; attempt < _config.attempts; ++attempt) {
+    if (!open()) continue;
+    unsigned long start = millis();
+    if (_socket.write(datagram, sizeof(datagram)) != sizeof(datagram)) continue;
+    _stats.sent++;
+    _stats.bytes += sizeof(datagram);
+    if (waitAck(hdr, _config.ackTimeoutMs)) {
+      _stats.acked++;
+      _stats.lastRttMs = millis() - start;
+      Serial.println("[UDP] Fix " + String(hdr.seq) + " acked in " + String(_stats.lastRttMs) + " ms.");
+      return true;
+    }
+    Serial.println("[UDP] No ack for fix " + String(hdr.seq) + ", retrying...");
+  }
+  _stats.failed++;
+  return false;
+}
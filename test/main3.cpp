@@ -12,7 +12,7 @@
  *   - SIM card status (AT+CPIN?)
  *   - Network registration and cell info (AT+CREG=2, AT+CREG?)
  *   - Signal quality (AT+CSQ)
- *   - Operator name and network codes (AT+COPS?)
+ *   - Operator name from the built-in MCC/MNC table (operator_table.h)
  *
  * It parses the responses to extract:
  *   - Location Area Code (LAC)
@@ -25,11 +25,23 @@
  * The extracted information is stored in global variables (g_lac, g_cid, g_mcc, g_mnc)
  * and a summary string (cellInfo).
  *
- * @return true if all required information was successfully retrieved and parsed, false otherwise.
+ * The query runs as a CoopTask (ScanTask), so the console stays responsive
+ * while the modem answers; failures are logged.
  */
 #include <Arduino.h>
 #include <math.h>
-#include <map>
+#include <LittleFS.h>
+
+#include "async_log.h"
+#include "at_response.h"
+#include "cell_fusion.h"
+#include "ceng_stream.h"
+#include "console.h"
+#include "coop_task.h"
+#include "fingerprint_db.h"
+#include "host_link.h"
+#include "operator_table.h"
+#include "survey_log.h"
 
 // SIM800L pins and baud
 #define MODEM_RX 16
@@ -41,6 +53,30 @@ HardwareSerial sim800Serial(2); // Use UART2
 // Globals for parsed cell info
 int g_mcc = 0, g_mnc = 0, g_lac = 0, g_cid = 0;
 String cellInfo = "";
+CellSnapshot g_snapshot; // Cells fused over the last scan window
+CellFusion g_fusion;     // All AT+CENG? answers of the last scan window
+
+// Survey mode: log every CENG snapshot to flash
+#define SURVEY_INTERVAL_MS 10000
+SurveyLog surveyLog;
+bool surveyMode = false;
+unsigned long surveyIntervalMs = SURVEY_INTERVAL_MS;  // "config interval <ms>"
+
+// All output goes through the log ring, drained to Serial without blocking
+AsyncLog logger;
+Console console(logger);
+
+// Binary frames on the same port for bulk reads (tools/host_client.h)
+HostLink hostLink(Serial);
+
+// Drains the log unless a host response is on its way out
+void drainLog() {
+  if (!hostLink.transmit()) logger.drain(Serial);
+}
+LocationFix g_fix;  // last fingerprint fix
+
+// Fingerprint index in the "fprint" partition (tools/fingerprint_builder.cpp)
+FingerprintDb fingerprints;
 
 // Timestamp helper
 String now() {
@@ -53,244 +89,354 @@ String now() {
   return String(buf);
 }
 
-bool isCengDataComplete(const String& cengResponse) {
-  int cengIdx = 0;
-  while ((cengIdx = cengResponse.indexOf("+CENG:", cengIdx)) != -1) {
-    int lineEnd = cengResponse.indexOf("\n", cengIdx);
-    if (lineEnd == -1) lineEnd = cengResponse.length();
-    String line = cengResponse.substring(cengIdx, lineEnd);
-    line.trim();
-
-    // Only process lines with a quoted data section (cell info lines)
-    int comma1 = line.indexOf(",");
-    int q1 = line.indexOf("\"", comma1);
-    int q2 = line.indexOf("\"", q1 + 1);
-    if (q1 == -1 || q2 == -1) {
-      cengIdx = lineEnd; // skip header or malformed lines
-      continue;
-    }
-    String data = line.substring(q1 + 1, q2);
-    String values[6];
-    int k = 0;
-    int start = 0;
-    for (int j = 0; j < 5; ++j) {
-      int comma = data.indexOf(",", start);
-      if (comma == -1) {
-        values[k++] = data.substring(start);
-        break;
+// Logs the cells of a complete AT+CENG? answer, as parsed by the CENG
+// stream, and of the fused scan window, and feeds them to the fingerprint
+// index and the survey log
+void reportCellInfo(const CellSnapshot& cells) {
+  for (uint8_t i = 0; i < cells.count; ++i) {
+    const CellRecord& cell = cells.cells[i];
+    logger.println(now() + "----------------- Cell " + String(i) + " -----------------");
+    if (i == 0 && cells.servingParsed) {
+      logger.println(now() + "[INFO] This is the connected cell.");
+      // Resolved from the built-in MCC/MNC table, no AT+COPS? round trip
+      const OperatorInfo* op = findOperator(cell.mcc, cell.mnc);
+      if (op) {
+        logger.println(now() + "[INFO] Operator Name: " + op->name + " (" + op->country + ")");
+      } else {
+        logger.println(now() + "[INFO] Operator Name: Not found");
       }
-      values[k++] = data.substring(start, comma);
-      start = comma + 1;
     }
-    while (k < 6) values[k++] = "";
-
-    // Check for completeness: no column should be empty, "0000", or "ffff"
-    for (int i = 0; i < 4; ++i) { // Only check MCC, MNC, LAC, CID
-      String v = values[i];
-      v.trim();
-      v.toLowerCase();
-      if (v.length() == 0 || v == "0000" || v == "ffff") {
-        return false;
-      }
+    logger.println(now() + "[INFO] MCC: " + String(cell.mcc));
+    logger.println(now() + "[INFO] MNC: " + String(cell.mnc));
+    logger.println(now() + "[INFO] LAC: " + String(cell.lac, HEX) + " (hex) / " + String(cell.lac) +
+                   " (dec)");
+    logger.println(now() + "[INFO] CID: " + String(cell.cid, HEX) + " (hex) / " + String(cell.cid) +
+                   " (dec)");
+    logger.println(now() + "[INFO] RxLev: " + String(cell.rxlev) + " (unit) / " +
+                   String(rxlevToDbm(cell.rxlev)) + " (dBm)");
+    if (cell.ta != CELL_TA_UNKNOWN) {
+      logger.println(now() + "[INFO] Timing Advance: " + String(cell.ta) + " units");
     }
-    cengIdx = lineEnd;
   }
-  return true;
+
+  // Keep the fused snapshot and the serving cell for the caller
+  g_fusion.toSnapshot(g_snapshot);
+  logger.println(now() + "[FUSION] " + String(g_fusion.count()) + " cells from " +
+                 String(g_fusion.scans()) + " scans.");
+  for (uint8_t i = 0; i < g_fusion.count(); ++i) {
+    const FusedCell& f = g_fusion[i];
+    logger.println(now() + "[FUSION] CID " + String(f.cell.cid) + ": RxLev " + String(f.rxlevMean, 1) +
+                   " (var " + String(f.rxlevVariance(), 1) + ", seen " + String(f.seen) + "x)");
+  }
+  if (g_snapshot.count > 0) {
+    const CellRecord& serving = g_snapshot.cells[0];
+    g_mcc = serving.mcc;
+    g_mnc = serving.mnc;
+    g_lac = serving.lac;
+    g_cid = serving.cid;
+    cellInfo = String(g_mcc) + "," + String(g_mnc) + "," + String(g_lac) + "," + String(g_cid);
+  }
+
+  if (fingerprints.valid() && g_fusion.count() > 0) {
+    LocationFix fix;
+    FingerprintMatch match;
+    unsigned long t0 = micros();
+    FingerprintQueryCell obs[CELL_FUSION_MAX];
+    for (uint8_t i = 0; i < g_fusion.count(); ++i) {
+      obs[i].key = cellKey(g_fusion[i].cell);
+      obs[i].rxlev = g_fusion[i].rxlevMean;
+    }
+    if (fingerprints.locate(obs, g_fusion.count(), fix, 4, &match)) {
+      g_fix = fix;
+      g_fix.timestamp = millis() / 1000;
+      logger.println(now() + "[FPRINT] " + String(fix.lat, 6) + "," + String(fix.lng, 6) + " +/-" +
+                     String(fix.accuracy, 0) + " m (" + String(match.candidates) + " candidates, " +
+                     String(micros() - t0) + " us)");
+    } else {
+      logger.println(now() + "[FPRINT] No matching fingerprint.");
+    }
+  }
+
+  // No independent position here: the fingerprint fix comes from these same
+  // cells, so it would only feed the models back into themselves.
+  // src/main.cpp logs each observation with its Google fix.
+  if (surveyMode && g_snapshot.count > 0) {
+    surveyLog.append(g_snapshot);
+    logger.println(now() + "[SURVEY] Logged " + String(g_snapshot.count) + " cells (" +
+                   String(surveyLog.stats().records) + " records, " +
+                   String((unsigned long)surveyLog.bytesOnFlash()) + " bytes on flash).");
+  }
+
+  logger.println(now() + "Cell info query complete.");
 }
 
-bool getCellInfo() {
-  Serial.println("\n----------------- SIM800L Section -----------------");
-  Serial.println(now() + "Getting cell info...");
+// The modem query as a CoopTask: loop() keeps polling the console and the
+// host link and draining the log while the modem answers.
+class ScanTask : public CoopTask {
+public:
+  CoStatus step() override {
+    CO_BEGIN();
+    logger.println("\n----------------- SIM800L Section -----------------");
+    logger.println(now() + "Getting cell info...");
 
-  // Helper to send command and print with timestamp and prefix
-  auto sendAT = [](const char* cmd) {
-    Serial.println(now() + "[CMD] " + cmd);
+    // 1. AT
+    logger.println(now() + "Checking SIM800L responsiveness...");
+    send("AT", 1000);
+    CO_AWAIT(received());
+    if (_resp.indexOf("OK") == -1) {
+      logger.println(now() + "[ERROR] SIM800L not responding to AT command.");
+      CO_EXIT();
+    }
+
+    // 2. AT+CPIN?
+    logger.println(now() + "Checking SIM card status...");
+    send("AT+CPIN?", 1000);
+    CO_AWAIT(received());
+    {
+      AtValues<1> cpin;
+      if (!parseAtResponse(AT_CPIN, _resp.c_str(), _resp.length(), cpin) ||
+          !cpin[AT_FIELD(AT_CPIN, code)].is("READY")) {
+        logger.println(now() + "[ERROR] SIM card not ready or missing.");
+        CO_EXIT();
+      }
+    }
+
+    // Use AT+CENG? instead of AT+CREG, AT+CSQ, AT+COPS
+    logger.println(now() + "Getting cell info using AT+CENG...");
+    send("AT+CENG=3,1", 1000); // Set CENG mode
+    CO_AWAIT(received());
+
+    _success = false;
+    g_fusion.reset();
+    for (_round = 0; _round < 5; ++_round) {
+      logger.println(now() + "[INFO] Attempt " + String(_round + 1) +
+                     " checking completeness of AT+CENG?...");
+      _stream.reset();
+      send("AT+CENG?", 3000, true);
+      CO_AWAIT(received());
+      {
+        // Every round counts towards the fused observation, complete or not
+        CellSnapshot round;
+        _stream.snapshot(round);
+        round.timestamp = millis() / 1000;
+        g_fusion.add(round);
+      }
+      if (_stream.complete()) {
+        _success = true;
+        logger.println(now() + "[INFO] Round " + String(_round + 1) + " checking was successful.");
+        break;
+      }
+      logger.println(now() + "[WARN] CENG data incomplete, retrying...");
+      CO_SLEEP(500);
+    }
+
+    if (!_success) {
+      logger.println(now() + "[ERROR] Failed to retrieve complete cell info after multiple attempts.");
+      CO_EXIT();
+    }
+    {
+      // The cells of the complete round, already parsed as they arrived
+      CellSnapshot cells;
+      _stream.snapshot(cells);
+      reportCellInfo(cells);
+    }
+    CO_END();
+  }
+
+private:
+  // Sends `cmd` and starts collecting its answer. With `ceng`, bytes go
+  // through the CENG stream as they arrive.
+  void send(const char* cmd, unsigned long timeout, bool ceng = false) {
+    logger.println(now() + "[CMD] " + cmd);
     sim800Serial.println(cmd);
-    delay(200); // Give SIM800L more time to process
-  };
-
-  // Helper to read and print response with timestamp and prefix
-  auto readAT = [&](unsigned long timeout = 3000) { // Increased timeout
-    String resp = "";
-    unsigned long start = millis();
-    while (millis() - start < timeout) {
-      while (sim800Serial.available()) {
-        char c = sim800Serial.read();
-        // Only keep printable ASCII and common control chars
-        if ((c >= 32 && c <= 126) || c == '\r' || c == '\n') {
-          resp += c;
+    _resp = "";
+    _ceng = ceng;
+    _start = millis();
+    _timeout = timeout;
+  }
+
+  // Reads what has arrived; true once the answer ended on its final result
+  // code or timed out, after printing it.
+  bool received() {
+    bool done = false;
+    while (!done && sim800Serial.available()) {
+      char c = sim800Serial.read();
+      // Only keep printable ASCII and common control chars
+      if ((c >= 32 && c <= 126) || c == '\r' || c == '\n') {
+        _resp += c;
+        if (_ceng) {
+          done = _stream.push(c) == CENG_STREAM_DONE;
+        } else if (c == '\n') {
+          done = _resp.endsWith("OK\r\n") || _resp.endsWith("ERROR\r\n");
         }
       }
-      delay(10); // Allow other tasks to run
     }
+    if (!done && millis() - _start < _timeout) return false;
     // Print each line with prefix and timestamp
     int last = 0;
     while (true) {
-      int next = resp.indexOf('\n', last);
-      String line = (next == -1) ? resp.substring(last) : resp.substring(last, next + 1);
+      int next = _resp.indexOf('\n', last);
+      String line = (next == -1) ? _resp.substring(last) : _resp.substring(last, next + 1);
       line.trim();
       if (line.length() > 0) {
-        Serial.println(now() + "[RSP] " + line);
+        logger.println(now() + "[RSP] " + line);
       }
       if (next == -1) break;
       last = next + 1;
     }
-    return resp;
-  };
-
-  // 1. AT
-  Serial.println(now() + "Checking SIM800L responsiveness...");
-  sendAT("AT");
-  String atResp = readAT(1000);
-  if (atResp.indexOf("OK") == -1) {
-    Serial.println(now() + "[ERROR] SIM800L not responding to AT command.");
-    return false;
+    return true;
   }
 
-  // 2. AT+CPIN?
-  Serial.println(now() + "Checking SIM card status...");
-  sendAT("AT+CPIN?");
-  String cpinResp = readAT(1000);
-  if (cpinResp.indexOf("READY") == -1) {
-    Serial.println(now() + "[ERROR] SIM card not ready or missing.");
-    return false;
+  String _resp;
+  bool _ceng = false;
+  CengStream _stream;
+  unsigned long _start = 0;
+  unsigned long _timeout = 0;
+  uint8_t _round = 0;
+  bool _success = false;
+};
+
+ScanTask scanTask;
+CoopScheduler scheduler;
+
+// Starts a scan unless one is running
+bool startScan() {
+  if (scheduler.contains(&scanTask)) return false;
+  return scheduler.add(&scanTask);
+}
+
+// ---- Console commands ---------------------------------------------------------
+
+void cmdScan(int, char**, void*) {
+  if (!startScan()) logger.println("Scan already running.");
+}
+
+void cmdFix(int, char**, void*) {
+  if (!g_fix.valid) {
+    logger.println("No fingerprint fix yet.");
+    return;
   }
+  logger.println(String(g_fix.lat, 6) + "," + String(g_fix.lng, 6) + " +/-" +
+                 String(g_fix.accuracy, 0) + " m, " + String((millis() / 1000) - g_fix.timestamp) +
+                 " s ago");
+}
 
-  // Use AT+CENG? instead of AT+CREG, AT+CSQ, AT+COPS
-  Serial.println(now() + "Getting cell info using AT+CENG...");
-  sendAT("AT+CENG=3,1"); // Set CENG mode
-  delay(500);
-
-  String cengResponse = "";
-  bool cengSuccess = false;
-  int successfulRound = -1;
-  for (int i = 0; i < 5; ++i) {
-    Serial.println(now() + "[INFO] Attempt " + String(i + 1) + " checking completeness of AT+CENG?...");
-    sendAT("AT+CENG?");
-    cengResponse = readAT(3000);
-
-    if (cengResponse.indexOf("+CENG:") != -1 && isCengDataComplete(cengResponse)) {
-      cengSuccess = true;
-      successfulRound = i + 1;
-      Serial.println(now() + "[INFO] Round " + String(successfulRound) + " checking was successful.");
-      break;
-    } else {
-      Serial.println(now() + "[WARN] CENG data incomplete, retrying...");
-      delay(500);
+void cmdStatus(int, char**, void*) {
+  logger.println("Uptime: " + String(millis() / 1000) + " s, free heap " +
+                 String(ESP.getFreeHeap()) + " bytes");
+  logger.println("Serving cell (MCC,MNC,LAC,CID): " + (cellInfo.length() > 0 ? cellInfo : String("none")));
+  logger.println(String("Survey mode: ") + (surveyMode ? "on" : "off"));
+}
+
+void cmdStats(int, char**, void*) {
+  const SurveyStats& st = surveyLog.stats();
+  logger.println("Fusion: " + String(g_fusion.count()) + " cells from " + String(g_fusion.scans()) +
+                 " scans");
+  logger.println("Survey: " + String(st.records) + " records, " + String(st.bytesWritten) +
+                 " bytes written, " + String(st.segmentsDeleted) + " segments deleted, " +
+                 String(st.writeErrors) + " write errors, " +
+                 String((unsigned long)surveyLog.bytesOnFlash()) + " bytes on flash");
+  logger.println("Log: " + String((unsigned long)logger.pending()) + " bytes pending, " +
+                 String(logger.dropped()) + " dropped");
+}
+
+void cmdConfig(int argc, char** argv, void*) {
+  if (argc == 3 && strcasecmp(argv[1], "interval") == 0) {
+    long ms = atol(argv[2]);
+    if (ms < 1000) {
+      logger.println("Interval must be at least 1000 ms.");
+      return;
     }
+    surveyIntervalMs = (unsigned long)ms;
+  } else if (argc != 1) {
+    logger.println("Usage: config [interval <ms>]");
+    return;
   }
+  logger.println("Modem baud: " + String(MODEM_BAUD) + ", survey interval: " +
+                 String(surveyIntervalMs) + " ms");
+}
 
-  if (!cengSuccess) {
-    Serial.println(now() + "[ERROR] Failed to retrieve complete cell info after multiple attempts.");
-    return false;
-  }
+void cmdTrace(int argc, char** argv, void*) {
+  size_t bytes = argc > 1 ? (size_t)atol(argv[1]) : ASYNC_LOG_BYTES;
+  logger.println("--- trace ---");
+  logger.replay(bytes);
+}
 
-  // Show parsing log and loading animation
-  Serial.println(now() + "[INFO] Parsing CENG data...");
-  for (int i = 0; i < 3; ++i) {
-    Serial.print(".");
-    delay(300);
-  }
-  Serial.println();
-
-  // Parse and display CENG data
-  // First, collect all cell lines into a map by index
-  std::map<int, String> cellLines;
-  int maxIndex = -1;
-  int cengIdx = 0;
-  while ((cengIdx = cengResponse.indexOf("+CENG:", cengIdx)) != -1) {
-    int lineEnd = cengResponse.indexOf("\n", cengIdx);
-    if (lineEnd == -1) lineEnd = cengResponse.length();
-    String line = cengResponse.substring(cengIdx, lineEnd);
-    line.trim();
-
-    int comma1 = line.indexOf(",");
-    if (comma1 == -1) {
-      cengIdx++;
-      continue;
-    }
-    int index = line.substring(6, comma1).toInt();
-    cellLines[index] = line;
-    if (index > maxIndex) maxIndex = index;
-    cengIdx = lineEnd;
+void cmdSurvey(int, char**, void*) {
+  surveyMode = !surveyMode;
+  if (!surveyMode) surveyLog.flush();
+  logger.println(now() + "[SURVEY] Survey mode " + (surveyMode ? "on." : "off."));
+}
+
+void cmdFlush(int, char**, void*) {
+  surveyLog.flush();
+}
+
+// ---- Host protocol handlers (host_frame.h) ---------------------------------------
+
+uint8_t hostPing(const uint8_t*, size_t, uint8_t* out, size_t& outLen, void*) {
+  out[0] = HOST_PROTOCOL_VERSION;
+  hostPutLe32(out + 1, millis() / 1000);
+  outLen = 5;
+  return HOST_STATUS_OK;
+}
+
+uint8_t hostStats(const uint8_t*, size_t, uint8_t* out, size_t& outLen, void*) {
+  const SurveyStats& st = surveyLog.stats();
+  const uint32_t values[] = {uint32_t(st.records), uint32_t(st.bytesWritten),
+                             uint32_t(st.segmentsDeleted), uint32_t(st.writeErrors),
+                             uint32_t(surveyLog.bytesOnFlash()), uint32_t(logger.dropped())};
+  outLen = 0;
+  for (uint32_t v : values) {
+    hostPutLe32(out + outLen, v);
+    outLen += 4;
   }
+  return HOST_STATUS_OK;
+}
 
-  // Print info for each cell index, even if missing
-  for (int idx = 0; idx <= maxIndex; ++idx) {
-    Serial.println(now() + "----------------- Cell " + String(idx) + " -----------------");
-    if (cellLines.count(idx) == 0) {
-      Serial.println(now() + "[WARN] Incomplete data for cell " + String(idx));
-      continue;
-    }
-    String line = cellLines[idx];
-
-    int comma1 = line.indexOf(",");
-    int q1 = line.indexOf("\"", comma1);
-    int q2 = line.indexOf("\"", q1 + 1);
-    if (q1 == -1 || q2 == -1) {
-      Serial.println(now() + "[WARN] Incomplete data for cell " + String(idx));
-      continue;
-    }
-    String data = line.substring(q1 + 1, q2);
-    String values[6];
-    int k = 0;
-    int start = 0;
-    for (int j = 0; j < 5; ++j) {
-      int comma = data.indexOf(",", start);
-      if (comma == -1) {
-        values[k++] = data.substring(start);
-        break;
-      }
-      values[k++] = data.substring(start, comma);
-      start = comma + 1;
-    }
-    while (k < 6) values[k++] = "";
-
-    if (idx == 0) {
-      Serial.println(now() + "[INFO] This is the connected cell.");
-      Serial.println(now() + "Querying operator name...");
-      sendAT("AT+COPS?");
-      String copsAlphaResp = readAT(1000);
-      String operatorName = "";
-      int copsAlphaIdx = copsAlphaResp.indexOf("\"");
-      int copsAlphaEnd = copsAlphaResp.indexOf("\"", copsAlphaIdx + 1);
-      if (copsAlphaIdx != -1 && copsAlphaEnd != -1) {
-        operatorName = copsAlphaResp.substring(copsAlphaIdx + 1, copsAlphaEnd);
-        Serial.println(now() + "[INFO] Operator Name: " + operatorName);
-      } else {
-        Serial.println(now() + "[INFO] Operator Name: Not found");
-      }
-    }
+uint8_t hostSegments(const uint8_t*, size_t, uint8_t* out, size_t& outLen, void*) {
+  hostPutLe32(out, surveyLog.firstSegment());
+  hostPutLe32(out + 4, surveyLog.currentSegment());
+  outLen = 8;
+  return HOST_STATUS_OK;
+}
 
-    if (values[0].length() > 0 && values[1].length() > 0 && values[2].length() > 0 && values[3].length() > 0) {
-      Serial.println(now() + "[INFO] MCC: " + values[0]);
-      Serial.println(now() + "[INFO] MNC: " + values[1]);
-      String lacHex = values[2];
-      long lacDec = strtol(lacHex.c_str(), NULL, 16);
-      Serial.println(now() + "[INFO] LAC: " + lacHex + " (hex) / " + String(lacDec) + " (dec)");
-      String cidHex = values[3];
-      long cidDec = strtol(cidHex.c_str(), NULL, 16);
-      Serial.println(now() + "[INFO] CID: " + cidHex + " (hex) / " + String(cidDec) + " (dec)");
-      if (values[4].length() > 0) {
-        int rxLev = values[4].toInt();
-        int rxDbm = -113 + (2 * rxLev);
-        Serial.println(now() + "[INFO] RxLev: " + values[4] + " (unit) / " + String(rxDbm) + " (dBm)");
-      }
-      if (values[5].length() > 0) Serial.println(now() + "[INFO] Timing Advance: " + values[5] + " units");
-    } else {
-      Serial.println(now() + "[WARN] Incomplete data for cell " + String(idx));
-    }
+// Chunks of one segment are read back to back: keep its file open between them
+uint8_t hostRead(const uint8_t* req, size_t reqLen, uint8_t* out, size_t& outLen, void*) {
+  static File file;
+  static uint32_t fileSegment = 0;
+  if (reqLen != 10) return HOST_STATUS_BAD_ARG;
+  const uint32_t segment = hostGetLe32(req);
+  const uint32_t offset = hostGetLe32(req + 4);
+  size_t length = hostGetLe16(req + 8);
+  if (length > HOST_FRAME_MAX_PAYLOAD - HOST_READ_HEADER) {
+    length = HOST_FRAME_MAX_PAYLOAD - HOST_READ_HEADER;
   }
+  // The current segment grows: reopen to see its new size
+  if (!file || fileSegment != segment || offset >= file.size()) {
+    if (file) file.close();
+    file = LittleFS.open(surveyLog.segmentPath(segment), "r");
+    fileSegment = segment;
+    if (!file) return HOST_STATUS_IO;
+  }
+  const uint32_t size = file.size();
+  size_t n = 0;
+  if (offset < size) {
+    if (!file.seek(offset)) return HOST_STATUS_IO;
+    n = file.read(out + HOST_READ_HEADER, length);
+  }
+  hostPutLe32(out, size);
+  outLen = HOST_READ_HEADER + n;
+  return HOST_STATUS_OK;
+}
 
-  //Clear global variables
-  g_mcc = 0;
-  g_mnc = 0;
-  g_lac = 0;
-  g_cid = 0;
-  cellInfo = "";
+uint8_t hostTrace(const uint8_t*, size_t, uint8_t* out, size_t& outLen, void*) {
+  outLen = logger.history(out, HOST_FRAME_MAX_PAYLOAD);
+  return HOST_STATUS_OK;
+}
 
-  Serial.println(now() + "Cell info query complete.");
-  return true;
+void consoleInput(char c, void*) {
+  console.push(c);
 }
 
 void setup() {
@@ -300,22 +446,42 @@ void setup() {
   // Initialize HardwareSerial for SIM800L
   sim800Serial.begin(MODEM_BAUD, SERIAL_8N1, MODEM_RX, MODEM_TX);
   delay(3000);
-  Serial.println("Ready. Type 'y' to get SIM800L cell info.");
+
+  // Survey log on the LittleFS data partition, leaving 10% headroom
+  if (!LittleFS.begin(true) || !surveyLog.begin(LittleFS, LittleFS.totalBytes() / 10 * 9)) {
+    logger.println("[WARN] LittleFS not available, survey mode disabled.");
+  }
+  if (mapFingerprintPartition(fingerprints)) {
+    logger.println("[FPRINT] " + String(fingerprints.fingerprints()) + " fingerprints over " +
+                   String(fingerprints.cells()) + " cells.");
+  }
+  console.add("scan", "query the modem for cell info", cmdScan);
+  console.add("y", "same as scan", cmdScan);
+  console.add("fix", "last fingerprint fix", cmdFix);
+  console.add("status", "uptime, serving cell, survey mode", cmdStatus);
+  console.add("stats", "fusion, survey log and log counters", cmdStats);
+  console.add("config", "show settings; config interval <ms>", cmdConfig);
+  console.add("trace", "print recent output again; trace [bytes]", cmdTrace);
+  console.add("survey", "toggle survey mode", cmdSurvey);
+  console.add("flush", "write buffered survey records", cmdFlush);
+  logger.println("Ready. Type 'scan' to get SIM800L cell info, 'help' for all commands.");
+  hostLink.add(HOST_CMD_PING, hostPing);
+  hostLink.add(HOST_CMD_STATS, hostStats);
+  hostLink.add(HOST_CMD_SEGMENTS, hostSegments);
+  hostLink.add(HOST_CMD_READ, hostRead);
+  hostLink.add(HOST_CMD_TRACE, hostTrace);
+  hostLink.setTextHandler(consoleInput, nullptr);
+  console.prompt();
 }
 
 void loop() {
-  static String input = "";
-  while (Serial.available()) {
-    char c = Serial.read();
-    if (c == '\n' || c == '\r') {
-      input.trim();
-      if (input.equalsIgnoreCase("y") || input.equalsIgnoreCase("yes")) {
-        getCellInfo();
-        Serial.println("Ready. Type 'y' to get SIM800L cell info.");
-      }
-      input = "";
-    } else {
-      input += c;
-    }
+  hostLink.poll();  // console input arrives through consoleInput()
+  scheduler.runOnce();
+  drainLog();
+
+  static unsigned long lastSurvey = 0;
+  if (surveyMode && millis() - lastSurvey >= surveyIntervalMs) {
+    lastSurvey = millis();
+    startScan();
   }
 }
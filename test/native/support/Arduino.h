@@ -0,0 +1,162 @@
+#pragma once
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the parts of the Arduino core the tested code uses.
+ *
+ * Only for [env:native]: String, Print, Stream, HardwareSerial, millis() and
+ * delay(), enough to build the modem layer (sim800_at, sim800_mux,
+ * async_modem, scan_modem, sms_sender) against the fake modem in
+ * fake_modem.h. Time is the host's steady clock.
+ */
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define SERIAL_8N1 0x800001c
+
+inline unsigned long millis() {
+  static const auto start = std::chrono::steady_clock::now();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+inline unsigned long micros() {
+  static const auto start = std::chrono::steady_clock::now();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+inline void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void yield() {
+  std::this_thread::yield();
+}
+
+class String {
+public:
+  String() {}
+  String(const char* s) : _s(s ? s : "") {}
+  String(const std::string& s) : _s(s) {}
+  explicit String(char c) : _s(1, c) {}
+  String(int v) : _s(std::to_string(v)) {}
+  String(unsigned v) : _s(std::to_string(v)) {}
+  String(long v) : _s(std::to_string(v)) {}
+  String(unsigned long v) : _s(std::to_string(v)) {}
+
+  unsigned length() const { return (unsigned)_s.size(); }
+  const char* c_str() const { return _s.c_str(); }
+  char operator[](unsigned i) const { return i < _s.size() ? _s[i] : 0; }
+
+  int indexOf(char c, unsigned from = 0) const { return pos(_s.find(c, from)); }
+  int indexOf(const char* s, unsigned from = 0) const { return pos(_s.find(s, from)); }
+  int indexOf(const String& s, unsigned from = 0) const { return pos(_s.find(s._s, from)); }
+  bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+  bool endsWith(const String& p) const {
+    return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;
+  }
+  String substring(unsigned from) const { return from < _s.size() ? _s.substr(from) : ""; }
+  String substring(unsigned from, unsigned to) const {
+    if (from > to) std::swap(from, to);
+    return from < _s.size() ? _s.substr(from, to - from) : "";
+  }
+  long toInt() const { return atol(_s.c_str()); }
+  void trim() {
+    size_t b = _s.find_first_not_of(" \t\r\n");
+    size_t e = _s.find_last_not_of(" \t\r\n");
+    _s = b == std::string::npos ? "" : _s.substr(b, e - b + 1);
+  }
+  void toUpperCase() {
+    for (char& c : _s) c = (char)toupper((unsigned char)c);
+  }
+
+  String& operator+=(const String& s) {
+    _s += s._s;
+    return *this;
+  }
+  String& operator+=(const char* s) {
+    _s += s;
+    return *this;
+  }
+  String& operator+=(char c) {
+    _s += c;
+    return *this;
+  }
+  bool operator==(const String& s) const { return _s == s._s; }
+  bool operator==(const char* s) const { return _s == s; }
+  bool operator!=(const String& s) const { return _s != s._s; }
+  bool operator!=(const char* s) const { return _s != s; }
+
+  friend String operator+(const String& a, const String& b) { return a._s + b._s; }
+  friend String operator+(const String& a, const char* b) { return a._s + b; }
+  friend String operator+(const char* a, const String& b) { return a + b._s; }
+  friend String operator+(const String& a, char b) { return a._s + b; }
+
+private:
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+
+  std::string _s;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    for (size_t i = 0; i < len; ++i) write(buf[i]);
+    return len;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t println(const String& s) { return print(s) + write("\r\n"); }
+  size_t println(const char* s) { return print(s) + write("\r\n"); }
+  size_t println() { return write("\r\n"); }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// A UART that goes nowhere; fake_modem.h derives the simulated modems.
+class HardwareSerial : public Stream {
+public:
+  virtual void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1,
+                     int8_t txPin = -1) {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t) override { return 1; }
+  using Print::write;
+};
+
+// Log output of the code under test; silent unless NATIVE_SERIAL_STDOUT is set.
+class HostSerial : public HardwareSerial {
+public:
+  size_t write(uint8_t b) override {
+#ifdef NATIVE_SERIAL_STDOUT
+    putchar(b);
+#endif
+    return 1;
+  }
+  using Print::write;
+};
+
+inline HostSerial Serial;
@@ -0,0 +1,33 @@
+#pragma once
+// Host stand-in for the Arduino Client interface (see Arduino.h here).
+#include <Arduino.h>
+
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _b{a, b, c, d} {}
+  String toString() const {
+    char s[16];
+    snprintf(s, sizeof(s), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+    return s;
+  }
+
+private:
+  uint8_t _b[4] = {0, 0, 0, 0};
+};
+
+class Client : public Stream {
+public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char* host, uint16_t port) = 0;
+  size_t write(uint8_t b) override = 0;
+  size_t write(const uint8_t* buf, size_t size) override = 0;
+  int available() override = 0;
+  int read() override = 0;
+  virtual int read(uint8_t* buf, size_t size) = 0;
+  int peek() override = 0;
+  void flush() override = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+};
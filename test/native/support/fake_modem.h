@@ -0,0 +1,171 @@
+#pragma once
+/**
+ * @file fake_modem.h
+ * @brief Scripted SIM800-style modem on a host "UART", for [env:native].
+ *
+ * The code under test writes AT commands to it like to a HardwareSerial;
+ * each line ending in CR goes to the handler, whose reply becomes readable
+ * after the reply's delay. A reply with `prompt` set is followed by "> "
+ * and switches the modem to data mode: the next bytes up to Ctrl-Z (or
+ * `dataLength` bytes) go to the data handler instead, as AT+CMGS and
+ * AT+CIPSEND do. Unsolicited lines can be pushed at any time with urc().
+ *
+ * Safe to use from several threads (ScanModem reads from its own task).
+ */
+#include <Arduino.h>
+
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct FakeReply {
+  std::string text;           // sent verbatim; include the CR LFs
+  unsigned long delayMs = 0;  // from the end of the command to the first byte
+  bool prompt = false;        // then "> " and data mode
+  size_t dataLength = 0;      // data mode length; 0 = until Ctrl-Z
+};
+
+class FakeModem : public HardwareSerial {
+public:
+  typedef std::function<FakeReply(const std::string& cmd)> CommandHandler;
+  typedef std::function<FakeReply(const std::string& data)> DataHandler;
+
+  void onCommand(CommandHandler handler) {
+    std::lock_guard<std::mutex> lock(_m);
+    _command = handler;
+  }
+
+  void onData(DataHandler handler) {
+    std::lock_guard<std::mutex> lock(_m);
+    _data = handler;
+  }
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1,
+             int8_t txPin = -1) override {
+    std::lock_guard<std::mutex> lock(_m);
+    _baud = baud;
+  }
+
+  // Queues an unsolicited line ("+CMTI: ...") right away.
+  void urc(const std::string& line) {
+    std::lock_guard<std::mutex> lock(_m);
+    queue(FakeReply{"\r\n" + line + "\r\n"});
+  }
+
+  size_t write(uint8_t b) override {
+    std::lock_guard<std::mutex> lock(_m);
+    if (_dataMode) {
+      if (b == '\n' && _buffer.empty()) return 1;  // of the command's CR LF
+      bool end = _dataLength ? false : b == 0x1A;
+      if (!end) _buffer += char(b);
+      if (end || (_dataLength && _buffer.size() >= _dataLength)) {
+        _dataMode = false;
+        std::string data;
+        data.swap(_buffer);
+        if (_data) queue(_data(data));
+      }
+      return 1;
+    }
+    if (b == '\n') return 1;
+    if (b != '\r') {
+      _buffer += char(b);
+      return 1;
+    }
+    std::string cmd;
+    cmd.swap(_buffer);
+    if (cmd.empty()) return 1;
+    _commands.push_back(cmd);
+    if (_command) queue(_command(cmd));
+    return 1;
+  }
+  using Print::write;
+
+  int available() override {
+    std::lock_guard<std::mutex> lock(_m);
+    return (int)ready();
+  }
+
+  int read() override {
+    std::lock_guard<std::mutex> lock(_m);
+    if (ready() == 0) return -1;
+    int c = (uint8_t)_out.front().byte;
+    _out.pop_front();
+    return c;
+  }
+
+  int peek() override {
+    std::lock_guard<std::mutex> lock(_m);
+    return ready() ? (uint8_t)_out.front().byte : -1;
+  }
+
+  // Every command line received so far, without CR.
+  std::vector<std::string> commands() {
+    std::lock_guard<std::mutex> lock(_m);
+    return _commands;
+  }
+
+  size_t count(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(_m);
+    size_t n = 0;
+    for (const std::string& c : _commands) n += c.compare(0, prefix.size(), prefix) == 0;
+    return n;
+  }
+
+  unsigned long baud() {
+    std::lock_guard<std::mutex> lock(_m);
+    return _baud;
+  }
+
+private:
+  struct Byte {
+    char byte;
+    unsigned long due;
+  };
+
+  // Bytes already due, all of them readable in order.
+  size_t ready() const {
+    unsigned long now = millis();
+    size_t n = 0;
+    while (n < _out.size() && (long)(now - _out[n].due) >= 0) n++;
+    return n;
+  }
+
+  void queue(const FakeReply& reply) {
+    // Replies never overtake each other, as on a real UART.
+    unsigned long due = millis() + reply.delayMs;
+    if (!_out.empty() && (long)(_out.back().due - due) > 0) due = _out.back().due;
+    for (char c : reply.text) _out.push_back(Byte{c, due});
+    if (reply.prompt) {
+      _out.push_back(Byte{'>', due});
+      _out.push_back(Byte{' ', due});
+      _dataMode = true;
+      _dataLength = reply.dataLength;
+    }
+  }
+
+  std::mutex _m;
+  CommandHandler _command;
+  DataHandler _data;
+  std::string _buffer;
+  std::deque<Byte> _out;
+  std::vector<std::string> _commands;
+  bool _dataMode = false;
+  size_t _dataLength = 0;
+  unsigned long _baud = 0;
+};
+
+// Body of an AT+CENG? answer ending in OK; cells are "<mcc>,<mnc>,<lac>,<cid>,<rxlev>,<ta>",
+// an empty string stands for an incomplete "0000" line at that index.
+inline std::string fakeCengReply(std::initializer_list<const char*> cells) {
+  std::string text = "\r\n+CENG: 3,1\r\n\r\n";
+  int index = 0;
+  for (const char* cell : cells) {
+    text += "+CENG: " + std::to_string(index++) + ",\"";
+    text += *cell ? cell : "000,00,0000,0000,00,00";
+    text += "\"\r\n";
+  }
+  return text + "\r\nOK\r\n";
+}
@@ -0,0 +1,58 @@
+#pragma once
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS calls the tested code makes.
+ *
+ * Tasks are detached std::threads, ticks are milliseconds. Only what
+ * scan_modem.cpp needs: binary semaphores, direct-to-task notifications and
+ * vTaskDelay(). Objects are never freed, as tasks on the device never end.
+ */
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+namespace native_rtos {
+
+// A counting signal; binary semaphores and task notifications both use it.
+struct Signal {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t count = 0;
+
+  bool take(TickType_t ticks, bool clear, uint32_t* taken = nullptr) {
+    std::unique_lock<std::mutex> lock(m);
+    auto ready = [this] { return count > 0; };
+    if (ticks == portMAX_DELAY) {
+      cv.wait(lock, ready);
+    } else if (!cv.wait_for(lock, std::chrono::milliseconds(ticks), ready)) {
+      return false;
+    }
+    if (taken) *taken = count;
+    count = clear ? 0 : count - 1;
+    return true;
+  }
+
+  void give(uint32_t max) {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      if (count < max) count++;
+    }
+    cv.notify_all();
+  }
+};
+
+}  // namespace native_rtos
@@ -0,0 +1,18 @@
+#pragma once
+// Host stand-in for FreeRTOS binary semaphores (see FreeRTOS.h here).
+#include "FreeRTOS.h"
+
+typedef native_rtos::Signal* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return new native_rtos::Signal();
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  return sem->take(ticks, false) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  sem->give(1);
+  return pdTRUE;
+}
@@ -0,0 +1,36 @@
+#pragma once
+// Host stand-in for FreeRTOS tasks and notifications (see FreeRTOS.h here).
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef native_rtos::Signal* TaskHandle_t;
+
+namespace native_rtos {
+inline thread_local TaskHandle_t currentTask = nullptr;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t entry, const char* name, uint32_t stack, void* arg,
+                              UBaseType_t priority, TaskHandle_t* handle) {
+  TaskHandle_t task = new native_rtos::Signal();
+  if (handle) *handle = task;
+  std::thread([entry, arg, task] {
+    native_rtos::currentTask = task;
+    entry(arg);
+  }).detach();
+  return pdPASS;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  task->give(UINT32_MAX);
+  return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  uint32_t value = 0;
+  native_rtos::currentTask->take(ticks, clearOnExit == pdTRUE, &value);
+  return value;
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
@@ -0,0 +1,105 @@
+/**
+ * @file test_main.cpp
+ * @brief async_log.h: non-blocking drain, drops on a full ring, replay.
+ */
+#include <unity.h>
+
+#include <string>
+
+#include "async_log.h"
+
+// A UART that accepts `room` bytes per drain.
+class Uart : public Print {
+public:
+  explicit Uart(int room) : room(room) {}
+
+  int room;
+  std::string out;
+
+  size_t write(uint8_t b) override {
+    out += char(b);
+    return 1;
+  }
+  using Print::write;
+  int availableForWrite() override { return room; }
+};
+
+static void drainAll(AsyncLog& log, Uart& uart) {
+  while (log.pending() > 0) {
+    if (log.drain(uart) == 0) break;
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_drain_respects_uart_room() {
+  AsyncLog log;
+  Uart uart(4);
+  log.print("hello world");
+  TEST_ASSERT_EQUAL(4, log.drain(uart));
+  TEST_ASSERT_EQUAL_STRING("hell", uart.out.c_str());
+  drainAll(log, uart);
+  TEST_ASSERT_EQUAL_STRING("hello world", uart.out.c_str());
+}
+
+void test_full_ring_drops_whole_writes() {
+  AsyncLog log;
+  std::string big(ASYNC_LOG_BYTES - 2, 'x');
+  log.print(big.c_str());
+  TEST_ASSERT_EQUAL(0, log.print("abc"));
+  TEST_ASSERT_EQUAL(3, log.dropped());
+  TEST_ASSERT_EQUAL(ASYNC_LOG_BYTES - 2, log.pending());
+}
+
+void test_replay_follows_pending_output() {
+  AsyncLog log;
+  Uart uart(64);
+  log.print("one two ");
+  drainAll(log, uart);
+  log.print("[trace]");
+  TEST_ASSERT_EQUAL(4, log.replay(4));
+  uart.out.clear();
+  drainAll(log, uart);
+  TEST_ASSERT_EQUAL_STRING("[trace]two ", uart.out.c_str());
+}
+
+void test_replay_leaves_room_for_new_output() {
+  AsyncLog log;
+  Uart uart(ASYNC_LOG_BYTES);
+  std::string history(ASYNC_LOG_BYTES, 'h');
+  log.print(history.c_str());
+  drainAll(log, uart);
+  TEST_ASSERT_EQUAL(ASYNC_LOG_BYTES, log.replay());
+  // The whole ring is being replayed, and new output still fits
+  TEST_ASSERT_EQUAL(3, log.print("new"));
+  TEST_ASSERT_EQUAL(0, log.dropped());
+  uart.out.clear();
+  drainAll(log, uart);
+  // "new" overwrote the three oldest replayed bytes, which are skipped
+  TEST_ASSERT_EQUAL_STRING((std::string(ASYNC_LOG_BYTES - 3, 'h') + "new").c_str(),
+                           uart.out.c_str());
+  TEST_ASSERT_EQUAL(0, log.pending());
+}
+
+void test_replay_in_small_drains() {
+  AsyncLog log;
+  Uart uart(3);
+  log.print("abcdef");
+  drainAll(log, uart);
+  log.replay(5);
+  log.print("XY");
+  uart.out.clear();
+  drainAll(log, uart);
+  TEST_ASSERT_EQUAL_STRING("bcdefXY", uart.out.c_str());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_drain_respects_uart_room);
+  RUN_TEST(test_full_ring_drops_whole_writes);
+  RUN_TEST(test_replay_follows_pending_output);
+  RUN_TEST(test_replay_leaves_room_for_new_output);
+  RUN_TEST(test_replay_in_small_drains);
+  return UNITY_END();
+}
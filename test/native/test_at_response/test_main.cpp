@@ -0,0 +1,200 @@
+/**
+ * @file test_main.cpp
+ * @brief at_response.h: every declared response, edge cases, and a benchmark
+ *        against the String indexOf/substring parsing it replaced.
+ */
+#include <Arduino.h>
+#include <unity.h>
+
+#include "at_response.h"
+
+template <size_t N>
+static bool parse(const AtResponseSpec<N>& spec, const char* text, AtValues<N>& v) {
+  return parseAtResponse(spec, text, strlen(text), v);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_creg_with_location() {
+  AtValues<4> v;
+  TEST_ASSERT_TRUE(parse(AT_CREG, "\r\n+CREG: 2,1,\"1A2B\",\"5C01\"\r\n\r\nOK\r\n", v));
+  TEST_ASSERT_EQUAL(2, v[AT_FIELD(AT_CREG, n)].num);
+  TEST_ASSERT_EQUAL(1, v[AT_FIELD(AT_CREG, stat)].num);
+  TEST_ASSERT_TRUE(v[AT_FIELD(AT_CREG, lac)].present);
+  TEST_ASSERT_EQUAL(0x1A2B, v[AT_FIELD(AT_CREG, lac)].num);
+  TEST_ASSERT_EQUAL(0x5C01, v[AT_FIELD(AT_CREG, ci)].num);
+}
+
+void test_creg_optional_fields_absent() {
+  AtValues<4> v;
+  TEST_ASSERT_TRUE(parse(AT_CREG, "+CREG: 0,5", v));
+  TEST_ASSERT_EQUAL(5, v[AT_FIELD(AT_CREG, stat)].num);
+  TEST_ASSERT_FALSE(v[AT_FIELD(AT_CREG, lac)].present);
+  TEST_ASSERT_FALSE(v[AT_FIELD(AT_CREG, ci)].present);
+}
+
+void test_required_field_missing_fails() {
+  AtValues<4> creg;
+  TEST_ASSERT_FALSE(parse(AT_CREG, "+CREG: 2", creg));
+  AtValues<2> csq;
+  TEST_ASSERT_FALSE(parse(AT_CSQ, "+CSQ: ,0", csq));
+}
+
+void test_malformed_number_fails() {
+  AtValues<2> v;
+  TEST_ASSERT_FALSE(parse(AT_CSQ, "+CSQ: 1x,0", v));
+  TEST_ASSERT_FALSE(parse(AT_CSQ, "+CSQ: 12,", v));
+  AtValues<4> creg;
+  TEST_ASSERT_FALSE(parse(AT_CREG, "+CREG: 2,1,\"1G00\",\"5C01\"", creg));  // not hex
+  TEST_ASSERT_FALSE(parse(AT_CREG, "+CREG: 2,1,\"1A2B", creg));             // open quote
+}
+
+void test_csq_and_negative_numbers() {
+  AtValues<2> v;
+  TEST_ASSERT_TRUE(parse(AT_CSQ, "+CSQ: 17,99", v));
+  TEST_ASSERT_EQUAL(17, v[AT_FIELD(AT_CSQ, rssi)].num);
+  TEST_ASSERT_EQUAL(99, v[AT_FIELD(AT_CSQ, ber)].num);
+  TEST_ASSERT_TRUE(parse(AT_CSQ, "+CSQ: -3 , 0", v));
+  TEST_ASSERT_EQUAL(-3, v[AT_FIELD(AT_CSQ, rssi)].num);
+}
+
+void test_cops_string_with_comma() {
+  AtValues<3> v;
+  TEST_ASSERT_TRUE(parse(AT_COPS, "+COPS: 0,0,\"Telekom, DE\"", v));
+  TEST_ASSERT_TRUE(v[AT_FIELD(AT_COPS, oper)].is("Telekom, DE"));
+  TEST_ASSERT_TRUE(parse(AT_COPS, "+COPS: 0", v));
+  TEST_ASSERT_FALSE(v[AT_FIELD(AT_COPS, format)].present);
+  TEST_ASSERT_FALSE(v[AT_FIELD(AT_COPS, oper)].present);
+}
+
+void test_string_field_requires_quotes() {
+  AtValues<3> v;
+  TEST_ASSERT_FALSE(parse(AT_COPS, "+COPS: 0,0,Telekom", v));
+}
+
+void test_cmgs_after_echo_and_prompt() {
+  AtValues<1> v;
+  TEST_ASSERT_TRUE(parse(AT_CMGS, "AT+CMGS=18\r\n> \r\n+CMGS: 42\r\n\r\nOK\r\n", v));
+  TEST_ASSERT_EQUAL(42, v[AT_FIELD(AT_CMGS, mr)].num);
+}
+
+void test_tokens() {
+  AtValues<1> v;
+  TEST_ASSERT_TRUE(parse(AT_CIPSTATUS, "\r\nOK\r\n\r\nSTATE: IP INITIAL\r\n", v));
+  TEST_ASSERT_TRUE(v[0].is("IP INITIAL"));
+  TEST_ASSERT_TRUE(parse(AT_CPIN, "+CPIN: SIM PIN  ", v));
+  TEST_ASSERT_TRUE(v[AT_FIELD(AT_CPIN, code)].is("SIM PIN"));
+  TEST_ASSERT_FALSE(v[0].is("SIM PIN2"));
+}
+
+void test_prefix_must_match_at_line_start() {
+  AtValues<2> v;
+  TEST_ASSERT_FALSE(parse(AT_CSQ, "AT+CSQ\r\nERROR\r\n", v));
+  TEST_ASSERT_FALSE(parse(AT_CSQ, "x+CSQ: 1,2", v));
+  TEST_ASSERT_TRUE(parse(AT_CSQ, "   +CSQ: 1,2", v));
+}
+
+void test_cipsend_lines() {
+  const char* text = "+CIPSEND: 0,1460\r\n+CIPSEND: 1,0\r\n+CIPSEND: 2,512\r\n\r\nOK\r\n";
+  int32_t sizes[3] = {-1, -1, -1};
+  size_t n = parseAtLines(AT_CIPSEND, text, strlen(text), [&](const AtValues<2>& v) {
+    sizes[v[AT_FIELD(AT_CIPSEND, link)].num] = v[AT_FIELD(AT_CIPSEND, size)].num;
+  });
+  TEST_ASSERT_EQUAL(3, n);
+  TEST_ASSERT_EQUAL(1460, sizes[0]);
+  TEST_ASSERT_EQUAL(0, sizes[1]);
+  TEST_ASSERT_EQUAL(512, sizes[2]);
+}
+
+void test_sms_notifications() {
+  AtValues<2> cmti;
+  TEST_ASSERT_TRUE(parse(AT_CMTI, "\r\n+CMTI: \"SM\",7\r\n", cmti));
+  TEST_ASSERT_TRUE(cmti[AT_FIELD(AT_CMTI, mem)].is("SM"));
+  TEST_ASSERT_EQUAL(7, cmti[AT_FIELD(AT_CMTI, index)].num);
+
+  AtValues<4> cmgr;
+  TEST_ASSERT_TRUE(parse(AT_CMGR,
+                         "+CMGR: \"REC UNREAD\",\"+491701234567\",\"\",\"26/10/17,12:00:00+08\"\r\n"
+                         "WHERE\r\n\r\nOK\r\n",
+                         cmgr));
+  TEST_ASSERT_TRUE(cmgr[AT_FIELD(AT_CMGR, oa)].is("+491701234567"));
+  TEST_ASSERT_TRUE(cmgr[AT_FIELD(AT_CMGR, alpha)].is(""));
+  TEST_ASSERT_TRUE(cmgr[AT_FIELD(AT_CMGR, scts)].is("26/10/17,12:00:00+08"));
+
+  const char* list = "+CMGL: 1,\"REC UNREAD\",\"+4917\",,\"t\"\r\nWHERE\r\n"
+                     "+CMGL: 4,\"REC READ\",\"+4918\",,\"t\"\r\nSURVEY\r\n\r\nOK\r\n";
+  int32_t indexes[2] = {0, 0};
+  size_t n = 0;
+  parseAtLines(AT_CMGL, list, strlen(list),
+               [&](const AtValues<3>& v) { indexes[n++] = v[AT_FIELD(AT_CMGL, index)].num; });
+  TEST_ASSERT_EQUAL(2, n);
+  TEST_ASSERT_EQUAL(1, indexes[0]);
+  TEST_ASSERT_EQUAL(4, indexes[1]);
+}
+
+// ---- benchmark ---------------------------------------------------------------
+
+static const char* BENCH_CREG = "\r\n+CREG: 2,1,\"1A2B\",\"5C01\"\r\n\r\nOK\r\n";
+static const int BENCH_ROUNDS = 200000;
+static volatile int32_t benchSink;
+
+// The String-based parsing the descriptors replaced.
+static bool parseCregByHand(const String& resp, int32_t& stat, int32_t& lac, int32_t& ci) {
+  int idx = resp.indexOf("+CREG: ");
+  if (idx == -1) return false;
+  int c1 = resp.indexOf(',', idx);
+  int c2 = resp.indexOf(',', c1 + 1);
+  int c3 = resp.indexOf(',', c2 + 1);
+  if (c1 == -1 || c2 == -1 || c3 == -1) return false;
+  stat = resp.substring(c1 + 1, c2).toInt();
+  lac = strtol(resp.substring(c2 + 2, c3 - 1).c_str(), nullptr, 16);
+  int end = resp.indexOf('"', c3 + 2);
+  ci = strtol(resp.substring(c3 + 2, end).c_str(), nullptr, 16);
+  return true;
+}
+
+void test_benchmark_against_string_parsing() {
+  const size_t len = strlen(BENCH_CREG);
+  AtValues<4> v;
+  unsigned long start = micros();
+  for (int i = 0; i < BENCH_ROUNDS; ++i) {
+    parseAtResponse(AT_CREG, BENCH_CREG, len, v);
+    benchSink = v.v[3].num;
+  }
+  unsigned long spec = micros() - start;
+  TEST_ASSERT_EQUAL(0x5C01, v[AT_FIELD(AT_CREG, ci)].num);
+
+  String resp = BENCH_CREG;
+  int32_t stat = 0, lac = 0, ci = 0;
+  start = micros();
+  for (int i = 0; i < BENCH_ROUNDS; ++i) {
+    parseCregByHand(resp, stat, lac, ci);
+    benchSink = ci;
+  }
+  unsigned long hand = micros() - start;
+  TEST_ASSERT_EQUAL(0x5C01, ci);
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "+CREG x%d: descriptors %.1f ns/parse, String %.1f ns/parse",
+           BENCH_ROUNDS, spec * 1000.0 / BENCH_ROUNDS, hand * 1000.0 / BENCH_ROUNDS);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_creg_with_location);
+  RUN_TEST(test_creg_optional_fields_absent);
+  RUN_TEST(test_required_field_missing_fails);
+  RUN_TEST(test_malformed_number_fails);
+  RUN_TEST(test_csq_and_negative_numbers);
+  RUN_TEST(test_cops_string_with_comma);
+  RUN_TEST(test_string_field_requires_quotes);
+  RUN_TEST(test_cmgs_after_echo_and_prompt);
+  RUN_TEST(test_tokens);
+  RUN_TEST(test_prefix_must_match_at_line_start);
+  RUN_TEST(test_cipsend_lines);
+  RUN_TEST(test_sms_notifications);
+  RUN_TEST(test_benchmark_against_string_parsing);
+  return UNITY_END();
+}
@@ -0,0 +1,95 @@
+/**
+ * @file test_main.cpp
+ * @brief cell_fusion.h: union of rounds, RxLev statistics and serving votes.
+ */
+#include <unity.h>
+
+#include <string.h>
+
+#include "cell_fusion.h"
+#include "ceng_parser.h"
+
+static CellSnapshot parse(const char* text) {
+  CellSnapshot snap;
+  bool complete;
+  parseCengResponse(text, strlen(text), snap, complete);
+  return snap;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_incomplete_serving_line_does_not_vote() {
+  // Round 1: serving cell line incomplete, so the neighbour 1111 is compacted
+  // into cells[0]; round 2 is complete with serving cell 2222.
+  CellSnapshot round1 = parse(
+      "+CENG: 0,\"262,01,1a2b,ffff,40,1\"\r\n"
+      "+CENG: 1,\"262,01,1a2b,1111,30,0\"\r\n"
+      "OK\r\n");
+  CellSnapshot round2 = parse(
+      "+CENG: 0,\"262,01,1a2b,2222,41,1\"\r\n"
+      "+CENG: 1,\"262,01,1a2b,1111,32,0\"\r\n"
+      "OK\r\n");
+  TEST_ASSERT_FALSE(round1.servingParsed);
+  TEST_ASSERT_EQUAL(0x1111, round1.cells[0].cid);
+  TEST_ASSERT_TRUE(round2.servingParsed);
+
+  CellFusion fusion;
+  fusion.add(round1);
+  fusion.add(round2);
+  TEST_ASSERT_EQUAL(2, fusion.count());
+  TEST_ASSERT_EQUAL(0x2222, fusion[fusion.servingIndex()].cell.cid);
+
+  CellSnapshot fused;
+  fusion.toSnapshot(fused);
+  TEST_ASSERT_TRUE(fused.servingParsed);
+  TEST_ASSERT_EQUAL(0x2222, fused.cells[0].cid);
+  TEST_ASSERT_EQUAL(0x1111, fused.cells[1].cid);
+}
+
+void test_no_serving_vote_orders_by_level() {
+  CellFusion fusion;
+  fusion.add(parse("+CENG: 0,\"262,01,1a2b,0000,40,1\"\r\n"
+                   "+CENG: 1,\"262,01,1a2b,1111,20,0\"\r\n"
+                   "+CENG: 2,\"262,01,1a2b,3333,35,0\"\r\n"));
+  TEST_ASSERT_EQUAL(-1, fusion.servingIndex());
+  CellSnapshot fused;
+  fusion.toSnapshot(fused);
+  TEST_ASSERT_FALSE(fused.servingParsed);
+  TEST_ASSERT_EQUAL(0x3333, fused.cells[0].cid);
+}
+
+void test_serving_majority_and_rxlev_statistics() {
+  CellFusion fusion;
+  const char* a = "+CENG: 0,\"262,01,1a2b,2222,40,1\"\r\n+CENG: 1,\"262,01,1a2b,1111,30,0\"\r\n";
+  const char* b = "+CENG: 0,\"262,01,1a2b,1111,34,0\"\r\n+CENG: 1,\"262,01,1a2b,2222,44,1\"\r\n";
+  fusion.add(parse(a));
+  fusion.add(parse(a));
+  fusion.add(parse(b));
+  TEST_ASSERT_EQUAL(3, fusion.scans());
+  const FusedCell& serving = fusion[fusion.servingIndex()];
+  TEST_ASSERT_EQUAL(0x2222, serving.cell.cid);
+  TEST_ASSERT_EQUAL(2, serving.serving);
+  TEST_ASSERT_EQUAL(3, serving.seen);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 124.0f / 3, serving.rxlevMean);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 16.0f / 3, serving.rxlevVariance());
+}
+
+void test_scan_modem_answers_do_not_vote() {
+  CellFusion fusion;
+  fusion.add(parse("+CENG: 0,\"262,01,1a2b,2222,20,1\"\r\n"));
+  fusion.add(parse("+CENG: 0,\"262,02,2b00,7001,50,1\"\r\n"), false);
+  CellSnapshot fused;
+  fusion.toSnapshot(fused);
+  TEST_ASSERT_EQUAL(2, fused.count);
+  TEST_ASSERT_EQUAL(0x2222, fused.cells[0].cid);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_incomplete_serving_line_does_not_vote);
+  RUN_TEST(test_no_serving_vote_orders_by_level);
+  RUN_TEST(test_serving_majority_and_rxlev_statistics);
+  RUN_TEST(test_scan_modem_answers_do_not_vote);
+  return UNITY_END();
+}
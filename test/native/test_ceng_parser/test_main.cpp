@@ -0,0 +1,110 @@
+/**
+ * @file test_main.cpp
+ * @brief ceng_parser.h: single lines and whole AT+CENG? answers.
+ */
+#include <unity.h>
+
+#include <string.h>
+
+#include "ceng_parser.h"
+
+static CengLineResult parseLine(const char* line, int& index, CellRecord& rec) {
+  return parseCengLine(line, line + strlen(line), index, rec);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_cell_line() {
+  int index = -1;
+  CellRecord rec;
+  TEST_ASSERT_EQUAL(CENG_OK, parseLine("+CENG: 0,\"262,01,1a2b,5C01,40,3\"", index, rec));
+  TEST_ASSERT_EQUAL(0, index);
+  TEST_ASSERT_EQUAL(262, rec.mcc);
+  TEST_ASSERT_EQUAL(1, rec.mnc);
+  TEST_ASSERT_EQUAL(0x1A2B, rec.lac);
+  TEST_ASSERT_EQUAL(0x5C01, rec.cid);
+  TEST_ASSERT_EQUAL(40, rec.rxlev);
+  TEST_ASSERT_EQUAL(3, rec.ta);
+}
+
+void test_neighbour_without_timing_advance() {
+  int index = -1;
+  CellRecord rec;
+  TEST_ASSERT_EQUAL(CENG_OK, parseLine("\r+CENG: 5,\"262,01,1a2b,5c02,70\"", index, rec));
+  TEST_ASSERT_EQUAL(5, index);
+  TEST_ASSERT_EQUAL(63, rec.rxlev);  // clamped
+  TEST_ASSERT_EQUAL(CELL_TA_UNKNOWN, rec.ta);
+}
+
+void test_placeholders_are_incomplete() {
+  int index = -1;
+  CellRecord rec;
+  TEST_ASSERT_EQUAL(CENG_INCOMPLETE, parseLine("+CENG: 1,\"262,01,0000,5c02,30,0\"", index, rec));
+  TEST_ASSERT_EQUAL(1, index);
+  TEST_ASSERT_EQUAL(CENG_INCOMPLETE, parseLine("+CENG: 2,\"262,01,1a2b,FFFF,30,0\"", index, rec));
+  TEST_ASSERT_EQUAL(CENG_INCOMPLETE, parseLine("+CENG: 3,\"262,,1a2b,5c02,30,0\"", index, rec));
+  TEST_ASSERT_EQUAL(CENG_INCOMPLETE, parseLine("+CENG: 4,\"262,01\"", index, rec));
+}
+
+void test_not_cell_lines() {
+  int index = -1;
+  CellRecord rec;
+  TEST_ASSERT_EQUAL(CENG_NOT_CELL, parseLine("+CENG: 3,1", index, rec));  // mode header
+  TEST_ASSERT_EQUAL(CENG_NOT_CELL, parseLine("OK", index, rec));
+  TEST_ASSERT_EQUAL(CENG_NOT_CELL, parseLine("+CENG: ,\"262,01,1a2b,5c01,40,3\"", index, rec));
+  TEST_ASSERT_EQUAL(CENG_NOT_CELL, parseLine("+CENG: 0,\"262,01,1a2b,5c01", index, rec));
+  TEST_ASSERT_EQUAL(-1, index);
+}
+
+void test_response_in_index_order() {
+  const char* text =
+      "\r\n+CENG: 3,1\r\n\r\n"
+      "+CENG: 2,\"262,01,1a2b,5c03,20,0\"\r\n"
+      "+CENG: 0,\"262,01,1a2b,5c01,40,1\"\r\n"
+      "+CENG: 1,\"262,01,1a2b,5c02,30,0\"\r\n"
+      "\r\nOK\r\n";
+  CellSnapshot snap;
+  bool complete = false;
+  TEST_ASSERT_TRUE(parseCengResponse(text, strlen(text), snap, complete));
+  TEST_ASSERT_TRUE(complete);
+  TEST_ASSERT_EQUAL(3, snap.count);
+  TEST_ASSERT_EQUAL(0x5C01, snap.cells[0].cid);
+  TEST_ASSERT_EQUAL(0x5C02, snap.cells[1].cid);
+  TEST_ASSERT_EQUAL(0x5C03, snap.cells[2].cid);
+}
+
+void test_incomplete_response() {
+  const char* text =
+      "+CENG: 0,\"262,01,0000,0000,40,1\"\r\n"
+      "+CENG: 1,\"262,01,1a2b,5c02,30,0\"\r\n"
+      "+CENG: 9,\"262,01,1a2b,5c09,30,0\"\r\n"  // beyond CELL_SNAPSHOT_MAX
+      "OK\r\n";
+  CellSnapshot snap;
+  bool complete = true;
+  TEST_ASSERT_TRUE(parseCengResponse(text, strlen(text), snap, complete));
+  TEST_ASSERT_FALSE(complete);
+  TEST_ASSERT_EQUAL(1, snap.count);
+  TEST_ASSERT_EQUAL(0x5C02, snap.cells[0].cid);
+}
+
+void test_empty_response() {
+  const char* text = "\r\nERROR\r\n";
+  CellSnapshot snap;
+  bool complete = false;
+  TEST_ASSERT_FALSE(parseCengResponse(text, strlen(text), snap, complete));
+  TEST_ASSERT_TRUE(complete);
+  TEST_ASSERT_EQUAL(0, snap.count);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cell_line);
+  RUN_TEST(test_neighbour_without_timing_advance);
+  RUN_TEST(test_placeholders_are_incomplete);
+  RUN_TEST(test_not_cell_lines);
+  RUN_TEST(test_response_in_index_order);
+  RUN_TEST(test_incomplete_response);
+  RUN_TEST(test_empty_response);
+  return UNITY_END();
+}
@@ -0,0 +1,304 @@
+/**
+ * @file test_main.cpp
+ * @brief CoopTask flows sharing one simulated modem through AsyncModem.
+ *
+ * Hundreds of sessions run their AT commands on one UART, stepped round-robin
+ * as the scheduler does: every session must get its own answer back, and an
+ * SMS sender holding the modem between AT+CMGS and its result must never
+ * have another session's command land in PDU mode or inside its PDU. A
+ * socket that is opening leaves the modem to the others until CONNECT OK.
+ */
+#include <unity.h>
+
+#include <ctype.h>
+
+#include <string>
+#include <vector>
+
+#include "async_modem.h"
+#include "coop_task.h"
+#include "fake_modem.h"
+#include "sim800_at.h"
+#include "sim800_mux.h"
+#include "sms_sender.h"
+
+static const int SESSIONS = 300;
+static const int ROUNDS = 3;
+
+// The modem side: echoes AT+ECHO=<n> as +ECHO: <n>, takes SMS PDUs after a
+// prompt, and counts whatever arrives where it must not.
+struct ModemScript {
+  bool pduMode = false;
+  int violations = 0;
+  int pdus = 0;
+  int mr = 0;
+};
+
+static void script(FakeModem& modem, ModemScript& state) {
+  modem.onCommand([&state](const std::string& cmd) {
+    if (cmd.compare(0, 8, "AT+ECHO=") == 0) {
+      if (state.pduMode) state.violations++;
+      const int n = atoi(cmd.c_str() + 8);
+      return FakeReply{"\r\n+ECHO: " + cmd.substr(8) + "\r\n\r\nOK\r\n", (unsigned long)(n % 3)};
+    }
+    if (cmd == "AT+CMGF=0") state.pduMode = true;
+    if (cmd == "AT+CMGF=1") state.pduMode = false;
+    if (cmd.compare(0, 8, "AT+CMGS=") == 0) {
+      if (!state.pduMode) state.violations++;
+      FakeReply reply{"\r\n", 2};
+      reply.prompt = true;
+      return reply;
+    }
+    return FakeReply{"\r\nOK\r\n"};
+  });
+  modem.onData([&state](const std::string& data) {
+    for (char c : data) {
+      if (!isxdigit((unsigned char)c)) {
+        state.violations++;
+        break;
+      }
+    }
+    state.pdus++;
+    return FakeReply{"\r\n+CMGS: " + std::to_string(++state.mr) + "\r\n\r\nOK\r\n", 5};
+  });
+}
+
+struct Rig {
+  FakeModem serial;
+  Sim800At at{serial};
+  Sim800Mux mux{at};
+  AsyncModem modem{mux};
+  ModemScript state;
+
+  Rig() { script(serial, state); }
+};
+
+class EchoSession : public CoopTask {
+public:
+  EchoSession(AsyncModem& modem, int id) : _modem(modem), _id(id) {}
+
+  int answered = 0;
+  int wrong = 0;
+
+  CoStatus step() override {
+    CO_BEGIN();
+    for (_round = 0; _round < ROUNDS; ++_round) {
+      CO_AT(_modem, "AT+ECHO=" + String(_id * ROUNDS + _round), 1000);
+      if (_modem.result() == AT_OK &&
+          _modem.response().indexOf("+ECHO: " + String(_id * ROUNDS + _round) + "\n") >= 0) {
+        answered++;
+      } else {
+        wrong++;
+      }
+    }
+    CO_END();
+  }
+
+private:
+  AsyncModem& _modem;
+  int _id;
+  int _round = 0;
+};
+
+class SmsSession : public CoopTask {
+public:
+  SmsSession(AsyncModem& modem, const String& text) : _sender(modem), _text(text) {}
+
+  SmsSender& sender() { return _sender; }
+
+  CoStatus step() override {
+    CO_BEGIN();
+    CO_AWAIT(_sender.claim(this));
+    _sender.prepare(_text, NUMBERS, 2);
+    CO_RUN(_sender);
+    _sender.release(this);
+    CO_END();
+  }
+
+private:
+  static const char* const NUMBERS[2];
+  SmsSender _sender;
+  String _text;
+};
+
+const char* const SmsSession::NUMBERS[2] = {"+491234567890", "+491234567891"};
+
+// Opens a mux link as the MQTT link task does: AT+CIPSTART on the
+// background slot, CONNECT OK awaited with the modem free.
+class ConnectSession : public CoopTask {
+public:
+  ConnectSession(AsyncModem& modem, Sim800Mux& mux) : _modem(modem), _socket(mux) {}
+
+  MuxSocket& socket() { return _socket; }
+  bool connected = false;
+
+  CoStatus step() override {
+    CO_BEGIN();
+    CO_AWAIT(_modem.acquire(this));
+    _command = _socket.startConnect("broker.example.com", 1883);
+    CO_AT_HELD(_modem, _command, 2000);
+    _modem.release(this);
+    CO_AWAIT(!_socket.connecting());
+    CO_AWAIT(_modem.acquire(this));
+    connected = _socket.finishConnect();
+    _modem.release(this);
+    CO_END();
+  }
+
+private:
+  AsyncModem& _modem;
+  MuxSocket _socket;
+  String _command;
+};
+
+// Steps every task until all are done, as CoopScheduler::runOnce() does.
+static bool runAll(std::vector<CoopTask*>& tasks, unsigned long timeout) {
+  std::vector<bool> done(tasks.size(), false);
+  size_t left = tasks.size();
+  unsigned long start = millis();
+  while (left > 0 && millis() - start < timeout) {
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      if (done[i] || tasks[i]->step() != CO_DONE) continue;
+      done[i] = true;
+      left--;
+    }
+  }
+  return left == 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_hundreds_of_sessions_get_their_own_answers() {
+  Rig rig;
+  std::vector<EchoSession> sessions;
+  sessions.reserve(SESSIONS);
+  std::vector<CoopTask*> tasks;
+  for (int i = 0; i < SESSIONS; ++i) {
+    sessions.emplace_back(rig.modem, i);
+    tasks.push_back(&sessions.back());
+  }
+  TEST_ASSERT_TRUE(runAll(tasks, 30000));
+  for (const EchoSession& s : sessions) {
+    TEST_ASSERT_EQUAL(ROUNDS, s.answered);
+    TEST_ASSERT_EQUAL(0, s.wrong);
+  }
+  TEST_ASSERT_EQUAL(SESSIONS * ROUNDS, (int)rig.serial.count("AT+ECHO="));
+  TEST_ASSERT_FALSE(rig.modem.busy());
+}
+
+void test_sms_sequences_are_not_interleaved() {
+  Rig rig;
+  std::vector<EchoSession> sessions;
+  sessions.reserve(SESSIONS);
+  std::vector<CoopTask*> tasks;
+  // Two-segment texts, so each sender goes back to AT+CMGS in the middle
+  SmsSession smsA(rig.modem, String(std::string(200, 'a').c_str()));
+  SmsSession smsB(rig.modem, "short");
+  tasks.push_back(&smsA);
+  for (int i = 0; i < SESSIONS; ++i) {
+    sessions.emplace_back(rig.modem, i);
+    tasks.push_back(&sessions.back());
+    if (i == SESSIONS / 2) tasks.push_back(&smsB);
+  }
+  TEST_ASSERT_TRUE(runAll(tasks, 30000));
+
+  TEST_ASSERT_EQUAL(0, rig.state.violations);
+  TEST_ASSERT_FALSE(rig.state.pduMode);
+  TEST_ASSERT_EQUAL(2, smsA.sender().delivered());
+  TEST_ASSERT_EQUAL(2, smsA.sender().result(0).sent);
+  TEST_ASSERT_EQUAL(2, smsB.sender().delivered());
+  TEST_ASSERT_EQUAL(2 * 2 + 2, rig.state.pdus);
+  for (const EchoSession& s : sessions) {
+    TEST_ASSERT_EQUAL(ROUNDS, s.answered);
+  }
+}
+
+void test_missing_prompt_leaves_pdu_mode() {
+  Rig rig;
+  // A modem that never prompts: the sender gives up on the segment, retries
+  // and still switches back to text mode for the other sessions
+  rig.serial.onCommand([&rig](const std::string& cmd) {
+    if (cmd == "AT+CMGF=0") rig.state.pduMode = true;
+    if (cmd == "AT+CMGF=1") rig.state.pduMode = false;
+    if (cmd.compare(0, 8, "AT+CMGS=") == 0) return FakeReply{"\r\nERROR\r\n"};
+    return FakeReply{"\r\nOK\r\n"};
+  });
+  SmsSendConfig config;
+  config.attempts = 2;
+  config.retryDelayMs = 10;
+  SmsSender sender(rig.modem, config);
+  const char* number = "+491234567890";
+  TEST_ASSERT_TRUE(sender.claim(&rig));
+  sender.prepare("hello", &number, 1);
+  std::vector<CoopTask*> tasks{&sender};
+  TEST_ASSERT_TRUE(runAll(tasks, 5000));
+  TEST_ASSERT_EQUAL(0, sender.delivered());
+  TEST_ASSERT_EQUAL(2, sender.result(0).attempts);
+  TEST_ASSERT_FALSE(rig.state.pduMode);
+  TEST_ASSERT_FALSE(rig.modem.busy());
+}
+
+void test_socket_opens_with_the_modem_free() {
+  Rig rig;
+  ConnectSession connect(rig.modem, rig.mux);
+  std::vector<EchoSession> sessions;
+  sessions.reserve(SESSIONS);
+  std::vector<CoopTask*> tasks{&connect};
+  for (int i = 0; i < SESSIONS; ++i) {
+    sessions.emplace_back(rig.modem, i);
+    tasks.push_back(&sessions.back());
+  }
+  // The broker answers once every echo session is through, which they only
+  // get while the connecting link leaves the modem free
+  std::vector<bool> done(tasks.size(), false);
+  int echoesLeft = SESSIONS;
+  unsigned long start = millis();
+  while (!done[0] && millis() - start < 30000) {
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      if (done[i] || tasks[i]->step() != CO_DONE) continue;
+      done[i] = true;
+      if (i > 0 && --echoesLeft == 0) rig.serial.urc("0, CONNECT OK");
+    }
+  }
+  TEST_ASSERT_TRUE(done[0]);
+  TEST_ASSERT_EQUAL(0, echoesLeft);
+  TEST_ASSERT_TRUE(connect.connected);
+  TEST_ASSERT_TRUE(connect.socket().connected());
+  TEST_ASSERT_EQUAL(1, (int)rig.serial.count("AT+CIPSTART=0,\"TCP\""));
+  TEST_ASSERT_FALSE(rig.modem.busy());
+}
+
+void test_ssl_mode_follows_each_link() {
+  Rig rig;
+  MuxSocket google(rig.mux);
+  MuxSocket broker(rig.mux);
+  MuxSocket other(rig.mux);
+  TEST_ASSERT_TRUE(rig.modem.acquire(&rig));
+  TEST_ASSERT_EQUAL_STRING("AT+CIPSTART=0,\"TCP\",\"www.googleapis.com\",443",
+                           google.startConnect("www.googleapis.com", 443, true).c_str());
+  TEST_ASSERT_TRUE(broker.startConnect("broker.example.com", 1883).length() > 0);
+  TEST_ASSERT_TRUE(other.startConnect("maps.googleapis.com", 443, true).length() > 0);
+  TEST_ASSERT_EQUAL(2, (int)rig.serial.count("AT+CIPSSL=1"));
+  TEST_ASSERT_EQUAL(1, (int)rig.serial.count("AT+CIPSSL=0"));
+
+  // A modem without SSL gets no plain link in its place
+  rig.serial.onCommand([](const std::string& cmd) {
+    return FakeReply{cmd == "AT+CIPSSL=1" ? "\r\nERROR\r\n" : "\r\nOK\r\n"};
+  });
+  google.stop();
+  TEST_ASSERT_TRUE(other.startConnect("maps.googleapis.com", 80).length() > 0);
+  TEST_ASSERT_EQUAL(0, (int)google.startConnect("www.googleapis.com", 443, true).length());
+  TEST_ASSERT_FALSE(google.finishConnect());
+  rig.modem.release(&rig);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_hundreds_of_sessions_get_their_own_answers);
+  RUN_TEST(test_sms_sequences_are_not_interleaved);
+  RUN_TEST(test_missing_prompt_leaves_pdu_mode);
+  RUN_TEST(test_socket_opens_with_the_modem_free);
+  RUN_TEST(test_ssl_mode_follows_each_link);
+  return UNITY_END();
+}
@@ -0,0 +1,184 @@
+/**
+ * @file test_main.cpp
+ * @brief http_exchange.h: responses parsed piecewise over a scripted Client.
+ *
+ * The response arrives in pieces of a few bytes, one piece per poll(), as
+ * it would from a TLS socket, so every state boundary falls inside a read.
+ */
+#include <unity.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "http_exchange.h"
+
+// Hands out `response` `piece` bytes per available(), then reports the
+// connection closed if `closeAfter` is set.
+class ScriptedClient : public Client {
+public:
+  ScriptedClient(const std::string& response, size_t piece, bool closeAfter = false)
+      : _response(response), _piece(piece), _closeAfter(closeAfter) {}
+
+  std::string written;
+
+  int connect(IPAddress ip, uint16_t port) override { return 1; }
+  int connect(const char* host, uint16_t port) override { return 1; }
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) override {
+    written.append((const char*)buf, size);
+    return size;
+  }
+  int available() override {
+    // A new piece becomes readable on the poll after the one that consumed
+    // the previous piece
+    if (_pause) {
+      _pause = false;
+      return 0;
+    }
+    if (_readable == 0 && _pos < _response.size()) {
+      _readable = std::min(_piece, _response.size() - _pos);
+    }
+    return (int)_readable;
+  }
+  int read() override {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+  }
+  int read(uint8_t* buf, size_t size) override {
+    size_t n = std::min(size, _readable);
+    memcpy(buf, _response.data() + _pos, n);
+    _pos += n;
+    _readable -= n;
+    _pause = n > 0 && _readable == 0;
+    return (int)n;
+  }
+  int peek() override { return _readable ? (uint8_t)_response[_pos] : -1; }
+  void flush() override {}
+  void stop() override { _pos = _response.size(); }
+  uint8_t connected() override { return !(_closeAfter && _pos == _response.size()); }
+  operator bool() override { return true; }
+
+private:
+  std::string _response;
+  size_t _piece;
+  bool _closeAfter;
+  size_t _pos = 0;
+  size_t _readable = 0;
+  bool _pause = false;
+};
+
+// Polls until the exchange is over; the number of polls it took.
+static int pollAll(HttpExchange& exchange, int limit = 10000) {
+  int polls = 1;
+  while (!exchange.poll() && polls < limit) polls++;
+  return polls;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_request_is_written_in_one_piece() {
+  ScriptedClient client("", 1);
+  HttpExchange exchange;
+  String body = "{\"considerIp\":false}";
+  TEST_ASSERT_TRUE(exchange.begin(client, "POST", "www.googleapis.com", "/geolocation/v1/geolocate",
+                                  "application/json", &body));
+  TEST_ASSERT_EQUAL_STRING(
+      "POST /geolocation/v1/geolocate HTTP/1.1\r\n"
+      "Host: www.googleapis.com\r\n"
+      "Connection: keep-alive\r\n"
+      "Content-Type: application/json\r\n"
+      "Content-Length: 20\r\n"
+      "\r\n"
+      "{\"considerIp\":false}",
+      client.written.c_str());
+}
+
+void test_content_length_body() {
+  ScriptedClient client(
+      "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\ncontent-length: 13\r\n\r\n"
+      "{\"lat\":51.5}\nNEXT",
+      3);
+  HttpExchange exchange;
+  exchange.begin(client, "GET", "maps.googleapis.com", "/");
+  TEST_ASSERT_TRUE(pollAll(exchange) > 20);
+  TEST_ASSERT_EQUAL(200, exchange.status());
+  TEST_ASSERT_EQUAL_STRING("{\"lat\":51.5}\n", exchange.body().c_str());
+  TEST_ASSERT_TRUE(exchange.keepAlive());
+}
+
+void test_chunked_body() {
+  ScriptedClient client(
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "5\r\nhello\r\n"
+      "7;ext=1\r\n, world\r\n"
+      "0\r\nX-Trailer: 1\r\n\r\n",
+      4);
+  HttpExchange exchange;
+  exchange.begin(client, "GET", "maps.googleapis.com", "/");
+  pollAll(exchange);
+  TEST_ASSERT_EQUAL(200, exchange.status());
+  TEST_ASSERT_EQUAL_STRING("hello, world", exchange.body().c_str());
+  TEST_ASSERT_TRUE(exchange.keepAlive());
+}
+
+void test_body_until_close() {
+  ScriptedClient client("HTTP/1.0 404 Not Found\r\n\r\nmissing", 2, true);
+  HttpExchange exchange;
+  exchange.begin(client, "GET", "maps.googleapis.com", "/");
+  pollAll(exchange);
+  TEST_ASSERT_EQUAL(404, exchange.status());
+  TEST_ASSERT_EQUAL_STRING("missing", exchange.body().c_str());
+  TEST_ASSERT_FALSE(exchange.keepAlive());
+}
+
+void test_connection_close_header() {
+  ScriptedClient client("HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n", 64);
+  HttpExchange exchange;
+  exchange.begin(client, "GET", "maps.googleapis.com", "/");
+  pollAll(exchange);
+  TEST_ASSERT_EQUAL(204, exchange.status());
+  TEST_ASSERT_FALSE(exchange.keepAlive());
+}
+
+void test_closed_before_complete() {
+  ScriptedClient client("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\nshort", 8, true);
+  HttpExchange exchange;
+  exchange.begin(client, "GET", "maps.googleapis.com", "/");
+  pollAll(exchange);
+  TEST_ASSERT_EQUAL(HTTP_ERROR_CLOSED, exchange.status());
+  TEST_ASSERT_FALSE(exchange.keepAlive());
+}
+
+void test_timeout() {
+  ScriptedClient client("HTTP/1.1 200 OK\r\n", 64);
+  HttpExchange exchange;
+  exchange.begin(client, "GET", "maps.googleapis.com", "/", nullptr, nullptr, 50);
+  unsigned long start = millis();
+  while (!exchange.poll()) delay(1);
+  TEST_ASSERT_EQUAL(HTTP_ERROR_TIMEOUT, exchange.status());
+  TEST_ASSERT_TRUE(millis() - start >= 50);
+}
+
+void test_malformed_status_line() {
+  ScriptedClient client("SSH-2.0-OpenSSH\r\n\r\n", 64);
+  HttpExchange exchange;
+  exchange.begin(client, "GET", "maps.googleapis.com", "/");
+  pollAll(exchange);
+  TEST_ASSERT_EQUAL(HTTP_ERROR_MALFORMED, exchange.status());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_request_is_written_in_one_piece);
+  RUN_TEST(test_content_length_body);
+  RUN_TEST(test_chunked_body);
+  RUN_TEST(test_body_until_close);
+  RUN_TEST(test_connection_close_header);
+  RUN_TEST(test_closed_before_complete);
+  RUN_TEST(test_timeout);
+  RUN_TEST(test_malformed_status_line);
+  return UNITY_END();
+}
@@ -0,0 +1,156 @@
+/**
+ * @file test_main.cpp
+ * @brief ScanModem (scan_modem.h) against simulated modems.
+ *
+ * Each scan modem runs its rounds in its own task, so two windows must take
+ * about as long as one; the answers join the data modem's own without a
+ * serving vote; a silent or slow modem must not stall or corrupt the fix.
+ */
+#include <unity.h>
+
+#include <memory>
+
+#include "fake_modem.h"
+#include "modem_traits.h"
+#include "scan_modem.h"
+
+static const unsigned long LATENCY_MS = 400;
+
+static const char* DATA_SERVING = "262,01,1a2b,5c01,40,1";
+static const char* DATA_NEIGHBOUR = "262,01,1a2b,5c02,30,0";
+static const char* OTHER_SERVING = "262,02,2b00,7001,45,2";
+static const char* OTHER_NEIGHBOUR = "262,02,2b00,7002,20,0";
+static const char* THIRD_SERVING = "262,03,3c00,9001,50,0";
+
+static uint32_t cidOf(const char* cell) {
+  return (uint32_t)strtoul(strchr(strchr(strchr(cell, ',') + 1, ',') + 1, ',') + 1, nullptr, 16);
+}
+
+// Answers AT with OK and every AT+CENG? with `answers` in turn, the last
+// one repeated, each after `latency`.
+static void script(FakeModem& modem, std::vector<std::string> answers, unsigned long latency) {
+  auto round = std::make_shared<size_t>(0);
+  modem.onCommand([answers, latency, round](const std::string& cmd) {
+    if (cmd == "AT+CENG?") {
+      size_t i = *round < answers.size() ? (*round)++ : answers.size() - 1;
+      return FakeReply{answers[i], latency};
+    }
+    return FakeReply{"\r\nOK\r\n"};
+  });
+}
+
+static void addDataModemAnswer(CellFusion& fusion) {
+  String resp = fakeCengReply({DATA_SERVING, DATA_NEIGHBOUR}).c_str();
+  CellSnapshot snap;
+  bool complete;
+  CellRadio radio;
+  ModemTraits::parseCells(resp.c_str(), resp.length(), snap, complete, radio);
+  fusion.add(snap);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_begin_enables_engineering_mode() {
+  FakeModem serial;
+  script(serial, {fakeCengReply({OTHER_SERVING})}, 0);
+  ScanModem modem("scan1", serial, 16, 17);
+  TEST_ASSERT_TRUE(modem.begin());
+  TEST_ASSERT_TRUE(modem.ready());
+  TEST_ASSERT_EQUAL(9600, serial.baud());
+  TEST_ASSERT_EQUAL(1, serial.count("AT+CENG=3,1"));
+}
+
+void test_silent_modem_is_not_started() {
+  FakeModem serial;
+  ScanModem modem("mute", serial, 16, 17);
+  TEST_ASSERT_FALSE(modem.begin());
+  TEST_ASSERT_FALSE(modem.ready());
+  TEST_ASSERT_FALSE(modem.startScan(3));
+  CellFusion fusion;
+  TEST_ASSERT_FALSE(modem.collect(fusion, 10));
+}
+
+void test_two_modems_scan_in_parallel() {
+  FakeModem serial1, serial2;
+  script(serial1, {fakeCengReply({OTHER_SERVING, OTHER_NEIGHBOUR})}, LATENCY_MS);
+  script(serial2, {fakeCengReply({THIRD_SERVING})}, LATENCY_MS);
+  ScanModem modem1("scan1", serial1, 16, 17);
+  ScanModem modem2("scan2", serial2, 18, 19);
+  TEST_ASSERT_TRUE(modem1.begin());
+  TEST_ASSERT_TRUE(modem2.begin());
+
+  unsigned long start = millis();
+  TEST_ASSERT_TRUE(modem1.startScan(3));
+  TEST_ASSERT_TRUE(modem2.startScan(3));
+  TEST_ASSERT_FALSE(modem1.startScan(3));  // window already running
+
+  CellFusion fusion;
+  addDataModemAnswer(fusion);
+  TEST_ASSERT_TRUE(modem1.collect(fusion, 2000));
+  TEST_ASSERT_TRUE(modem2.collect(fusion, 2000));
+  unsigned long elapsed = millis() - start;
+
+  // One complete answer each ends the window, and the windows overlap.
+  TEST_ASSERT_GREATER_OR_EQUAL(LATENCY_MS, elapsed);
+  TEST_ASSERT_LESS_THAN(LATENCY_MS * 3 / 2, elapsed);
+  TEST_ASSERT_EQUAL(1, serial1.count("AT+CENG?"));
+  TEST_ASSERT_EQUAL(1, serial2.count("AT+CENG?"));
+  TEST_ASSERT_TRUE(modem1.finished());
+
+  // Union of all cells; the data modem's serving cell still leads.
+  CellSnapshot fused;
+  fusion.toSnapshot(fused);
+  TEST_ASSERT_EQUAL(5, fused.count);
+  TEST_ASSERT_EQUAL(cidOf(DATA_SERVING), fused.cells[0].cid);
+  TEST_ASSERT_EQUAL(cidOf(THIRD_SERVING), fused.cells[1].cid);  // strongest neighbour
+}
+
+void test_incomplete_answers_are_kept_until_a_complete_one() {
+  FakeModem serial;
+  script(serial,
+         {fakeCengReply({"", OTHER_NEIGHBOUR}), fakeCengReply({OTHER_SERVING, OTHER_NEIGHBOUR}),
+          fakeCengReply({THIRD_SERVING})},
+         10);
+  ScanModem modem("scan1", serial, 16, 17);
+  TEST_ASSERT_TRUE(modem.begin());
+  TEST_ASSERT_TRUE(modem.startScan(5));
+  CellFusion fusion;
+  TEST_ASSERT_TRUE(modem.collect(fusion, 3000));
+  TEST_ASSERT_EQUAL(2, serial.count("AT+CENG?"));
+  TEST_ASSERT_EQUAL(2, fusion.scans());
+  TEST_ASSERT_EQUAL(2, fusion.count());
+  TEST_ASSERT_EQUAL(-1, fusion.servingIndex());  // no votes from scan modems
+}
+
+void test_slow_modem_is_skipped_then_collected_late() {
+  FakeModem serial;
+  script(serial, {fakeCengReply({OTHER_SERVING})}, 600);
+  ScanModem modem("slow", serial, 16, 17);
+  TEST_ASSERT_TRUE(modem.begin());
+  TEST_ASSERT_TRUE(modem.startScan(1));
+
+  CellFusion fusion;
+  addDataModemAnswer(fusion);
+  unsigned long start = millis();
+  TEST_ASSERT_FALSE(modem.collect(fusion, 200));
+  TEST_ASSERT_LESS_THAN(400, millis() - start);
+  TEST_ASSERT_EQUAL(2, fusion.count());
+  TEST_ASSERT_FALSE(modem.finished());
+  TEST_ASSERT_FALSE(modem.startScan(1));
+
+  // The window still completes and the next fix may take it.
+  TEST_ASSERT_TRUE(modem.collect(fusion, 2000));
+  TEST_ASSERT_EQUAL(3, fusion.count());
+  TEST_ASSERT_TRUE(modem.finished());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_enables_engineering_mode);
+  RUN_TEST(test_silent_modem_is_not_started);
+  RUN_TEST(test_two_modems_scan_in_parallel);
+  RUN_TEST(test_incomplete_answers_are_kept_until_a_complete_one);
+  RUN_TEST(test_slow_modem_is_skipped_then_collected_late);
+  return UNITY_END();
+}
@@ -0,0 +1,109 @@
+/**
+ * @file test_main.cpp
+ * @brief sms_pdu.h: GSM 7-bit packing, segmentation and the TPDU header.
+ */
+#include <unity.h>
+
+#include <string.h>
+
+#include <string>
+
+#include "sms_pdu.h"
+
+static bool encode(const std::string& text, SmsEncoded& out, uint8_t ref = 0x2A) {
+  return smsEncode(text.c_str(), text.size(), ref, out);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_single_segment_packing() {
+  SmsEncoded sms;
+  TEST_ASSERT_TRUE(encode("hello", sms));
+  TEST_ASSERT_EQUAL(1, sms.count);
+  TEST_ASSERT_FALSE(sms.concat);
+  TEST_ASSERT_EQUAL(5, sms.segments[0].udl);
+  TEST_ASSERT_EQUAL(5, sms.segments[0].udOctets);
+  TEST_ASSERT_EQUAL_STRING("E8329BFD06", sms.segments[0].udHex);
+
+  TEST_ASSERT_TRUE(encode("hellohello", sms));
+  TEST_ASSERT_EQUAL_STRING("E8329BFD4697D9EC37", sms.segments[0].udHex);
+}
+
+void test_escapes_and_replacements() {
+  uint8_t s[2];
+  TEST_ASSERT_EQUAL(1, gsm7Septets('@', s));
+  TEST_ASSERT_EQUAL(0x00, s[0]);
+  TEST_ASSERT_EQUAL(2, gsm7Septets('[', s));
+  TEST_ASSERT_EQUAL(0x1B, s[0]);
+  TEST_ASSERT_EQUAL(0x3C, s[1]);
+  TEST_ASSERT_EQUAL(1, gsm7Septets('`', s));
+  TEST_ASSERT_EQUAL('?', s[0]);
+
+  SmsEncoded sms;
+  TEST_ASSERT_TRUE(encode("\xC3\xA9\xE2\x82\xAC", sms));  // one '?' per UTF-8 character
+  TEST_ASSERT_EQUAL(2, sms.segments[0].udl);
+  TEST_ASSERT_TRUE(encode("{}", sms));
+  TEST_ASSERT_EQUAL(4, sms.segments[0].udl);
+}
+
+void test_160_septets_fit_one_sms() {
+  SmsEncoded sms;
+  TEST_ASSERT_TRUE(encode(std::string(160, 'a'), sms));
+  TEST_ASSERT_EQUAL(1, sms.count);
+  TEST_ASSERT_EQUAL(160, sms.segments[0].udl);
+  TEST_ASSERT_EQUAL(SMS_UD_MAX, sms.segments[0].udOctets);
+}
+
+void test_concatenated_segments() {
+  SmsEncoded sms;
+  TEST_ASSERT_TRUE(encode(std::string(161, 'a'), sms, 0x2A));
+  TEST_ASSERT_TRUE(sms.concat);
+  TEST_ASSERT_EQUAL(2, sms.count);
+  TEST_ASSERT_EQUAL(7 + SMS_SEPTETS_CONCAT, sms.segments[0].udl);
+  TEST_ASSERT_EQUAL(SMS_UD_MAX, sms.segments[0].udOctets);
+  TEST_ASSERT_EQUAL_STRING_LEN("0500032A0201", sms.segments[0].udHex, 12);
+  TEST_ASSERT_EQUAL(7 + 8, sms.segments[1].udl);
+  TEST_ASSERT_EQUAL_STRING_LEN("0500032A0202", sms.segments[1].udHex, 12);
+  TEST_ASSERT_EQUAL(2 * sms.segments[1].udOctets, strlen(sms.segments[1].udHex));
+}
+
+void test_escape_never_split_across_segments() {
+  SmsEncoded sms;
+  TEST_ASSERT_TRUE(encode(std::string(152, 'a') + "[" + std::string(10, 'b'), sms));
+  TEST_ASSERT_EQUAL(2, sms.count);
+  TEST_ASSERT_EQUAL(7 + 152, sms.segments[0].udl);
+  TEST_ASSERT_EQUAL(7 + 2 + 10, sms.segments[1].udl);
+}
+
+void test_long_text_is_truncated() {
+  SmsEncoded sms;
+  TEST_ASSERT_FALSE(encode(std::string(SMS_MAX_SEGMENTS * SMS_SEPTETS_CONCAT + 1, 'a'), sms));
+  TEST_ASSERT_TRUE(sms.truncated);
+  TEST_ASSERT_EQUAL(SMS_MAX_SEGMENTS, sms.count);
+}
+
+void test_pdu_header() {
+  SmsEncoded sms;
+  encode("hello", sms);
+  char header[2 * (7 + 12) + 1];
+  size_t octets = smsPduHeader(sms.segments[0], sms.concat, "+491234567890", header);
+  TEST_ASSERT_EQUAL_STRING("0001000C91942143658709000005", header);
+  TEST_ASSERT_EQUAL(13 + 5, octets);
+
+  octets = smsPduHeader(sms.segments[0], true, "12345", header);
+  TEST_ASSERT_EQUAL_STRING("00410005812143F5000005", header);
+  TEST_ASSERT_EQUAL(10 + 5, octets);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_single_segment_packing);
+  RUN_TEST(test_escapes_and_replacements);
+  RUN_TEST(test_160_septets_fit_one_sms);
+  RUN_TEST(test_concatenated_segments);
+  RUN_TEST(test_escape_never_split_across_segments);
+  RUN_TEST(test_long_text_is_truncated);
+  RUN_TEST(test_pdu_header);
+  return UNITY_END();
+}
@@ -0,0 +1,259 @@
+/**
+ * @file ceng_extract.cpp
+ * @brief Extracts +CENG: cell records from raw serial captures.
+ *
+ * Field captures of test/main2.cpp / test/main3.cpp sessions are megabytes
+ * of mixed AT traffic with optional "[hh:mm:ss] [RSP] " prefixes. Each file
+ * is memory-mapped and split at line boundaries into one chunk per thread.
+ * Threads look for '+' with SSE2/AVX2 compares (16 or 32 bytes per step),
+ * check for "+CENG:", find the line end the same way, and parse the line
+ * with the firmware's own parseCengLine(). Per-thread results are written
+ * out in file order, either as CSV or as a columnar binary file.
+ *
+ * Columnar layout (little-endian): "CENGCOL1", row count u64, then one
+ * contiguous array per column in this order:
+ *   source u16, offset u64, time_s i32 (-1 if no prefix), index u8,
+ *   mcc u16, mnc u16, lac u16, cid u32, rxlev u8, ta u8
+ *
+ * Build (host):
+ *   g++ -O3 -march=native -std=c++17 -pthread -Iinclude tools/ceng_extract.cpp -o ceng_extract
+ *
+ * Usage:
+ *   ceng_extract [-j threads] [--columnar] -o out capture.txt...
+ */
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ceng_parser.h"
+#include "mapped_file.h"
+
+// Column buffers for the rows found in one chunk.
+struct Columns {
+  std::vector<uint16_t> source;
+  std::vector<uint64_t> offset;
+  std::vector<int32_t> time;
+  std::vector<uint8_t> index;
+  std::vector<uint16_t> mcc, mnc, lac;
+  std::vector<uint32_t> cid;
+  std::vector<uint8_t> rxlev, ta;
+
+  size_t size() const { return offset.size(); }
+};
+
+// First occurrence of `c` in [p, end), or end.
+static const char* findByte(const char* p, const char* end, char c) {
+#if defined(__AVX2__)
+  const __m256i needle = _mm256_set1_epi8(c);
+  for (; p + 32 <= end; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#elif defined(__SSE2__)
+  const __m128i needle = _mm_set1_epi8(c);
+  for (; p + 16 <= end; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+#endif
+  for (; p < end; ++p) {
+    if (*p == c) return p;
+  }
+  return end;
+}
+
+// Parses a "[hh:mm:ss]" prefix at the start of the line, or returns -1.
+static int32_t lineTime(const char* lineStart, const char* plus) {
+  const char* p = lineStart;
+  while (p < plus && (*p == '\r' || *p == ' ')) ++p;
+  if (plus - p < 10 || p[0] != '[' || p[3] != ':' || p[6] != ':' || p[9] != ']') return -1;
+  auto two = [](const char* d) { return (d[0] - '0') * 10 + (d[1] - '0'); };
+  for (int i : {1, 2, 4, 5, 7, 8}) {
+    if (p[i] < '0' || p[i] > '9') return -1;
+  }
+  return two(p + 1) * 3600 + two(p + 4) * 60 + two(p + 7);
+}
+
+static void scanChunk(const char* base, const char* begin, const char* end, const char* fileEnd,
+                      uint16_t source, Columns& out) {
+  const char* lineStart = begin;
+  const char* p = begin;
+  while (p < end) {
+    const char* plus = findByte(p, end, '+');
+    if (plus == end) break;
+    // Track the start of the line the candidate is on.
+    const char* nl = plus;
+    while (nl > lineStart && nl[-1] != '\n') --nl;
+    lineStart = nl;
+
+    if (fileEnd - plus < 6 || memcmp(plus, "+CENG:", 6) != 0) {
+      p = plus + 1;
+      continue;
+    }
+    const char* eol = findByte(plus, fileEnd, '\n');
+    int index = 0;
+    CellRecord rec;
+    if (parseCengLine(plus, eol, index, rec) == CENG_OK) {
+      out.source.push_back(source);
+      out.offset.push_back(uint64_t(plus - base));
+      out.time.push_back(lineTime(lineStart, plus));
+      out.index.push_back(uint8_t(index));
+      out.mcc.push_back(rec.mcc);
+      out.mnc.push_back(rec.mnc);
+      out.lac.push_back(rec.lac);
+      out.cid.push_back(rec.cid);
+      out.rxlev.push_back(rec.rxlev);
+      out.ta.push_back(rec.ta);
+    }
+    p = eol;
+    lineStart = eol + 1;
+  }
+}
+
+static void formatCsv(const Columns& c, std::string& out) {
+  char line[160];
+  for (size_t i = 0; i < c.size(); ++i) {
+    int n = snprintf(line, sizeof(line), "%u,%llu,%d,%u,%u,%u,%u,%u,%u,%d,%d\n", c.source[i],
+                     (unsigned long long)c.offset[i], c.time[i], c.index[i], c.mcc[i], c.mnc[i],
+                     c.lac[i], c.cid[i], c.rxlev[i], rxlevToDbm(c.rxlev[i]),
+                     c.ta[i] == CELL_TA_UNKNOWN ? -1 : int(c.ta[i]));
+    out.append(line, size_t(n));
+  }
+}
+
+// Appends `v` little-endian, whatever the host's byte order.
+template <typename T>
+static void putLe(std::vector<uint8_t>& out, T v) {
+  typedef typename std::make_unsigned<T>::type U;
+  const U u = U(v);
+  for (size_t i = 0; i < sizeof(T); ++i) out.push_back(uint8_t(u >> (8 * i)));
+}
+
+template <typename T>
+static void writeColumn(FILE* fp, const std::vector<Columns>& parts, std::vector<T> Columns::*col) {
+  std::vector<uint8_t> bytes;
+  for (const Columns& part : parts) {
+    const std::vector<T>& v = part.*col;
+    if (v.empty()) continue;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // The host's layout already is the file's
+    fwrite(v.data(), sizeof(T), v.size(), fp);
+#else
+    bytes.clear();
+    bytes.reserve(v.size() * sizeof(T));
+    for (T x : v) putLe(bytes, x);
+    fwrite(bytes.data(), 1, bytes.size(), fp);
+#endif
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  bool columnar = false;
+  const char* outPath = nullptr;
+  std::vector<const char*> inputs;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+      threads = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      outPath = argv[++i];
+    } else if (!strcmp(argv[i], "--columnar")) {
+      columnar = true;
+    } else {
+      inputs.push_back(argv[i]);
+    }
+  }
+  if (!outPath || inputs.empty()) {
+    fprintf(stderr, "usage: %s [-j threads] [--columnar] -o out capture.txt...\n", argv[0]);
+    return 2;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Columns> parts;  // in file and chunk order
+  uint64_t bytes = 0;
+  for (size_t f = 0; f < inputs.size(); ++f) {
+    MappedFile file;
+    if (!file.open(inputs[f])) {
+      fprintf(stderr, "cannot map %s\n", inputs[f]);
+      return 1;
+    }
+    const char* base = reinterpret_cast<const char*>(file.data());
+    const char* fileEnd = base + file.size();
+    bytes += file.size();
+
+    // Chunk boundaries on line starts, so each line belongs to one chunk.
+    unsigned n = unsigned(std::min<size_t>(threads, std::max<size_t>(1, file.size() / 65536)));
+    std::vector<const char*> cuts(n + 1, fileEnd);
+    cuts[0] = base;
+    for (unsigned i = 1; i < n; ++i) {
+      const char* c = base + file.size() / n * i;
+      c = findByte(std::max(c, cuts[i - 1]), fileEnd, '\n');
+      cuts[i] = c < fileEnd ? c + 1 : fileEnd;
+    }
+
+    size_t first = parts.size();
+    parts.resize(first + n);
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < n; ++i) {
+      pool.emplace_back([&, i] {
+        scanChunk(base, cuts[i], cuts[i + 1], fileEnd, uint16_t(f), parts[first + i]);
+      });
+    }
+    for (std::thread& t : pool) t.join();
+  }
+
+  uint64_t rows = 0;
+  for (const Columns& c : parts) rows += c.size();
+
+  FILE* fp = fopen(outPath, "wb");
+  if (!fp) {
+    perror(outPath);
+    return 1;
+  }
+  if (columnar) {
+    std::vector<uint8_t> header(reinterpret_cast<const uint8_t*>("CENGCOL1"),
+                                reinterpret_cast<const uint8_t*>("CENGCOL1") + 8);
+    putLe(header, rows);
+    fwrite(header.data(), 1, header.size(), fp);
+    writeColumn(fp, parts, &Columns::source);
+    writeColumn(fp, parts, &Columns::offset);
+    writeColumn(fp, parts, &Columns::time);
+    writeColumn(fp, parts, &Columns::index);
+    writeColumn(fp, parts, &Columns::mcc);
+    writeColumn(fp, parts, &Columns::mnc);
+    writeColumn(fp, parts, &Columns::lac);
+    writeColumn(fp, parts, &Columns::cid);
+    writeColumn(fp, parts, &Columns::rxlev);
+    writeColumn(fp, parts, &Columns::ta);
+  } else {
+    // Format in parallel, write in order.
+    std::vector<std::string> text(parts.size());
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+      pool.emplace_back([&, t] {
+        for (size_t i = t; i < parts.size(); i += threads) formatCsv(parts[i], text[i]);
+      });
+    }
+    for (std::thread& th : pool) th.join();
+    fputs("source,offset,time_s,index,mcc,mnc,lac,cid,rxlev,dbm,ta\n", fp);
+    for (const std::string& s : text) fwrite(s.data(), 1, s.size(), fp);
+  }
+  fclose(fp);
+
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "%zu file(s), %.1f MB, %llu cell rows in %.3f s (%.0f MB/s)\n", inputs.size(),
+          bytes / 1e6, (unsigned long long)rows, secs, bytes / 1e6 / std::max(secs, 1e-9));
+  return 0;
+}
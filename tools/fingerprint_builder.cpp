@@ -0,0 +1,186 @@
+/**
+ * @file fingerprint_builder.cpp
+ * @brief Builds the fingerprint_db.h index from survey logs with positions.
+ *
+ * Positioned survey records are binned on a square grid (25 m by default).
+ * Each occupied bin becomes one fingerprint: the mean observer position and
+ * the mean RxLev of every cell heard in at least a quarter of the bin's
+ * scans, strongest first, capped at FINGERPRINT_MAX_QUERY cells. The cell
+ * table, posting lists and signatures are then written in the on-flash
+ * layout.
+ *
+ * Build (host):
+ *   g++ -O2 -std=c++17 -Iinclude tools/fingerprint_builder.cpp -o fingerprint_builder
+ *
+ * Usage:
+ *   fingerprint_builder [--grid metres] -o fingerprints.bin segment.log...
+ *   esptool.py write_flash 0x380000 fingerprints.bin   # "fprint" partition
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "fingerprint_db.h"
+#include "mapped_file.h"
+#include "survey_format.h"
+
+static const double METRES_PER_DEGREE = 111195.0;
+static const double MIN_CELL_PRESENCE = 0.25;
+
+struct Bin {
+  double lat = 0, lng = 0;
+  uint32_t scans = 0;
+  std::map<uint64_t, std::pair<uint32_t, uint32_t>> cells;  // key -> (rxlev sum, count)
+};
+
+struct Print {
+  int32_t lat7, lng7;
+  std::vector<std::pair<uint64_t, uint8_t>> cells;  // key, mean rxlev
+};
+
+static void usage(const char* argv0) {
+  fprintf(stderr, "usage: %s [--grid metres] -o fingerprints.bin segment.log...\n", argv0);
+}
+
+int main(int argc, char** argv) {
+  double grid = 25.0;
+  const char* outPath = nullptr;
+  std::vector<const char*> inputs;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--grid") && i + 1 < argc) {
+      grid = std::max(1.0, atof(argv[++i]));
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      outPath = argv[++i];
+    } else {
+      inputs.push_back(argv[i]);
+    }
+  }
+  if (!outPath || inputs.empty()) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // Bin positioned scans. Longitude is scaled at the first record's latitude.
+  std::unordered_map<uint64_t, Bin> bins;
+  double cosRef = 0;
+  uint64_t scans = 0;
+  for (const char* path : inputs) {
+    MappedFile file;
+    uint32_t segment;
+    if (!file.open(path) || !decodeSurveyHeader(file.data(), file.size(), segment)) {
+      fprintf(stderr, "skipping %s: not a survey segment\n", path);
+      continue;
+    }
+    const uint8_t* p = file.data() + SURVEY_HEADER_SIZE;
+    const uint8_t* end = file.data() + file.size();
+    SurveyCodecState st;
+    SurveyRecord rec;
+    while (decodeSurveyRecord(st, p, end, rec)) {
+      if (!rec.position.valid || rec.snapshot.count == 0) continue;
+      if (cosRef == 0) cosRef = std::cos(rec.position.lat * M_PI / 180.0);
+      int64_t gx = int64_t(std::floor(rec.position.lng * METRES_PER_DEGREE * cosRef / grid));
+      int64_t gy = int64_t(std::floor(rec.position.lat * METRES_PER_DEGREE / grid));
+      Bin& b = bins[(uint64_t(gx) << 32) ^ uint64_t(uint32_t(gy))];
+      b.lat += rec.position.lat;
+      b.lng += rec.position.lng;
+      b.scans++;
+      for (uint8_t i = 0; i < rec.snapshot.count; ++i) {
+        auto& c = b.cells[cellKey(rec.snapshot.cells[i])];
+        c.first += rec.snapshot.cells[i].rxlev;
+        c.second++;
+      }
+      scans++;
+    }
+  }
+
+  // One fingerprint per bin.
+  std::vector<Print> prints;
+  prints.reserve(bins.size());
+  for (const auto& kv : bins) {
+    const Bin& b = kv.second;
+    Print fp;
+    fp.lat7 = int32_t(std::lround(b.lat / b.scans * 1e7));
+    fp.lng7 = int32_t(std::lround(b.lng / b.scans * 1e7));
+    for (const auto& c : b.cells) {
+      if (c.second.second < MIN_CELL_PRESENCE * b.scans) continue;
+      fp.cells.push_back({c.first, uint8_t((c.second.first + c.second.second / 2) / c.second.second)});
+    }
+    std::sort(fp.cells.begin(), fp.cells.end(),
+              [](const std::pair<uint64_t, uint8_t>& a, const std::pair<uint64_t, uint8_t>& c) {
+                return a.second > c.second;
+              });
+    if (fp.cells.size() > FINGERPRINT_MAX_QUERY) fp.cells.resize(FINGERPRINT_MAX_QUERY);
+    if (!fp.cells.empty()) prints.push_back(std::move(fp));
+  }
+  // Deterministic output: order fingerprints by position.
+  std::sort(prints.begin(), prints.end(), [](const Print& a, const Print& b) {
+    return a.lat7 != b.lat7 ? a.lat7 < b.lat7 : a.lng7 < b.lng7;
+  });
+
+  // Cell table and posting lists.
+  std::map<uint64_t, std::vector<uint32_t>> postings;
+  for (uint32_t i = 0; i < prints.size(); ++i) {
+    for (const auto& c : prints[i].cells) postings[c.first].push_back(i);
+  }
+  std::unordered_map<uint64_t, uint32_t> cellIndex;
+  std::vector<uint8_t> cellBytes, postingBytes;
+  uint32_t postingCount = 0;
+  for (const auto& kv : postings) {
+    uint8_t rec[FINGERPRINT_CELL_SIZE];
+    for (int i = 0; i < 8; ++i) rec[i] = uint8_t(kv.first >> (8 * i));
+    fpPutLe32(rec + 8, postingCount);
+    cellBytes.insert(cellBytes.end(), rec, rec + sizeof(rec));
+    cellIndex[kv.first] = uint32_t(cellIndex.size());
+    for (uint32_t fp : kv.second) {
+      uint8_t v[4];
+      fpPutLe32(v, fp);
+      postingBytes.insert(postingBytes.end(), v, v + 4);
+    }
+    postingCount += uint32_t(kv.second.size());
+  }
+
+  // Signatures, sorted by cell index.
+  std::vector<uint8_t> printBytes, entryBytes;
+  uint32_t entryCount = 0;
+  for (const Print& fp : prints) {
+    uint8_t rec[FINGERPRINT_PRINT_SIZE];
+    fpPutLe32(rec, uint32_t(fp.lat7));
+    fpPutLe32(rec + 4, uint32_t(fp.lng7));
+    fpPutLe32(rec + 8, entryCount);
+    printBytes.insert(printBytes.end(), rec, rec + sizeof(rec));
+    std::vector<uint32_t> entries;
+    for (const auto& c : fp.cells) entries.push_back((cellIndex[c.first] << 8) | c.second);
+    std::sort(entries.begin(), entries.end());
+    for (uint32_t e : entries) {
+      uint8_t v[4];
+      fpPutLe32(v, e);
+      entryBytes.insert(entryBytes.end(), v, v + 4);
+    }
+    entryCount += uint32_t(entries.size());
+  }
+
+  FILE* fp = fopen(outPath, "wb");
+  if (!fp) {
+    perror(outPath);
+    return 1;
+  }
+  uint8_t header[FINGERPRINT_HEADER_SIZE];
+  encodeFingerprintHeader(header, uint32_t(postings.size()), uint32_t(prints.size()), postingCount,
+                          entryCount);
+  fwrite(header, 1, sizeof(header), fp);
+  fwrite(cellBytes.data(), 1, cellBytes.size(), fp);
+  fwrite(postingBytes.data(), 1, postingBytes.size(), fp);
+  fwrite(printBytes.data(), 1, printBytes.size(), fp);
+  fwrite(entryBytes.data(), 1, entryBytes.size(), fp);
+  long size = ftell(fp);
+  fclose(fp);
+
+  fprintf(stderr, "%llu scans -> %zu fingerprints, %zu cells, %ld bytes\n",
+          (unsigned long long)scans, prints.size(), postings.size(), size);
+  return 0;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file geofence_builder.cpp
+ * @brief Builds the geofence.h zone file from a text list of zones.
+ *
+ * Input, one zone per line ('#' starts a comment):
+ *
+ *   circle  <id> <name> <lat> <lng> <radius_m>
+ *   polygon <id> <name> <lat>,<lng> <lat>,<lng> <lat>,<lng> ...
+ *
+ * Names are truncated to 16 characters. Coordinates are projected to metres
+ * around the south-west corner of all zones, and every zone is listed in
+ * each grid cell its bounding box touches. The grid is capped at 64 x 64
+ * cells; the cell size grows to fit larger areas.
+ *
+ * Build (host):
+ *   g++ -O2 -std=c++17 -Iinclude tools/geofence_builder.cpp -o geofence_builder
+ *
+ * Usage:
+ *   geofence_builder [--cell metres] -o data/geofences.bin zones.txt
+ *   pio run -t uploadfs   # the firmware loads /geofences.bin from LittleFS
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "geofence.h"
+
+static const uint32_t MAX_GRID = 64;  // the firmware keeps the file in RAM
+
+struct Zone {
+  uint16_t id = 0;
+  uint8_t type = GEOFENCE_CIRCLE;
+  std::string name;
+  std::vector<std::pair<double, double>> points;  // lat, lng
+  double radius = 0;
+  double minX = 0, minY = 0, maxX = 0, maxY = 0;  // local bounds
+};
+
+static void put16(std::vector<uint8_t>& out, uint16_t v) {
+  out.push_back(uint8_t(v));
+  out.push_back(uint8_t(v >> 8));
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) out.push_back(uint8_t(v >> (8 * i)));
+}
+
+static bool parseZones(const char* path, std::vector<Zone>& zones) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string line;
+  for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream ls(line);
+    std::string kind;
+    if (!(ls >> kind)) continue;
+    Zone z;
+    unsigned id;
+    if (!(ls >> id >> z.name)) {
+      fprintf(stderr, "%s:%d: expected id and name\n", path, lineNo);
+      return false;
+    }
+    z.id = uint16_t(id);
+    if (kind == "circle") {
+      double lat, lng;
+      if (!(ls >> lat >> lng >> z.radius) || z.radius <= 0) {
+        fprintf(stderr, "%s:%d: expected lat lng radius\n", path, lineNo);
+        return false;
+      }
+      z.type = GEOFENCE_CIRCLE;
+      z.points.push_back({lat, lng});
+    } else if (kind == "polygon") {
+      z.type = GEOFENCE_POLYGON;
+      std::string pt;
+      while (ls >> pt) {
+        double lat, lng;
+        if (sscanf(pt.c_str(), "%lf,%lf", &lat, &lng) != 2) {
+          fprintf(stderr, "%s:%d: bad vertex '%s'\n", path, lineNo, pt.c_str());
+          return false;
+        }
+        z.points.push_back({lat, lng});
+      }
+      if (z.points.size() < 3 || z.points.size() > 65535) {
+        fprintf(stderr, "%s:%d: a polygon needs 3..65535 vertices\n", path, lineNo);
+        return false;
+      }
+    } else {
+      fprintf(stderr, "%s:%d: unknown zone type '%s'\n", path, lineNo, kind.c_str());
+      return false;
+    }
+    zones.push_back(z);
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  double cell = 500;
+  const char* outPath = nullptr;
+  const char* inPath = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--cell") && i + 1 < argc) {
+      cell = std::max(10.0, atof(argv[++i]));
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      outPath = argv[++i];
+    } else {
+      inPath = argv[i];
+    }
+  }
+  if (!outPath || !inPath) {
+    fprintf(stderr, "usage: %s [--cell metres] -o geofences.bin zones.txt\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<Zone> zones;
+  if (!parseZones(inPath, zones)) return 1;
+  if (zones.empty() || zones.size() > GEOFENCE_MAX_ZONES) {
+    fprintf(stderr, "need 1..%u zones\n", unsigned(GEOFENCE_MAX_ZONES));
+    return 1;
+  }
+
+  // Origin: south-west corner, including circle radii.
+  double minLat = 90, minLng = 180;
+  for (const Zone& z : zones) {
+    for (const auto& p : z.points) {
+      const double dLat = z.radius / GEOFENCE_METRES_PER_DEGREE;
+      const double dLng = dLat / std::cos(p.first * M_PI / 180.0);
+      minLat = std::min(minLat, p.first - dLat);
+      minLng = std::min(minLng, p.second - dLng);
+    }
+  }
+  const int32_t originLat7 = int32_t(std::floor(minLat * 1e7));
+  const int32_t originLng7 = int32_t(std::floor(minLng * 1e7));
+  const double originLat = originLat7 * 1e-7, originLng = originLng7 * 1e-7;
+  const double cosOrigin = std::cos(originLat * M_PI / 180.0);
+
+  // Project vertices (rounded to the metre) and compute bounds.
+  std::vector<std::pair<int32_t, int32_t>> vertices;
+  double maxX = 0, maxY = 0;
+  std::vector<uint32_t> firstVertex;
+  for (Zone& z : zones) {
+    firstVertex.push_back(uint32_t(vertices.size()));
+    z.minX = z.minY = INFINITY;
+    z.maxX = z.maxY = -INFINITY;
+    for (const auto& p : z.points) {
+      int32_t x = int32_t(std::lround((p.second - originLng) * GEOFENCE_METRES_PER_DEGREE * cosOrigin));
+      int32_t y = int32_t(std::lround((p.first - originLat) * GEOFENCE_METRES_PER_DEGREE));
+      vertices.push_back({x, y});
+      z.minX = std::min(z.minX, x - z.radius);
+      z.minY = std::min(z.minY, y - z.radius);
+      z.maxX = std::max(z.maxX, x + z.radius);
+      z.maxY = std::max(z.maxY, y + z.radius);
+    }
+    maxX = std::max(maxX, z.maxX);
+    maxY = std::max(maxY, z.maxY);
+  }
+
+  cell = std::max(cell, std::ceil(std::max(maxX, maxY) / MAX_GRID));
+  const uint32_t cols = std::max<uint32_t>(1, uint32_t(std::ceil(maxX / cell)));
+  const uint32_t rows = std::max<uint32_t>(1, uint32_t(std::ceil(maxY / cell)));
+
+  std::vector<std::vector<uint16_t>> grid(size_t(cols) * rows);
+  for (uint16_t i = 0; i < zones.size(); ++i) {
+    const Zone& z = zones[i];
+    auto clampCell = [](double v, double size, uint32_t n) {
+      long c = long(std::floor(v / size));
+      return uint32_t(std::min<long>(std::max<long>(c, 0), long(n) - 1));
+    };
+    for (uint32_t r = clampCell(z.minY, cell, rows); r <= clampCell(z.maxY, cell, rows); ++r) {
+      for (uint32_t c = clampCell(z.minX, cell, cols); c <= clampCell(z.maxX, cell, cols); ++c) {
+        grid[size_t(r) * cols + c].push_back(i);
+      }
+    }
+  }
+
+  std::vector<uint8_t> out;
+  out.insert(out.end(), GEOFENCE_MAGIC, GEOFENCE_MAGIC + 4);
+  out.push_back(GEOFENCE_VERSION);
+  out.resize(8, 0);
+  put16(out, uint16_t(zones.size()));
+  put16(out, uint16_t(cols));
+  put16(out, uint16_t(rows));
+  put16(out, 0);
+  put32(out, uint32_t(originLat7));
+  put32(out, uint32_t(originLng7));
+  put32(out, uint32_t(cell));
+  put32(out, uint32_t(vertices.size()));
+
+  for (size_t i = 0; i < zones.size(); ++i) {
+    const Zone& z = zones[i];
+    put16(out, z.id);
+    out.push_back(z.type);
+    out.push_back(0);
+    put32(out, firstVertex[i]);
+    put16(out, uint16_t(z.points.size()));
+    put16(out, 0);
+    put32(out, uint32_t(std::lround(z.radius)));
+    char name[GEOFENCE_NAME_LEN] = {0};
+    memcpy(name, z.name.data(), std::min(z.name.size(), GEOFENCE_NAME_LEN));
+    out.insert(out.end(), name, name + GEOFENCE_NAME_LEN);
+  }
+
+  uint32_t postings = 0;
+  for (const auto& g : grid) {
+    put32(out, postings);
+    postings += uint32_t(g.size());
+  }
+  put32(out, postings);
+  for (const auto& g : grid) {
+    for (uint16_t z : g) put16(out, z);
+  }
+  for (const auto& v : vertices) {
+    put32(out, uint32_t(v.first));
+    put32(out, uint32_t(v.second));
+  }
+
+  FILE* fp = fopen(outPath, "wb");
+  if (!fp) {
+    perror(outPath);
+    return 1;
+  }
+  fwrite(out.data(), 1, out.size(), fp);
+  fclose(fp);
+  fprintf(stderr, "%zu zones, %ux%u grid of %.0f m, %u postings, %zu bytes\n", zones.size(), cols,
+          rows, cell, postings, out.size());
+  return 0;
+}
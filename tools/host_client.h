@@ -0,0 +1,264 @@
+#pragma once
+// Host end of the binary protocol (include/host_frame.h) over a serial port
+// (POSIX termios), shared by the host tools. One HostClient per device; the
+// client is not thread-safe, use one thread per device.
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "host_frame.h"
+
+class HostClient {
+public:
+  HostClient() {}
+  HostClient(const HostClient&) = delete;
+  HostClient& operator=(const HostClient&) = delete;
+  ~HostClient() { close(); }
+
+  // Opens `path` raw at `baud` (8N1, no flow control).
+  bool open(const char* path, int baud = 115200) {
+    close();
+    speed_t speed;
+    if (!speedFor(baud, speed)) return false;
+    _fd = ::open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (_fd < 0) return false;
+    termios tio;
+    if (tcgetattr(_fd, &tio) != 0) {
+      close();
+      return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~CRTSCTS;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(_fd, TCSANOW, &tio) != 0) {
+      close();
+      return false;
+    }
+    tcflush(_fd, TCIOFLUSH);
+    _rx.clear();
+    _inPos = _inLen = 0;
+    return true;
+  }
+
+  void close() {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+  }
+
+  /**
+   * @brief Sends one request and waits for its response, retrying on timeout.
+   * @return false if no valid response arrived; `status` holds the device's verdict
+   */
+  bool call(uint8_t command, const uint8_t* payload, size_t len, std::vector<uint8_t>& response,
+            uint8_t& status, int timeoutMs = 1000, int attempts = 3) {
+    for (int a = 0; a < attempts; ++a) {
+      const uint16_t id = _nextId++;
+      if (!send(command, id, payload, len)) return false;
+      HostFrame frame;
+      auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+      while (receive(frame, deadline)) {
+        if (frame.id != id || frame.command != (command | HOST_RESPONSE)) continue;
+        status = frame.status;
+        response.assign(frame.payload, frame.payload + frame.length);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ping(uint8_t& version, uint32_t& uptime) {
+    std::vector<uint8_t> r;
+    uint8_t status;
+    if (!call(HOST_CMD_PING, nullptr, 0, r, status) || status != HOST_STATUS_OK || r.size() < 5) {
+      return false;
+    }
+    version = r[0];
+    uptime = hostGetLe32(&r[1]);
+    return true;
+  }
+
+  bool segments(uint32_t& first, uint32_t& current) {
+    std::vector<uint8_t> r;
+    uint8_t status;
+    if (!call(HOST_CMD_SEGMENTS, nullptr, 0, r, status) || status != HOST_STATUS_OK ||
+        r.size() < 8) {
+      return false;
+    }
+    first = hostGetLe32(&r[0]);
+    current = hostGetLe32(&r[4]);
+    return true;
+  }
+
+  // The u32 counters of HOST_CMD_STATS, in protocol order.
+  bool stats(std::vector<uint32_t>& values) {
+    std::vector<uint8_t> r;
+    uint8_t status;
+    if (!call(HOST_CMD_STATS, nullptr, 0, r, status) || status != HOST_STATUS_OK) return false;
+    values.clear();
+    for (size_t i = 0; i + 4 <= r.size(); i += 4) values.push_back(hostGetLe32(&r[i]));
+    return true;
+  }
+
+  bool trace(std::string& text) {
+    std::vector<uint8_t> r;
+    uint8_t status;
+    if (!call(HOST_CMD_TRACE, nullptr, 0, r, status) || status != HOST_STATUS_OK) return false;
+    text.assign(r.begin(), r.end());
+    return true;
+  }
+
+  /**
+   * @brief Reads a whole survey segment, keeping `window` chunk requests in
+   *        flight so the device never waits for the host between chunks.
+   *
+   * The size is taken from the first chunk; bytes the device appends to the
+   * current segment later are not read.
+   */
+  bool readSegment(uint32_t segment, std::vector<uint8_t>& data, size_t window = 4,
+                   int timeoutMs = 2000) {
+    static const size_t CHUNK = HOST_FRAME_MAX_PAYLOAD - HOST_READ_HEADER;
+    std::vector<uint8_t> r;
+    uint8_t status;
+    uint8_t req[10];
+    encodeRead(req, segment, 0, CHUNK);
+    if (!call(HOST_CMD_READ, req, sizeof(req), r, status) || status != HOST_STATUS_OK ||
+        r.size() < HOST_READ_HEADER) {
+      return false;
+    }
+    const uint32_t size = hostGetLe32(&r[0]);
+    data.assign(r.begin() + HOST_READ_HEADER, r.end());
+    if (data.size() >= size) {
+      data.resize(size);
+      return true;
+    }
+    data.resize(size);
+
+    std::map<uint16_t, uint32_t> inFlight;  // id -> offset
+    std::vector<uint32_t> todo;             // offsets to (re)request, next one last
+    for (uint32_t off = uint32_t(r.size() - HOST_READ_HEADER); off < size; off += CHUNK) {
+      todo.push_back(off);
+    }
+    std::reverse(todo.begin(), todo.end());
+    int timeouts = 0;
+    while (!todo.empty() || !inFlight.empty()) {
+      while (inFlight.size() < window && !todo.empty()) {
+        const uint32_t off = todo.back();
+        todo.pop_back();
+        const uint16_t id = _nextId++;
+        encodeRead(req, segment, off, CHUNK);
+        if (!send(HOST_CMD_READ, id, req, sizeof(req))) return false;
+        inFlight[id] = off;
+      }
+      HostFrame frame;
+      if (!receive(frame, Clock::now() + std::chrono::milliseconds(timeoutMs))) {
+        // Lost request or response: ask again for everything outstanding
+        if (++timeouts > 3) return false;
+        for (auto& f : inFlight) todo.push_back(f.second);
+        inFlight.clear();
+        continue;
+      }
+      auto it = inFlight.find(frame.id);
+      if (it == inFlight.end() || frame.command != (HOST_CMD_READ | HOST_RESPONSE)) continue;
+      timeouts = 0;  // only consecutive timeouts give up
+      const uint32_t off = it->second;
+      inFlight.erase(it);
+      if (frame.status != HOST_STATUS_OK || frame.length < HOST_READ_HEADER) return false;
+      size_t n = frame.length - HOST_READ_HEADER;
+      if (n > size - off) n = size - off;
+      if (n == 0) return false;  // the segment shrank: deleted meanwhile
+      memcpy(&data[off], frame.payload + HOST_READ_HEADER, n);
+      // A short chunk: request its rest
+      const uint32_t end = off + CHUNK < size ? off + CHUNK : size;
+      if (off + n < end) todo.push_back(off + uint32_t(n));
+    }
+    return true;
+  }
+
+  unsigned long badFrames() const { return _badFrames; }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  static bool speedFor(int baud, speed_t& speed) {
+    static const struct { int baud; speed_t speed; } SPEEDS[] = {
+      {9600, B9600},     {19200, B19200},   {38400, B38400},   {57600, B57600},
+      {115200, B115200}, {230400, B230400}, {460800, B460800}, {921600, B921600},
+    };
+    for (const auto& s : SPEEDS) {
+      if (s.baud == baud) {
+        speed = s.speed;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void encodeRead(uint8_t* req, uint32_t segment, uint32_t offset, size_t length) {
+    hostPutLe32(req, segment);
+    hostPutLe32(req + 4, offset);
+    hostPutLe16(req + 8, uint16_t(length));
+  }
+
+  bool send(uint8_t command, uint16_t id, const uint8_t* payload, size_t len) {
+    uint8_t wire[HOST_WIRE_MAX];
+    size_t n = hostEncodeFrame(command, 0, id, payload, len, wire);
+    size_t done = 0;
+    while (done < n) {
+      ssize_t w = ::write(_fd, wire + done, n - done);
+      if (w < 0) return false;
+      done += size_t(w);
+    }
+    return true;
+  }
+
+  // Next valid response frame before `deadline`; console text and broken
+  // frames between delimiters are skipped.
+  bool receive(HostFrame& frame, Clock::time_point deadline) {
+    for (;;) {
+      while (_inPos < _inLen) {
+        const uint8_t c = _in[_inPos++];
+        if (c != 0) {
+          if (_rx.size() < HOST_WIRE_MAX) _rx.push_back(c);
+          continue;
+        }
+        if (_rx.empty()) continue;
+        const bool ok = hostDecodeFrame(_rx.data(), _rx.size(), _decoded, frame) &&
+                        (frame.command & HOST_RESPONSE);
+        if (!ok) _badFrames++;
+        _rx.clear();
+        if (ok) return true;
+      }
+      const auto left =
+          std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+      if (left <= 0) return false;
+      pollfd p = {_fd, POLLIN, 0};
+      if (::poll(&p, 1, int(left)) <= 0) continue;
+      ssize_t n = ::read(_fd, _in, sizeof(_in));
+      if (n <= 0) return false;
+      _inPos = 0;
+      _inLen = size_t(n);
+    }
+  }
+
+  int _fd = -1;
+  uint16_t _nextId = 1;
+  std::vector<uint8_t> _rx;          // bytes since the last delimiter
+  uint8_t _decoded[HOST_FRAME_MAX];  // payload of the last frame
+  uint8_t _in[4096];
+  size_t _inPos = 0;
+  size_t _inLen = 0;
+  unsigned long _badFrames = 0;
+};
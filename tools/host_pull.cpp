@@ -0,0 +1,177 @@
+/**
+ * @file host_pull.cpp
+ * @brief Pulls survey logs, stats and the console trace from devices over USB.
+ *
+ * Talks the binary host protocol (include/host_frame.h) to any number of
+ * devices at once, one thread per serial port. Each device's survey
+ * segments are written as <out>/<port>/<segment>.log, the same names as on
+ * the device (SurveyLog::segmentPath), ready for fingerprint_builder.
+ * Closed segments never change, so those already pulled are skipped; the
+ * current one, which is still growing, is always read.
+ *
+ * Build (host):
+ *   g++ -O2 -std=c++17 -pthread -Iinclude -Itools tools/host_pull.cpp -o host_pull
+ *
+ * Usage:
+ *   host_pull [-b baud] [-o dir] [--trace] /dev/ttyUSB0 [/dev/ttyUSB1 ...]
+ */
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host_client.h"
+
+static std::mutex printLock;
+
+struct DeviceResult {
+  bool ok = false;
+  uint32_t segments = 0;
+  uint32_t skipped = 0;
+  size_t bytes = 0;
+  double seconds = 0;
+};
+
+static std::string baseName(const std::string& path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static long fileSize(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? long(st.st_size) : -1;
+}
+
+static void report(const std::string& port, const char* fmt, const std::string& arg = "") {
+  std::lock_guard<std::mutex> guard(printLock);
+  fprintf(stderr, "%s: ", port.c_str());
+  fprintf(stderr, fmt, arg.c_str());
+  fputc('\n', stderr);
+}
+
+static void pullDevice(const std::string& port, int baud, const std::string& outDir, bool trace,
+                       DeviceResult& result) {
+  auto t0 = std::chrono::steady_clock::now();
+  HostClient client;
+  if (!client.open(port.c_str(), baud)) {
+    report(port, "cannot open");
+    return;
+  }
+  uint8_t version;
+  uint32_t uptime;
+  if (!client.ping(version, uptime)) {
+    report(port, "no answer");
+    return;
+  }
+  if (version != HOST_PROTOCOL_VERSION) {
+    report(port, "protocol version %s not supported", std::to_string(version));
+    return;
+  }
+
+  std::vector<uint32_t> stats;
+  if (client.stats(stats) && stats.size() >= 6) {
+    std::lock_guard<std::mutex> guard(printLock);
+    fprintf(stderr,
+            "%s: up %us, %u records, %u bytes on flash, %u segments deleted, %u write errors, "
+            "%u log bytes dropped\n",
+            port.c_str(), uptime, stats[0], stats[4], stats[2], stats[3], stats[5]);
+  }
+
+  const std::string dir = outDir + "/" + baseName(port);
+  mkdir(outDir.c_str(), 0755);
+  mkdir(dir.c_str(), 0755);
+
+  if (trace) {
+    std::string text;
+    if (client.trace(text)) {
+      FILE* f = fopen((dir + "/trace.txt").c_str(), "wb");
+      if (f) {
+        fwrite(text.data(), 1, text.size(), f);
+        fclose(f);
+      }
+    }
+  }
+
+  uint32_t first, current;
+  if (!client.segments(first, current)) {
+    report(port, "cannot list segments");
+    return;
+  }
+  std::vector<uint8_t> data;
+  for (uint32_t seg = first; seg <= current; ++seg) {
+    char name[16];
+    snprintf(name, sizeof(name), "/%08lu.log", (unsigned long)seg);
+    const std::string path = dir + name;
+    if (seg != current && fileSize(path) > 0) {
+      result.skipped++;
+      continue;
+    }
+    if (!client.readSegment(seg, data)) {
+      // The oldest segment may have been deleted since the listing
+      report(port, "segment %s unreadable", std::to_string(seg));
+      continue;
+    }
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f || fwrite(data.data(), 1, data.size(), f) != data.size()) {
+      report(port, "cannot write %s", path);
+      if (f) fclose(f);
+      return;
+    }
+    fclose(f);
+    result.segments++;
+    result.bytes += data.size();
+  }
+  result.seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  result.ok = true;
+  if (client.badFrames() > 0) {
+    report(port, "%s damaged frames skipped", std::to_string(client.badFrames()));
+  }
+}
+
+int main(int argc, char** argv) {
+  int baud = 115200;
+  std::string outDir = ".";
+  bool trace = false;
+  std::vector<std::string> ports;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+      baud = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      outDir = argv[++i];
+    } else if (!strcmp(argv[i], "--trace")) {
+      trace = true;
+    } else {
+      ports.push_back(argv[i]);
+    }
+  }
+  if (ports.empty()) {
+    fprintf(stderr, "usage: %s [-b baud] [-o dir] [--trace] port...\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<DeviceResult> results(ports.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < ports.size(); ++i) {
+    threads.emplace_back(pullDevice, ports[i], baud, outDir, trace, std::ref(results[i]));
+  }
+  for (std::thread& t : threads) t.join();
+
+  int failed = 0;
+  for (size_t i = 0; i < ports.size(); ++i) {
+    const DeviceResult& r = results[i];
+    if (!r.ok) {
+      failed++;
+      continue;
+    }
+    printf("%s: %u segments (%u unchanged), %zu bytes in %.1f s, %.0f B/s\n", ports[i].c_str(),
+           r.segments, r.skipped, r.bytes, r.seconds, r.seconds > 0 ? r.bytes / r.seconds : 0.0);
+  }
+  return failed ? 1 : 0;
+}
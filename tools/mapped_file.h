@@ -0,0 +1,58 @@
+#pragma once
+// Read-only memory mapping of a whole file (POSIX), shared by the host tools.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile {
+public:
+  MappedFile() {}
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& o) noexcept : _data(o._data), _size(o._size) {
+    o._data = nullptr;
+    o._size = 0;
+  }
+  ~MappedFile() { close(); }
+
+  bool open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      return false;
+    }
+    _size = size_t(st.st_size);
+    if (_size > 0) {
+      void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        _size = 0;
+        return false;
+      }
+      madvise(p, _size, MADV_SEQUENTIAL);
+      _data = static_cast<const uint8_t*>(p);
+    }
+    ::close(fd);
+    return true;
+  }
+
+  void close() {
+    if (_data) munmap(const_cast<uint8_t*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+  }
+
+  const uint8_t* data() const { return _data; }
+  size_t size() const { return _size; }
+
+private:
+  const uint8_t* _data = nullptr;
+  size_t _size = 0;
+};
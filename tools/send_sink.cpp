@@ -0,0 +1,107 @@
+/**
+ * @file send_sink.cpp
+ * @brief TCP sink for runSendModeBenchmark() (include/sim800_transparent.h).
+ *
+ * Accepts one connection at a time (the benchmark opens one per send mode),
+ * reads frames of [u32 little-endian length][bytes] and answers each with
+ * the same 4-byte length once every byte has arrived. The device times each
+ * payload up to that answer. One line per frame goes to stderr:
+ *
+ *   <peer> <length> B in <ms> ms
+ *
+ * Build (host):
+ *   g++ -O2 -std=c++17 tools/send_sink.cpp -o send_sink
+ *
+ * Usage:
+ *   send_sink <port> [bind-address]     (default bind 0.0.0.0)
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const uint32_t MAX_FRAME = 1 << 20;
+
+static bool readAll(int fd, uint8_t* buf, size_t len) {
+  size_t got = 0;
+  while (got < len) {
+    ssize_t n = recv(fd, buf + got, len - got, 0);
+    if (n <= 0) return false;
+    got += size_t(n);
+  }
+  return true;
+}
+
+static void serve(int fd, const char* peer) {
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  std::vector<uint8_t> buf;
+  for (;;) {
+    uint8_t header[4];
+    if (!readAll(fd, header, sizeof(header))) break;
+    auto t0 = std::chrono::steady_clock::now();
+    const uint32_t len = uint32_t(header[0]) | uint32_t(header[1]) << 8 |
+                         uint32_t(header[2]) << 16 | uint32_t(header[3]) << 24;
+    if (len > MAX_FRAME) {
+      fprintf(stderr, "%s: frame of %u B too large, closing\n", peer, len);
+      break;
+    }
+    buf.resize(len);
+    if (!readAll(fd, buf.data(), len)) break;
+    if (send(fd, header, sizeof(header), 0) != sizeof(header)) break;
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    fprintf(stderr, "%s %u B in %.0f ms\n", peer, len, ms);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <port> [bind-address]\n", argv[0]);
+    return 2;
+  }
+  const int port = atoi(argv[1]);
+  const char* bindAddr = argc > 2 ? argv[2] : "0.0.0.0";
+
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock < 0) {
+    perror("socket");
+    return 1;
+  }
+  int one = 1;
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(uint16_t(port));
+  if (inet_pton(AF_INET, bindAddr, &addr.sin_addr) != 1) {
+    fprintf(stderr, "bad bind address: %s\n", bindAddr);
+    return 2;
+  }
+  if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(sock, 1) < 0) {
+    perror("bind");
+    return 1;
+  }
+  fprintf(stderr, "listening on %s:%d\n", bindAddr, port);
+
+  for (;;) {
+    sockaddr_in peer;
+    socklen_t peerLen = sizeof(peer);
+    int fd = accept(sock, reinterpret_cast<sockaddr*>(&peer), &peerLen);
+    if (fd < 0) {
+      perror("accept");
+      continue;
+    }
+    char name[32];
+    inet_ntop(AF_INET, &peer.sin_addr, name, sizeof(name));
+    serve(fd, name);
+    close(fd);
+  }
+}
@@ -0,0 +1,351 @@
+/**
+ * @file tower_estimator.cpp
+ * @brief Estimates tower positions from survey logs with known positions.
+ *
+ * Reads survey log segments (survey_format.h) produced in survey mode,
+ * keeps the records that carry an observer position, and estimates one
+ * position per (MCC, MNC, LAC, CID):
+ *
+ *   1. RxLev-weighted centroid of all observer positions of the cell.
+ *   2. For cells with enough serving-cell timing advance ranges, a
+ *      linearised least-squares multilateration around that centroid.
+ *      The solution is kept when it is well conditioned and within GSM
+ *      range of the centroid.
+ *
+ * Both passes only need additive sums, so each worker thread aggregates
+ * into its own hash table over a share of the memory-mapped files; the
+ * tables are then split into shards by key and the shards merged in
+ * parallel. The result is written as a sorted tower_db.h file.
+ *
+ * Build (host):
+ *   g++ -O2 -std=c++17 -pthread -Iinclude tools/tower_estimator.cpp -o tower_estimator
+ *
+ * Usage:
+ *   tower_estimator [-j threads] [--csv] -o towers.bin segment.log...
+ */
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+#include "survey_format.h"
+#include "tower_db.h"
+
+static const double EARTH_RADIUS_M = 6371000.0;
+static const double TA_STEP_M = 553.5;          // one GSM timing advance unit
+static const double MAX_GSM_RANGE_M = 35000.0;
+static const uint32_t MIN_TA_OBSERVATIONS = 3;
+
+// Pass 1 sums: weighted centroid and spread.
+struct CentroidSums {
+  double w = 0, wLat = 0, wLng = 0, wLat2 = 0, wLng2 = 0;
+  uint32_t n = 0;
+  uint32_t nTa = 0;
+
+  void merge(const CentroidSums& o) {
+    w += o.w;
+    wLat += o.wLat;
+    wLng += o.wLng;
+    wLat2 += o.wLat2;
+    wLng2 += o.wLng2;
+    n += o.n;
+    nTa += o.nTa;
+  }
+};
+
+// Pass 2 sums: normal equations of 2x*Tx + 2y*Ty - c = x^2 + y^2 - r^2 in
+// metres around the centroid, unknowns (Tx, Ty, c = Tx^2 + Ty^2).
+struct RangeSums {
+  double a[3][3] = {{0}};
+  double b[3] = {0};
+  uint32_t n = 0;
+
+  void add(double x, double y, double r) {
+    const double row[3] = {2 * x, 2 * y, -1};
+    const double rhs = x * x + y * y - r * r;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) a[i][j] += row[i] * row[j];
+      b[i] += row[i] * rhs;
+    }
+    n++;
+  }
+
+  void merge(const RangeSums& o) {
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) a[i][j] += o.a[i][j];
+      b[i] += o.b[i];
+    }
+    n += o.n;
+  }
+};
+
+template <typename Sums>
+using SumTable = std::unordered_map<uint64_t, Sums>;
+
+struct Centroid {
+  double lat, lng;
+};
+
+static double rxlevWeight(uint8_t rxlev) {
+  // Linear received amplitude: stronger cells pull the centroid harder.
+  return std::pow(10.0, (rxlevToDbm(rxlev) + 113) / 20.0);
+}
+
+static void toLocal(double lat, double lng, const Centroid& ref, double& x, double& y) {
+  const double k = M_PI / 180.0 * EARTH_RADIUS_M;
+  x = (lng - ref.lng) * k * std::cos(ref.lat * M_PI / 180.0);
+  y = (lat - ref.lat) * k;
+}
+
+// Calls fn(record) for each positioned record of a mapped segment.
+template <typename Fn>
+static void forEachPositioned(const MappedFile& file, Fn fn) {
+  uint32_t segment;
+  if (!decodeSurveyHeader(file.data(), file.size(), segment)) return;
+  const uint8_t* p = file.data() + SURVEY_HEADER_SIZE;
+  const uint8_t* end = file.data() + file.size();
+  SurveyCodecState st;
+  SurveyRecord rec;
+  while (decodeSurveyRecord(st, p, end, rec)) {
+    if (rec.position.valid) fn(rec);
+  }
+}
+
+// Runs `work(thread, fileIndex)` over all files on `threads` workers.
+template <typename Work>
+static void parallelFiles(size_t files, unsigned threads, Work work) {
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; ++t) {
+    pool.emplace_back([&, t] {
+      for (size_t i; (i = next.fetch_add(1)) < files;) work(t, i);
+    });
+  }
+  for (std::thread& th : pool) th.join();
+}
+
+// Merges per-thread tables into shards by key. Every thread first splits its
+// own table into per-shard buckets, then each shard merges its buckets.
+template <typename Sums>
+static std::vector<SumTable<Sums>> mergeTables(std::vector<SumTable<Sums>>& local, unsigned threads) {
+  typedef std::vector<std::pair<uint64_t, Sums>> Bucket;
+  const size_t shards = size_t(threads) * 4;
+  std::vector<std::vector<Bucket>> buckets(local.size(), std::vector<Bucket>(shards));
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < local.size(); ++t) {
+    pool.emplace_back([&, t] {
+      for (const auto& kv : local[t]) {
+        buckets[t][std::hash<uint64_t>()(kv.first) % shards].push_back(kv);
+      }
+      SumTable<Sums>().swap(local[t]);
+    });
+  }
+  for (std::thread& th : pool) th.join();
+  pool.clear();
+
+  std::vector<SumTable<Sums>> out(shards);
+  std::atomic<size_t> next(0);
+  for (unsigned t = 0; t < threads; ++t) {
+    pool.emplace_back([&] {
+      for (size_t s; (s = next.fetch_add(1)) < shards;) {
+        for (std::vector<Bucket>& perThread : buckets) {
+          for (const auto& kv : perThread[s]) out[s][kv.first].merge(kv.second);
+          Bucket().swap(perThread[s]);
+        }
+      }
+    });
+  }
+  for (std::thread& th : pool) th.join();
+  local.clear();
+  return out;
+}
+
+// Solves the 3x3 system by Gaussian elimination with partial pivoting.
+static bool solve3(double a[3][3], double b[3], double x[3]) {
+  for (int c = 0; c < 3; ++c) {
+    int piv = c;
+    for (int r = c + 1; r < 3; ++r) {
+      if (std::fabs(a[r][c]) > std::fabs(a[piv][c])) piv = r;
+    }
+    if (std::fabs(a[piv][c]) < 1e-9) return false;
+    std::swap(a[c], a[piv]);
+    std::swap(b[c], b[piv]);
+    for (int r = c + 1; r < 3; ++r) {
+      double f = a[r][c] / a[c][c];
+      for (int k = c; k < 3; ++k) a[r][k] -= f * a[c][k];
+      b[r] -= f * b[c];
+    }
+  }
+  for (int r = 2; r >= 0; --r) {
+    double s = b[r];
+    for (int k = r + 1; k < 3; ++k) s -= a[r][k] * x[k];
+    x[r] = s / a[r][r];
+  }
+  return true;
+}
+
+static void usage(const char* argv0) {
+  fprintf(stderr, "usage: %s [-j threads] [--csv] -o towers.bin segment.log...\n", argv0);
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  const char* outPath = nullptr;
+  bool csv = false;
+  std::vector<const char*> inputs;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+      threads = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      outPath = argv[++i];
+    } else if (!strcmp(argv[i], "--csv")) {
+      csv = true;
+    } else {
+      inputs.push_back(argv[i]);
+    }
+  }
+  if (!outPath || inputs.empty()) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<MappedFile> files(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (!files[i].open(inputs[i])) {
+      fprintf(stderr, "cannot map %s\n", inputs[i]);
+      return 1;
+    }
+  }
+
+  // Pass 1: weighted centroids.
+  std::vector<SumTable<CentroidSums>> local1(threads);
+  std::vector<uint64_t> observations(threads, 0);
+  parallelFiles(files.size(), threads, [&](unsigned t, size_t f) {
+    SumTable<CentroidSums>& table = local1[t];
+    forEachPositioned(files[f], [&](const SurveyRecord& rec) {
+      const CellSnapshot& snap = rec.snapshot;
+      for (uint8_t i = 0; i < snap.count; ++i) {
+        CentroidSums& s = table[cellKey(snap.cells[i])];
+        const double w = rxlevWeight(snap.cells[i].rxlev);
+        s.w += w;
+        s.wLat += w * rec.position.lat;
+        s.wLng += w * rec.position.lng;
+        s.wLat2 += w * rec.position.lat * rec.position.lat;
+        s.wLng2 += w * rec.position.lng * rec.position.lng;
+        s.n++;
+        if (i == 0 && snap.cells[i].ta != CELL_TA_UNKNOWN) s.nTa++;
+      }
+      observations[t] += snap.count;
+    });
+  });
+  std::vector<SumTable<CentroidSums>> shards1 = mergeTables(local1, threads);
+
+  std::unordered_map<uint64_t, Centroid> centroids;
+  size_t towers = 0;
+  for (const auto& shard : shards1) towers += shard.size();
+  centroids.reserve(towers);
+  for (const auto& shard : shards1) {
+    for (const auto& kv : shard) {
+      const CentroidSums& s = kv.second;
+      centroids[kv.first] = Centroid{s.wLat / s.w, s.wLng / s.w};
+    }
+  }
+
+  // Pass 2: timing-advance ranges around each centroid (serving cells only).
+  std::vector<SumTable<RangeSums>> local2(threads);
+  parallelFiles(files.size(), threads, [&](unsigned t, size_t f) {
+    SumTable<RangeSums>& table = local2[t];
+    forEachPositioned(files[f], [&](const SurveyRecord& rec) {
+      const CellRecord& serving = rec.snapshot.cells[0];
+      if (rec.snapshot.count == 0 || serving.ta == CELL_TA_UNKNOWN) return;
+      const Centroid& ref = centroids.at(cellKey(serving));
+      double x, y;
+      toLocal(rec.position.lat, rec.position.lng, ref, x, y);
+      table[cellKey(serving)].add(x, y, (serving.ta + 0.5) * TA_STEP_M);
+    });
+  });
+  std::vector<SumTable<RangeSums>> shards2 = mergeTables(local2, threads);
+  std::unordered_map<uint64_t, RangeSums> ranges;
+  for (auto& shard : shards2) {
+    for (auto& kv : shard) ranges.emplace(kv.first, kv.second);
+  }
+
+  // Solve and collect.
+  std::vector<TowerRecord> out;
+  out.reserve(towers);
+  size_t leastSquares = 0;
+  for (const auto& shard : shards1) {
+    for (const auto& kv : shard) {
+      const CentroidSums& s = kv.second;
+      Centroid c = centroids[kv.first];
+      TowerRecord r;
+      r.key = kv.first;
+      r.observations = s.n;
+      r.method = TOWER_CENTROID;
+
+      auto it = ranges.find(kv.first);
+      if (it != ranges.end() && it->second.n >= MIN_TA_OBSERVATIONS) {
+        RangeSums rs = it->second;
+        double sol[3];
+        if (solve3(rs.a, rs.b, sol) && std::hypot(sol[0], sol[1]) < MAX_GSM_RANGE_M) {
+          const double k = M_PI / 180.0 * EARTH_RADIUS_M;
+          c.lat += sol[1] / k;
+          c.lng += sol[0] / (k * std::cos(c.lat * M_PI / 180.0));
+          r.method = TOWER_LEAST_SQUARES;
+          leastSquares++;
+        }
+      }
+
+      // RMS distance of observers from the centroid, in metres.
+      const double mLat = s.wLat / s.w, mLng = s.wLng / s.w;
+      const double varLat = std::max(0.0, s.wLat2 / s.w - mLat * mLat);
+      const double varLng = std::max(0.0, s.wLng2 / s.w - mLng * mLng);
+      const double k = M_PI / 180.0 * EARTH_RADIUS_M;
+      const double spread =
+          std::sqrt(varLat * k * k + varLng * std::pow(k * std::cos(mLat * M_PI / 180.0), 2));
+      r.spread = uint16_t(std::min(spread, 65535.0));
+      r.lat7 = int32_t(std::lround(c.lat * 1e7));
+      r.lng7 = int32_t(std::lround(c.lng * 1e7));
+      out.push_back(r);
+    }
+  }
+  std::sort(out.begin(), out.end(),
+            [](const TowerRecord& a, const TowerRecord& b) { return a.key < b.key; });
+
+  FILE* fp = fopen(outPath, "wb");
+  if (!fp) {
+    perror(outPath);
+    return 1;
+  }
+  if (csv) {
+    fprintf(fp, "mcc,mnc,lac,cid,lat,lng,observations,spread_m,method\n");
+    for (const TowerRecord& r : out) {
+      fprintf(fp, "%u,%u,%u,%u,%.7f,%.7f,%u,%u,%s\n", unsigned(r.key >> 54),
+              unsigned((r.key >> 44) & 0x3FF), unsigned((r.key >> 28) & 0xFFFF),
+              unsigned(r.key & 0x0FFFFFFF), r.lat7 / 1e7, r.lng7 / 1e7, r.observations, r.spread,
+              r.method == TOWER_LEAST_SQUARES ? "lsq" : "centroid");
+    }
+  } else {
+    uint8_t buf[TOWER_DB_RECORD_SIZE];
+    encodeTowerHeader(buf, uint32_t(out.size()));
+    fwrite(buf, 1, TOWER_DB_HEADER_SIZE, fp);
+    for (const TowerRecord& r : out) {
+      encodeTowerRecord(buf, r);
+      fwrite(buf, 1, TOWER_DB_RECORD_SIZE, fp);
+    }
+  }
+  fclose(fp);
+
+  uint64_t total = 0;
+  for (uint64_t n : observations) total += n;
+  fprintf(stderr, "%zu files, %llu observations, %zu towers (%zu by least squares)\n",
+          files.size(), (unsigned long long)total, out.size(), leastSquares);
+  return 0;
+}
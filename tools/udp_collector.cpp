@@ -0,0 +1,104 @@
+/**
+ * @file udp_collector.cpp
+ * @brief Reference collector for the UDP fix report channel.
+ *
+ * Receives the 32-byte datagrams sent by UdpReporter, checks their HMAC with
+ * the shared key, acks them and prints one CSV line per new fix:
+ *
+ *   device,session,seq,timestamp,lat,lng,accuracy
+ *
+ * Retransmissions of an already acked fix are acked again but not printed.
+ *
+ * Build (host):
+ *   g++ -O2 -std=c++17 -Iinclude tools/udp_collector.cpp -o udp_collector
+ *
+ * Usage:
+ *   udp_collector <port> <psk> [bind-address]     (default bind 127.0.0.1)
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "fix_datagram.h"
+
+// Highest sequence number seen per (device, session).
+typedef std::pair<uint32_t, uint16_t> SessionKey;
+
+static bool isNewer(uint16_t seq, uint16_t last) {
+  return int16_t(seq - last) > 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <port> <psk> [bind-address]\n", argv[0]);
+    return 2;
+  }
+  const int port = atoi(argv[1]);
+  const std::string psk = argv[2];
+  const char* bindAddr = argc > 3 ? argv[3] : "127.0.0.1";
+
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0) {
+    perror("socket");
+    return 1;
+  }
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(uint16_t(port));
+  if (inet_pton(AF_INET, bindAddr, &addr.sin_addr) != 1) {
+    fprintf(stderr, "bad bind address: %s\n", bindAddr);
+    return 2;
+  }
+  if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    perror("bind");
+    return 1;
+  }
+  fprintf(stderr, "listening on %s:%d\n", bindAddr, port);
+  printf("device,session,seq,timestamp,lat,lng,accuracy\n");
+  fflush(stdout);
+
+  const uint8_t* key = reinterpret_cast<const uint8_t*>(psk.data());
+  std::map<SessionKey, uint16_t> lastSeq;
+  unsigned long rejected = 0;
+
+  for (;;) {
+    uint8_t buf[512];
+    sockaddr_in peer;
+    socklen_t peerLen = sizeof(peer);
+    ssize_t n = recvfrom(sock, buf, sizeof(buf), 0, reinterpret_cast<sockaddr*>(&peer), &peerLen);
+    if (n < 0) {
+      perror("recvfrom");
+      continue;
+    }
+
+    DatagramHeader hdr;
+    LocationFix fix;
+    if (!decodeFixDatagram(buf, size_t(n), key, psk.size(), hdr, fix)) {
+      ++rejected;
+      fprintf(stderr, "rejected %zd-byte datagram (%lu so far)\n", n, rejected);
+      continue;
+    }
+
+    uint8_t ack[ACK_DATAGRAM_SIZE];
+    encodeAckDatagram(ack, hdr, key, psk.size());
+    sendto(sock, ack, sizeof(ack), 0, reinterpret_cast<sockaddr*>(&peer), peerLen);
+
+    SessionKey sk(hdr.deviceId, hdr.session);
+    auto it = lastSeq.find(sk);
+    if (it != lastSeq.end() && !isNewer(hdr.seq, it->second)) continue;  // retransmission
+    lastSeq[sk] = hdr.seq;
+
+    printf("%u,%u,%u,%u,%.7f,%.7f,%.0f\n", hdr.deviceId, hdr.session, hdr.seq, fix.timestamp,
+           fix.lat, fix.lng, fix.accuracy);
+    fflush(stdout);
+  }
+}